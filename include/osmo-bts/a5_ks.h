@@ -0,0 +1,106 @@
+#pragma once
+
+/* Cache of A5 keystreams for ciphered logical channels */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <osmocom/core/bits.h>
+
+/* Number of (FN tagged) entries, must be a power of two.  The frames
+ * generated at once on a miss (4 of a logical channel, at most 26 frames
+ * apart for SACCH/T) map to distinct entries, and an entry survives the
+ * 16 frames until it is overwritten, which is more than the delay from
+ * the (advanced) Downlink scheduling until the Uplink burst arrives. */
+#define A5_KS_CACHE_SIZE	16
+/* Keystream bits per burst (2 x 57) */
+#define A5_KS_BURST_BITS	114
+/* Tag of an entry, which holds no keystream */
+#define A5_KS_FN_INVALID	UINT32_MAX
+
+enum a5_ks_dir {
+	A5_KS_DL,
+	A5_KS_UL,
+	_A5_KS_DIR_NUM
+};
+
+/*! A5 algorithm and key of one direction */
+struct a5_ks_cipher {
+	int algo;		/* A5/x (0 means no ciphering) */
+	const uint8_t *key;
+	unsigned int key_len;
+};
+
+struct a5_ks_entry {
+	/*! TDMA frame number the keystream was generated for (per direction) */
+	uint32_t fn[_A5_KS_DIR_NUM];
+	ubit_t ks[_A5_KS_DIR_NUM][A5_KS_BURST_BITS];
+};
+
+struct a5_ks_cache {
+	struct a5_ks_entry ent[A5_KS_CACHE_SIZE];
+	/*! number of osmo_a5() invocations */
+	unsigned int a5_calls;
+};
+
+void a5_ks_cache_reset(struct a5_ks_cache *c);
+void a5_ks_cache_gen(struct a5_ks_cache *c, uint32_t fn,
+		     const struct a5_ks_cipher *dl,
+		     const struct a5_ks_cipher *ul);
+
+/*! Look up the keystream of the given direction and TDMA frame number.
+ *  \returns pointer to A5_KS_BURST_BITS unpacked bits; NULL if not cached. */
+static inline const ubit_t *a5_ks_cache_get(const struct a5_ks_cache *c,
+					    enum a5_ks_dir dir, uint32_t fn)
+{
+	const struct a5_ks_entry *e = &c->ent[fn % A5_KS_CACHE_SIZE];
+
+	if (e->fn[dir] != fn)
+		return NULL;
+	return e->ks[dir];
+}
+
+/*! XOR unpacked bits with the keystream, a machine word at a time */
+static inline void a5_ks_xor_ubits(ubit_t *bits, const ubit_t *ks, unsigned int len)
+{
+	unsigned int i = 0;
+
+	for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+		uint64_t a, b;
+
+		memcpy(&a, &bits[i], sizeof(a));
+		memcpy(&b, &ks[i], sizeof(b));
+		a ^= b;
+		memcpy(&bits[i], &a, sizeof(a));
+	}
+
+	for (; i < len; i++)
+		bits[i] ^= ks[i];
+}
+
+/*! Flip the sign of soft-bits where the keystream bit is 1 (branch-free) */
+static inline void a5_ks_flip_sbits(sbit_t *bits, const ubit_t *ks, unsigned int len)
+{
+	unsigned int i;
+
+	for (i = 0; i < len; i++) {
+		/* mask is 0x00 or 0xff, so (x ^ mask) - mask is either x or -x */
+		const int8_t mask = -(int8_t) ks[i];
+		bits[i] = (bits[i] ^ mask) - mask;
+	}
+}
+
+/*! Encrypt a normal burst (148 unpacked bits) using the given keystream */
+static inline void a5_ks_encrypt_burst(ubit_t *burst, const ubit_t *ks)
+{
+	a5_ks_xor_ubits(&burst[3], &ks[0], 57);
+	a5_ks_xor_ubits(&burst[88], &ks[57], 57);
+}
+
+/*! Decrypt a normal burst (148 soft-bits) using the given keystream */
+static inline void a5_ks_decrypt_burst(sbit_t *burst, const ubit_t *ks)
+{
+	a5_ks_flip_sbits(&burst[3], &ks[0], 57);
+	a5_ks_flip_sbits(&burst[88], &ks[57], 57);
+}
@@ -22,6 +22,7 @@ enum {
 	BTS_CTR_PAGING_DROP_PS,
 	BTS_CTR_PAGING_SENT,
 	BTS_CTR_PAGING_CONG,
+	BTS_CTR_PAGING_BLOCKS,
 	BTS_CTR_RACH_RCVD,
 	BTS_CTR_RACH_DROP,
 	BTS_CTR_RACH_HO,
@@ -40,6 +41,17 @@ enum {
 	BTS_CTR_RTP_RX_DROP_V110_DEC,
 	BTS_CTR_RTP_TX_TOTAL,
 	BTS_CTR_RTP_TX_MARKER,
+
+	BTS_CTR_OSMUX_RX_DGRAMS,
+	BTS_CTR_OSMUX_RX_SYSCALLS,
+	BTS_CTR_OSMUX_RX_POOL_EXHAUSTED,
+	BTS_CTR_OSMUX_TX_DGRAMS,
+	BTS_CTR_OSMUX_TX_SYSCALLS,
+
+	BTS_CTR_PCU_TX_PRIMS,
+	BTS_CTR_PCU_TX_WRITES,
+	BTS_CTR_PCU_RX_PRIMS,
+	BTS_CTR_PCU_RX_READS,
 };
 
 /* Used by OML layer for BTS Attribute reporting */
@@ -152,6 +164,13 @@ struct bsc_oml_host {
 
 #define BTS_PCU_SOCK_WQUEUE_LEN_DEFAULT 100
 
+/* BCCH Norm schedule (3GPP TS 05.02 6.3.1.3): the SI types sent for each TC,
+ * sent in turn if there are several.  See bts_sysinfo_sched_update(). */
+struct bts_bcch_sched {
+	uint8_t si[8][4];
+	uint8_t num[8];
+};
+
 /* One BTS */
 struct gsm_bts {
 	/* list header in g_bts_sm->bts_list */
@@ -213,6 +232,8 @@ struct gsm_bts {
 	uint8_t si2q_count; /* si2q_index for the last (highest indexed) individual SI2quater message */
 	/* buffers where we put the pre-computed SI */
 	sysinfo_buf_t si_buf[_MAX_SYSINFO_TYPE][SI2Q_MAX_NUM];
+	/* the SACCH filling of si_buf, as referenced by the lchans */
+	struct gsm_sacch_si *sacch_si[_MAX_SYSINFO_TYPE];
 	/* offsets used while generating SI2quater */
 	size_t e_offset;
 	size_t u_offset;
@@ -335,6 +356,7 @@ struct gsm_bts {
 	} support;
 	struct {
 		uint8_t tc4_ctr;
+		struct bts_bcch_sched sched;
 	} si;
 	struct gsm_time gsm_time;
 	/* frame number statistics (FN in PH-RTS.ind vs. PH-DATA.ind */
@@ -434,6 +456,8 @@ enum ccch_msgt {
 int bts_ccch_copy_msg(struct gsm_bts *bts, uint8_t *out_buf, struct gsm_time *gt, enum ccch_msgt ccch);
 int bts_supports_cipher(struct gsm_bts *bts, int rsl_cipher);
 uint8_t *bts_sysinfo_get(struct gsm_bts *bts, const struct gsm_time *g_time);
+void bts_sysinfo_sched_build(struct bts_bcch_sched *sched, uint32_t si_valid, bool pcu_connected);
+void bts_sysinfo_sched_update(struct gsm_bts *bts);
 void regenerate_si3_restoctets(struct gsm_bts *bts);
 void regenerate_si4_restoctets(struct gsm_bts *bts);
 int get_si4_ro_offset(const uint8_t *si4_buf);
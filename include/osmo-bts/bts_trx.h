@@ -51,6 +51,27 @@ struct gsm_bts_trx {
 	} support;
 
 	struct gsm_bts_trx_ts ts[TRX_NR_TS];
+
+	/* L1 scheduler state, maintained by trx_sched_set_{pchan,lchan}() */
+	struct {
+		/* timeslots (1 << tn) with a multiframe layout configured */
+		uint8_t mf_ts;
+		/* timeslots (1 << tn) with at least one active logical channel
+		 * on either the primary or the shadow (VAMOS) timeslot */
+		uint8_t active_ts;
+	} l1sched;
+
+	/* chan_nr to lchan lookup tables, see gsm_bts_trx_chan_nr_map_update() */
+	struct {
+		/* L1SAP chan_nr, see get_lchan_by_chan_nr() */
+		struct gsm_lchan *l1sap[256];
+		/* RSL chan_nr, see rsl_lchan_lookup() */
+		struct {
+			struct gsm_lchan *lchan;
+			/* (1 << pchan) for the pchan of the timeslot matching the chan_nr */
+			uint32_t pchan_mask;
+		} rsl[256];
+	} chan_nr_map;
 };
 
 static inline struct gsm_bts_trx *gsm_bts_bb_trx_get_trx(struct gsm_bts_bb_trx *bb_transc) {
@@ -0,0 +1,117 @@
+#pragma once
+
+/* Precomputed frequency hopping routing tables */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <osmocom/core/linuxlist.h>
+
+#include <osmo-bts/gsm_data.h>
+
+/* The hopping sequence (for HSN != 0) depends on T1 mod 64, T2 and T3 only */
+#define FH_SEQ_PERIOD	(64 * 26 * 51)
+
+struct fh_route_cfg;
+
+/*! Hopping timeslots on the same TN sharing the same HSN and MA */
+struct fh_route_group {
+	struct llist_head list;
+	uint8_t hsn;
+	uint8_t ma_len;
+	uint16_t ma[64];
+	/*! MAI sequence (without MAIO) for the whole period, NULL if HSN is 0 */
+	const uint8_t *seq;
+	/*! MAI -> TRX transmitting/receiving on that ARFCN (or NULL) */
+	struct gsm_bts_trx *mai_trx[64];
+	/*! MAIO -> TRX owning the timeslot with that MAIO (or NULL) */
+	struct gsm_bts_trx *maio_trx[64];
+	/*! TRX number -> MAI of its ARFCN (or -1) */
+	int8_t trx_mai[256];
+};
+
+/*! Routing state of a single (logical) timeslot */
+struct fh_route_ts {
+	/*! NULL if the timeslot is not hopping */
+	const struct fh_route_group *grp;
+	uint8_t maio;
+};
+
+/*! Routing tables of a BTS */
+struct fh_route {
+	/*! cached MAI sequences (struct fh_route_seq), per (HSN, MA length) */
+	struct llist_head seq_list;
+	/*! talloc context of the groups below, freed on each rebuild */
+	void *tables;
+	/*! groups (struct fh_route_group) for each TN */
+	struct llist_head groups[TRX_NR_TS];
+	/*! routing state for each TRX/TS, indexed by (trx->nr * TRX_NR_TS + tn) */
+	struct fh_route_ts *ts;
+	unsigned int num_trx;
+	/*! hopping parameters the tables were built from, for each TRX */
+	struct fh_route_cfg *cfg;
+	/*! number of times the tables have been rebuilt */
+	unsigned int rebuilds;
+};
+
+struct fh_route *fh_route_alloc(void *ctx);
+bool fh_route_changed(const struct fh_route *fr, const struct gsm_bts *bts);
+int fh_route_rebuild(struct fh_route *fr, const struct gsm_bts *bts);
+
+static inline uint8_t fh_route_mai(const struct fh_route_group *grp, uint8_t maio, uint32_t fn)
+{
+	/* HSN 0 is a cyclic sequence over the whole hyperframe */
+	if (grp->seq == NULL)
+		return (fn + maio) % grp->ma_len;
+	return (grp->seq[fn % FH_SEQ_PERIOD] + maio) % grp->ma_len;
+}
+
+/*! Find the TRX (RF carrier) transmitting the burst of a hopping timeslot.
+ *  \param[in] fr routing tables of the BTS.
+ *  \param[in] ts the (logical) timeslot the burst belongs to.
+ *  \param[in] fn TDMA frame number of the burst.
+ *  \returns the TRX on success; NULL if there is no such carrier. */
+static inline struct gsm_bts_trx *fh_route_dl(const struct fh_route *fr,
+					      const struct gsm_bts_trx_ts *ts,
+					      uint32_t fn)
+{
+	const struct fh_route_ts *rts;
+
+	if (ts->trx->nr >= fr->num_trx)
+		return NULL;
+	rts = &fr->ts[ts->trx->nr * TRX_NR_TS + ts->nr];
+	if (rts->grp == NULL)
+		return NULL;
+
+	return rts->grp->mai_trx[fh_route_mai(rts->grp, rts->maio, fn)];
+}
+
+/*! Find the TRX (logical timeslot owner) of a burst received on a carrier.
+ *  \param[in] fr routing tables of the BTS.
+ *  \param[in] src_trx the TRX (RF carrier) the burst was received on.
+ *  \param[in] tn timeslot number of the burst.
+ *  \param[in] fn TDMA frame number of the burst.
+ *  \returns the TRX on success; NULL if no hopping timeslot matches. */
+static inline struct gsm_bts_trx *fh_route_ul(const struct fh_route *fr,
+					      const struct gsm_bts_trx *src_trx,
+					      uint8_t tn, uint32_t fn)
+{
+	const struct fh_route_group *grp;
+
+	/* Usually there is only one group per TN */
+	llist_for_each_entry(grp, &fr->groups[tn], list) {
+		int mai = grp->trx_mai[src_trx->nr];
+		struct gsm_bts_trx *trx;
+		uint8_t maio;
+
+		if (mai < 0)
+			continue;
+
+		/* MAI = (S + MAIO) mod N, so MAIO = (MAI - S) mod N */
+		maio = (mai + grp->ma_len - fh_route_mai(grp, 0, fn)) % grp->ma_len;
+		if ((trx = grp->maio_trx[maio]) != NULL)
+			return trx;
+	}
+
+	return NULL;
+}
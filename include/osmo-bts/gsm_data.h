@@ -150,9 +150,6 @@ struct gsm_bts_trx_ts {
 		uint8_t arfcn_num;
 	} hopping;
 
-	/* Transceiver "cache" for frequency hopping */
-	const struct gsm_bts_trx *fh_trx_list[64];
-
 	/* Implementation specific structure(s) */
 	void *priv;
 
@@ -224,6 +221,7 @@ char *gsm_ts_and_pchan_name(const struct gsm_bts_trx_ts *ts);
 
 struct gsm_lchan *rsl_lchan_lookup(struct gsm_bts_trx *trx, uint8_t chan_nr,
 				   int *rc);
+void gsm_bts_trx_chan_nr_map_update(struct gsm_bts_trx *trx);
 
 enum gsm_phys_chan_config ts_pchan(const struct gsm_bts_trx_ts *ts);
 uint8_t ts_subslots(const struct gsm_bts_trx_ts *ts);
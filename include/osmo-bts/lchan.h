@@ -136,6 +136,13 @@ struct lchan_ta_ctrl_state {
 	uint8_t current;
 };
 
+/* An immutable SACCH filling message (L2 UI header + L3), shared by
+ * reference between the BTS and all lchans using it */
+struct gsm_sacch_si {
+	unsigned int refcnt;
+	sysinfo_buf_t buf;
+};
+
 struct gsm_lchan {
 	/* The TS that we're part of */
 	struct gsm_bts_trx_ts *ts;
@@ -213,14 +220,14 @@ struct gsm_lchan {
 	struct llist_head dl_tch_queue;
 	unsigned int dl_tch_queue_len;
 	struct {
-		/* bitmask of all SI that are present/valid in si_buf */
+		/* bitmask of all SI that are present/valid in msg[] */
 		uint32_t valid;
 		/* bitmask of all SI that do not mirror the BTS-global SI values */
 		uint32_t overridden;
 		uint32_t last;
-		/* buffers where we put the pre-computed SI:
-		   SI2Q_MAX_NUM is the max number of SI2quater messages (see 3GPP TS 44.018) */
-		sysinfo_buf_t buf[_MAX_SYSINFO_TYPE][SI2Q_MAX_NUM];
+		/* the pre-computed SI, one reference each (see lchan_sacch_si_set()):
+		   the BTS-global ones, unless overridden for this lchan */
+		struct gsm_sacch_si *msg[_MAX_SYSINFO_TYPE];
 	} si;
 	struct {
 		uint8_t flags;
@@ -378,7 +385,7 @@ static inline const char *lchan_ciph_state_name(uint8_t state)
 	return get_value_string(lchan_ciph_state_names, state);
 }
 
-#define GSM_LCHAN_SI(lchan, i) (void *)((lchan)->si.buf[i][0])
+#define GSM_LCHAN_SI(lchan, i) (void *)((lchan)->si.msg[i]->buf)
 
 void gsm_lchan_init(struct gsm_lchan *lchan, struct gsm_bts_trx_ts *ts, unsigned int lchan_nr);
 void gsm_lchan_name_update(struct gsm_lchan *lchan);
@@ -394,6 +401,12 @@ static inline char *gsm_lchan_name(const struct gsm_lchan *lchan)
 
 uint8_t *lchan_sacch_get(struct gsm_lchan *lchan);
 
+struct gsm_sacch_si *sacch_si_alloc(void *ctx);
+struct gsm_sacch_si *sacch_si_get(struct gsm_sacch_si *si);
+void sacch_si_put(struct gsm_sacch_si *si);
+void lchan_sacch_si_set(struct gsm_lchan *lchan, uint8_t osmo_si, struct gsm_sacch_si *si);
+void lchan_sacch_si_clear(struct gsm_lchan *lchan);
+
 uint8_t gsm_lchan2chan_nr(const struct gsm_lchan *lchan);
 uint8_t gsm_lchan2chan_nr_rsl(const struct gsm_lchan *lchan);
 uint8_t gsm_lchan_as_pchan2chan_nr(const struct gsm_lchan *lchan,
@@ -0,0 +1,43 @@
+#pragma once
+
+/* Pools of preallocated msgb for the L1SAP and PHY primitives */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <osmocom/core/msgb.h>
+
+/* Largest L2 payload of a msgb from BTS_MSGB_POOL_L1SAP */
+#define BTS_MSGB_POOL_L1SAP_L2_LEN	256
+/* Largest L2 payload of a msgb from BTS_MSGB_POOL_RTP */
+#define BTS_MSGB_POOL_RTP_L2_LEN	512
+/* Buffer size of a msgb from BTS_MSGB_POOL_PHY */
+#define BTS_MSGB_POOL_PHY_SIZE		1536
+
+enum bts_msgb_pool_class {
+	/*! L1SAP primitives with (short) L2 data, see l1sap_msgb_alloc() */
+	BTS_MSGB_POOL_L1SAP,
+	/*! L1SAP primitives with an RTP payload */
+	BTS_MSGB_POOL_RTP,
+	/*! primitives of the PHY (l1p_msgb_alloc(), _sched_msgb_alloc()) */
+	BTS_MSGB_POOL_PHY,
+	_NUM_BTS_MSGB_POOL
+};
+
+struct bts_msgb_pool_stats {
+	/*! allocations served from / not served from the free list */
+	unsigned int hits;
+	unsigned int misses;
+	/*! misses served by msgb_alloc_headroom(), outside of the pool */
+	unsigned int fallbacks;
+	/*! msgb owned by the pool, and how many of them are free */
+	unsigned int num;
+	unsigned int num_free;
+};
+
+void bts_msgb_pool_init(void *ctx);
+void bts_msgb_pool_release(void);
+struct msgb *bts_msgb_pool_alloc(enum bts_msgb_pool_class cls, uint16_t size,
+				 uint16_t headroom, const char *name);
+void bts_msgb_pool_set_no_alloc(bool no_alloc);
+void bts_msgb_pool_get_stats(enum bts_msgb_pool_class cls, struct bts_msgb_pool_stats *st);
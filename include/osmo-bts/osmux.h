@@ -8,6 +8,15 @@
 struct gsm_bts;
 struct gsm_lchan;
 
+/* Number of buckets of the osmux_handle hash, must be a power of 2 */
+#define OSMUX_HANDLE_HASH_SIZE 16
+/* Number of preallocated receive buffers, i.e. datagrams per recvmmsg() */
+#define OSMUX_RX_POOL_SIZE 32
+/* Max number of batches queued for a single sendmmsg() */
+#define OSMUX_TX_QUEUE_SIZE 32
+/* Size of a receive buffer, larger than any Osmux batch */
+#define OSMUX_RX_BUF_SIZE 4096
+
 enum osmux_usage {
 	OSMUX_USAGE_OFF = 0,
 	OSMUX_USAGE_ON = 1,
@@ -22,7 +31,20 @@ struct osmux_state {
 	uint8_t batch_factor;
 	unsigned int batch_size;
 	bool dummy_padding;
-	struct llist_head osmux_handle_list;
+	/* struct osmux_handle, hashed by remote address, see osmux_handle_hash() */
+	struct llist_head osmux_handle_hash[OSMUX_HANDLE_HASH_SIZE];
+	/* Connected lchans indexed by their local CID. Local CIDs are unique, the
+	 * remote address is checked against the lchan's osmux_handle on lookup. */
+	struct gsm_lchan *lchan_by_cid[OSMUX_CID_MAX + 1];
+	/* Receive buffers, allocated once in bts_osmux_open() and reused */
+	struct msgb *rx_pool[OSMUX_RX_POOL_SIZE];
+	/* Batches delivered during this event loop iteration, sent with a
+	 * single sendmmsg() once the socket becomes writable */
+	struct {
+		struct msgb *msg;
+		struct osmo_sockaddr rem_addr;
+	} tx_queue[OSMUX_TX_QUEUE_SIZE];
+	unsigned int tx_queue_len;
 };
 
 /* Contains a "struct osmux_in_handle" towards a specific peer (remote IPaddr+port) */
@@ -26,6 +26,7 @@ int pcu_tx_pag_req(const uint8_t *identity_lv, uint8_t chan_needed);
 int pcu_tx_data_cnf(uint32_t msg_id, uint8_t sapi);
 int pcu_tx_susp_req(struct gsm_lchan *lchan, uint32_t tlli, const uint8_t *ra_id, uint8_t cause);
 int pcu_sock_send(struct msgb *msg);
+void pcu_sock_flush(void);
 
 int pcu_sock_init(const char *path, int qlength_max);
 void pcu_sock_exit(void);
@@ -7,6 +7,12 @@
 
 #define PCU_SOCK_DEFAULT	"/tmp/pcu_bts"
 
+/* The compact, batch and shm modes (see enum gsm_pcu_if_text_type) do not
+ * change the version: they are offered by flags in INFO_IND, which a PCU not
+ * knowing them ignores, and only used once the PCU asked for them with a
+ * TXT_IND.  A PCU must not ask unless the BTS set the flag, as a BTS not
+ * knowing the mode rejects the TXT_IND.  Until then, and if the PCU never
+ * asks, all primitives are exactly as in this version. */
 #define PCU_IF_VERSION		0x0c
 #define TXT_MAX_LEN	128
 
@@ -25,6 +31,7 @@
 #define PCU_IF_MSG_PAG_REQ	0x60	/* paging request */
 #define PCU_IF_MSG_TXT_IND	0x70	/* Text indication for BTS */
 #define PCU_IF_MSG_CONTAINER	0x80	/* Transparent container message */
+#define PCU_IF_MSG_BATCH	0x90	/* Batch of compact primitives */
 
 /* sapi */
 #define PCU_IF_SAPI_RACH	0x01	/* channel request on CCCH */
@@ -38,6 +45,9 @@
 /* flags */
 #define PCU_IF_FLAG_ACTIVE	(1 << 0)/* BTS is active */
 #define PCU_IF_FLAG_DIRECT_PHY	(1 << 1)/* access PHY directly via dedicated hardware support */
+#define PCU_IF_FLAG_COMPACT	(1 << 2)/* BTS supports compact primitives, see PCU_COMPACT_MODE */
+#define PCU_IF_FLAG_BATCH	(1 << 3)/* BTS supports batches of primitives, see PCU_BATCH_MODE */
+#define PCU_IF_FLAG_SHM		(1 << 4)/* BTS supports shared memory rings, see PCU_SHM_MODE */
 #define PCU_IF_FLAG_CS1		(1 << 16)
 #define PCU_IF_FLAG_CS2		(1 << 17)
 #define PCU_IF_FLAG_CS3		(1 << 18)
@@ -74,6 +84,25 @@ enum gsm_pcuif_bts_model {
 enum gsm_pcu_if_text_type {
 	PCU_VERSION,
 	PCU_OML_ALERT,
+	/* PCU asks for compact primitives (if the BTS indicates PCU_IF_FLAG_COMPACT):
+	 * from now on, each primitive ends after the union member it uses, in both
+	 * directions, instead of being sizeof(struct gsm_pcu_if).  The text of a
+	 * TXT_IND may end after its terminating NUL. */
+	PCU_COMPACT_MODE,
+	/* PCU asks for batches of primitives (if the BTS indicates PCU_IF_FLAG_BATCH):
+	 * implies PCU_COMPACT_MODE, and from now on the BTS sends the primitives of a
+	 * MAC block in PCU_IF_MSG_BATCH datagrams.  The PCU may send batches, e.g. of
+	 * its DATA_REQs, in any mode. */
+	PCU_BATCH_MODE,
+	/* PCU asks for shared memory rings (if the BTS indicates PCU_IF_FLAG_SHM):
+	 * the BTS answers with a TXT_IND of the same type, carrying the shared
+	 * memory object and two eventfds (SCM_RIGHTS).  From then on, the BTS
+	 * sends each primitive (in the form negotiated so far) as a ring record.
+	 * The PCU may use either, and both keep the socket open: it tells them
+	 * when the peer goes away.  A TXT_IND without the file descriptors means
+	 * that the BTS could not set up the rings: both keep using the socket.
+	 * If the BTS fails to hand over the rings, it closes the connection. */
+	PCU_SHM_MODE,
 };
 
 struct gsm_pcu_if_txt_ind {
@@ -231,6 +260,22 @@ struct gsm_pcu_if_container {
 	uint8_t		data[0];
 } __attribute__ ((packed));
 
+/* Max. length of a PCU_IF_MSG_BATCH datagram, header included */
+#define PCU_IF_BATCH_MAX_LEN	4096
+
+/* Several primitives in one datagram: each primitive in the compact form
+ * (header and the union member it uses), preceded by its length */
+struct gsm_pcu_if_batch {
+	uint16_t	num;	/* number of primitives */
+	uint16_t	length;	/* length of data */
+	uint8_t		data[0];
+} __attribute__ ((packed));
+
+struct gsm_pcu_if_batch_entry {
+	uint16_t	length;	/* length of prim */
+	uint8_t		prim[0];
+} __attribute__ ((packed));
+
 /* Struct to send a (confirmed) IMMEDIATE ASSIGNMENT message via PCH. The struct is sent as a data request
  * (data_req) under SAPI PCU_IF_SAPI_PCH_2. */
 struct gsm_pcu_if_pch {
@@ -278,6 +323,7 @@ struct gsm_pcu_if {
 		struct gsm_pcu_if_app_info_req	app_info_req;
 		struct gsm_pcu_if_interf_ind	interf_ind;
 		struct gsm_pcu_if_container	container;
+		struct gsm_pcu_if_batch		batch;
 	} u;
 } __attribute__ ((packed));
 
@@ -49,6 +49,10 @@ struct phy_link {
 			uint32_t rts_advance;
 			bool use_legacy_setbsic;
 			uint8_t trxd_pdu_ver_max; /* Maximum TRXD PDU version to negotiate */
+			bool trxd_batch_io; /* use recvmmsg()/sendmmsg() for TRXD */
+			uint8_t trxc_window; /* max. number of TRXC commands in flight */
+			bool trxd_use_shm; /* TRXD over shared memory rings instead of UDP */
+			char *trxd_shm_path; /* unix socket path prefix for the shm handshake */
 			bool powered; /* last POWERON (true) or POWEROFF (false) confirmed */
 			bool poweron_sent; /* is there a POWERON in transit? */
 			bool poweroff_sent; /* is there a POWEROFF in transit? */
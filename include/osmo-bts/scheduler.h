@@ -79,30 +79,17 @@ struct l1sched_meas_set {
 	float			rssi;		/* RSSI (dBm) */
 };
 
-/* States each channel on a multiframe */
-struct l1sched_chan_state {
-	/* Pointer to the associated logical channel state from gsm_data_shared.
-	 * Initialized during channel activation, thus may be NULL for inactive
-	 * or auto-active channels. Always check before dereferencing! */
-	struct gsm_lchan	*lchan;
-
-	/* scheduler */
-	bool			active;		/* Channel is active */
-	ubit_t			*dl_bursts;	/* burst buffer for TX */
-	enum trx_mod_type	dl_mod_type;	/* Downlink modulation type */
-	uint8_t			dl_mask;	/* mask of transmitted bursts */
-	sbit_t			*ul_bursts;	/* burst buffer for RX */
-	uint32_t		ul_first_fn;	/* fn of first burst */
-	uint32_t		ul_mask;	/* mask of received bursts */
+struct a5_ks_cache;
 
+/* State of an active logical channel which is not needed on every burst.
+ * Allocated on activation and freed on deactivation, see trx_sched_set_lchan(),
+ * so that inactive channels do not carry it. */
+struct l1sched_chan_act_state {
 	/* loss detection */
 	uint32_t		last_tdma_fn;	/* last processed TDMA frame number */
 	uint32_t		proc_tdma_fs;	/* how many TDMA frames were processed */
 	uint32_t		lost_tdma_fs;	/* how many TDMA frames were lost */
 
-	/* mode */
-	uint8_t			rsl_cmode, tch_mode; /* mode for TCH channels */
-
 	/* AMR */
 	uint8_t			codec[4];	/* 4 possible codecs for amr */
 	int			codecs;		/* number of possible codecs */
@@ -114,32 +101,75 @@ struct l1sched_chan_state {
 	uint8_t			dl_cmr;		/* current downlink CMR index */
 	uint8_t			amr_last_dtx;	/* last received dtx frame type */
 
-	/* TCH/H */
-	uint8_t			dl_ongoing_facch; /* FACCH/H on downlink */
-	uint8_t			ul_ongoing_facch; /* FACCH/H on uplink */
-
-	uint8_t			dl_facch_bursts;  /* number of remaining DL FACCH bursts */
-
-	/* encryption */
-	int			ul_encr_algo;	/* A5/x encry algo downlink */
-	int			dl_encr_algo;	/* A5/x encry algo uplink */
-	int			ul_encr_key_len;
-	int			dl_encr_key_len;
+	/* encryption (the algorithms are in struct l1sched_chan_state) */
+	uint8_t			ul_encr_key_len;
+	uint8_t			dl_encr_key_len;
 	uint8_t			ul_encr_key[MAX_A5_KEY_LEN];
 	uint8_t			dl_encr_key[MAX_A5_KEY_LEN];
+	struct a5_ks_cache	*a5_cache;	/* keystreams, if ciphering is enabled */
 
 	/* Uplink measurements */
 	struct {
 		/* Active channel measurements (simple ring buffer) */
 		struct l1sched_meas_set buf[24]; /* up to 24 (BUFMAX) entries */
 		unsigned int current; /* current position */
-
-		/* Interference measurements */
-		int interf_avg; /* sliding average */
 	} meas;
+};
+
+/* States each channel on a multiframe.  Only what the burst handlers need on
+ * (almost) every burst lives here, so that the whole array of a timeslot stays
+ * small: the rest is in the l1sched_chan_act_state of active channels. */
+struct l1sched_chan_state {
+	/* Pointer to the associated logical channel state from gsm_data_shared.
+	 * Initialized during channel activation, thus may be NULL for inactive
+	 * or auto-active channels. Always check before dereferencing! */
+	struct gsm_lchan	*lchan;
+
+	/* scheduler */
+	ubit_t			*dl_bursts;	/* burst buffer for TX */
+	sbit_t			*ul_bursts;	/* burst buffer for RX */
+	struct l1sched_chan_act_state *act;	/* NULL unless the channel is active */
+	uint32_t		ul_first_fn;	/* fn of first burst */
+	uint32_t		ul_mask;	/* mask of received bursts */
+	enum trx_mod_type	dl_mod_type;	/* Downlink modulation type */
+	bool			active;		/* Channel is active */
+	uint8_t			dl_mask;	/* mask of transmitted bursts */
+	uint8_t			ul_ring_pos;	/* start of the RX window (TCH only) */
+	uint8_t			ul_ring_fill;	/* mask of valid slots of the newest RX block */
+
+	/* mode */
+	uint8_t			rsl_cmode, tch_mode; /* mode for TCH channels */
+
+	/* TCH/H */
+	uint8_t			dl_ongoing_facch; /* FACCH/H on downlink */
+	uint8_t			ul_ongoing_facch; /* FACCH/H on uplink */
+
+	uint8_t			dl_facch_bursts;  /* number of remaining DL FACCH bursts */
+
+	/* PDTCH */
+	bool			ul_egprs_gmsk;	/* last GMSK block was EGPRS (MCS-1..4) */
+
+	/* encryption (A5/x, 0 if none) */
+	uint8_t			ul_encr_algo;	/* A5/x encry algo uplink */
+	uint8_t			dl_encr_algo;	/* A5/x encry algo downlink */
 
 	/* handover */
 	bool			ho_rach_detect;	/* if rach detection is on */
+
+	/* Interference measurements of the inactive channel (sliding average) */
+	int			interf_avg;
+};
+
+/* Number of FN buckets of the DL primitive queue (must be a power of two
+ * dividing GSM_TDMA_HYPERFRAME, so that FN mod N is continuous on wrap) */
+#define L1SCHED_DL_PRIM_SLOTS	128
+
+/* Rate counters of a timeslot (struct l1sched_ts) */
+enum {
+	L1SCHED_TS_CTR_DL_LATE,
+	L1SCHED_TS_CTR_DL_NOT_FOUND,
+	L1SCHED_TS_CTR_A5_KS_HIT,
+	L1SCHED_TS_CTR_A5_KS_MISS,
 };
 
 struct l1sched_ts {
@@ -149,10 +179,18 @@ struct l1sched_ts {
 	uint8_t			mf_period;	/* period of multiframe */
 	const struct trx_sched_frame *mf_frames; /* pointer to frame layout */
 
-	struct llist_head	dl_prims;	/* Queue primitives for TX */
+	/* Queue primitives for TX, bucketed by (FN mod L1SCHED_DL_PRIM_SLOTS) */
+	struct llist_head	dl_prims[L1SCHED_DL_PRIM_SLOTS];
+	/* Buckets which may be non-empty, so that the empty ones are skipped */
+	uint64_t		dl_prims_used[L1SCHED_DL_PRIM_SLOTS / 64];
+	uint32_t		dl_prims_fn;	/* last FN the buckets were checked for */
+	bool			dl_prims_fn_valid;
 
 	struct rate_ctr_group	*ctrs;		/* rate counters */
 
+	/* Active logical channels, (1 << enum trx_chan_type) */
+	uint64_t		active_chans;
+
 	/* Channel states for all logical channels */
 	struct l1sched_chan_state chan_state[_TRX_CHAN_MAX];
 };
@@ -164,6 +202,9 @@ void trx_sched_init(struct gsm_bts_trx *trx);
 /*! \brief De-initialize the scheduler data structures */
 void trx_sched_clean(struct gsm_bts_trx *trx);
 
+/*! \brief Number of DL primitives queued for a timeslot */
+unsigned int trx_sched_dl_prims_count(const struct l1sched_ts *l1ts);
+
 /*! \brief Handle a PH-DATA.req from L2 down to L1 */
 int trx_sched_ph_data_req(struct gsm_bts_trx *trx, struct osmo_phsap_prim *l1sap);
 
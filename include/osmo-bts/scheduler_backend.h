@@ -1,10 +1,25 @@
 #pragma once
 
+#include <osmo-bts/a5_ks.h>
+
+struct l1sched_dl_ctx;
+struct rate_ctr_group;
+
+/* Downlink context of the current thread (if any), see struct l1sched_dl_ctx */
+extern __thread struct l1sched_dl_ctx *l1sched_dl_ctx_cur;
+
+/* Within a Downlink context, the messages are logged later by the main thread */
 #define LOGL1S(subsys, level, l1ts, chan, fn, fmt, args ...)	\
-		LOGP(subsys, level, "%s %s %s: " fmt,		\
-			gsm_fn_as_gsmtime_str(fn),		\
-			gsm_ts_name((l1ts)->ts),		\
-			chan >=0 ? trx_chan_desc[chan].name : "", ## args)
+	do {								\
+		if (OSMO_UNLIKELY(l1sched_dl_ctx_cur != NULL))		\
+			_sched_log_defer(subsys, level, __FILE__, __LINE__, \
+					 l1ts, chan, fn, fmt, ## args);	\
+		else							\
+			LOGP(subsys, level, "%s %s %s: " fmt,		\
+				gsm_fn_as_gsmtime_str(fn),		\
+				gsm_ts_name((l1ts)->ts),		\
+				chan >=0 ? trx_chan_desc[chan].name : "", ## args); \
+	} while (0)
 
 /* Logging helper adding context from trx_{ul,dl}_burst_{ind,req} */
 #define LOGL1SB(subsys, level, l1ts, b, fmt, args ...) \
@@ -39,6 +54,68 @@ extern const ubit_t _sched_train_seq_gmsk_nb[4][8][26];
 extern const ubit_t _sched_train_seq_8psk_nb[8][78];
 extern const ubit_t _sched_train_seq_gmsk_sb[64];
 
+/* Number of msgb in a Downlink context pool: 8 timeslots, each with a primary
+ * and a shadow burst, each of them may need a dummy TCH and a dummy FACCH frame.
+ * This is the worst case, the pool is refilled for every TDMA frame. */
+#define L1SCHED_DL_CTX_POOL_SIZE	(8 * 2 * 2)
+/* Size of each msgb in a Downlink context pool */
+#define L1SCHED_DL_CTX_MSGB_SIZE	512
+/* Number of distinct rate counters a Downlink context can update: 8 timeslots,
+ * each with a primary and a shadow burst, each with a few counters */
+#define L1SCHED_DL_CTX_CTR_MAX		(8 * 2 * 4)
+/* Number of messages a Downlink context can log, and their maximum length
+ * (including the prefix added by LOGL1S(), longer ones are truncated) */
+#define L1SCHED_DL_CTX_LOG_MAX		32
+#define L1SCHED_DL_CTX_LOG_LEN		512
+
+/*! A message logged within a Downlink context */
+struct l1sched_dl_ctx_log {
+	int			subsys;
+	int			level;
+	const char		*file;
+	int			line;
+	char			text[L1SCHED_DL_CTX_LOG_LEN];
+};
+
+/*! Context for generating Downlink bursts outside of the main thread.
+ *  talloc, logging and rate counters are not thread-safe, so while a
+ *  context is entered, msgb are taken from a pre-allocated pool and
+ *  freed later by the main thread, which also does the logging and
+ *  updates the rate counters (see l1sched_dl_ctx_flush()). */
+struct l1sched_dl_ctx {
+	/*! pre-allocated msgb for _sched_msgb_alloc() */
+	struct llist_head	pool;
+	unsigned int		pool_len;
+	/*! msgb passed to _sched_msgb_free(), to be freed by the main thread */
+	struct llist_head	free_list;
+	/*! rate counter increments passed to _sched_ctr_add() */
+	struct {
+		struct rate_ctr_group *grp;
+		unsigned int	idx;
+		uint64_t	inc;
+	}			ctrs[L1SCHED_DL_CTX_CTR_MAX];
+	unsigned int		ctrs_num;
+	unsigned int		ctrs_dropped;
+	/*! messages passed to _sched_log_defer() */
+	struct l1sched_dl_ctx_log logs[L1SCHED_DL_CTX_LOG_MAX];
+	unsigned int		logs_num;
+	unsigned int		logs_dropped;
+};
+
+void l1sched_dl_ctx_init(struct l1sched_dl_ctx *ctx);
+void l1sched_dl_ctx_refill(struct l1sched_dl_ctx *ctx);
+void l1sched_dl_ctx_flush(struct l1sched_dl_ctx *ctx);
+void l1sched_dl_ctx_release(struct l1sched_dl_ctx *ctx);
+void l1sched_dl_ctx_enter(struct l1sched_dl_ctx *ctx);
+
+struct msgb *_sched_msgb_alloc(uint16_t size, const char *name);
+void _sched_msgb_free(struct msgb *msg);
+void _sched_ctr_add(struct rate_ctr_group *grp, unsigned int idx, uint64_t inc);
+void _sched_log_defer(int subsys, int level, const char *file, int line,
+		      const struct l1sched_ts *l1ts, int chan, uint32_t fn,
+		      const char *fmt, ...)
+	__attribute__((format(printf, 8, 9)));
+
 struct msgb *_sched_dequeue_prim(struct l1sched_ts *l1ts, const struct trx_dl_burst_req *br);
 
 int _sched_compose_ph_data_ind(struct l1sched_ts *l1ts, uint32_t fn,
@@ -68,6 +145,15 @@ int rx_pdtch_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi);
 int rx_tchf_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi);
 int rx_tchh_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi);
 
+/* Size of the Uplink burst buffer of a logical channel, in bytes */
+size_t rx_bursts_size(enum trx_chan_type chan);
+
+const ubit_t *_sched_a5_ks(const struct l1sched_ts *l1ts,
+			   struct l1sched_chan_state *l1cs,
+			   enum trx_chan_type chan,
+			   enum a5_ks_dir dir, uint32_t fn,
+			   ubit_t *buf);
+
 void _sched_dl_burst(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br);
 int _sched_rts(const struct l1sched_ts *l1ts, uint32_t fn);
 void _sched_act_rach_det(struct gsm_bts_trx *trx, uint8_t tn, uint8_t ss, int activate);
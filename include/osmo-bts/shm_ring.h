@@ -0,0 +1,56 @@
+#pragma once
+
+/* Lock-free single-producer/single-consumer ring buffers in POSIX
+ * shared memory, used as a local alternative to datagram sockets. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Default size of the data area of each ring (must be a power of two) */
+#define SHM_RING_DEF_SIZE	(256 * 1024)
+
+enum shm_link_role {
+	/*! creates the shared memory segment and the eventfds */
+	SHM_LINK_ROLE_SERVER,
+	/*! attaches to a segment created by the server */
+	SHM_LINK_ROLE_CLIENT,
+};
+
+struct shm_ring;
+
+/*! Process-local handle for a pair of rings (one per direction) */
+struct shm_link {
+	enum shm_link_role role;
+	/*! name of the POSIX shared memory object (server only) */
+	char *name;
+	/*! the mapped shared memory segment */
+	void *map;
+	size_t map_len;
+	/*! ring we produce into / consume from */
+	struct shm_ring *tx;
+	struct shm_ring *rx;
+	/*! size of the data area of each ring; the copy in the shared
+	 *  memory is not trusted, the peer may write to it */
+	uint32_t ring_size;
+	/*! file descriptors: shared memory object and wakeup eventfds */
+	int shm_fd;
+	int efd_tx;
+	int efd_rx;
+};
+
+struct shm_link *shm_link_create(void *ctx, const char *name, size_t ring_size);
+struct shm_link *shm_link_attach(void *ctx, int shm_fd, int efd_srv, int efd_clnt);
+void shm_link_free(struct shm_link *link);
+void shm_link_reset(struct shm_link *link);
+
+int shm_link_send_fds(const struct shm_link *link, int sock_fd);
+struct shm_link *shm_link_recv_fds(void *ctx, int sock_fd);
+int shm_link_send_fds_msg(const struct shm_link *link, int sock_fd, const void *buf, size_t len);
+int shm_link_recv_msg(void *ctx, int sock_fd, void *buf, size_t buf_len,
+		      struct shm_link **link, int flags);
+
+int shm_link_push(struct shm_link *link, const uint8_t *buf, size_t len);
+int shm_link_pop(struct shm_link *link, uint8_t *buf, size_t buf_len);
+void shm_link_rx_ack(struct shm_link *link);
+bool shm_link_rx_empty(const struct shm_link *link);
@@ -0,0 +1,83 @@
+/* Cache of A5 keystreams for ciphered logical channels */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* osmo_a5() generates the Downlink and the Uplink keystream of a frame
+ * at once (for A5/1 and A5/2 at the cost of one), but the scheduler used
+ * to call it twice per frame, once for each direction, and at different
+ * times.  The cache keeps the keystreams of the recent and upcoming
+ * frames, so that one call serves both directions. */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/gsm/a5.h>
+
+#include <osmo-bts/a5_ks.h>
+
+/*! Drop all cached keystreams, e.g. on a change of the algorithm or key */
+void a5_ks_cache_reset(struct a5_ks_cache *c)
+{
+	unsigned int i;
+
+	for (i = 0; i < A5_KS_CACHE_SIZE; i++) {
+		c->ent[i].fn[A5_KS_DL] = A5_KS_FN_INVALID;
+		c->ent[i].fn[A5_KS_UL] = A5_KS_FN_INVALID;
+	}
+}
+
+/*! Generate (unless cached already) the keystreams of a TDMA frame.
+ *  \param[inout] c the cache to store the keystreams in.
+ *  \param[in] fn TDMA frame number.
+ *  \param[in] dl Downlink algorithm and key, NULL if not needed.
+ *  \param[in] ul Uplink algorithm and key, NULL if not needed. */
+void a5_ks_cache_gen(struct a5_ks_cache *c, uint32_t fn,
+		     const struct a5_ks_cipher *dl,
+		     const struct a5_ks_cipher *ul)
+{
+	struct a5_ks_entry *e = &c->ent[fn % A5_KS_CACHE_SIZE];
+
+	if (dl != NULL && (dl->algo == 0 || e->fn[A5_KS_DL] == fn))
+		dl = NULL;
+	if (ul != NULL && (ul->algo == 0 || e->fn[A5_KS_UL] == fn))
+		ul = NULL;
+
+	/* Both directions in one go, if they share algorithm and key */
+	if (dl != NULL && ul != NULL && dl->algo == ul->algo &&
+	    dl->key_len == ul->key_len && !memcmp(dl->key, ul->key, dl->key_len)) {
+		osmo_a5(dl->algo, dl->key, fn, e->ks[A5_KS_DL], e->ks[A5_KS_UL]);
+		e->fn[A5_KS_DL] = e->fn[A5_KS_UL] = fn;
+		c->a5_calls++;
+		return;
+	}
+
+	if (dl != NULL) {
+		osmo_a5(dl->algo, dl->key, fn, e->ks[A5_KS_DL], NULL);
+		e->fn[A5_KS_DL] = fn;
+		c->a5_calls++;
+	}
+
+	if (ul != NULL) {
+		osmo_a5(ul->algo, ul->key, fn, NULL, e->ks[A5_KS_UL]);
+		e->fn[A5_KS_UL] = fn;
+		c->a5_calls++;
+	}
+}
@@ -58,6 +58,7 @@
 #include <osmo-bts/power_control.h>
 #include <osmo-bts/osmux.h>
 #include <osmo-bts/notification.h>
+#include <osmo-bts/msgb_pool.h>
 
 #define MAX_TA_DEF	 63 /* default max Timing Advance value */
 #define MIN_QUAL_RACH	 50 /* minimum link quality (in centiBels) for Access Bursts */
@@ -83,6 +84,7 @@ static int bts_signal_cbfn(unsigned int subsys, unsigned int signal,
 		struct gsm_bts *bts = signal_data;
 
 		bts_update_agch_max_queue_length(bts);
+		bts_sysinfo_sched_update(bts);
 	}
 	return 0;
 }
@@ -93,6 +95,7 @@ static const struct rate_ctr_desc bts_ctr_desc[] = {
 	[BTS_CTR_PAGING_DROP_PS] =	{"paging:drop-ps", "Dropped paging requests (PS/PCU)"},
 	[BTS_CTR_PAGING_CONG] =		{"paging:cong", "Paging congestion detected (Abis)"},
 	[BTS_CTR_PAGING_SENT] =		{"paging:sent", "Sent paging requests (Um)"},
+	[BTS_CTR_PAGING_BLOCKS] =	{"paging:blocks", "Paging blocks carrying paging requests (Um)"},
 
 	[BTS_CTR_RACH_RCVD] =		{"rach:rcvd", "Received RACH requests (Um)"},
 	[BTS_CTR_RACH_DROP] =		{"rach:drop", "Dropped RACH requests (Um)"},
@@ -113,6 +116,17 @@ static const struct rate_ctr_desc bts_ctr_desc[] = {
 	[BTS_CTR_RTP_RX_DROP_V110_DEC] = {"rtp:rx:drop:v110_dec", "Total number of received RTP packets dropped during V.110 decode"},
 	[BTS_CTR_RTP_TX_TOTAL] =	{"rtp:tx:total", "Total number of transmitted RTP packets"},
 	[BTS_CTR_RTP_TX_MARKER] =	{"rtp:tx:marker", "Number of transmitted RTP packets with marker bit set"},
+
+	[BTS_CTR_OSMUX_RX_DGRAMS] =	{"osmux:rx:dgrams", "Number of received Osmux datagrams"},
+	[BTS_CTR_OSMUX_RX_SYSCALLS] =	{"osmux:rx:syscalls", "Number of recvmmsg() calls on the Osmux socket"},
+	[BTS_CTR_OSMUX_RX_POOL_EXHAUSTED] = {"osmux:rx:pool_exhausted", "Number of times all Osmux receive buffers were filled by one recvmmsg() call"},
+	[BTS_CTR_OSMUX_TX_DGRAMS] =	{"osmux:tx:dgrams", "Number of transmitted Osmux datagrams"},
+	[BTS_CTR_OSMUX_TX_SYSCALLS] =	{"osmux:tx:syscalls", "Number of sendmmsg() calls on the Osmux socket"},
+
+	[BTS_CTR_PCU_TX_PRIMS] =	{"pcu:tx:prims", "Number of primitives sent to the PCU"},
+	[BTS_CTR_PCU_TX_WRITES] =	{"pcu:tx:writes", "Number of write() calls on the PCU socket"},
+	[BTS_CTR_PCU_RX_PRIMS] =	{"pcu:rx:prims", "Number of primitives received from the PCU"},
+	[BTS_CTR_PCU_RX_READS] =	{"pcu:rx:reads", "Number of recv() calls on the PCU socket"},
 };
 static const struct rate_ctr_group_desc bts_ctrg_desc = {
 	"bts",
@@ -362,6 +376,7 @@ int bts_init(struct gsm_bts *bts)
 	bts->min_qual_rach = MIN_QUAL_RACH;
 	bts->min_qual_norm = MIN_QUAL_NORM;
 	bts->max_ber10k_rach = 1707; /* 7 of 41 bits is Eb/N0 of 0 dB = 0.1707 */
+	bts_sysinfo_sched_update(bts);
 	bts->pcu.sock_path = talloc_strdup(bts, PCU_SOCK_DEFAULT);
 	bts->pcu.sock_wqueue_len_max = BTS_PCU_SOCK_WQUEUE_LEN_DEFAULT;
 	for (i = 0; i < ARRAY_SIZE(bts->t200_fn); i++)
@@ -380,6 +395,9 @@ int bts_init(struct gsm_bts *bts)
 	tall_rtp_ctx = talloc_pool(tall_bts_ctx, 262144);
 	osmo_rtp_init(tall_rtp_ctx);
 
+	/* preallocate the msgb of the L1SAP and PHY primitives */
+	bts_msgb_pool_init(tall_bts_ctx);
+
 	/* Osmux */
 	rc = bts_osmux_init(bts);
 	if (rc < 0)
@@ -119,6 +119,8 @@ void gsm_bts_trx_init_shadow_ts(struct gsm_bts_trx *trx)
 
 		gsm_bts_trx_ts_init_lchan(ts);
 	}
+
+	gsm_bts_trx_chan_nr_map_update(trx);
 }
 
 void gsm_bts_trx_free_shadow_ts(struct gsm_bts_trx *trx)
@@ -135,11 +137,14 @@ void gsm_bts_trx_free_shadow_ts(struct gsm_bts_trx *trx)
 		for (ln = 0; ln < ARRAY_SIZE(shadow_ts->lchan); ln++) {
 			struct gsm_lchan *lchan = &shadow_ts->lchan[ln];
 			TALLOC_FREE(lchan->name);
+			lchan_sacch_si_clear(lchan);
 		}
 
 		talloc_free(shadow_ts);
 		trx->ts[tn].vamos.peer = NULL;
 	}
+
+	gsm_bts_trx_chan_nr_map_update(trx);
 }
 
 struct gsm_bts_trx *gsm_bts_trx_alloc(struct gsm_bts *bts)
@@ -167,6 +172,7 @@ struct gsm_bts_trx *gsm_bts_trx_alloc(struct gsm_bts *bts)
 	oml_mo_state_init(&trx->bb_transc.mo, NM_OPSTATE_DISABLED, NM_AVSTATE_NOT_INSTALLED);
 
 	gsm_bts_trx_init_ts(trx);
+	gsm_bts_trx_chan_nr_map_update(trx);
 
 	if (trx->nr != 0)
 		trx->nominal_power = bts->c0->nominal_power;
@@ -0,0 +1,281 @@
+/* Precomputed frequency hopping routing tables */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* With frequency hopping, a burst of a (logical) timeslot is transmitted
+ * and received by whichever TRX (RF carrier) is tuned to the ARFCN the
+ * hopping sequence yields for the current TDMA frame.  Instead of running
+ * gsm0502_hop_seq_gen() for every TRX on every burst, the MAI sequence
+ * (without MAIO) is computed once for the whole period, and both
+ * directions are resolved by table lookups:
+ *
+ *   Downlink: MAI = (S(fn) + MAIO) mod N, then MAI -> TRX (by ARFCN)
+ *   Uplink:   ARFCN of the TRX -> MAI, then MAIO = (MAI - S(fn)) mod N,
+ *             then MAIO -> TRX owning the timeslot
+ *
+ * Timeslots on the same TN sharing HSN and MA are grouped together,
+ * which in practice leaves one group per TN. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/gsm/gsm0502.h>
+#include <osmocom/gsm/gsm_utils.h>
+
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/bts_trx.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/fh_route.h>
+
+/* MAI sequence (without MAIO) for the given HSN and MA length */
+struct fh_route_seq {
+	struct llist_head list;
+	uint8_t hsn;
+	uint8_t ma_len;
+	bool used;
+	uint8_t mai[FH_SEQ_PERIOD];
+};
+
+/* Hopping parameters of a TRX, as far as the routing depends on them */
+struct fh_route_cfg {
+	uint16_t arfcn;
+	struct {
+		bool enabled;
+		uint8_t hsn;
+		uint8_t maio;
+		uint8_t arfcn_num;
+		uint16_t arfcn_list[64];
+	} ts[TRX_NR_TS];
+};
+
+/*! Allocate (empty) frequency hopping routing tables */
+struct fh_route *fh_route_alloc(void *ctx)
+{
+	struct fh_route *fr;
+	unsigned int tn;
+
+	fr = talloc_zero(ctx, struct fh_route);
+	if (fr == NULL)
+		return NULL;
+
+	INIT_LLIST_HEAD(&fr->seq_list);
+	for (tn = 0; tn < ARRAY_SIZE(fr->groups); tn++)
+		INIT_LLIST_HEAD(&fr->groups[tn]);
+
+	return fr;
+}
+
+static const struct fh_route_seq *fh_route_get_seq(struct fh_route *fr, uint8_t hsn, uint8_t ma_len)
+{
+	struct fh_route_seq *seq;
+	struct gsm_time time;
+	uint32_t fn;
+
+	llist_for_each_entry(seq, &fr->seq_list, list) {
+		if (seq->hsn == hsn && seq->ma_len == ma_len) {
+			seq->used = true;
+			return seq;
+		}
+	}
+
+	seq = talloc_zero(fr, struct fh_route_seq);
+	OSMO_ASSERT(seq != NULL);
+
+	seq->hsn = hsn;
+	seq->ma_len = ma_len;
+	seq->used = true;
+
+	for (fn = 0; fn < FH_SEQ_PERIOD; fn++) {
+		gsm_fn2gsmtime(&time, fn);
+		seq->mai[fn] = gsm0502_hop_seq_gen(&time, hsn, 0, ma_len, NULL);
+	}
+
+	llist_add_tail(&seq->list, &fr->seq_list);
+	return seq;
+}
+
+static struct fh_route_group *fh_route_get_group(struct fh_route *fr,
+						 const struct gsm_bts *bts,
+						 const struct gsm_bts_trx_ts *ts)
+{
+	const size_t ma_size = ts->hopping.arfcn_num * sizeof(ts->hopping.arfcn_list[0]);
+	const struct gsm_bts_trx *trx;
+	struct fh_route_group *grp;
+	unsigned int i;
+
+	llist_for_each_entry(grp, &fr->groups[ts->nr], list) {
+		if (grp->hsn != ts->hopping.hsn)
+			continue;
+		if (grp->ma_len != ts->hopping.arfcn_num)
+			continue;
+		if (memcmp(&grp->ma[0], &ts->hopping.arfcn_list[0], ma_size) != 0)
+			continue;
+		return grp;
+	}
+
+	grp = talloc_zero(fr->tables, struct fh_route_group);
+	OSMO_ASSERT(grp != NULL);
+
+	grp->hsn = ts->hopping.hsn;
+	grp->ma_len = ts->hopping.arfcn_num;
+	memcpy(&grp->ma[0], &ts->hopping.arfcn_list[0], ma_size);
+	if (grp->hsn != 0)
+		grp->seq = &fh_route_get_seq(fr, grp->hsn, grp->ma_len)->mai[0];
+
+	/* Map MAI <-> TRX (RF carrier) by ARFCN */
+	memset(&grp->trx_mai[0], -1, sizeof(grp->trx_mai));
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		for (i = 0; i < grp->ma_len; i++) {
+			if (grp->ma[i] != trx->arfcn)
+				continue;
+			grp->mai_trx[i] = (struct gsm_bts_trx *) trx;
+			grp->trx_mai[trx->nr] = i;
+			break;
+		}
+	}
+
+	llist_add_tail(&grp->list, &fr->groups[ts->nr]);
+	return grp;
+}
+
+static void fh_route_cfg_get(struct fh_route_cfg *cfg, const struct gsm_bts_trx *trx)
+{
+	unsigned int tn;
+
+	/* Zero-initialized, so that the unused ARFCNs compare equal */
+	memset(cfg, 0, sizeof(*cfg));
+	cfg->arfcn = trx->arfcn;
+
+	for (tn = 0; tn < ARRAY_SIZE(trx->ts); tn++) {
+		const struct gsm_bts_trx_ts *ts = &trx->ts[tn];
+		uint8_t arfcn_num = OSMO_MIN(ts->hopping.arfcn_num, ARRAY_SIZE(cfg->ts[tn].arfcn_list));
+
+		cfg->ts[tn].enabled = ts->hopping.enabled;
+		cfg->ts[tn].hsn = ts->hopping.hsn;
+		cfg->ts[tn].maio = ts->hopping.maio;
+		cfg->ts[tn].arfcn_num = arfcn_num;
+		memcpy(&cfg->ts[tn].arfcn_list[0], &ts->hopping.arfcn_list[0],
+		       arfcn_num * sizeof(ts->hopping.arfcn_list[0]));
+	}
+}
+
+/*! Check whether the routing tables are outdated.
+ *  \param[in] fr routing tables of the BTS.
+ *  \param[in] bts BTS instance to compare the TRXs and hopping parameters with.
+ *  \returns true if the tables need to be rebuilt; false otherwise. */
+bool fh_route_changed(const struct fh_route *fr, const struct gsm_bts *bts)
+{
+	const struct gsm_bts_trx *trx;
+	struct fh_route_cfg cfg;
+
+	if (fr->cfg == NULL || fr->num_trx != bts->num_trx)
+		return true;
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		if (trx->nr >= fr->num_trx)
+			return true;
+		fh_route_cfg_get(&cfg, trx);
+		if (memcmp(&cfg, &fr->cfg[trx->nr], sizeof(cfg)) != 0)
+			return true;
+	}
+
+	return false;
+}
+
+/*! (Re)build the routing tables from the hopping parameters of all timeslots.
+ *  \param[inout] fr routing tables to be rebuilt.
+ *  \param[in] bts BTS instance to take the TRXs and hopping parameters from.
+ *  \returns 0 on success; negative on error. */
+int fh_route_rebuild(struct fh_route *fr, const struct gsm_bts *bts)
+{
+	struct fh_route_seq *seq, *seq2;
+	const struct gsm_bts_trx *trx;
+	unsigned int tn;
+
+	/* Start from scratch, but keep the (expensive) sequences */
+	talloc_free(fr->tables);
+	fr->cfg = NULL;
+	fr->tables = talloc_named_const(fr, 0, "fh_route_tables");
+	if (fr->tables == NULL)
+		return -ENOMEM;
+	for (tn = 0; tn < ARRAY_SIZE(fr->groups); tn++)
+		INIT_LLIST_HEAD(&fr->groups[tn]);
+	llist_for_each_entry(seq, &fr->seq_list, list)
+		seq->used = false;
+
+	fr->num_trx = bts->num_trx;
+	fr->ts = talloc_zero_array(fr->tables, struct fh_route_ts, fr->num_trx * TRX_NR_TS);
+	if (fr->ts == NULL)
+		return -ENOMEM;
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		for (tn = 0; tn < ARRAY_SIZE(trx->ts); tn++) {
+			const struct gsm_bts_trx_ts *ts = &trx->ts[tn];
+			struct fh_route_ts *rts;
+			struct fh_route_group *grp;
+			uint8_t maio;
+
+			if (!ts->hopping.enabled || ts->hopping.arfcn_num == 0)
+				continue;
+			if (trx->nr >= fr->num_trx)
+				continue;
+
+			grp = fh_route_get_group(fr, bts, ts);
+			maio = ts->hopping.maio % grp->ma_len;
+
+			if (grp->maio_trx[maio] != NULL) {
+				LOGPTRX(trx, DL1C, LOGL_ERROR, "Frequency hopping: TS%u shares "
+					"MAIO %u with TRX%u, check hopping parameters\n",
+					tn, ts->hopping.maio, grp->maio_trx[maio]->nr);
+				continue;
+			}
+			grp->maio_trx[maio] = (struct gsm_bts_trx *) trx;
+
+			rts = &fr->ts[trx->nr * TRX_NR_TS + tn];
+			rts->grp = grp;
+			rts->maio = maio;
+		}
+	}
+
+	/* Remember what the tables were built from */
+	fr->cfg = talloc_zero_array(fr->tables, struct fh_route_cfg, fr->num_trx);
+	if (fr->cfg == NULL)
+		return -ENOMEM;
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		if (trx->nr < fr->num_trx)
+			fh_route_cfg_get(&fr->cfg[trx->nr], trx);
+	}
+
+	/* Drop sequences which are not used anymore */
+	llist_for_each_entry_safe(seq, seq2, &fr->seq_list, list) {
+		if (seq->used)
+			continue;
+		llist_del(&seq->list);
+		talloc_free(seq);
+	}
+
+	fr->rebuilds++;
+
+	return 0;
+}
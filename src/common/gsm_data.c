@@ -38,6 +38,7 @@
 #include <osmo-bts/gsm_data.h>
 #include <osmo-bts/bts.h>
 #include <osmo-bts/bts_trx.h>
+#include <osmo-bts/l1sap.h>
 #include <osmo-bts/logging.h>
 
 struct osmo_tdef_group bts_tdef_groups[] = {
@@ -147,18 +148,17 @@ char *gsm_ts_and_pchan_name(const struct gsm_bts_trx_ts *ts)
 	return ts2str;
 }
 
-/* determine logical channel based on TRX and channel number IE */
-struct gsm_lchan *rsl_lchan_lookup(struct gsm_bts_trx *trx, uint8_t chan_nr,
-				   int *rc)
+#define PCHAN_BIT(pchan) (1 << (pchan))
+
+/* Decode an RSL channel number IE: return the logical channel, and the
+ * physical channel configurations its timeslot may have */
+static struct gsm_lchan *rsl_chan_nr_decode(struct gsm_bts_trx *trx, uint8_t chan_nr,
+					    uint32_t *pchan_mask)
 {
 	uint8_t ts_nr = chan_nr & 0x07;
 	uint8_t cbits = chan_nr >> 3;
 	uint8_t lch_idx;
 	struct gsm_bts_trx_ts *ts = &trx->ts[ts_nr];
-	bool ok = true;
-
-	if (rc)
-		*rc = -EINVAL;
 
 	switch (cbits) {
 	case ABIS_RSL_CHAN_NR_CBITS_OSMO_VAMOS_Bm_ACCHs:
@@ -168,11 +168,10 @@ struct gsm_lchan *rsl_lchan_lookup(struct gsm_bts_trx *trx, uint8_t chan_nr,
 		/* fall-through */
 	case ABIS_RSL_CHAN_NR_CBITS_Bm_ACCHs:
 		lch_idx = 0;	/* TCH/F */
-		if (ts->pchan != GSM_PCHAN_TCH_F &&
-		    ts->pchan != GSM_PCHAN_PDCH &&
-		    ts->pchan != GSM_PCHAN_TCH_F_PDCH &&
-		    ts->pchan != GSM_PCHAN_OSMO_DYN)
-			ok = false;
+		*pchan_mask = PCHAN_BIT(GSM_PCHAN_TCH_F) |
+			      PCHAN_BIT(GSM_PCHAN_PDCH) |
+			      PCHAN_BIT(GSM_PCHAN_TCH_F_PDCH) |
+			      PCHAN_BIT(GSM_PCHAN_OSMO_DYN);
 		break;
 	case ABIS_RSL_CHAN_NR_CBITS_OSMO_VAMOS_Lm_ACCHs(0):
 	case ABIS_RSL_CHAN_NR_CBITS_OSMO_VAMOS_Lm_ACCHs(1):
@@ -183,18 +182,16 @@ struct gsm_lchan *rsl_lchan_lookup(struct gsm_bts_trx *trx, uint8_t chan_nr,
 	case ABIS_RSL_CHAN_NR_CBITS_Lm_ACCHs(0):
 	case ABIS_RSL_CHAN_NR_CBITS_Lm_ACCHs(1):
 		lch_idx = cbits & 0x1;	/* TCH/H */
-		if (ts->pchan != GSM_PCHAN_TCH_H &&
-		    ts->pchan != GSM_PCHAN_OSMO_DYN)
-			ok = false;
+		*pchan_mask = PCHAN_BIT(GSM_PCHAN_TCH_H) |
+			      PCHAN_BIT(GSM_PCHAN_OSMO_DYN);
 		break;
 	case ABIS_RSL_CHAN_NR_CBITS_SDCCH4_ACCH(0):
 	case ABIS_RSL_CHAN_NR_CBITS_SDCCH4_ACCH(1):
 	case ABIS_RSL_CHAN_NR_CBITS_SDCCH4_ACCH(2):
 	case ABIS_RSL_CHAN_NR_CBITS_SDCCH4_ACCH(3):
 		lch_idx = cbits & 0x3;	/* SDCCH/4 */
-		if (ts->pchan != GSM_PCHAN_CCCH_SDCCH4 &&
-		    ts->pchan != GSM_PCHAN_CCCH_SDCCH4_CBCH)
-			ok = false;
+		*pchan_mask = PCHAN_BIT(GSM_PCHAN_CCCH_SDCCH4) |
+			      PCHAN_BIT(GSM_PCHAN_CCCH_SDCCH4_CBCH);
 		break;
 	case ABIS_RSL_CHAN_NR_CBITS_SDCCH8_ACCH(0):
 	case ABIS_RSL_CHAN_NR_CBITS_SDCCH8_ACCH(1):
@@ -205,36 +202,84 @@ struct gsm_lchan *rsl_lchan_lookup(struct gsm_bts_trx *trx, uint8_t chan_nr,
 	case ABIS_RSL_CHAN_NR_CBITS_SDCCH8_ACCH(6):
 	case ABIS_RSL_CHAN_NR_CBITS_SDCCH8_ACCH(7):
 		lch_idx = cbits & 0x7;	/* SDCCH/8 */
-		if (ts->pchan != GSM_PCHAN_SDCCH8_SACCH8C &&
-		    ts->pchan != GSM_PCHAN_SDCCH8_SACCH8C_CBCH &&
-		    ts->pchan != GSM_PCHAN_OSMO_DYN)
-			ok = false;
+		*pchan_mask = PCHAN_BIT(GSM_PCHAN_SDCCH8_SACCH8C) |
+			      PCHAN_BIT(GSM_PCHAN_SDCCH8_SACCH8C_CBCH) |
+			      PCHAN_BIT(GSM_PCHAN_OSMO_DYN);
 		break;
 	case ABIS_RSL_CHAN_NR_CBITS_BCCH:
 	case ABIS_RSL_CHAN_NR_CBITS_RACH:
 	case ABIS_RSL_CHAN_NR_CBITS_PCH_AGCH:
 		lch_idx = 0;
-		if (ts->pchan != GSM_PCHAN_CCCH &&
-		    ts->pchan != GSM_PCHAN_CCCH_SDCCH4 &&
-		    ts->pchan != GSM_PCHAN_CCCH_SDCCH4_CBCH)
-			ok = false;
+		*pchan_mask = PCHAN_BIT(GSM_PCHAN_CCCH) |
+			      PCHAN_BIT(GSM_PCHAN_CCCH_SDCCH4) |
+			      PCHAN_BIT(GSM_PCHAN_CCCH_SDCCH4_CBCH);
 		/* FIXME: we should not return first sdcch4 !!! */
 		break;
 	case ABIS_RSL_CHAN_NR_CBITS_OSMO_PDCH:
 		lch_idx = 0;
-		if (ts->pchan != GSM_PCHAN_OSMO_DYN)
-			ok = false;
+		*pchan_mask = PCHAN_BIT(GSM_PCHAN_OSMO_DYN);
 		break;
 	default:
 		return NULL;
 	}
 
-	if (rc && ok)
-		*rc = 0;
-
 	return &ts->lchan[lch_idx];
 }
 
+/* Decode an L1SAP channel number */
+static struct gsm_lchan *l1sap_chan_nr_decode(struct gsm_bts_trx *trx, uint8_t chan_nr)
+{
+	struct gsm_bts_trx_ts *ts;
+	unsigned int ss;
+
+	ts = &trx->ts[L1SAP_CHAN2TS(chan_nr)];
+
+	if (L1SAP_IS_CHAN_VAMOS(chan_nr)) {
+		if (ts->vamos.peer == NULL)
+			return NULL;
+		ts = ts->vamos.peer;
+	}
+
+	if (L1SAP_IS_CHAN_CBCH(chan_nr))
+		ss = 2; /* CBCH is always on sub-slot 2 */
+	else
+		ss = l1sap_chan2ss(chan_nr);
+	OSMO_ASSERT(ss < ARRAY_SIZE(ts->lchan));
+
+	return &ts->lchan[ss];
+}
+
+/* Re-build the chan_nr lookup tables of a TRX.  They only depend on the
+ * presence of the shadow (VAMOS) timeslots, the pchan of the timeslot is
+ * checked against the pchan_mask by rsl_lchan_lookup(). */
+void gsm_bts_trx_chan_nr_map_update(struct gsm_bts_trx *trx)
+{
+	unsigned int chan_nr;
+
+	for (chan_nr = 0; chan_nr < ARRAY_SIZE(trx->chan_nr_map.l1sap); chan_nr++) {
+		trx->chan_nr_map.l1sap[chan_nr] = l1sap_chan_nr_decode(trx, chan_nr);
+		trx->chan_nr_map.rsl[chan_nr].pchan_mask = 0;
+		trx->chan_nr_map.rsl[chan_nr].lchan =
+			rsl_chan_nr_decode(trx, chan_nr, &trx->chan_nr_map.rsl[chan_nr].pchan_mask);
+	}
+}
+
+/* determine logical channel based on TRX and channel number IE */
+struct gsm_lchan *rsl_lchan_lookup(struct gsm_bts_trx *trx, uint8_t chan_nr,
+				   int *rc)
+{
+	const struct gsm_lchan *lchan = trx->chan_nr_map.rsl[chan_nr].lchan;
+
+	if (rc) {
+		if (lchan && (trx->chan_nr_map.rsl[chan_nr].pchan_mask & PCHAN_BIT(lchan->ts->pchan)))
+			*rc = 0;
+		else
+			*rc = -EINVAL;
+	}
+
+	return trx->chan_nr_map.rsl[chan_nr].lchan;
+}
+
 static const uint8_t subslots_per_pchan[] = {
 	[GSM_PCHAN_NONE] = 0,
 	[GSM_PCHAN_CCCH] = 0,
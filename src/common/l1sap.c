@@ -60,6 +60,7 @@
 #include <osmo-bts/cbch.h>
 #include <osmo-bts/asci.h>
 #include <osmo-bts/csd_v110.h>
+#include <osmo-bts/msgb_pool.h>
 
 /* determine the CCCH block number based on the frame number */
 unsigned int l1sap_fn2ccch_block(uint32_t fn)
@@ -70,28 +71,11 @@ unsigned int l1sap_fn2ccch_block(uint32_t fn)
 	return rc;
 }
 
+/* see gsm_bts_trx_chan_nr_map_update() */
 struct gsm_lchan *get_lchan_by_chan_nr(struct gsm_bts_trx *trx,
 				       unsigned int chan_nr)
 {
-	struct gsm_bts_trx_ts *ts;
-	unsigned int tn, ss;
-
-	tn = L1SAP_CHAN2TS(chan_nr);
-	ts = &trx->ts[tn];
-
-	if (L1SAP_IS_CHAN_VAMOS(chan_nr)) {
-		if (ts->vamos.peer == NULL)
-			return NULL;
-		ts = ts->vamos.peer;
-	}
-
-	if (L1SAP_IS_CHAN_CBCH(chan_nr))
-		ss = 2; /* CBCH is always on sub-slot 2 */
-	else
-		ss = l1sap_chan2ss(chan_nr);
-	OSMO_ASSERT(ss < ARRAY_SIZE(ts->lchan));
-
-	return &ts->lchan[ss];
+	return trx->chan_nr_map.l1sap[chan_nr & 0xff];
 }
 
 static struct gsm_lchan *
@@ -139,7 +123,12 @@ struct msgb *l1sap_msgb_alloc(unsigned int l2_len)
 {
 	const int headroom = L1SAP_MSGB_HEADROOM;
 	const int size = headroom + sizeof(struct osmo_phsap_prim) + l2_len;
-	struct msgb *msg = msgb_alloc_headroom(size, headroom, "l1sap_prim");
+	struct msgb *msg;
+
+	if (l2_len <= BTS_MSGB_POOL_L1SAP_L2_LEN)
+		msg = bts_msgb_pool_alloc(BTS_MSGB_POOL_L1SAP, size, headroom, "l1sap_prim");
+	else
+		msg = bts_msgb_pool_alloc(BTS_MSGB_POOL_RTP, size, headroom, "l1sap_prim");
 
 	if (!msg)
 		return NULL;
@@ -629,7 +618,9 @@ static int l1sap_info_time_ind(struct gsm_bts *bts,
 	/* Update our data structures with the current GSM time */
 	gsm_fn2gsmtime(&bts->gsm_time, info_time_ind->fn);
 
-	/* Update time on PCU interface */
+	/* Update time on PCU interface, the primitives of the previous
+	 * frame (if batched and not written yet) go out first */
+	pcu_sock_flush();
 	pcu_tx_time_ind(info_time_ind->fn);
 
 	/* increment number of RACH slots that have passed by since the
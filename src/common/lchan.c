@@ -270,6 +270,61 @@ uint8_t *lchan_sacch_get(struct gsm_lchan *lchan)
 	return NULL;
 }
 
+/*! Allocate a SACCH filling message, holding a single reference */
+struct gsm_sacch_si *sacch_si_alloc(void *ctx)
+{
+	struct gsm_sacch_si *si = talloc_zero(ctx, struct gsm_sacch_si);
+
+	OSMO_ASSERT(si != NULL);
+	si->refcnt = 1;
+
+	return si;
+}
+
+/*! Take a reference to a SACCH filling message */
+struct gsm_sacch_si *sacch_si_get(struct gsm_sacch_si *si)
+{
+	si->refcnt++;
+	return si;
+}
+
+/*! Drop a reference to a SACCH filling message (may be NULL) */
+void sacch_si_put(struct gsm_sacch_si *si)
+{
+	if (si == NULL)
+		return;
+	OSMO_ASSERT(si->refcnt > 0);
+	if (--si->refcnt == 0)
+		talloc_free(si);
+}
+
+/*! Use the given SACCH filling message for an SI type of an lchan, or none if NULL.
+ *  The lchan takes its own reference, the message must not be modified anymore. */
+void lchan_sacch_si_set(struct gsm_lchan *lchan, uint8_t osmo_si, struct gsm_sacch_si *si)
+{
+	struct gsm_sacch_si *old = lchan->si.msg[osmo_si];
+
+	if (si != NULL) {
+		lchan->si.msg[osmo_si] = sacch_si_get(si);
+		lchan->si.valid |= (1 << osmo_si);
+	} else {
+		lchan->si.msg[osmo_si] = NULL;
+		lchan->si.valid &= ~(1 << osmo_si);
+	}
+
+	sacch_si_put(old);
+}
+
+/*! Drop all SACCH filling messages of an lchan, including its overrides */
+void lchan_sacch_si_clear(struct gsm_lchan *lchan)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(lchan->si.msg); i++)
+		lchan_sacch_si_set(lchan, i, NULL);
+	lchan->si.overridden = 0;
+}
+
 void lchan_set_state(struct gsm_lchan *lchan, enum gsm_lchan_state state)
 {
 	if (lchan->state == state)
@@ -311,6 +366,8 @@ void lchan_set_state(struct gsm_lchan *lchan, enum gsm_lchan_state state)
 		lchan->pending_rel_ind_msg = NULL;
 		msgb_free(lchan->pending_chan_activ);
 		lchan->pending_chan_activ = NULL;
+		/* Drop the references to the SACCH filling, activation takes new ones */
+		lchan_sacch_si_clear(lchan);
 		/* fall through */
 	default:
 		if (lchan->early_rr_ia) {
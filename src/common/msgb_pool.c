@@ -0,0 +1,319 @@
+/* Pools of preallocated msgb for the L1SAP and PHY primitives */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Every lchan allocates and frees several primitives per TDMA frame or
+ * 20 ms speech frame, which on a long running BTS fragments the heap.
+ * Instead, each size class keeps a free list of msgb of a fixed buffer
+ * size.  msgb_free() of a pooled msgb is intercepted by a talloc
+ * destructor, which puts the msgb back on the free list and refuses
+ * the free, so that the users of these msgb need no changes at all.
+ *
+ * Each pooled msgb carries a tag behind its buffer, which tells the
+ * destructor the pool it belongs to.
+ *
+ * A pool starts with a number of preallocated msgb and grows on demand
+ * (up to a limit) when its free list runs empty, so that it settles at
+ * the working set of the BTS.  Allocations that the pool can not serve
+ * fall back to msgb_alloc_headroom() and are counted separately.  In
+ * 'no alloc' mode (for tests) any allocation through the pools which is
+ * not served from a free list is a fatal error; msgb allocated directly
+ * with msgb_alloc*() are not covered by it.
+ *
+ * The pools are only used from the main thread: msgb allocated or freed
+ * in the scheduler workers go through their own l1sched_dl_ctx. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/stats.h>
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/l1sap.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/msgb_pool.h>
+
+enum {
+	MSGB_POOL_CTR_L1SAP_HIT,
+	MSGB_POOL_CTR_L1SAP_MISS,
+	MSGB_POOL_CTR_L1SAP_FALLBACK,
+	MSGB_POOL_CTR_RTP_HIT,
+	MSGB_POOL_CTR_RTP_MISS,
+	MSGB_POOL_CTR_RTP_FALLBACK,
+	MSGB_POOL_CTR_PHY_HIT,
+	MSGB_POOL_CTR_PHY_MISS,
+	MSGB_POOL_CTR_PHY_FALLBACK,
+};
+
+static const struct rate_ctr_desc msgb_pool_ctr_desc[] = {
+	[MSGB_POOL_CTR_L1SAP_HIT] =	{"l1sap:hit", "L1SAP primitives taken from the pool"},
+	[MSGB_POOL_CTR_L1SAP_MISS] =	{"l1sap:miss", "L1SAP primitives allocated with talloc"},
+	[MSGB_POOL_CTR_L1SAP_FALLBACK] = {"l1sap:fallback", "L1SAP primitives allocated outside of the pool"},
+	[MSGB_POOL_CTR_RTP_HIT] =	{"rtp:hit", "RTP payload primitives taken from the pool"},
+	[MSGB_POOL_CTR_RTP_MISS] =	{"rtp:miss", "RTP payload primitives allocated with talloc"},
+	[MSGB_POOL_CTR_RTP_FALLBACK] =	{"rtp:fallback", "RTP payload primitives allocated outside of the pool"},
+	[MSGB_POOL_CTR_PHY_HIT] =	{"phy:hit", "PHY primitives taken from the pool"},
+	[MSGB_POOL_CTR_PHY_MISS] =	{"phy:miss", "PHY primitives allocated with talloc"},
+	[MSGB_POOL_CTR_PHY_FALLBACK] =	{"phy:fallback", "PHY primitives allocated outside of the pool"},
+};
+
+static const struct rate_ctr_group_desc msgb_pool_ctrg_desc = {
+	"msgb_pool",
+	"pools of L1SAP and PHY primitives",
+	OSMO_STATS_CLASS_GLOBAL,
+	ARRAY_SIZE(msgb_pool_ctr_desc),
+	msgb_pool_ctr_desc
+};
+
+struct bts_msgb_pool {
+	const char *name;
+	/*! buffer size of the msgb of this pool */
+	uint16_t size;
+	/*! number of msgb allocated by bts_msgb_pool_init(), and at most */
+	unsigned int prealloc;
+	unsigned int max;
+	unsigned int ctr_hit;
+	unsigned int ctr_miss;
+	unsigned int ctr_fallback;
+
+	struct llist_head free_list;
+	struct bts_msgb_pool_stats st;
+};
+
+static struct bts_msgb_pool msgb_pools[_NUM_BTS_MSGB_POOL] = {
+	[BTS_MSGB_POOL_L1SAP] = {
+		.name = "l1sap_pool",
+		.size = L1SAP_MSGB_HEADROOM + sizeof(struct osmo_phsap_prim) + BTS_MSGB_POOL_L1SAP_L2_LEN,
+		.prealloc = 64,
+		.max = 1024,
+		.ctr_hit = MSGB_POOL_CTR_L1SAP_HIT,
+		.ctr_miss = MSGB_POOL_CTR_L1SAP_MISS,
+		.ctr_fallback = MSGB_POOL_CTR_L1SAP_FALLBACK,
+	},
+	[BTS_MSGB_POOL_RTP] = {
+		.name = "rtp_pool",
+		.size = L1SAP_MSGB_HEADROOM + sizeof(struct osmo_phsap_prim) + BTS_MSGB_POOL_RTP_L2_LEN,
+		.prealloc = 32,
+		.max = 512,
+		.ctr_hit = MSGB_POOL_CTR_RTP_HIT,
+		.ctr_miss = MSGB_POOL_CTR_RTP_MISS,
+		.ctr_fallback = MSGB_POOL_CTR_RTP_FALLBACK,
+	},
+	[BTS_MSGB_POOL_PHY] = {
+		.name = "phy_pool",
+		.size = BTS_MSGB_POOL_PHY_SIZE,
+		.prealloc = 32,
+		.max = 512,
+		.ctr_hit = MSGB_POOL_CTR_PHY_HIT,
+		.ctr_miss = MSGB_POOL_CTR_PHY_MISS,
+		.ctr_fallback = MSGB_POOL_CTR_PHY_FALLBACK,
+	},
+};
+
+/* Behind the buffer of each pooled msgb, see msgb_pool_grow() */
+struct msgb_pool_tag {
+	uint32_t magic;
+	struct bts_msgb_pool *pool;
+};
+
+#define MSGB_POOL_TAG_MAGIC	0x6d736270 /* "msbp" */
+
+static struct rate_ctr_group *msgb_pool_ctrs;
+static bool msgb_pool_enabled;
+static bool msgb_pool_no_alloc;
+
+/* The pool a msgb belongs to, identified by its tag */
+static struct bts_msgb_pool *msgb_pool_by_msg(const struct msgb *msg)
+{
+	size_t size = talloc_get_size(msg);
+	struct msgb_pool_tag tag;
+
+	if (size < sizeof(struct msgb) + sizeof(tag))
+		return NULL;
+	/* not necessarily aligned */
+	memcpy(&tag, (const uint8_t *) msg + size - sizeof(tag), sizeof(tag));
+
+	if (tag.magic != MSGB_POOL_TAG_MAGIC)
+		return NULL;
+	if (tag.pool < &msgb_pools[0] || tag.pool >= &msgb_pools[ARRAY_SIZE(msgb_pools)])
+		return NULL;
+	if (size != sizeof(struct msgb) + tag.pool->size + sizeof(tag))
+		return NULL;
+
+	return tag.pool;
+}
+
+/* Called by msgb_free(): keep the msgb on the free list instead */
+static int msgb_pool_destructor(struct msgb *msg)
+{
+	struct bts_msgb_pool *pool = msgb_pool_by_msg(msg);
+
+	OSMO_ASSERT(pool != NULL);
+	if (!msgb_pool_enabled) {
+		pool->st.num--;
+		return 0;
+	}
+
+	llist_add(&msg->list, &pool->free_list);
+	pool->st.num_free++;
+
+	return -1;
+}
+
+static struct msgb *msgb_pool_grow(struct bts_msgb_pool *pool)
+{
+	const struct msgb_pool_tag tag = {
+		.magic = MSGB_POOL_TAG_MAGIC,
+		.pool = pool,
+	};
+	struct msgb *msg;
+
+	/* The tag is out of reach of the users: the buffer handed out
+	 * never exceeds pool->size, see bts_msgb_pool_alloc() */
+	msg = msgb_alloc(pool->size + sizeof(tag), pool->name);
+	if (msg == NULL)
+		return NULL;
+	memcpy(&msg->_data[pool->size], &tag, sizeof(tag));
+	talloc_set_destructor(msg, msgb_pool_destructor);
+	pool->st.num++;
+
+	return msg;
+}
+
+/*! Preallocate the msgb pools (once per process) */
+void bts_msgb_pool_init(void *ctx)
+{
+	struct msgb *msg;
+	unsigned int i;
+
+	if (msgb_pool_enabled)
+		return;
+
+	msgb_pool_ctrs = rate_ctr_group_alloc(ctx, &msgb_pool_ctrg_desc, 0);
+	OSMO_ASSERT(msgb_pool_ctrs != NULL);
+
+	for (i = 0; i < ARRAY_SIZE(msgb_pools); i++) {
+		struct bts_msgb_pool *pool = &msgb_pools[i];
+
+		INIT_LLIST_HEAD(&pool->free_list);
+		pool->st.hits = 0;
+		pool->st.misses = 0;
+		pool->st.fallbacks = 0;
+		while (pool->st.num < pool->prealloc) {
+			msg = msgb_pool_grow(pool);
+			OSMO_ASSERT(msg != NULL);
+			llist_add(&msg->list, &pool->free_list);
+			pool->st.num_free++;
+		}
+	}
+
+	msgb_pool_enabled = true;
+}
+
+/*! Free the msgb pools; msgb still in use are freed when released */
+void bts_msgb_pool_release(void)
+{
+	struct msgb *msg, *msg2;
+	unsigned int i;
+
+	if (!msgb_pool_enabled)
+		return;
+	msgb_pool_enabled = false;
+
+	for (i = 0; i < ARRAY_SIZE(msgb_pools); i++) {
+		struct bts_msgb_pool *pool = &msgb_pools[i];
+
+		llist_for_each_entry_safe(msg, msg2, &pool->free_list, list) {
+			llist_del(&msg->list);
+			pool->st.num_free--;
+			msgb_free(msg);
+		}
+	}
+
+	rate_ctr_group_free(msgb_pool_ctrs);
+	msgb_pool_ctrs = NULL;
+}
+
+/*! Abort on any allocation through the pools not served from a free list (for tests) */
+void bts_msgb_pool_set_no_alloc(bool no_alloc)
+{
+	msgb_pool_no_alloc = no_alloc;
+}
+
+void bts_msgb_pool_get_stats(enum bts_msgb_pool_class cls, struct bts_msgb_pool_stats *st)
+{
+	OSMO_ASSERT(cls < _NUM_BTS_MSGB_POOL);
+	*st = msgb_pools[cls].st;
+}
+
+/*! msgb_alloc_headroom() from the pool of the given class */
+struct msgb *bts_msgb_pool_alloc(enum bts_msgb_pool_class cls, uint16_t size,
+				 uint16_t headroom, const char *name)
+{
+	struct bts_msgb_pool *pool;
+	struct msgb *msg;
+
+	OSMO_ASSERT(cls < _NUM_BTS_MSGB_POOL);
+	OSMO_ASSERT(size >= headroom);
+
+	if (OSMO_UNLIKELY(!msgb_pool_enabled))
+		return msgb_alloc_headroom(size, headroom, name);
+
+	pool = &msgb_pools[cls];
+	if (OSMO_LIKELY(size <= pool->size && !llist_empty(&pool->free_list))) {
+		msg = llist_first_entry(&pool->free_list, struct msgb, list);
+		llist_del(&msg->list);
+		pool->st.num_free--;
+		pool->st.hits++;
+		rate_ctr_inc2(msgb_pool_ctrs, pool->ctr_hit);
+	} else {
+		if (msgb_pool_no_alloc) {
+			LOGP(DL1C, LOGL_FATAL, "msgb pool %s: allocation of %u bytes not served "
+			     "from the free list (%u msgb in use)\n", pool->name, size, pool->st.num);
+			OSMO_ASSERT(0);
+		}
+		pool->st.misses++;
+		rate_ctr_inc2(msgb_pool_ctrs, pool->ctr_miss);
+		if (size > pool->size || pool->st.num >= pool->max) {
+			pool->st.fallbacks++;
+			rate_ctr_inc2(msgb_pool_ctrs, pool->ctr_fallback);
+			return msgb_alloc_headroom(size, headroom, name);
+		}
+		msg = msgb_pool_grow(pool);
+		if (msg == NULL)
+			return NULL;
+	}
+
+	/* Same as a fresh msgb_alloc_headroom(size, headroom, name) */
+	talloc_set_name_const(msg, name);
+	memset(msg, 0, sizeof(*msg) + size);
+	msg->data_len = size;
+	msg->head = msg->_data;
+	msg->data = msg->_data;
+	msg->tail = msg->_data;
+	msgb_reserve(msg, headroom);
+
+	return msg;
+}
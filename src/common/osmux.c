@@ -19,7 +19,7 @@
  *
  */
 
-
+#define _GNU_SOURCE
 #include <errno.h>
 #include <sys/socket.h>
 #include <stdint.h>
@@ -31,6 +31,7 @@
 #include <osmocom/core/utils.h>
 #include <osmocom/core/msgb.h>
 #include <osmocom/core/socket.h>
+#include <osmocom/core/rate_ctr.h>
 #include <osmocom/netif/rtp.h>
 
 #include <osmo-bts/bts.h>
@@ -93,72 +94,169 @@ void osmux_put_local_cid(uint8_t osmux_cid)
 	osmux_cid_bitmap[osmux_cid / 8] &= ~(1 << (osmux_cid % 8));
 }
 
-/* Deliver OSMUX batch to the remote end */
+static socklen_t osmux_sockaddr_len(const struct osmo_sockaddr *addr)
+{
+	switch (addr->u.sa.sa_family) {
+	case AF_INET6:
+		return sizeof(addr->u.sin6);
+	case AF_INET:
+	default:
+		return sizeof(addr->u.sin);
+	}
+}
+
+/* Free the first 'n' queued OSMUX batches and move the remaining ones up */
+static void osmux_tx_queue_pop(struct gsm_bts *bts, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		msgb_free(bts->osmux.tx_queue[i].msg);
+	bts->osmux.tx_queue_len -= n;
+	memmove(&bts->osmux.tx_queue[0], &bts->osmux.tx_queue[n],
+		bts->osmux.tx_queue_len * sizeof(bts->osmux.tx_queue[0]));
+}
+
+/* Send all queued OSMUX batches using as few sendmmsg() calls as possible.
+ * Batches which could not be sent because the socket buffer is full stay
+ * queued, and are sent once the socket becomes writable again. */
+static void osmux_tx_flush(struct gsm_bts *bts)
+{
+	struct mmsghdr msgs[OSMUX_TX_QUEUE_SIZE];
+	struct iovec iov[OSMUX_TX_QUEUE_SIZE];
+	unsigned int i, sent = 0, num = bts->osmux.tx_queue_len;
+	int rc;
+
+	memset(&msgs[0], 0x00, sizeof(msgs[0]) * num);
+	for (i = 0; i < num; i++) {
+		struct msgb *msg = bts->osmux.tx_queue[i].msg;
+		struct osmo_sockaddr *rem_addr = &bts->osmux.tx_queue[i].rem_addr;
+
+		iov[i] = (struct iovec) {
+			.iov_base = msgb_data(msg),
+			.iov_len = msgb_length(msg),
+		};
+		msgs[i].msg_hdr.msg_name = &rem_addr->u.sa;
+		msgs[i].msg_hdr.msg_namelen = osmux_sockaddr_len(rem_addr);
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	/* sendmmsg() may return early, so loop until all are sent */
+	while (sent < num) {
+		rc = sendmmsg(bts->osmux.fd.fd, &msgs[sent], num - sent, 0);
+		rate_ctr_inc2(bts->ctrs, BTS_CTR_OSMUX_TX_SYSCALLS);
+		if (rc < 0) {
+			char errbuf[129];
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			strerror_r(errno, errbuf, sizeof(errbuf));
+			LOGP(DOSMUX, LOGL_ERROR, "osmux sendmmsg(%s) failed: %s\n",
+			     osmo_sockaddr_to_str(&bts->osmux.tx_queue[sent].rem_addr), errbuf);
+			/* Drop the offending batch, but not the ones behind it */
+			sent++;
+			continue;
+		}
+		if (rc == 0)
+			break;
+		rate_ctr_add2(bts->ctrs, BTS_CTR_OSMUX_TX_DGRAMS, rc);
+		sent += rc;
+	}
+
+	osmux_tx_queue_pop(bts, sent);
+	if (bts->osmux.tx_queue_len == 0)
+		osmo_fd_write_disable(&bts->osmux.fd);
+}
+
+/* Deliver OSMUX batch to the remote end. Batches of all peers are queued
+ * and sent together once the socket is writable, i.e. in the next event
+ * loop iteration. */
 static void osmux_deliver_cb(struct msgb *batch_msg, void *data)
 {
 	struct osmux_handle *handle = data;
 	struct gsm_bts *bts = handle->bts;
-	socklen_t dest_len;
-	ssize_t rc;
 
-	switch (handle->rem_addr.u.sa.sa_family) {
-	case AF_INET6:
-		dest_len = sizeof(handle->rem_addr.u.sin6);
-		break;
-	case AF_INET:
-	default:
-		dest_len = sizeof(handle->rem_addr.u.sin);
-		break;
+	if (bts->osmux.tx_queue_len == ARRAY_SIZE(bts->osmux.tx_queue))
+		osmux_tx_flush(bts);
+	/* The socket buffer is full, make room by dropping the oldest batch */
+	if (bts->osmux.tx_queue_len == ARRAY_SIZE(bts->osmux.tx_queue)) {
+		LOGP(DOSMUX, LOGL_NOTICE, "osmux send queue full, dropping batch to %s\n",
+		     osmo_sockaddr_to_str(&bts->osmux.tx_queue[0].rem_addr));
+		osmux_tx_queue_pop(bts, 1);
 	}
-	rc = sendto(bts->osmux.fd.fd, batch_msg->data, batch_msg->len, 0,
-		(struct sockaddr *)&handle->rem_addr.u.sa, dest_len);
-	if (rc < 0) {
-		char errbuf[129];
-		strerror_r(errno, errbuf, sizeof(errbuf));
-		LOGP(DOSMUX, LOGL_ERROR, "osmux sendto(%s) failed: %s\n",
-			 osmo_sockaddr_to_str(&handle->rem_addr), errbuf);
+
+	bts->osmux.tx_queue[bts->osmux.tx_queue_len].msg = batch_msg;
+	/* Copied, the handle may be gone by the time the batch is sent */
+	bts->osmux.tx_queue[bts->osmux.tx_queue_len].rem_addr = handle->rem_addr;
+	bts->osmux.tx_queue_len++;
+	osmo_fd_write_enable(&bts->osmux.fd);
+}
+
+/* Only AF_INET is supported, see osmux_handle_find_or_create() */
+static inline unsigned int osmux_handle_hash(const struct osmo_sockaddr *rem_addr)
+{
+	uint32_t key = rem_addr->u.sin.sin_addr.s_addr ^ ((uint32_t)rem_addr->u.sin.sin_port << 16);
+
+	/* Knuth's multiplicative hash, take the upper bits */
+	key *= 2654435761u;
+	return (key >> 24) & (OSMUX_HANDLE_HASH_SIZE - 1);
+}
+
+/* Lookup existing OSMUX handle for specified destination address, without
+ * taking a reference. */
+static struct osmux_handle *osmux_handle_find(const struct gsm_bts *bts,
+					      const struct osmo_sockaddr *rem_addr)
+{
+	const struct llist_head *bucket;
+	struct osmux_handle *h;
+
+	if (rem_addr->u.sa.sa_family != AF_INET)
+		return NULL;
+
+	bucket = &bts->osmux.osmux_handle_hash[osmux_handle_hash(rem_addr)];
+	llist_for_each_entry(h, bucket, head) {
+		if (osmo_sockaddr_cmp(&h->rem_addr, rem_addr) == 0)
+			return h;
 	}
-	msgb_free(batch_msg);
+
+	return NULL;
 }
 
 /* Lookup existing OSMUX handle for specified destination address. */
 static struct osmux_handle *osmux_handle_find_get(const struct gsm_bts *bts,
 						  const struct osmo_sockaddr *rem_addr)
 {
-	struct osmux_handle *h;
+	struct osmux_handle *h = osmux_handle_find(bts, rem_addr);
 
-	llist_for_each_entry(h, &bts->osmux.osmux_handle_list, head) {
-		if (osmo_sockaddr_cmp(&h->rem_addr, rem_addr) == 0) {
-			LOGP(DOSMUX, LOGL_DEBUG,
-			     "Using existing OSMUX handle for rem_addr=%s\n",
-				osmo_sockaddr_to_str(rem_addr));
-			h->refcnt++;
-			return h;
-		}
+	if (h) {
+		LOGP(DOSMUX, LOGL_DEBUG,
+		     "Using existing OSMUX handle for rem_addr=%s\n",
+			osmo_sockaddr_to_str(rem_addr));
+		h->refcnt++;
 	}
 
-	return NULL;
+	return h;
 }
 
 /* Put down no longer needed OSMUX handle */
 static void osmux_handle_put(struct gsm_bts *bts, struct osmux_in_handle *in)
 {
-	struct osmux_handle *h;
+	/* The handle owning 'in' is registered as its deliver_cb data */
+	struct osmux_handle *h = osmux_xfrm_input_get_deliver_cb_data(in);
 
-	llist_for_each_entry(h, &bts->osmux.osmux_handle_list, head) {
-		if (h->in == in) {
-			if (--h->refcnt == 0) {
-				LOGP(DOSMUX, LOGL_INFO,
-				     "Releasing unused osmux handle for %s\n",
-				     osmo_sockaddr_to_str(&h->rem_addr));
-				llist_del(&h->head);
-				TALLOC_FREE(h->in);
-				talloc_free(h);
-			}
-			return;
-		}
+	if (!h || h->in != in || h->bts != bts) {
+		LOGP(DOSMUX, LOGL_ERROR, "Cannot find Osmux input handle %p\n", in);
+		return;
+	}
+
+	if (--h->refcnt == 0) {
+		LOGP(DOSMUX, LOGL_INFO,
+		     "Releasing unused osmux handle for %s\n",
+		     osmo_sockaddr_to_str(&h->rem_addr));
+		llist_del(&h->head);
+		TALLOC_FREE(h->in);
+		talloc_free(h);
 	}
-	LOGP(DOSMUX, LOGL_ERROR, "Cannot find Osmux input handle %p\n", in);
 }
 
 /* Allocate free OSMUX handle */
@@ -189,7 +287,7 @@ static struct osmux_handle *osmux_handle_alloc(struct gsm_bts *bts, const struct
 	osmux_xfrm_input_set_batch_size(h->in, bts->osmux.batch_size);
 	osmux_xfrm_input_set_deliver_cb(h->in, osmux_deliver_cb, h);
 
-	llist_add(&h->head, &bts->osmux.osmux_handle_list);
+	llist_add(&h->head, &bts->osmux.osmux_handle_hash[osmux_handle_hash(rem_addr)]);
 
 	LOGP(DOSMUX, LOGL_DEBUG, "Created new OSMUX handle for rem_addr=%s\n",
 		osmo_sockaddr_to_str(rem_addr));
@@ -221,77 +319,98 @@ osmux_handle_find_or_create(struct gsm_bts *bts, const struct osmo_sockaddr *rem
 }
 
 
-static struct msgb *osmux_recv(struct osmo_fd *ofd, struct osmo_sockaddr *addr)
+static void osmux_rx_pool_free(struct gsm_bts *bts)
 {
-	struct msgb *msg;
-	socklen_t slen = sizeof(addr->u.sas);
-	int ret;
+	unsigned int i;
 
-	msg = msgb_alloc(4096, "OSMUX"); /* TODO: pool? */
-	if (!msg) {
-		LOGP(DOSMUX, LOGL_ERROR, "cannot allocate message\n");
-		return NULL;
-	}
-	ret = recvfrom(ofd->fd, msg->data, msg->data_len, 0, &addr->u.sa, &slen);
-	if (ret <= 0) {
-		msgb_free(msg);
-		LOGP(DOSMUX, LOGL_ERROR, "cannot receive message\n");
-		return NULL;
+	for (i = 0; i < ARRAY_SIZE(bts->osmux.rx_pool); i++) {
+		if (bts->osmux.rx_pool[i]) {
+			msgb_free(bts->osmux.rx_pool[i]);
+			bts->osmux.rx_pool[i] = NULL;
+		}
 	}
-	msgb_put(msg, ret);
-
-	return msg;
 }
 
-static struct gsm_lchan *osmux_lchan_find(struct gsm_bts *bts, const struct osmo_sockaddr *rem_addr, uint8_t osmux_cid)
+static int osmux_rx_pool_alloc(struct gsm_bts *bts)
 {
-	/* TODO: Optimize this by maintaining a hashmap local_cid->lchan in bts */
-	struct gsm_bts_trx *trx;
-
-	llist_for_each_entry(trx, &bts->trx_list, list) { /* C0..n */
-		unsigned int tn;
-		for (tn = 0; tn < ARRAY_SIZE(trx->ts); tn++) {
-			struct gsm_bts_trx_ts *ts = &trx->ts[tn];
-			uint8_t subslot, subslots;
-			if (!ts_is_tch(ts))
-				continue;
+	unsigned int i;
 
-			subslots = ts_subslots(ts);
-			for (subslot = 0; subslot < subslots; subslot++) {
-				struct gsm_lchan *lchan = &ts->lchan[subslot];
-				struct osmux_handle *h;
-				if (!lchan->abis_ip.osmux.use)
-					continue;
-				if (!lchan_osmux_connected(lchan))
-					continue;
-				if (lchan->abis_ip.osmux.local_cid != osmux_cid)
-					continue;
-				h = osmux_xfrm_input_get_deliver_cb_data(lchan->abis_ip.osmux.in);
-				if (osmo_sockaddr_cmp(&h->rem_addr, rem_addr) != 0)
-					continue;
-				return lchan; /* Found it! */
-			}
+	for (i = 0; i < ARRAY_SIZE(bts->osmux.rx_pool); i++) {
+		bts->osmux.rx_pool[i] = msgb_alloc(OSMUX_RX_BUF_SIZE, "OSMUX");
+		if (!bts->osmux.rx_pool[i]) {
+			osmux_rx_pool_free(bts);
+			return -ENOMEM;
 		}
 	}
-	return NULL;
+
+	return 0;
 }
 
-static int osmux_read_fd_cb(struct osmo_fd *ofd, unsigned int what)
+/* Receive up to OSMUX_RX_POOL_SIZE datagrams into the pool buffers, using a
+ * single recvmmsg() call. Returns the number of datagrams received. */
+static int osmux_recv(struct osmo_fd *ofd, struct osmo_sockaddr *addr)
 {
-	struct msgb *msg;
-	struct osmux_hdr *osmuxh;
-	struct osmo_sockaddr rem_addr;
 	struct gsm_bts *bts = ofd->data;
+	struct mmsghdr msgs[OSMUX_RX_POOL_SIZE];
+	struct iovec iov[OSMUX_RX_POOL_SIZE];
+	int i, num;
+
+	memset(&msgs[0], 0x00, sizeof(msgs));
+	for (i = 0; i < ARRAY_SIZE(msgs); i++) {
+		struct msgb *msg = bts->osmux.rx_pool[i];
+
+		msgb_reset(msg);
+		iov[i] = (struct iovec) {
+			.iov_base = msg->data,
+			.iov_len = msgb_tailroom(msg),
+		};
+		msgs[i].msg_hdr.msg_name = &addr[i].u.sa;
+		msgs[i].msg_hdr.msg_namelen = sizeof(addr[i].u.sas);
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
 
-	msg = osmux_recv(ofd, &rem_addr);
-	if (!msg)
-		return -1;
+	num = recvmmsg(ofd->fd, &msgs[0], ARRAY_SIZE(msgs), MSG_DONTWAIT, NULL);
+	if (num <= 0)
+		return num;
+
+	rate_ctr_inc2(bts->ctrs, BTS_CTR_OSMUX_RX_SYSCALLS);
+	rate_ctr_add2(bts->ctrs, BTS_CTR_OSMUX_RX_DGRAMS, num);
+
+	for (i = 0; i < num; i++)
+		msgb_put(bts->osmux.rx_pool[i], msgs[i].msg_len);
+
+	return num;
+}
+
+/* Lookup the lchan a CID received from the peer behind handle 'h' belongs to */
+static struct gsm_lchan *osmux_lchan_find(const struct gsm_bts *bts, const struct osmux_handle *h,
+					  uint8_t osmux_cid)
+{
+	struct gsm_lchan *lchan = bts->osmux.lchan_by_cid[osmux_cid];
+
+	if (!lchan || !h)
+		return NULL;
+	/* Same local CID, but the peer is not the one this lchan is connected to */
+	if (lchan->abis_ip.osmux.in != h->in)
+		return NULL;
+	return lchan;
+}
+
+static void osmux_handle_rx_msg(struct gsm_bts *bts, struct msgb *msg,
+				const struct osmo_sockaddr *rem_addr)
+{
+	struct osmux_hdr *osmuxh;
+	const struct osmux_handle *h;
+
+	/* All circuits of a batch come from the same peer */
+	h = osmux_handle_find(bts, rem_addr);
 
 	while ((osmuxh = osmux_xfrm_output_pull(msg)) != NULL) {
-		struct gsm_lchan *lchan = osmux_lchan_find(bts, &rem_addr, osmuxh->circuit_id);
+		struct gsm_lchan *lchan = osmux_lchan_find(bts, h, osmuxh->circuit_id);
 		if (!lchan) {
 			char addr_str[64];
-			osmo_sockaddr_to_str_buf(addr_str, sizeof(addr_str), &rem_addr);
+			osmo_sockaddr_to_str_buf(addr_str, sizeof(addr_str), rem_addr);
 			LOGP(DOSMUX, LOGL_DEBUG,
 			     "Cannot find lchan for %s CID=%d\n",
 			     addr_str, osmuxh->circuit_id);
@@ -299,33 +418,79 @@ static int osmux_read_fd_cb(struct osmo_fd *ofd, unsigned int what)
 		}
 		osmux_xfrm_output_sched(lchan->abis_ip.osmux.out, osmuxh);
 	}
-	msgb_free(msg);
+}
+
+/* Drain the socket, each recvmmsg() call reuses the pool buffers */
+static int osmux_read(struct osmo_fd *ofd)
+{
+	struct osmo_sockaddr rem_addr[OSMUX_RX_POOL_SIZE];
+	struct gsm_bts *bts = ofd->data;
+	int i, num;
+
+	do {
+		num = osmux_recv(ofd, &rem_addr[0]);
+		if (num < 0 && errno == EAGAIN)
+			break;
+		if (num <= 0) {
+			LOGP(DOSMUX, LOGL_ERROR, "cannot receive message\n");
+			return -1;
+		}
+
+		for (i = 0; i < num; i++)
+			osmux_handle_rx_msg(bts, bts->osmux.rx_pool[i], &rem_addr[i]);
+
+		/* All buffers filled, more datagrams are likely pending */
+		if (num == OSMUX_RX_POOL_SIZE)
+			rate_ctr_inc2(bts->ctrs, BTS_CTR_OSMUX_RX_POOL_EXHAUSTED);
+	} while (num == OSMUX_RX_POOL_SIZE);
+
 	return 0;
 }
 
+static int osmux_fd_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct gsm_bts *bts = ofd->data;
+	int rc = 0;
+
+	if (what & OSMO_FD_READ)
+		rc = osmux_read(ofd);
+	if (what & OSMO_FD_WRITE)
+		osmux_tx_flush(bts);
+	return rc;
+}
+
 /* Called before config file read, set defaults */
 int bts_osmux_init(struct gsm_bts *bts)
 {
+	unsigned int i;
+
 	bts->osmux.use = OSMUX_USAGE_OFF;
 	bts->osmux.local_addr = talloc_strdup(bts, "127.0.0.1");
 	bts->osmux.local_port = OSMUX_DEFAULT_PORT;
 	bts->osmux.batch_factor = 4;
 	bts->osmux.batch_size = OSMUX_BATCH_DEFAULT_MAX;
 	bts->osmux.dummy_padding = false;
-	INIT_LLIST_HEAD(&bts->osmux.osmux_handle_list);
+	for (i = 0; i < ARRAY_SIZE(bts->osmux.osmux_handle_hash); i++)
+		INIT_LLIST_HEAD(&bts->osmux.osmux_handle_hash[i]);
 	bts->osmux.fd.fd = -1;
 	return 0;
 }
 
 void bts_osmux_release(struct gsm_bts *bts)
 {
-	/* bts->osmux.osmux_handle_list should end up empty when all lchans are
+	/* bts->osmux.osmux_handle_hash should end up empty when all lchans are
 	 * released/freed upon talloc_free(bts). */
 	/* If bts->osmux.fd.data is NULL, bts is being released/freed without
 	 * passing bts_osmux_init()/through bts_osmux_open() and hence fd is
 	 * probably 0 (memzeored). Avoid accessing it if not initialized. */
-	if (bts->osmux.fd.fd != -1 && bts->osmux.fd.data)
+	if (bts->osmux.fd.fd != -1 && bts->osmux.fd.data) {
+		if (bts->osmux.tx_queue_len > 0)
+			osmux_tx_flush(bts);
+		/* Whatever the socket did not take by now is lost */
+		osmux_tx_queue_pop(bts, bts->osmux.tx_queue_len);
 		osmo_fd_close(&bts->osmux.fd);
+	}
+	osmux_rx_pool_free(bts);
 }
 
 /* Called after config file read, start services */
@@ -337,7 +502,13 @@ int bts_osmux_open(struct gsm_bts *bts)
 	if (bts->osmux.use == OSMUX_USAGE_OFF)
 		return 0;
 
-	bts->osmux.fd.cb = osmux_read_fd_cb;
+	rc = osmux_rx_pool_alloc(bts);
+	if (rc < 0) {
+		LOGP(DOSMUX, LOGL_ERROR, "Failed allocating Osmux receive buffers\n");
+		return rc;
+	}
+
+	bts->osmux.fd.cb = osmux_fd_cb;
 	bts->osmux.fd.data = bts;
 	rc = osmo_sock_init2_ofd(&bts->osmux.fd, AF_UNSPEC, SOCK_DGRAM, IPPROTO_UDP,
 				 bts->osmux.local_addr, bts->osmux.local_port,
@@ -346,6 +517,7 @@ int bts_osmux_open(struct gsm_bts *bts)
 		LOGP(DOSMUX, LOGL_ERROR,
 		     "Failed binding Osmux socket to %s:%u\n",
 		     bts->osmux.local_addr ? : "*", bts->osmux.local_port);
+		osmux_rx_pool_free(bts);
 		return rc;
 	}
 
@@ -454,6 +626,8 @@ void lchan_osmux_release(struct gsm_lchan *lchan)
 
 	/* Now the remote / tx part, if ever set (connected): */
 	if (lchan->abis_ip.osmux.in) {
+		if (bts->osmux.lchan_by_cid[lchan->abis_ip.osmux.local_cid] == lchan)
+			bts->osmux.lchan_by_cid[lchan->abis_ip.osmux.local_cid] = NULL;
 		osmux_xfrm_input_close_circuit(lchan->abis_ip.osmux.in,
 					       lchan->abis_ip.osmux.remote_cid);
 		osmux_handle_put(bts, lchan->abis_ip.osmux.in);
@@ -497,6 +671,7 @@ int lchan_osmux_connect(struct gsm_lchan *lchan)
 		lchan->abis_ip.osmux.in = NULL;
 		return -1;
 	}
+	bts->osmux.lchan_by_cid[lchan->abis_ip.osmux.local_cid] = lchan;
 	return 0;
 }
 
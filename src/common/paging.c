@@ -28,7 +28,6 @@
 #include <stdint.h>
 #include <errno.h>
 #include <string.h>
-#include <time.h>
 
 #include <osmocom/core/talloc.h>
 #include <osmocom/core/linuxlist.h>
@@ -47,6 +46,13 @@
 
 #define MAX_PAGING_BLOCKS_CCCH	9
 #define MAX_BS_PA_MFRMS		9
+/* Number of buckets of the identity hash (power of two) */
+#define PAGING_ID_HASH_SIZE	256
+/* Number of one second slots of the expiration timer wheel, more than
+ * the maximum paging lifetime (see 'paging lifetime') */
+#define PAGING_WHEEL_SLOTS	64
+/* Number of queued records looked at when packing a paging block */
+#define PAGING_PACK_WINDOW	8
 
 enum paging_record_type {
 	PAGING_RECORD_NORMAL,
@@ -58,7 +64,13 @@ struct paging_record {
 	enum paging_record_type type;
 	union {
 		struct {
-			time_t expiration_time;
+			/* entries in the identity hash and the expiration timer wheel */
+			struct llist_head hash_list;
+			struct llist_head wheel_list;
+			uint32_t expiration_s; /* see paging_clock_update() */
+			uint8_t paging_group;
+			bool sent; /* sent at least once */
+			bool deferred; /* left at the head of the queue for a Type 3 */
 			uint8_t chan_needed;
 			uint8_t identity_lv[9];
 		} normal;
@@ -84,6 +96,22 @@ struct paging_state {
 	unsigned int num_paging;
 	struct llist_head paging_queue[MAX_PAGING_BLOCKS_CCCH*MAX_BS_PA_MFRMS];
 
+	/* free records for normal pagings, allocated in chunks as num_paging_max
+	 * grows, so that there's no allocation per paging */
+	struct llist_head slab_free;
+	unsigned int slab_size;
+
+	/* normal paging records by paging group and identity */
+	struct llist_head id_hash[PAGING_ID_HASH_SIZE];
+
+	/* coarse paging clock in seconds, derived from the TDMA frame number */
+	uint64_t clock_fn;
+	uint32_t clock_last_fn;
+	bool clock_valid;
+	uint32_t clock_s;
+	/* normal paging records by expiration second */
+	struct llist_head wheel[PAGING_WHEEL_SLOTS];
+
 	/* prioritization of cs pagings will automatically become
 	 * active on congestions (queue almost full) */
 	bool cs_priority_active;
@@ -114,6 +142,137 @@ static void check_congestion(struct paging_state *ps)
 		ps->cs_priority_active = false;
 }
 
+/* Make sure the slab holds (at least) num_paging_max records.  It never
+ * shrinks, as the records in use can't be moved. */
+static int paging_slab_grow(struct paging_state *ps, unsigned int size)
+{
+	struct paging_record *chunk;
+	unsigned int i;
+
+	if (size <= ps->slab_size)
+		return 0;
+
+	chunk = talloc_zero_array(ps, struct paging_record, size - ps->slab_size);
+	if (!chunk) {
+		LOGP(DPAG, LOGL_ERROR, "Failed to grow the paging record slab to %u\n", size);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < size - ps->slab_size; i++)
+		llist_add_tail(&chunk[i].list, &ps->slab_free);
+	ps->slab_size = size;
+
+	return 0;
+}
+
+static struct paging_record *paging_record_alloc(struct paging_state *ps)
+{
+	struct paging_record *pr;
+
+	if (llist_empty(&ps->slab_free))
+		return NULL;
+
+	pr = llist_first_entry(&ps->slab_free, struct paging_record, list);
+	llist_del(&pr->list);
+	memset(pr, 0, sizeof(*pr));
+
+	return pr;
+}
+
+/* Free a record which is not in a paging group queue (any more) */
+static void paging_record_free(struct paging_state *ps, struct paging_record *pr)
+{
+	/* MAC blocks are not taken from the slab, see paging_add_macblock() */
+	if (pr->type == PAGING_RECORD_MACBLOCK) {
+		talloc_free(pr);
+		return;
+	}
+
+	llist_del(&pr->u.normal.hash_list);
+	llist_del(&pr->u.normal.wheel_list);
+	llist_add(&pr->list, &ps->slab_free);
+	ps->num_paging--;
+}
+
+/* FNV-1a over the paging group and the identity LV */
+static unsigned int paging_id_hash(uint8_t paging_group, const uint8_t *identity_lv)
+{
+	uint32_t h = 2166136261u;
+	unsigned int i;
+
+	h = (h ^ paging_group) * 16777619u;
+	for (i = 0; i <= identity_lv[0]; i++)
+		h = (h ^ identity_lv[i]) * 16777619u;
+
+	return h & (PAGING_ID_HASH_SIZE - 1);
+}
+
+static struct paging_record *paging_find_identity(struct paging_state *ps, uint8_t paging_group,
+						   const uint8_t *identity_lv)
+{
+	struct llist_head *bucket = &ps->id_hash[paging_id_hash(paging_group, identity_lv)];
+	struct paging_record *pr;
+
+	llist_for_each_entry(pr, bucket, u.normal.hash_list) {
+		if (pr->u.normal.paging_group == paging_group &&
+		    identity_lv[0] == pr->u.normal.identity_lv[0] &&
+		    !memcmp(identity_lv+1, pr->u.normal.identity_lv+1, identity_lv[0]))
+			return pr;
+	}
+
+	return NULL;
+}
+
+/* (Re-)start the lifetime of a normal paging record */
+static void paging_wheel_add(struct paging_state *ps, struct paging_record *pr)
+{
+	pr->u.normal.expiration_s = ps->clock_s + ps->paging_lifetime;
+	llist_add_tail(&pr->u.normal.wheel_list,
+		       &ps->wheel[pr->u.normal.expiration_s % PAGING_WHEEL_SLOTS]);
+}
+
+/* Remove the expired records of a timer wheel slot from the queues.  Records
+ * which were not sent yet stay, they are removed after being sent once. */
+static void paging_wheel_expire(struct paging_state *ps, struct llist_head *slot)
+{
+	struct paging_record *pr, *pr2;
+	unsigned int num_expired = 0;
+
+	llist_for_each_entry_safe(pr, pr2, slot, u.normal.wheel_list) {
+		if (pr->u.normal.expiration_s > ps->clock_s || !pr->u.normal.sent)
+			continue;
+		llist_del(&pr->list);
+		paging_record_free(ps, pr);
+		num_expired++;
+	}
+
+	if (num_expired > 0)
+		LOGP(DPAG, LOGL_INFO, "Removed %u expired paging records, queue_len=%u\n",
+		     num_expired, ps->num_paging);
+}
+
+/* Advance the coarse paging clock (one TDMA frame is 60/13 ms) and expire
+ * the records of the timer wheel slots passed by. */
+static void paging_clock_update(struct paging_state *ps, const struct gsm_time *gt)
+{
+	uint32_t now_s, i, n;
+
+	if (ps->clock_valid)
+		ps->clock_fn += GSM_TDMA_FN_SUB(gt->fn, ps->clock_last_fn);
+	ps->clock_last_fn = gt->fn;
+	ps->clock_valid = true;
+
+	now_s = ps->clock_fn * 60 / 13000;
+	if (now_s == ps->clock_s)
+		return;
+
+	/* visit each slot at most once, even after a long gap */
+	n = OSMO_MIN(now_s - ps->clock_s, PAGING_WHEEL_SLOTS);
+	ps->clock_s = now_s;
+	for (i = 0; i < n; i++)
+		paging_wheel_expire(ps, &ps->wheel[(now_s - i) % PAGING_WHEEL_SLOTS]);
+}
+
 unsigned int paging_get_lifetime(struct paging_state *ps)
 {
 	return ps->paging_lifetime;
@@ -132,6 +291,7 @@ void paging_set_lifetime(struct paging_state *ps, unsigned int lifetime)
 void paging_set_queue_max(struct paging_state *ps, unsigned int queue_max)
 {
 	ps->num_paging_max = queue_max;
+	paging_slab_grow(ps, queue_max);
 }
 
 static int tmsi_mi_to_uint(uint32_t *out, const uint8_t *tmsi_lv)
@@ -231,36 +391,32 @@ int paging_add_identity(struct paging_state *ps, uint8_t paging_group,
 		return -ENOSPC;
 	}
 
+	if (*identity_lv + 1 > sizeof(pr->u.normal.identity_lv))
+		return -E2BIG;
+
 	/* Check if we already have this identity */
-	llist_for_each_entry(pr, group_q, list) {
-		if (pr->type != PAGING_RECORD_NORMAL)
-			continue;
-		if (identity_lv[0] == pr->u.normal.identity_lv[0] &&
-		    !memcmp(identity_lv+1, pr->u.normal.identity_lv+1,
-							identity_lv[0])) {
-			LOGP(DPAG, LOGL_INFO, "Ignoring duplicate paging\n");
-			pr->u.normal.expiration_time =
-					time(NULL) + ps->paging_lifetime;
-			return -EEXIST;
-		}
+	pr = paging_find_identity(ps, paging_group, identity_lv);
+	if (pr) {
+		LOGP(DPAG, LOGL_INFO, "Ignoring duplicate paging\n");
+		llist_del(&pr->u.normal.wheel_list);
+		paging_wheel_add(ps, pr);
+		return -EEXIST;
 	}
 
-	pr = talloc_zero(ps, struct paging_record);
+	pr = paging_record_alloc(ps);
 	if (!pr)
 		return -ENOMEM;
 	pr->type = PAGING_RECORD_NORMAL;
 
-	if (*identity_lv + 1 > sizeof(pr->u.normal.identity_lv)) {
-		talloc_free(pr);
-		return -E2BIG;
-	}
-
 	LOGP(DPAG, LOGL_INFO, "Add paging to queue (group=%u, queue_len=%u)\n",
 		paging_group, ps->num_paging+1);
 
-	pr->u.normal.expiration_time = time(NULL) + ps->paging_lifetime;
+	pr->u.normal.paging_group = paging_group;
 	pr->u.normal.chan_needed = chan_needed;
 	memcpy(&pr->u.normal.identity_lv, identity_lv, identity_lv[0]+1);
+	llist_add(&pr->u.normal.hash_list,
+		  &ps->id_hash[paging_id_hash(paging_group, identity_lv)]);
+	paging_wheel_add(ps, pr);
 
 	/* enqueue the new identity to the HEAD of the queue,
 	 * to ensure it will be paged quickly at least once.  */
@@ -587,41 +743,168 @@ static int fill_paging_type_3(uint8_t *out_buf, const uint8_t *tmsi1_lv, uint8_t
 
 static const uint8_t empty_id_lv[] = { 0x01, 0xF0 };
 
-static struct paging_record *dequeue_pr(struct llist_head *group_q)
+static bool pr_is_tmsi(const struct paging_record *pr)
+{
+	return pr->u.normal.identity_lv[0] >= 5 &&
+	       (pr->u.normal.identity_lv[1] & 7) == GSM_MI_TYPE_TMSI;
+}
+
+/* Return the first MAC block record (from the PCU) among the first max records of a queue */
+static struct paging_record *paging_first_macblock(struct llist_head *group_q, unsigned int max)
 {
 	struct paging_record *pr;
 
-	pr = llist_entry(group_q->next, struct paging_record, list);
-	llist_del(&pr->list);
+	llist_for_each_entry(pr, group_q, list) {
+		if (max-- == 0)
+			break;
+		if (pr->type == PAGING_RECORD_MACBLOCK)
+			return pr;
+	}
 
-	return pr;
+	return NULL;
 }
 
-static int pr_is_imsi(struct paging_record *pr)
+/* Collect up to PAGING_PACK_WINDOW normal records from the head of a queue */
+static unsigned int paging_pack_window(struct llist_head *group_q,
+				       struct paging_record *win[PAGING_PACK_WINDOW],
+				       unsigned int *num_tmsi)
 {
-	if ((pr->u.normal.identity_lv[1] & 7) == GSM_MI_TYPE_IMSI)
-		return 1;
-	else
-		return 0;
+	struct paging_record *pr;
+	unsigned int n = 0;
+
+	*num_tmsi = 0;
+	llist_for_each_entry(pr, group_q, list) {
+		if (n == PAGING_PACK_WINDOW || pr->type != PAGING_RECORD_NORMAL)
+			break;
+		win[n++] = pr;
+		if (pr_is_tmsi(pr))
+			(*num_tmsi)++;
+	}
+
+	return n;
+}
+
+/* Choose the records for the next paging block of a group and take them off
+ * the queue.  The records are taken in queue order among the first records, so
+ * that the block carries as many identities as possible: four TMSIs in a Type 3,
+ * two TMSIs and any identity in a Type 2, otherwise any two identities in a
+ * Type 1.  The record at the head of the queue is part of the block, except
+ * that an IMSI at the head may be left there once for a Type 3 of the TMSIs
+ * behind it; it goes into the next block then.  The head of the queue must be
+ * a normal record.  Returns the number of records. */
+static unsigned int paging_pack_block(struct llist_head *group_q, struct paging_record *pr[4],
+				      uint8_t *msg_type)
+{
+	struct paging_record *win[PAGING_PACK_WINDOW];
+	bool used[PAGING_PACK_WINDOW] = { false };
+	unsigned int n, num_tmsi, num_pr = 0, i;
+
+	n = paging_pack_window(group_q, win, &num_tmsi);
+
+	if (num_tmsi >= 4 && (pr_is_tmsi(win[0]) || !win[0]->u.normal.deferred)) {
+		*msg_type = GSM48_MT_RR_PAG_REQ_3;
+		for (i = 0; i < n && num_pr < 4; i++) {
+			if (pr_is_tmsi(win[i])) {
+				pr[num_pr++] = win[i];
+				used[i] = true;
+			}
+		}
+		if (!used[0])
+			win[0]->u.normal.deferred = true;
+	} else if (num_tmsi >= 2 && n >= 3) {
+		*msg_type = GSM48_MT_RR_PAG_REQ_2;
+		for (i = 0; i < n && num_pr < 2; i++) {
+			if (pr_is_tmsi(win[i])) {
+				pr[num_pr++] = win[i];
+				used[i] = true;
+			}
+		}
+		/* the head of the queue, unless it is one of the TMSIs */
+		for (i = 0; i < n; i++) {
+			if (!used[i]) {
+				pr[num_pr++] = win[i];
+				break;
+			}
+		}
+	} else {
+		*msg_type = GSM48_MT_RR_PAG_REQ_1;
+		for (i = 0; i < n && num_pr < 2; i++)
+			pr[num_pr++] = win[i];
+	}
+
+	for (i = 0; i < num_pr; i++)
+		llist_del(&pr[i]->list);
+
+	return num_pr;
+}
+
+/* Size of the P1 Rest Octets in octets */
+static unsigned int p1_rest_octets_len(const struct p1_rest_octets *p1ro)
+{
+	uint8_t buf[GSM_MACBLOCK_LEN];
+	struct bitvec bv = {
+		.data_len = sizeof(buf),
+		.data = buf,
+	};
+
+	append_p1_rest_octets(&bv, p1ro, NULL);
+
+	return (bv.cur_bit + 7) / 8;
 }
 
-static void sort_pr_tmsi_imsi(struct paging_record *pr[], unsigned int n)
+/* Choose up to two records whose identities fit into a Type 1 next to the
+ * given P1 Rest Octets (e.g. an ETWS Primary Notification segment), in queue
+ * order, and take them off the queue.  Returns the number of records. */
+static unsigned int paging_pack_p1(struct llist_head *group_q, struct paging_record *pr[2],
+				   const struct p1_rest_octets *p1ro)
 {
-	int i, j;
-	struct paging_record *t;
+	struct paging_record *win[PAGING_PACK_WINDOW];
+	unsigned int n, num_tmsi, num_pr = 0, i;
+	int space;
+
+	/* L2 pseudo length, protocol discriminator, message type, page mode */
+	space = GSM_MACBLOCK_LEN - 4 - p1_rest_octets_len(p1ro);
+
+	n = paging_pack_window(group_q, win, &num_tmsi);
+	for (i = 0; i < n && num_pr < 2; i++) {
+		/* LV for the first identity, TLV for the second one */
+		int len = win[i]->u.normal.identity_lv[0] + (num_pr == 0 ? 1 : 2);
+		if (len > space)
+			continue;
+		space -= len;
+		pr[num_pr++] = win[i];
+	}
+
+	for (i = 0; i < num_pr; i++)
+		llist_del(&pr[i]->list);
+
+	return num_pr;
+}
+
+/* Account for the records sent in a paging block, and free or re-queue them */
+static void paging_records_sent(struct paging_state *ps, struct llist_head *group_q,
+				struct paging_record *pr[], unsigned int num_pr)
+{
+	struct gsm_bts *bts = ps->bts;
+	unsigned int i;
 
-	if (n < 2)
+	if (num_pr == 0)
 		return;
 
-	/* simple bubble sort */
-	for (i = n-2; i >= 0; i--) {
-		for (j=0; j<=i ; j++) {
-			if (pr_is_imsi(pr[j]) > pr_is_imsi(pr[j+1])) {
-				t = pr[j];
-				pr[j] = pr[j+1];
-				pr[j+1] = t;
-			}
-		}
+	rate_ctr_inc2(bts->ctrs, BTS_CTR_PAGING_BLOCKS);
+
+	for (i = 0; i < num_pr; i++) {
+		rate_ctr_inc2(bts->ctrs, BTS_CTR_PAGING_SENT);
+		pr[i]->u.normal.sent = true;
+		pr[i]->u.normal.deferred = false;
+		/* check if we can expire the paging record,
+		 * or if we need to re-queue it */
+		if (pr[i]->u.normal.expiration_s <= ps->clock_s) {
+			paging_record_free(ps, pr[i]);
+			LOGP(DPAG, LOGL_INFO, "Removed paging record, queue_len=%u\n",
+				ps->num_paging);
+		} else
+			llist_add_tail(&pr[i]->list, group_q);
 	}
 }
 
@@ -665,6 +948,8 @@ int paging_gen_msg(struct paging_state *ps, uint8_t *out_buf, struct gsm_time *g
 	 * need to check the congestion status of the queue from time to time. */
 	check_congestion(ps);
 
+	paging_clock_update(ps, gt);
+
 	*is_empty = 0;
 	bts->load.ccch.pch_total += 1;
 
@@ -680,9 +965,24 @@ int paging_gen_msg(struct paging_state *ps, uint8_t *out_buf, struct gsm_time *g
 
 	if (ps->bts->etws.prim_notif) {
 		struct p1_rest_octets p1ro;
+		struct paging_record *pr[2];
+		unsigned int num_pr = 0;
+
 		build_p1_rest_octets(&p1ro, bts);
-		/* we intentioanally don't try to add notifications here, as ETWS is more critical */
-		len = fill_paging_type_1(out_buf, empty_id_lv, 0, NULL, 0, &p1ro, NULL);
+		/* we intentioanally don't try to add notifications here, as ETWS is more critical,
+		 * but identities are added if they fit next to the ETWS segment */
+		num_pr = paging_pack_p1(group_q, pr, &p1ro);
+		if (num_pr > 0) {
+			bts->load.ccch.pch_used += 1;
+			len = fill_paging_type_1(out_buf,
+						 pr[0]->u.normal.identity_lv,
+						 pr[0]->u.normal.chan_needed,
+						 num_pr > 1 ? pr[1]->u.normal.identity_lv : NULL,
+						 num_pr > 1 ? pr[1]->u.normal.chan_needed : 0,
+						 &p1ro, NULL);
+			paging_records_sent(ps, group_q, pr, num_pr);
+		} else
+			len = fill_paging_type_1(out_buf, empty_id_lv, 0, NULL, 0, &p1ro, NULL);
 	} else if (llist_empty(group_q)) {
 		struct p1_rest_octets p1ro;
 		memset(&p1ro, 0, sizeof(p1ro));
@@ -698,52 +998,27 @@ int paging_gen_msg(struct paging_state *ps, uint8_t *out_buf, struct gsm_time *g
 		*is_empty = 1;
 	} else {
 		struct paging_record *pr[4];
-		unsigned int num_pr = 0, macblock = 0;
-		time_t now = time(NULL);
-		unsigned int i, num_imsi = 0;
+		unsigned int num_pr;
+		uint8_t msg_type;
 
 		bts->load.ccch.pch_used += 1;
 
-		/* get (if we have) up to four paging records */
-		for (i = 0; i < ARRAY_SIZE(pr); i++) {
-			if (llist_empty(group_q))
-				break;
-			pr[i] = dequeue_pr(group_q);
-
-			/* check for MAC block */
-			if (pr[i]->type == PAGING_RECORD_MACBLOCK) {
-				macblock = 1;
-				break;
-			}
-
-			num_pr++;
-
-			/* count how many IMSIs are among them */
-			if (pr_is_imsi(pr[i]))
-				num_imsi++;
-		}
-
-		/* Handle MAC block (from the PCU) */
-		if (macblock) {
-			/* re-add normal paging records */
-			for (i = 0; i < num_pr; i++)
-				llist_add(&pr[i]->list, group_q);
-
+		/* Handle MAC block (from the PCU) among the first four records */
+		pr[0] = paging_first_macblock(group_q, ARRAY_SIZE(pr));
+		if (pr[0]) {
+			llist_del(&pr[0]->list);
 			/* get MAC block message and free record */
-			memcpy(out_buf, pr[num_pr]->u.macblock.msg,
-							GSM_MACBLOCK_LEN);
+			memcpy(out_buf, pr[0]->u.macblock.msg, GSM_MACBLOCK_LEN);
 			/* send a confirmation back (if required) */
-			if (pr[num_pr]->u.macblock.confirm)
-				pcu_tx_data_cnf(pr[num_pr]->u.macblock.msg_id, PCU_IF_SAPI_PCH_2);
-			talloc_free(pr[num_pr]);
+			if (pr[0]->u.macblock.confirm)
+				pcu_tx_data_cnf(pr[0]->u.macblock.msg_id, PCU_IF_SAPI_PCH_2);
+			talloc_free(pr[0]);
 			return GSM_MACBLOCK_LEN;
 		}
 
-		/* make sure the TMSIs are ahead of the IMSIs in the array */
-		sort_pr_tmsi_imsi(pr, num_pr);
+		num_pr = paging_pack_block(group_q, pr, &msg_type);
 
-		if (num_pr == 4 && num_imsi == 0) {
-			/* No IMSI: easy case, can use TYPE 3 */
+		if (msg_type == GSM48_MT_RR_PAG_REQ_3) {
 			DEBUGP(DPAG, "Tx PAGING TYPE 3 (4 TMSI)\n");
 			struct p3_rest_octets p3ro;
 			memset(&p3ro, 0, sizeof(p3ro));
@@ -761,8 +1036,7 @@ int paging_gen_msg(struct paging_state *ps, uint8_t *out_buf, struct gsm_time *g
 						 pr[2]->u.normal.identity_lv,
 						 pr[3]->u.normal.identity_lv,
 						 &p3ro);
-		} else if (num_pr >= 3 && num_imsi <= 1) {
-			/* 3 or 4, of which only up to 1 is IMSI */
+		} else if (msg_type == GSM48_MT_RR_PAG_REQ_2) {
 			DEBUGP(DPAG, "Tx PAGING TYPE 2 (2 TMSI,1 xMSI)\n");
 			struct p2_rest_octets p2ro;
 			memset(&p2ro, 0, sizeof(p2ro));
@@ -778,11 +1052,6 @@ int paging_gen_msg(struct paging_state *ps, uint8_t *out_buf, struct gsm_time *g
 						 pr[1]->u.normal.chan_needed,
 						 pr[2]->u.normal.identity_lv,
 						 &p2ro);
-			if (num_pr == 4) {
-				/* re-add #4 for next time */
-				llist_add(&pr[3]->list, group_q);
-				pr[3] = NULL;
-			}
 		} else if (num_pr == 1) {
 			DEBUGP(DPAG, "Tx PAGING TYPE 1 (1 xMSI,1 empty)\n");
 			/* TODO: check if we can include an ASCI notification */
@@ -791,8 +1060,6 @@ int paging_gen_msg(struct paging_state *ps, uint8_t *out_buf, struct gsm_time *g
 						 pr[0]->u.normal.chan_needed,
 						 NULL, 0, NULL, NULL);
 		} else {
-			/* 2 (any type) or
-			 * 3 or 4, of which only 2 will be sent */
 			DEBUGP(DPAG, "Tx PAGING TYPE 1 (2 xMSI)\n");
 			/* TODO: check if we can include an ASCI notification */
 			len = fill_paging_type_1(out_buf,
@@ -800,33 +1067,9 @@ int paging_gen_msg(struct paging_state *ps, uint8_t *out_buf, struct gsm_time *g
 						 pr[0]->u.normal.chan_needed,
 						 pr[1]->u.normal.identity_lv,
 						 pr[1]->u.normal.chan_needed, NULL, NULL);
-			if (num_pr >= 3) {
-				/* re-add #4 for next time */
-				llist_add(&pr[2]->list, group_q);
-				pr[2] = NULL;
-			}
-			if (num_pr == 4) {
-				/* re-add #4 for next time */
-				llist_add(&pr[3]->list, group_q);
-				pr[3] = NULL;
-			}
 		}
 
-		for (i = 0; i < num_pr; i++) {
-			/* skip those that we might have re-added above */
-			if (pr[i] == NULL)
-				continue;
-			rate_ctr_inc2(bts->ctrs, BTS_CTR_PAGING_SENT);
-			/* check if we can expire the paging record,
-			 * or if we need to re-queue it */
-			if (pr[i]->u.normal.expiration_time <= now) {
-				talloc_free(pr[i]);
-				ps->num_paging--;
-				LOGP(DPAG, LOGL_INFO, "Removed paging record, queue_len=%u\n",
-					ps->num_paging);
-			} else
-				llist_add_tail(&pr[i]->list, group_q);
-		}
+		paging_records_sent(ps, group_q, pr, num_pr);
 	}
 	memset(out_buf+len, 0x2B, GSM_MACBLOCK_LEN-len);
 	return len;
@@ -876,6 +1119,15 @@ struct paging_state *paging_init(struct gsm_bts *bts,
 
 	for (i = 0; i < ARRAY_SIZE(ps->paging_queue); i++)
 		INIT_LLIST_HEAD(&ps->paging_queue[i]);
+	for (i = 0; i < ARRAY_SIZE(ps->id_hash); i++)
+		INIT_LLIST_HEAD(&ps->id_hash[i]);
+	for (i = 0; i < ARRAY_SIZE(ps->wheel); i++)
+		INIT_LLIST_HEAD(&ps->wheel[i]);
+	INIT_LLIST_HEAD(&ps->slab_free);
+	if (paging_slab_grow(ps, num_paging_max) < 0) {
+		talloc_free(ps);
+		return NULL;
+	}
 
 	if (!initialized) {
 		osmo_signal_register_handler(SS_GLOBAL, paging_signal_cbfn, NULL);
@@ -890,6 +1142,7 @@ void paging_config(struct paging_state *ps,
 {
 	ps->num_paging_max = num_paging_max;
 	ps->paging_lifetime = paging_lifetime;
+	paging_slab_grow(ps, num_paging_max);
 }
 
 void paging_reset(struct paging_state *ps)
@@ -901,8 +1154,7 @@ void paging_reset(struct paging_state *ps)
 		struct paging_record *pr, *pr2;
 		llist_for_each_entry_safe(pr, pr2, queue, list) {
 			llist_del(&pr->list);
-			talloc_free(pr);
-			ps->num_paging--;
+			paging_record_free(ps, pr);
 		}
 	}
 
@@ -32,6 +32,7 @@
 #include <osmocom/core/select.h>
 #include <osmocom/core/socket.h>
 #include <osmocom/core/write_queue.h>
+#include <osmocom/core/rate_ctr.h>
 #include <osmocom/gsm/gsm23003.h>
 #include <osmocom/gsm/abis_nm.h>
 #include <osmo-bts/logging.h>
@@ -45,6 +46,7 @@
 #include <osmo-bts/l1sap.h>
 #include <osmo-bts/oml.h>
 #include <osmo-bts/abis_osmo.h>
+#include <osmo-bts/shm_ring.h>
 
 uint32_t trx_get_hlayer1(const struct gsm_bts_trx *trx);
 
@@ -61,19 +63,73 @@ static const char *sapi_string[] = {
 	[PCU_IF_SAPI_AGCH_2] =	"AGCH_2",
 };
 
+struct pcu_sock_state {
+	struct osmo_fd listen_bfd;	/* fd for listen socket */
+	struct osmo_wqueue upqueue;	/* For sending messages; has fd for conn. to PCU */
+	bool compact;			/* PCU asked for compact primitives */
+	bool batch;			/* PCU asked for batches of primitives */
+	struct msgb *batch_msg;		/* open batch, queued in upqueue but not yet written */
+	struct shm_link *shm;		/* rings to the PCU, see PCU_SHM_MODE */
+	struct msgb *shm_msg;		/* TXT_IND handing over the rings, queued in upqueue */
+	struct osmo_fd shm_ofd;		/* eventfd signalled by the PCU */
+	uint8_t shm_rx_buf[PCU_IF_BATCH_MAX_LEN]; /* primitive popped from the ring of the PCU */
+	unsigned int conn_nr;		/* connections accepted so far, names the shm object */
+};
+
+/* FIXME: allow multiple BTS */
+static struct gsm_bts *pcu_sock_bts(void)
+{
+	return llist_entry(g_bts_sm->bts_list.next, struct gsm_bts, list);
+}
+
 /*
  * PCU messages
  */
 
+/* Length of a primitive in the compact form: the header and the union member it uses */
+static size_t pcu_prim_compact_len(uint8_t msg_type)
+{
+	const struct gsm_pcu_if *pcu_prim = NULL;
+
+	switch (msg_type) {
+	case PCU_IF_MSG_DATA_IND:
+		return PCUIF_HDR_SIZE + sizeof(pcu_prim->u.data_ind);
+	case PCU_IF_MSG_DATA_CNF_2:
+		return PCUIF_HDR_SIZE + sizeof(pcu_prim->u.data_cnf2);
+	case PCU_IF_MSG_SUSP_REQ:
+		return PCUIF_HDR_SIZE + sizeof(pcu_prim->u.susp_req);
+	case PCU_IF_MSG_APP_INFO_REQ:
+		return PCUIF_HDR_SIZE + sizeof(pcu_prim->u.app_info_req);
+	case PCU_IF_MSG_RTS_REQ:
+		return PCUIF_HDR_SIZE + sizeof(pcu_prim->u.rts_req);
+	case PCU_IF_MSG_RACH_IND:
+		return PCUIF_HDR_SIZE + sizeof(pcu_prim->u.rach_ind);
+	case PCU_IF_MSG_TIME_IND:
+		return PCUIF_HDR_SIZE + sizeof(pcu_prim->u.time_ind);
+	case PCU_IF_MSG_INTERF_IND:
+		return PCUIF_HDR_SIZE + sizeof(pcu_prim->u.interf_ind);
+	case PCU_IF_MSG_PAG_REQ:
+		return PCUIF_HDR_SIZE + sizeof(pcu_prim->u.pag_req);
+	default:
+		/* INFO_IND is the largest union member anyway */
+		return sizeof(struct gsm_pcu_if);
+	}
+}
+
 struct msgb *pcu_msgb_alloc(uint8_t msg_type, uint8_t bts_nr)
 {
+	struct pcu_sock_state *state = g_bts_sm->gprs.pcu_state;
+	size_t len = sizeof(struct gsm_pcu_if);
 	struct msgb *msg;
 	struct gsm_pcu_if *pcu_prim;
 
-	msg = msgb_alloc(sizeof(struct gsm_pcu_if), "pcu_sock_tx");
+	if (state != NULL && state->compact)
+		len = pcu_prim_compact_len(msg_type);
+
+	msg = msgb_alloc(len, "pcu_sock_tx");
 	if (!msg)
 		return NULL;
-	msgb_put(msg, sizeof(struct gsm_pcu_if));
+	msgb_put(msg, len);
 	pcu_prim = (struct gsm_pcu_if *) msg->data;
 	pcu_prim->msg_type = msg_type;
 	pcu_prim->bts_nr = bts_nr;
@@ -282,6 +338,7 @@ int pcu_tx_info_ind(void)
 
 	if (pcu_direct)
 		info_ind->flags |= PCU_IF_FLAG_DIRECT_PHY;
+	info_ind->flags |= PCU_IF_FLAG_COMPACT | PCU_IF_FLAG_BATCH | PCU_IF_FLAG_SHM;
 
 	info_ind->bsic = bts->bsic;
 	/* RAI */
@@ -855,9 +912,52 @@ static int pcu_tx_si_all(struct gsm_bts *bts)
 	return 0;
 }
 
+/* Create the rings and queue their handover (see pcu_sock_shm_handover()) */
+static int pcu_sock_shm_open(struct pcu_sock_state *state)
+{
+	struct gsm_pcu_if *pcu_prim;
+	struct msgb *msg;
+	char name[64];
+	int rc;
+
+	if (state->shm != NULL)
+		return 0;
+
+	msg = pcu_msgb_alloc(PCU_IF_MSG_TXT_IND, 0);
+	if (!msg)
+		return -ENOMEM;
+	pcu_prim = (struct gsm_pcu_if *) msg->data;
+	pcu_prim->u.txt_ind.type = PCU_SHM_MODE;
+
+	/* a new object for each connection, the previous PCU may still have one mapped */
+	snprintf(name, sizeof(name), "/osmo-bts-pcu.%d.%u", (int) getpid(), state->conn_nr);
+	state->shm = shm_link_create(state, name, SHM_RING_DEF_SIZE);
+	if (state->shm == NULL) {
+		LOGP(DPCU, LOGL_ERROR, "Could not create PCU shm rings %s: %s, "
+		     "the PCU keeps using the socket\n", name, strerror(errno));
+		/* answer without the rings (no file descriptors) */
+		if (osmo_wqueue_enqueue(&state->upqueue, msg) < 0)
+			msgb_free(msg);
+		return -EIO;
+	}
+
+	/* not through pcu_sock_send(), it must not end up in a batch */
+	rc = osmo_wqueue_enqueue(&state->upqueue, msg);
+	if (rc < 0) {
+		msgb_free(msg);
+		shm_link_free(state->shm);
+		state->shm = NULL;
+		return rc;
+	}
+	state->shm_msg = msg;
+
+	return 0;
+}
+
 static int pcu_rx_txt_ind(struct gsm_bts *bts,
 			  struct gsm_pcu_if_txt_ind *txt)
 {
+	struct pcu_sock_state *state = g_bts_sm->gprs.pcu_state;
 	int rc;
 
 	switch (txt->type) {
@@ -880,6 +980,18 @@ static int pcu_rx_txt_ind(struct gsm_bts *bts,
 		oml_tx_failure_event_rep(&bts->gprs.cell.mo, NM_SEVER_INDETERMINATE, OSMO_EVT_EXT_ALARM,
 					 txt->text);
 		break;
+	case PCU_COMPACT_MODE:
+		LOGP(DPCU, LOGL_INFO, "PCU switches to compact primitives\n");
+		state->compact = true;
+		break;
+	case PCU_BATCH_MODE:
+		LOGP(DPCU, LOGL_INFO, "PCU switches to batches of compact primitives\n");
+		state->compact = true;
+		state->batch = true;
+		break;
+	case PCU_SHM_MODE:
+		LOGP(DPCU, LOGL_INFO, "PCU asks for shm rings\n");
+		return pcu_sock_shm_open(state);
 	default:
 		LOGP(DPCU, LOGL_ERROR, "Unknown TXT_IND type %u received\n",
 		     txt->type);
@@ -937,6 +1049,59 @@ static int pcu_rx_act_req(struct gsm_bts *bts,
 			return -EINVAL; \
 		} \
 	} while (0)
+static int pcu_rx(uint8_t msg_type, struct gsm_pcu_if *pcu_prim, size_t prim_len);
+
+/* Each primitive of a batch goes through pcu_rx() as if it came alone */
+static int pcu_rx_batch(const struct gsm_pcu_if_batch *batch, size_t len)
+{
+	const struct gsm_pcu_if_batch_entry *entry;
+	struct gsm_pcu_if pcu_prim;
+	size_t offs = 0;
+	unsigned int i;
+	int rc = 0;
+
+	if (batch->length > len) {
+		LOGP(DPCU, LOGL_ERROR, "Received %zu bytes of PCU batch, but its length "
+		     "is %u, discarding\n", len, batch->length);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < batch->num; i++) {
+		if (offs + sizeof(*entry) > batch->length)
+			goto short_batch;
+		entry = (const struct gsm_pcu_if_batch_entry *) &batch->data[offs];
+		offs += sizeof(*entry);
+		if (offs + entry->length > batch->length)
+			goto short_batch;
+		offs += entry->length;
+
+		if (entry->length < PCUIF_HDR_SIZE || entry->length > sizeof(pcu_prim)) {
+			LOGP(DPCU, LOGL_ERROR, "Received primitive of %u bytes in PCU batch, "
+			     "discarding\n", entry->length);
+			rc = -EINVAL;
+			continue;
+		}
+
+		/* same as pcu_sock_read() for a primitive in the compact form */
+		memcpy(&pcu_prim, entry->prim, entry->length);
+		memset((uint8_t *) &pcu_prim + entry->length, 0, sizeof(pcu_prim) - entry->length);
+		if (pcu_prim.msg_type == PCU_IF_MSG_BATCH) {
+			LOGP(DPCU, LOGL_ERROR, "Received PCU batch in a batch, discarding\n");
+			rc = -EINVAL;
+			continue;
+		}
+		if (pcu_rx(pcu_prim.msg_type, &pcu_prim, entry->length) < 0)
+			rc = -EINVAL;
+	}
+
+	return rc;
+
+short_batch:
+	LOGP(DPCU, LOGL_ERROR, "PCU batch ends after %u of %u primitives, discarding the rest\n",
+	     i, batch->num);
+	return -EINVAL;
+}
+
 static int pcu_rx(uint8_t msg_type, struct gsm_pcu_if *pcu_prim, size_t prim_len)
 {
 	int rc = 0;
@@ -948,6 +1113,9 @@ static int pcu_rx(uint8_t msg_type, struct gsm_pcu_if *pcu_prim, size_t prim_len
 		return -EINVAL;
 	}
 
+	if (msg_type != PCU_IF_MSG_BATCH)
+		rate_ctr_inc2(bts->ctrs, BTS_CTR_PCU_RX_PRIMS);
+
 	switch (msg_type) {
 	case PCU_IF_MSG_DATA_REQ:
 		CHECK_IF_MSG_SIZE(prim_len, pcu_prim->u.data_req);
@@ -962,7 +1130,8 @@ static int pcu_rx(uint8_t msg_type, struct gsm_pcu_if *pcu_prim, size_t prim_len
 		rc = pcu_rx_act_req(bts, &pcu_prim->u.act_req);
 		break;
 	case PCU_IF_MSG_TXT_IND:
-		CHECK_IF_MSG_SIZE(prim_len, pcu_prim->u.txt_ind);
+		/* the text may end after its NUL (compact form), see pcu_sock_read() */
+		CHECK_IF_MSG_SIZE(prim_len, pcu_prim->u.txt_ind.type);
 		rc = pcu_rx_txt_ind(bts, &pcu_prim->u.txt_ind);
 		break;
 	case PCU_IF_MSG_CONTAINER:
@@ -976,6 +1145,10 @@ static int pcu_rx(uint8_t msg_type, struct gsm_pcu_if *pcu_prim, size_t prim_len
 		}
 		rc = abis_osmo_pcu_tx_container(bts, &pcu_prim->u.container);
 		break;
+	case PCU_IF_MSG_BATCH:
+		CHECK_IF_MSG_SIZE(prim_len, pcu_prim->u.batch);
+		rc = pcu_rx_batch(&pcu_prim->u.batch, prim_len - PCUIF_HDR_SIZE - sizeof(pcu_prim->u.batch));
+		break;
 	default:
 		LOGP(DPCU, LOGL_ERROR, "Received unknown PCU msg type %d\n",
 			msg_type);
@@ -985,17 +1158,179 @@ static int pcu_rx(uint8_t msg_type, struct gsm_pcu_if *pcu_prim, size_t prim_len
 	return rc;
 }
 
+/* Handle len bytes received from the PCU, buf has room for a full struct gsm_pcu_if */
+static int pcu_rx_buf(uint8_t *buf, size_t len)
+{
+	struct gsm_pcu_if *pcu_prim = (struct gsm_pcu_if *) buf;
+
+	if (len < PCUIF_HDR_SIZE) {
+		LOGP(DPCU, LOGL_ERROR, "Received %zu bytes on PCU Socket, but primitive hdr size "
+		     "is %zu, discarding\n", len, PCUIF_HDR_SIZE);
+		return 0;
+	}
+
+	/* A primitive in the compact form ends after the union member it uses:
+	 * let the rest of struct gsm_pcu_if read as zero, like in the full form */
+	if (len < sizeof(*pcu_prim))
+		memset(buf + len, 0, sizeof(*pcu_prim) - len);
+
+	return pcu_rx(pcu_prim->msg_type, pcu_prim, len);
+}
+
 /*
  * PCU socket interface
  */
 
-struct pcu_sock_state {
-	struct osmo_fd listen_bfd;	/* fd for listen socket */
-	struct osmo_wqueue upqueue;	/* For sending messages; has fd for conn. to PCU */
-};
-
 static void pcu_sock_close(struct pcu_sock_state *state);
 
+/* Number of primitives in a msgb sent to the PCU */
+static unsigned int pcu_msgb_num_prims(const struct msgb *msg)
+{
+	const struct gsm_pcu_if *pcu_prim = (const struct gsm_pcu_if *) msg->data;
+
+	if (pcu_prim->msg_type == PCU_IF_MSG_BATCH)
+		return pcu_prim->u.batch.num;
+	return 1;
+}
+
+/* Enqueue a primitive (or batch) into the ring to the PCU, msg is freed */
+static int pcu_sock_shm_push(struct pcu_sock_state *state, struct msgb *msg)
+{
+	int rc;
+
+	rc = shm_link_push(state->shm, msgb_data(msg), msgb_length(msg));
+	if (OSMO_UNLIKELY(rc < 0))
+		LOGP(DPCU, LOGL_ERROR, "Failed to enqueue PCU primitive into the shm ring (%s)\n",
+		     strerror(-rc));
+	else
+		rate_ctr_add2(pcu_sock_bts()->ctrs, BTS_CTR_PCU_TX_PRIMS, pcu_msgb_num_prims(msg));
+	msgb_free(msg);
+
+	return rc;
+}
+
+/* Consume primitives from the ring of the PCU */
+static int pcu_sock_shm_read_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct pcu_sock_state *state = ofd->data;
+	int len;
+
+	shm_link_rx_ack(state->shm);
+
+	/* Drain the ring, a wakeup is requested once it is empty */
+	while ((len = shm_link_pop(state->shm, state->shm_rx_buf, sizeof(state->shm_rx_buf))) != -EAGAIN) {
+		if (OSMO_UNLIKELY(len == -EIO)) {
+			LOGP(DPCU, LOGL_ERROR, "The shm ring of the PCU is corrupt, closing the connection\n");
+			pcu_sock_close(state);
+			break;
+		}
+		if (OSMO_UNLIKELY(len <= 0)) {
+			LOGP(DPCU, LOGL_ERROR, "Rx malformed PCU primitive from the shm ring (rc=%d)\n", len);
+			continue;
+		}
+		pcu_rx_buf(state->shm_rx_buf, len);
+		/* the connection may have been closed meanwhile */
+		if (state->shm == NULL)
+			break;
+	}
+
+	return 0;
+}
+
+/* Write the TXT_IND queued by pcu_sock_shm_open() along with the rings;
+ * the primitives queued behind it go through the rings instead */
+static int pcu_sock_shm_handover(struct pcu_sock_state *state, struct msgb *msg)
+{
+	struct osmo_wqueue *queue = &state->upqueue;
+	struct msgb *qmsg;
+	int rc;
+
+	rc = shm_link_send_fds_msg(state->shm, queue->bfd.fd, msgb_data(msg), msgb_length(msg));
+	if (rc == -EAGAIN)
+		return -EAGAIN;
+	state->shm_msg = NULL;
+	if (rc < 0) {
+		LOGP(DPCU, LOGL_ERROR, "Failed to hand over the PCU shm rings (%s), "
+		     "closing the connection\n", strerror(-rc));
+		goto close;
+	}
+
+	osmo_fd_setup(&state->shm_ofd, state->shm->efd_rx, OSMO_FD_READ,
+		      pcu_sock_shm_read_cb, state, 0);
+	if (osmo_fd_register(&state->shm_ofd) != 0) {
+		LOGP(DPCU, LOGL_ERROR, "Failed to register the PCU shm eventfd, closing the connection\n");
+		state->shm_ofd.fd = -1;
+		goto close;
+	}
+
+	LOGP(DPCU, LOGL_NOTICE, "PCU attached to the shm rings\n");
+
+	/* keep the order of the primitives */
+	while ((qmsg = msgb_dequeue(&queue->msg_queue)) != NULL) {
+		queue->current_length--;
+		if (qmsg == state->batch_msg)
+			state->batch_msg = NULL;
+		pcu_sock_shm_push(state, qmsg);
+	}
+
+	return 0;
+
+close:
+	/* The PCU waits for the rings, or may have them already: neither
+	 * side can tell which primitives went where, so start over */
+	pcu_sock_close(state);
+	return -1;
+}
+
+/* Append a primitive to the open batch.  Returns NULL if it went into the
+ * batch that is queued already, otherwise the msgb to queue: a new batch,
+ * or the primitive itself if it does not fit into a batch or if there is
+ * no memory for one. */
+static struct msgb *pcu_sock_batch_add(struct pcu_sock_state *state, struct msgb *msg)
+{
+	const struct gsm_pcu_if *pcu_prim = (const struct gsm_pcu_if *) msg->data;
+	struct gsm_pcu_if_batch_entry *entry;
+	struct gsm_pcu_if *batch_prim;
+	struct msgb *batch_msg = state->batch_msg;
+	size_t len = msgb_length(msg);
+	bool new_batch = false;
+
+	/* too large even for an empty batch: queue it on its own, behind the
+	 * open batch, which must not take any later primitives then */
+	if (PCUIF_HDR_SIZE + sizeof(batch_prim->u.batch) + sizeof(*entry) + len > PCU_IF_BATCH_MAX_LEN) {
+		state->batch_msg = NULL;
+		return msg;
+	}
+
+	/* a TIME_IND starts the primitives of the next MAC block */
+	if (batch_msg == NULL || pcu_prim->msg_type == PCU_IF_MSG_TIME_IND ||
+	    msgb_tailroom(batch_msg) < sizeof(*entry) + len) {
+		batch_msg = msgb_alloc(PCU_IF_BATCH_MAX_LEN, "pcu_sock_tx_batch");
+		if (!batch_msg) {
+			state->batch_msg = NULL;
+			return msg;
+		}
+		msgb_put(batch_msg, PCUIF_HDR_SIZE + sizeof(batch_prim->u.batch));
+		batch_prim = (struct gsm_pcu_if *) batch_msg->data;
+		batch_prim->msg_type = PCU_IF_MSG_BATCH;
+		batch_prim->bts_nr = pcu_prim->bts_nr;
+		new_batch = true;
+	}
+
+	batch_prim = (struct gsm_pcu_if *) batch_msg->data;
+	entry = (struct gsm_pcu_if_batch_entry *) msgb_put(batch_msg, sizeof(*entry) + len);
+	entry->length = len;
+	memcpy(entry->prim, msgb_data(msg), len);
+	batch_prim->u.batch.num++;
+	batch_prim->u.batch.length += sizeof(*entry) + len;
+	msgb_free(msg);
+
+	if (!new_batch)
+		return NULL;
+	state->batch_msg = batch_msg;
+	return batch_msg;
+}
+
 int pcu_sock_send(struct msgb *msg)
 {
 	struct pcu_sock_state *state = g_bts_sm->gprs.pcu_state;
@@ -1021,6 +1356,24 @@ int pcu_sock_send(struct msgb *msg)
 		return -EIO;
 	}
 
+	/* once handed over, the rings carry all primitives */
+	if (state->shm != NULL && state->shm_msg == NULL) {
+		rc = pcu_sock_shm_push(state, msg);
+		if (rc == -ENOSPC) {
+			LOGP(DPCU, LOGL_NOTICE, "PCU not reacting (shm ring full). Closing connection\n");
+			pcu_sock_close(state);
+		}
+		return rc;
+	}
+
+	/* the primitives of a MAC block are collected until pcu_sock_flush()
+	 * at the end of the frame, or until the socket is found writable */
+	if (state->batch) {
+		msg = pcu_sock_batch_add(state, msg);
+		if (msg == NULL)
+			return 0;
+	}
+
 	rc = osmo_wqueue_enqueue(&state->upqueue, msg);
 	if (rc < 0) {
 		if (rc == -ENOSPC)
@@ -1033,6 +1386,32 @@ int pcu_sock_send(struct msgb *msg)
 	return 0;
 }
 
+/*! Write the open batch of primitives to the PCU now, along with what is
+ *  queued ahead of it, instead of when the main loop finds the socket
+ *  writable.  Called once the primitives of a frame are complete. */
+void pcu_sock_flush(void)
+{
+	struct pcu_sock_state *state = g_bts_sm->gprs.pcu_state;
+	struct osmo_wqueue *queue;
+	struct msgb *batch_msg;
+
+	if (!state || state->batch_msg == NULL)
+		return;
+	queue = &state->upqueue;
+	batch_msg = state->batch_msg;
+
+	/* pcu_sock_write() closes the batch; on EAGAIN the main loop takes over */
+	while (queue->bfd.fd > 0 && !llist_empty(&queue->msg_queue)) {
+		const struct msgb *msg = llist_first_entry(&queue->msg_queue, struct msgb, list);
+		const bool last = (msg == batch_msg);
+		const unsigned int len = queue->current_length;
+
+		osmo_wqueue_bfd_cb(&queue->bfd, OSMO_FD_WRITE);
+		if (last || queue->current_length == len)
+			break;
+	}
+}
+
 static void pcu_sock_close(struct pcu_sock_state *state)
 {
 	struct osmo_fd *bfd = &state->upqueue.bfd;
@@ -1040,19 +1419,36 @@ static void pcu_sock_close(struct pcu_sock_state *state)
 	struct gsm_bts_trx *trx;
 	unsigned int tn;
 
-	/* FIXME: allow multiple BTS */
-	bts = llist_entry(g_bts_sm->bts_list.next, struct gsm_bts, list);
+	bts = pcu_sock_bts();
 
 	LOGP(DPCU, LOGL_NOTICE, "PCU socket has LOST connection\n");
 	oml_tx_failure_event_rep(&bts->gprs.cell.mo, NM_SEVER_MAJOR, OSMO_EVT_PCU_VERS,
 				 "PCU socket has LOST connection");
 
 	bts->pcu_version[0] = '\0';
+	state->compact = false;
+	state->batch = false;
+	/* freed with the upqueue below */
+	state->batch_msg = NULL;
+	state->shm_msg = NULL;
+
+	if (state->shm != NULL) {
+		/* The eventfd is owned (and closed) by the shm_link */
+		if (state->shm_ofd.fd >= 0) {
+			osmo_fd_unregister(&state->shm_ofd);
+			state->shm_ofd.fd = -1;
+		}
+		shm_link_free(state->shm);
+		state->shm = NULL;
+	}
 
 	osmo_fd_unregister(bfd);
 	close(bfd->fd);
 	bfd->fd = -1;
 
+	/* stop sending SI13 on the BCCH */
+	bts_sysinfo_sched_update(bts);
+
 	/* patch SI3 to remove GPRS indicator */
 	regenerate_si3_restoctets(bts);
 	regenerate_si4_restoctets(bts);
@@ -1091,12 +1487,10 @@ static int pcu_sock_read(struct osmo_fd *bfd)
 	struct msgb *msg;
 	int rc;
 
-	msg = msgb_alloc(sizeof(*pcu_prim) + 1000, "pcu_sock_rx");
+	msg = msgb_alloc(OSMO_MAX(sizeof(*pcu_prim) + 1000, PCU_IF_BATCH_MAX_LEN), "pcu_sock_rx");
 	if (!msg)
 		return -ENOMEM;
 
-	pcu_prim = (struct gsm_pcu_if *) msg->tail;
-
 	rc = recv(bfd->fd, msg->tail, msgb_tailroom(msg), 0);
 	if (rc == 0)
 		goto close;
@@ -1109,14 +1503,9 @@ static int pcu_sock_read(struct osmo_fd *bfd)
 		goto close;
 	}
 
-	if (rc < PCUIF_HDR_SIZE) {
-		LOGP(DPCU, LOGL_ERROR, "Received %d bytes on PCU Socket, but primitive hdr size "
-		     "is %zu, discarding\n", rc, PCUIF_HDR_SIZE);
-		msgb_free(msg);
-		return 0;
-	}
+	rate_ctr_inc2(pcu_sock_bts()->ctrs, BTS_CTR_PCU_RX_READS);
 
-	rc = pcu_rx(pcu_prim->msg_type, pcu_prim, rc);
+	rc = pcu_rx_buf(msg->tail, rc);
 
 	/* as we always synchronously process the message in pcu_rx() and
 	 * its callbacks, we can free the message here. */
@@ -1133,10 +1522,16 @@ close:
 static int pcu_sock_write(struct osmo_fd *bfd, struct msgb *msg)
 {
 	struct pcu_sock_state *state = bfd->data;
+	struct rate_ctr_group *ctrs = pcu_sock_bts()->ctrs;
 	int rc;
 
 	/* bug hunter 8-): maybe someone forgot msgb_put(...) ? */
 	OSMO_ASSERT(msgb_length(msg) > 0);
+	if (msg == state->shm_msg)
+		return pcu_sock_shm_handover(state, msg);
+	/* no more primitives for this batch, even if it has to be retried */
+	if (msg == state->batch_msg)
+		state->batch_msg = NULL;
 	/* try to send it over the socket */
 	rc = write(bfd->fd, msgb_data(msg), msgb_length(msg));
 	if (OSMO_UNLIKELY(rc == 0))
@@ -1146,6 +1541,9 @@ static int pcu_sock_write(struct osmo_fd *bfd, struct msgb *msg)
 			return -EAGAIN;
 		return -1;
 	}
+
+	rate_ctr_inc2(ctrs, BTS_CTR_PCU_TX_WRITES);
+	rate_ctr_add2(ctrs, BTS_CTR_PCU_TX_PRIMS, pcu_msgb_num_prims(msg));
 	return 0;
 
 close:
@@ -1159,6 +1557,7 @@ static int pcu_sock_accept(struct osmo_fd *bfd, unsigned int flags)
 	struct pcu_sock_state *state = (struct pcu_sock_state *)bfd->data;
 	struct osmo_fd *conn_bfd = &state->upqueue.bfd;
 	struct sockaddr_un un_addr;
+	struct gsm_bts *bts;
 	socklen_t len;
 	int fd;
 
@@ -1187,6 +1586,11 @@ static int pcu_sock_accept(struct osmo_fd *bfd, unsigned int flags)
 	}
 
 	LOGP(DPCU, LOGL_NOTICE, "PCU socket connected to external PCU\n");
+	state->conn_nr++;
+
+	/* SI13 is scheduled on the BCCH while the PCU is connected */
+	llist_for_each_entry(bts, &g_bts_sm->bts_list, list)
+		bts_sysinfo_sched_update(bts);
 
 	/* send current info */
 	pcu_tx_info_ind();
@@ -1208,6 +1612,7 @@ int pcu_sock_init(const char *path, int qlength_max)
 	state->upqueue.read_cb = pcu_sock_read;
 	state->upqueue.write_cb = pcu_sock_write;
 	state->upqueue.bfd.fd = -1;
+	state->shm_ofd.fd = -1;
 
 	bfd = &state->listen_bfd;
 
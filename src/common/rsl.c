@@ -1031,20 +1031,51 @@ static inline void lapdm_ui_prefix(uint8_t *buf, uint32_t *valid, const uint8_t
  *  \param[out] bts BTS in whose System Information State we shall store
  *  \param[in] current input data (L3 without L2/L1 header)
  *  \param[in] osmo_si Sytstem Information Type (SYSINFO_TYPE_*)
- *  \param[in] len length of \a current in octets */
-static inline void lapdm_ui_prefix_bts(struct gsm_bts *bts, const uint8_t *current, uint8_t osmo_si, uint16_t len)
+ *  \param[in] len length of \a current in octets
+ *  \returns the new SACCH filling message of the BTS (not modifiable anymore) */
+static struct gsm_sacch_si *lapdm_ui_prefix_bts(struct gsm_bts *bts, const uint8_t *current, uint8_t osmo_si,
+						uint16_t len)
 {
-	lapdm_ui_prefix(GSM_BTS_SI(bts, osmo_si), &bts->si_valid, current, osmo_si, len);
+	struct gsm_sacch_si *si = sacch_si_alloc(bts);
+
+	lapdm_ui_prefix(si->buf, &bts->si_valid, current, osmo_si, len);
+	memcpy(GSM_BTS_SI(bts, osmo_si), si->buf, sizeof(sysinfo_buf_t));
+
+	/* lchans still referencing the previous one keep it until they follow */
+	sacch_si_put(bts->sacch_si[osmo_si]);
+	bts->sacch_si[osmo_si] = si;
+
+	return si;
 }
 
-/*! Prefix a given SACCH frame with a L2/LAPDm UI header and store it in given lchan SACCH buffer
+/*! Prefix a given SACCH frame with a L2/LAPDm UI header and store it in given lchan SACCH buffer.
+ *  If the result equals the SACCH filling of the BTS, the lchan shares it, otherwise it gets its own copy.
  *  \param[out] lchan Logical Channel in whose System Information State we shall store
  *  \param[in] current input data (L3 without L2/L1 header)
  *  \param[in] osmo_si Sytstem Information Type (SYSINFO_TYPE_*)
- *  \param[in] len length of \a current in octets */
-static inline void lapdm_ui_prefix_lchan(struct gsm_lchan *lchan, const uint8_t *current, uint8_t osmo_si, uint16_t len)
+ *  \param[in] len length of \a current in octets
+ *  \returns true if the lchan got its own copy, false if it shares the one of the BTS */
+static bool lapdm_ui_prefix_lchan(struct gsm_lchan *lchan, const uint8_t *current, uint8_t osmo_si, uint16_t len)
 {
-	lapdm_ui_prefix(GSM_LCHAN_SI(lchan, osmo_si), &lchan->si.valid, current, osmo_si, len);
+	struct gsm_bts *bts = lchan->ts->trx->bts;
+	struct gsm_sacch_si *si;
+	sysinfo_buf_t buf;
+	uint32_t valid = 0;
+
+	lapdm_ui_prefix(buf, &valid, current, osmo_si, len);
+
+	if ((bts->si_valid & (1 << osmo_si)) && bts->sacch_si[osmo_si] != NULL &&
+	    memcmp(bts->sacch_si[osmo_si]->buf, buf, sizeof(buf)) == 0) {
+		lchan_sacch_si_set(lchan, osmo_si, bts->sacch_si[osmo_si]);
+		return false;
+	}
+
+	si = sacch_si_alloc(bts);
+	memcpy(si->buf, buf, sizeof(buf));
+	lchan_sacch_si_set(lchan, osmo_si, si);
+	sacch_si_put(si);
+
+	return true;
 }
 
 /* 8.6.2 SACCH FILLING */
@@ -1075,9 +1106,10 @@ static int rsl_rx_sacch_fill(struct gsm_bts_trx *trx, struct msgb *msg)
 	}
 	if (TLVP_PRESENT(&tp, RSL_IE_L3_INFO)) {
 		uint16_t len = TLVP_LEN(&tp, RSL_IE_L3_INFO);
+		struct gsm_sacch_si *si;
 		struct gsm_bts_trx *t;
 
-		lapdm_ui_prefix_bts(bts, TLVP_VAL(&tp, RSL_IE_L3_INFO), osmo_si, len);
+		si = lapdm_ui_prefix_bts(bts, TLVP_VAL(&tp, RSL_IE_L3_INFO), osmo_si, len);
 
 		/* Propagate SI change to all lchans which adhere to BTS-global default. */
 		llist_for_each_entry(t, &bts->trx_list, list) {
@@ -1088,7 +1120,7 @@ static int rsl_rx_sacch_fill(struct gsm_bts_trx *trx, struct msgb *msg)
 					struct gsm_lchan *lchan = &ts->lchan[j];
 					if (lchan->state == LCHAN_S_NONE || (lchan->si.overridden & (1 << osmo_si)))
 						continue;
-					lapdm_ui_prefix_lchan(lchan, TLVP_VAL(&tp, RSL_IE_L3_INFO), osmo_si, len);
+					lchan_sacch_si_set(lchan, osmo_si, si);
 				}
 			}
 		}
@@ -1099,6 +1131,8 @@ static int rsl_rx_sacch_fill(struct gsm_bts_trx *trx, struct msgb *msg)
 		struct gsm_bts_trx *t;
 
 		bts->si_valid &= ~(1 << osmo_si);
+		sacch_si_put(bts->sacch_si[osmo_si]);
+		bts->sacch_si[osmo_si] = NULL;
 
 		/* Propagate SI change to all lchans which adhere to BTS-global default. */
 		llist_for_each_entry(t, &bts->trx_list, list) {
@@ -1109,7 +1143,7 @@ static int rsl_rx_sacch_fill(struct gsm_bts_trx *trx, struct msgb *msg)
 					struct gsm_lchan *lchan = &ts->lchan[j];
 					if (lchan->state == LCHAN_S_NONE || (lchan->si.overridden & (1 << osmo_si)))
 						continue;
-					lchan->si.valid &= ~(1 << osmo_si);
+					lchan_sacch_si_set(lchan, osmo_si, NULL);
 				}
 			}
 		}
@@ -1688,7 +1722,7 @@ int rsl_tx_chan_rqd(struct gsm_bts_trx *trx, struct gsm_time *gtime,
 	return abis_bts_rsl_sendmsg(nmsg);
 }
 
-/* copy the SACCH related sysinfo from BTS global buffer to lchan specific buffer */
+/* let the lchan use the SACCH related sysinfo of the BTS (by reference) */
 static void copy_sacch_si_to_lchan(struct gsm_lchan *lchan)
 {
 	struct gsm_bts *bts = lchan->ts->trx->bts;
@@ -1704,11 +1738,10 @@ static void copy_sacch_si_to_lchan(struct gsm_lchan *lchan)
 		if (osmo_si == SYSINFO_TYPE_NONE)
 			continue;
 		if (!(bts->si_valid & osmo_si_shifted)) {
-			lchan->si.valid &= ~osmo_si_shifted;
+			lchan_sacch_si_set(lchan, osmo_si, NULL);
 			continue;
 		}
-		lchan->si.valid |= osmo_si_shifted;
-		memcpy(GSM_LCHAN_SI(lchan, osmo_si), GSM_BTS_SI(bts, osmo_si), sizeof(sysinfo_buf_t));
+		lchan_sacch_si_set(lchan, osmo_si, bts->sacch_si[osmo_si]);
 	}
 }
 
@@ -2680,7 +2713,6 @@ static int rsl_rx_sacch_inf_mod(struct msgb *msg)
 {
 	struct abis_rsl_dchan_hdr *dch = msgb_l2(msg);
 	struct gsm_lchan *lchan = msg->lchan;
-	struct gsm_bts *bts = lchan->ts->trx->bts;
 	struct tlv_parsed tp;
 	uint8_t rsl_si, osmo_si;
 
@@ -2710,8 +2742,7 @@ static int rsl_rx_sacch_inf_mod(struct msgb *msg)
 	if (TLVP_PRESENT(&tp, RSL_IE_L3_INFO)) {
 		uint16_t len = TLVP_LEN(&tp, RSL_IE_L3_INFO);
 
-		lapdm_ui_prefix_lchan(lchan, TLVP_VAL(&tp, RSL_IE_L3_INFO), osmo_si, len);
-		if (memcmp(GSM_BTS_SI(bts, osmo_si), TLVP_VAL(&tp, RSL_IE_L3_INFO), sizeof(sysinfo_buf_t)) != 0)
+		if (lapdm_ui_prefix_lchan(lchan, TLVP_VAL(&tp, RSL_IE_L3_INFO), osmo_si, len))
 			lchan->si.overridden |= (1 << osmo_si);
 		else
 			lchan->si.overridden &= ~(1 << osmo_si);
@@ -2719,7 +2750,7 @@ static int rsl_rx_sacch_inf_mod(struct msgb *msg)
 		LOGPLCHAN(lchan, DRSL, LOGL_INFO, "Rx RSL SACCH FILLING (SI%s)\n",
 			  get_value_string(osmo_sitype_strs, osmo_si));
 	} else {
-		lchan->si.valid &= ~(1 << osmo_si);
+		lchan_sacch_si_set(lchan, osmo_si, NULL);
 		LOGPLCHAN(lchan, DRSL, LOGL_INFO, "Rx RSL Disabling SACCH FILLING (SI%s)\n",
 			  get_value_string(osmo_sitype_strs, osmo_si));
 	}
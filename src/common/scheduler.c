@@ -26,6 +26,7 @@
 #include <errno.h>
 #include <stdint.h>
 #include <ctype.h>
+#include <stdarg.h>
 
 #include <osmocom/core/msgb.h>
 #include <osmocom/core/talloc.h>
@@ -45,6 +46,8 @@
 #include <osmo-bts/scheduler.h>
 #include <osmo-bts/scheduler_backend.h>
 #include <osmo-bts/bts.h>
+#include <osmo-bts/a5_ks.h>
+#include <osmo-bts/msgb_pool.h>
 
 extern void *tall_bts_ctx;
 
@@ -574,14 +577,11 @@ const struct trx_chan_desc trx_chan_desc[_TRX_CHAN_MAX] = {
 	},
 };
 
-enum {
-	L1SCHED_TS_CTR_DL_LATE,
-	L1SCHED_TS_CTR_DL_NOT_FOUND,
-};
-
 static const struct rate_ctr_desc l1sched_ts_ctr_desc[] = {
 	[L1SCHED_TS_CTR_DL_LATE] =	{"l1sched_ts:dl_late", "Downlink frames arrived too late to submit to lower layers"},
 	[L1SCHED_TS_CTR_DL_NOT_FOUND] =	{"l1sched_ts:dl_not_found", "Downlink frames not found while scheduling"},
+	[L1SCHED_TS_CTR_A5_KS_HIT] =	{"l1sched_ts:a5_ks_hit", "A5 keystreams of bursts found in the cache"},
+	[L1SCHED_TS_CTR_A5_KS_MISS] =	{"l1sched_ts:a5_ks_miss", "A5 keystreams of bursts generated on a cache miss"},
 };
 static const struct rate_ctr_group_desc l1sched_ts_ctrg_desc = {
 	"l1sched_ts",
@@ -617,7 +617,8 @@ static void trx_sched_init_ts(struct gsm_bts_trx_ts *ts,
 		 ts->vamos.is_shadow ? "-shadow" : "");
 	rate_ctr_group_set_name(l1ts->ctrs, name);
 
-	INIT_LLIST_HEAD(&l1ts->dl_prims);
+	for (i = 0; i < ARRAY_SIZE(l1ts->dl_prims); i++)
+		INIT_LLIST_HEAD(&l1ts->dl_prims[i]);
 
 	for (i = 0; i < ARRAY_SIZE(l1ts->chan_state); i++) {
 		struct l1sched_chan_state *chan_state;
@@ -652,7 +653,9 @@ static void trx_sched_clean_ts(struct gsm_bts_trx_ts *ts)
 	struct l1sched_ts *l1ts = ts->priv;
 	unsigned int i;
 
-	msgb_queue_free(&l1ts->dl_prims);
+	for (i = 0; i < ARRAY_SIZE(l1ts->dl_prims); i++)
+		msgb_queue_free(&l1ts->dl_prims[i]);
+	memset(&l1ts->dl_prims_used[0], 0x00, sizeof(l1ts->dl_prims_used));
 	rate_ctr_group_free(l1ts->ctrs);
 	l1ts->ctrs = NULL;
 
@@ -680,49 +683,314 @@ void trx_sched_clean(struct gsm_bts_trx *trx)
 
 	/* Free previously allocated shadow timeslots */
 	gsm_bts_trx_free_shadow_ts(trx);
+
+	trx->l1sched.mf_ts = 0x00;
+	trx->l1sched.active_ts = 0x00;
 }
 
-struct msgb *_sched_dequeue_prim(struct l1sched_ts *l1ts, const struct trx_dl_burst_req *br)
+/* Downlink context of the current thread (if any), see struct l1sched_dl_ctx */
+__thread struct l1sched_dl_ctx *l1sched_dl_ctx_cur;
+
+void l1sched_dl_ctx_init(struct l1sched_dl_ctx *ctx)
+{
+	INIT_LLIST_HEAD(&ctx->pool);
+	INIT_LLIST_HEAD(&ctx->free_list);
+	ctx->pool_len = 0;
+	ctx->ctrs_num = 0;
+	ctx->ctrs_dropped = 0;
+	ctx->logs_num = 0;
+	ctx->logs_dropped = 0;
+}
+
+/*! Fill up the msgb pool of a Downlink context (main thread only) */
+void l1sched_dl_ctx_refill(struct l1sched_dl_ctx *ctx)
+{
+	struct msgb *msg;
+
+	while (ctx->pool_len < L1SCHED_DL_CTX_POOL_SIZE) {
+		msg = msgb_alloc(L1SCHED_DL_CTX_MSGB_SIZE, "l1sched_dl_ctx");
+		OSMO_ASSERT(msg != NULL);
+		llist_add_tail(&msg->list, &ctx->pool);
+		ctx->pool_len++;
+	}
+}
+
+/*! Do what was deferred within a Downlink context (main thread only):
+ *  free the released msgb, log the messages, update the rate counters */
+void l1sched_dl_ctx_flush(struct l1sched_dl_ctx *ctx)
+{
+	struct msgb *msg, *msg2;
+	unsigned int i;
+
+	llist_for_each_entry_safe(msg, msg2, &ctx->free_list, list) {
+		llist_del(&msg->list);
+		msgb_free(msg);
+	}
+
+	for (i = 0; i < ctx->logs_num; i++) {
+		const struct l1sched_dl_ctx_log *log = &ctx->logs[i];
+		LOGPSRC(log->subsys, log->level, log->file, log->line, "%s", log->text);
+	}
+	if (OSMO_UNLIKELY(ctx->logs_dropped > 0)) {
+		LOGP(DL1C, LOGL_NOTICE, "%u message(s) logged by a Downlink scheduler job "
+		     "were dropped\n", ctx->logs_dropped);
+	}
+	ctx->logs_num = 0;
+	ctx->logs_dropped = 0;
+
+	for (i = 0; i < ctx->ctrs_num; i++)
+		rate_ctr_add2(ctx->ctrs[i].grp, ctx->ctrs[i].idx, ctx->ctrs[i].inc);
+	if (OSMO_UNLIKELY(ctx->ctrs_dropped > 0)) {
+		LOGP(DL1C, LOGL_ERROR, "%u rate counter update(s) by a Downlink scheduler job "
+		     "were dropped\n", ctx->ctrs_dropped);
+	}
+	ctx->ctrs_num = 0;
+	ctx->ctrs_dropped = 0;
+}
+
+/*! Free all msgb owned by a Downlink context (main thread only) */
+void l1sched_dl_ctx_release(struct l1sched_dl_ctx *ctx)
+{
+	struct msgb *msg, *msg2;
+
+	l1sched_dl_ctx_flush(ctx);
+
+	llist_for_each_entry_safe(msg, msg2, &ctx->pool, list) {
+		llist_del(&msg->list);
+		msgb_free(msg);
+	}
+	ctx->pool_len = 0;
+}
+
+/*! Enter (or leave if NULL) a Downlink context for the current thread */
+void l1sched_dl_ctx_enter(struct l1sched_dl_ctx *ctx)
+{
+	l1sched_dl_ctx_cur = ctx;
+}
+
+/*! msgb_alloc() for the Downlink burst generation path */
+struct msgb *_sched_msgb_alloc(uint16_t size, const char *name)
+{
+	struct l1sched_dl_ctx *ctx = l1sched_dl_ctx_cur;
+	struct msgb *msg;
+
+	if (ctx == NULL)
+		return bts_msgb_pool_alloc(BTS_MSGB_POOL_PHY, size, 0, name);
+
+	/* The pool covers the worst case (see L1SCHED_DL_CTX_POOL_SIZE),
+	 * there is no falling back to talloc outside of the main thread */
+	OSMO_ASSERT(size <= L1SCHED_DL_CTX_MSGB_SIZE);
+	OSMO_ASSERT(!llist_empty(&ctx->pool));
+
+	msg = llist_first_entry(&ctx->pool, struct msgb, list);
+	llist_del(&msg->list);
+	ctx->pool_len--;
+
+	msgb_reset(msg);
+	return msg;
+}
+
+/*! msgb_free() for the Downlink burst generation path */
+void _sched_msgb_free(struct msgb *msg)
+{
+	struct l1sched_dl_ctx *ctx = l1sched_dl_ctx_cur;
+
+	if (msg == NULL)
+		return;
+	if (ctx == NULL) {
+		msgb_free(msg);
+		return;
+	}
+
+	/* the caller has unlinked the msgb already (if it was queued) */
+	llist_add_tail(&msg->list, &ctx->free_list);
+}
+
+/*! rate_ctr_add2() for the Downlink burst generation path */
+void _sched_ctr_add(struct rate_ctr_group *grp, unsigned int idx, uint64_t inc)
+{
+	struct l1sched_dl_ctx *ctx = l1sched_dl_ctx_cur;
+	unsigned int i;
+
+	if (ctx == NULL) {
+		rate_ctr_add2(grp, idx, inc);
+		return;
+	}
+
+	for (i = 0; i < ctx->ctrs_num; i++) {
+		if (ctx->ctrs[i].grp == grp && ctx->ctrs[i].idx == idx) {
+			ctx->ctrs[i].inc += inc;
+			return;
+		}
+	}
+
+	if (OSMO_UNLIKELY(ctx->ctrs_num >= ARRAY_SIZE(ctx->ctrs))) {
+		ctx->ctrs_dropped++;
+		return;
+	}
+
+	ctx->ctrs[ctx->ctrs_num++] = (typeof(ctx->ctrs[0])) {
+		.grp = grp,
+		.idx = idx,
+		.inc = inc,
+	};
+}
+
+/*! Format a message for LOGL1S() within a Downlink context, to be logged
+ *  later by the main thread.  The static buffers of gsm_ts_name() and
+ *  gsm_fn_as_gsmtime_str() can not be used here. */
+void _sched_log_defer(int subsys, int level, const char *file, int line,
+		      const struct l1sched_ts *l1ts, int chan, uint32_t fn,
+		      const char *fmt, ...)
+{
+	struct l1sched_dl_ctx *ctx = l1sched_dl_ctx_cur;
+	struct l1sched_dl_ctx_log *log;
+	char time_buf[32];
+	struct gsm_time time;
+	va_list ap;
+	int len;
+
+	if (!log_check_level(subsys, level))
+		return;
+
+	if (OSMO_UNLIKELY(ctx->logs_num >= ARRAY_SIZE(ctx->logs))) {
+		ctx->logs_dropped++;
+		return;
+	}
+
+	log = &ctx->logs[ctx->logs_num++];
+	log->subsys = subsys;
+	log->level = level;
+	log->file = file;
+	log->line = line;
+
+	gsm_fn2gsmtime(&time, fn);
+	len = snprintf(log->text, sizeof(log->text), "%s (" GSM_TS_NAME_FMT ") %s: ",
+		       osmo_dump_gsmtime_buf(time_buf, sizeof(time_buf), &time),
+		       GSM_TS_NAME_ARGS(l1ts->ts),
+		       chan >= 0 ? trx_chan_desc[chan].name : "");
+	if (OSMO_UNLIKELY(len < 0 || len >= sizeof(log->text)))
+		return;
+
+	va_start(ap, fmt);
+	vsnprintf(&log->text[len], sizeof(log->text) - len, fmt, ap);
+	va_end(ap);
+}
+
+osmo_static_assert(L1SCHED_DL_PRIM_SLOTS % 64 == 0, l1sched_dl_prims_used_fits);
+
+/* Queue a DL primitive into the bucket of its FN */
+static void dl_prims_enqueue(struct l1sched_ts *l1ts, uint32_t fn, struct msgb *msg)
+{
+	const unsigned int slot = fn % L1SCHED_DL_PRIM_SLOTS;
+
+	msgb_enqueue(&l1ts->dl_prims[slot], msg);
+	l1ts->dl_prims_used[slot / 64] |= (1ULL << (slot % 64));
+}
+
+static inline bool dl_prims_slot_used(const struct l1sched_ts *l1ts, unsigned int slot)
+{
+	return (l1ts->dl_prims_used[slot / 64] & (1ULL << (slot % 64))) != 0;
+}
+
+/* Mark a bucket as unused, if primitives were removed and it is empty now */
+static inline void dl_prims_slot_update(struct l1sched_ts *l1ts, unsigned int slot)
+{
+	if (llist_empty(&l1ts->dl_prims[slot]))
+		l1ts->dl_prims_used[slot / 64] &= ~(1ULL << (slot % 64));
+}
+
+/* Get FN, chan_nr and link_id of a queued DL primitive */
+static bool dl_prim_get_info(const struct msgb *msg, uint32_t *fn,
+			     uint8_t *chan_nr, uint8_t *link_id)
+{
+	const struct osmo_phsap_prim *l1sap = msgb_l1sap_prim(msg);
+
+	switch (l1sap->oph.primitive) {
+	case PRIM_PH_DATA:
+		*chan_nr = l1sap->u.data.chan_nr;
+		*link_id = l1sap->u.data.link_id;
+		*fn = l1sap->u.data.fn;
+		return true;
+	case PRIM_TCH:
+		*chan_nr = l1sap->u.tch.chan_nr;
+		*link_id = 0;
+		*fn = l1sap->u.tch.fn;
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Drop primitives, which are too late for the current FN, from a bucket */
+static void _sched_drop_late_prims(struct l1sched_ts *l1ts, unsigned int slot,
+				   const struct trx_dl_burst_req *br)
 {
 	struct msgb *msg, *msg2;
 	uint32_t prim_fn, l1sap_fn;
 	uint8_t chan_nr, link_id;
+	char chan_nr_buf[64];
 
-	/* get prim of current fn from queue */
-	llist_for_each_entry_safe(msg, msg2, &l1ts->dl_prims, list) {
-		struct osmo_phsap_prim *l1sap = msgb_l1sap_prim(msg);
-		switch (l1sap->oph.primitive) {
-		case PRIM_PH_DATA:
-			chan_nr = l1sap->u.data.chan_nr;
-			link_id = l1sap->u.data.link_id;
-			l1sap_fn = l1sap->u.data.fn;
-			break;
-		case PRIM_TCH:
-			chan_nr = l1sap->u.tch.chan_nr;
-			link_id = 0;
-			l1sap_fn = l1sap->u.tch.fn;
-			break;
-		default:
+	if (!dl_prims_slot_used(l1ts, slot))
+		return;
+
+	llist_for_each_entry_safe(msg, msg2, &l1ts->dl_prims[slot], list) {
+		if (!dl_prim_get_info(msg, &l1sap_fn, &chan_nr, &link_id)) {
 			LOGL1SB(DL1P, LOGL_ERROR, l1ts, br, "Prim has wrong type.\n");
-			goto free_msg;
-		}
-		prim_fn = GSM_TDMA_FN_SUB(l1sap_fn, br->fn);
-		if (prim_fn > 100) { /* l1sap_fn < fn */
-			LOGL1SB(DL1P, LOGL_NOTICE, l1ts, br,
-			     "Prim %u is out of range (%u vs exp %u), or channel %s with "
-			     "type %s is already disabled. If this happens in "
-			     "conjunction with PCU, increase 'rts-advance' by 5.\n",
-			     prim_fn, l1sap_fn, br->fn,
-			     get_lchan_by_chan_nr(l1ts->ts->trx, chan_nr)->name,
-			     trx_chan_desc[br->chan].name);
-			rate_ctr_inc2(l1ts->ctrs, L1SCHED_TS_CTR_DL_LATE);
-			/* unlink and free message */
 			llist_del(&msg->list);
-			msgb_free(msg);
+			_sched_msgb_free(msg);
 			continue;
 		}
-		if (prim_fn > 0) /* l1sap_fn > fn */
-			break;
+
+		prim_fn = GSM_TDMA_FN_SUB(l1sap_fn, br->fn);
+		if (prim_fn <= 100) /* l1sap_fn >= fn */
+			continue;
+
+		LOGL1SB(DL1P, LOGL_NOTICE, l1ts, br,
+		     "Prim %u is out of range (%u vs exp %u), or channel %s with "
+		     "type %s is already disabled. If this happens in "
+		     "conjunction with PCU, increase 'rts-advance' by 5.\n",
+		     prim_fn, l1sap_fn, br->fn,
+		     rsl_chan_nr_str_buf(chan_nr_buf, sizeof(chan_nr_buf), chan_nr),
+		     trx_chan_desc[br->chan].name);
+		_sched_ctr_add(l1ts->ctrs, L1SCHED_TS_CTR_DL_LATE, 1);
+		/* unlink and free message */
+		llist_del(&msg->list);
+		_sched_msgb_free(msg);
+	}
+
+	dl_prims_slot_update(l1ts, slot);
+}
+
+struct msgb *_sched_dequeue_prim(struct l1sched_ts *l1ts, const struct trx_dl_burst_req *br)
+{
+	const unsigned int slot = br->fn % L1SCHED_DL_PRIM_SLOTS;
+	uint32_t elapsed, l1sap_fn;
+	uint8_t chan_nr, link_id;
+	struct msgb *msg;
+	unsigned int i;
+
+	/* Check the buckets of all frames passed since the last call (including
+	 * the current one) for primitives, which are too late to be sent.  Both
+	 * GSM_TDMA_HYPERFRAME and 2^32 are multiples of the number of buckets,
+	 * so (fn - i) picks the right bucket even if fn has wrapped.  Buckets
+	 * known to be empty are skipped. */
+	if (l1ts->dl_prims_fn_valid)
+		elapsed = GSM_TDMA_FN_SUB(br->fn, l1ts->dl_prims_fn);
+	else
+		elapsed = 1;
+	if (elapsed > L1SCHED_DL_PRIM_SLOTS)
+		elapsed = L1SCHED_DL_PRIM_SLOTS;
+	for (i = 0; i < elapsed; i++)
+		_sched_drop_late_prims(l1ts, (br->fn - i) % L1SCHED_DL_PRIM_SLOTS, br);
+	l1ts->dl_prims_fn = br->fn;
+	l1ts->dl_prims_fn_valid = true;
+
+	/* get prim of current fn from its bucket */
+	llist_for_each_entry(msg, &l1ts->dl_prims[slot], list) {
+		dl_prim_get_info(msg, &l1sap_fn, &chan_nr, &link_id);
+		if (l1sap_fn != br->fn) /* l1sap_fn > fn */
+			continue;
 
 		/* l1sap_fn == fn */
 		if ((chan_nr ^ (trx_chan_desc[br->chan].chan_nr | br->tn))
@@ -730,22 +998,21 @@ struct msgb *_sched_dequeue_prim(struct l1sched_ts *l1ts, const struct trx_dl_bu
 			LOGL1SB(DL1P, LOGL_ERROR, l1ts, br, "Prim has wrong chan_nr=0x%02x link_id=%02x, "
 				"expecting chan_nr=0x%02x link_id=%02x.\n", chan_nr, link_id,
 				trx_chan_desc[br->chan].chan_nr | br->tn, trx_chan_desc[br->chan].link_id);
-			goto free_msg;
+			/* unlink and free message */
+			llist_del(&msg->list);
+			_sched_msgb_free(msg);
+			dl_prims_slot_update(l1ts, slot);
+			return NULL;
 		}
 
 		/* unlink and return message */
 		llist_del(&msg->list);
+		dl_prims_slot_update(l1ts, slot);
 		return msg;
 	}
 
-	/* Queue was traversed with no candidate, no prim is available for current FN: */
-	rate_ctr_inc2(l1ts->ctrs, L1SCHED_TS_CTR_DL_NOT_FOUND);
-	return NULL;
-
-free_msg:
-	/* unlink and free message */
-	llist_del(&msg->list);
-	msgb_free(msg);
+	/* No prim is available for current FN: */
+	_sched_ctr_add(l1ts->ctrs, L1SCHED_TS_CTR_DL_NOT_FOUND, 1);
 	return NULL;
 }
 
@@ -834,6 +1101,16 @@ int _sched_compose_tch_ind(struct l1sched_ts *l1ts, uint32_t fn,
  * data request (from upper layer)
  */
 
+unsigned int trx_sched_dl_prims_count(const struct l1sched_ts *l1ts)
+{
+	unsigned int i, count = 0;
+
+	for (i = 0; i < ARRAY_SIZE(l1ts->dl_prims); i++)
+		count += llist_count(&l1ts->dl_prims[i]);
+
+	return count;
+}
+
 int trx_sched_ph_data_req(struct gsm_bts_trx *trx, struct osmo_phsap_prim *l1sap)
 {
 	uint8_t tn = L1SAP_CHAN2TS(l1sap->u.data.chan_nr);
@@ -853,7 +1130,7 @@ int trx_sched_ph_data_req(struct gsm_bts_trx *trx, struct osmo_phsap_prim *l1sap
 	if (trx->ts[tn].vamos.is_shadow)
 		l1sap->u.data.chan_nr &= ~RSL_CHAN_OSMO_VAMOS_MASK;
 
-	msgb_enqueue(&l1ts->dl_prims, l1sap->oph.msg);
+	dl_prims_enqueue(l1ts, l1sap->u.data.fn, l1sap->oph.msg);
 
 	return 0;
 }
@@ -876,7 +1153,7 @@ int trx_sched_tch_req(struct gsm_bts_trx *trx, struct osmo_phsap_prim *l1sap)
 	if (trx->ts[tn].vamos.is_shadow)
 		l1sap->u.tch.chan_nr &= ~RSL_CHAN_OSMO_VAMOS_MASK;
 
-	msgb_enqueue(&l1ts->dl_prims, l1sap->oph.msg);
+	dl_prims_enqueue(l1ts, l1sap->u.tch.fn, l1sap->oph.msg);
 
 	return 0;
 }
@@ -1021,6 +1298,10 @@ int trx_sched_set_pchan(struct gsm_bts_trx_ts *ts, enum gsm_phys_chan_config pch
 		l1ts->mf_period = trx_sched_multiframes[i].period;
 		l1ts->mf_frames = trx_sched_multiframes[i].frames;
 	}
+	if (i != 0) /* not GSM_PCHAN_NONE */
+		ts->trx->l1sched.mf_ts |= (1 << ts->nr);
+	else
+		ts->trx->l1sched.mf_ts &= ~(1 << ts->nr);
 	LOGP(DL1C, LOGL_NOTICE, "%s Configured multiframe with '%s'\n",
 	     gsm_ts_name(ts), trx_sched_multiframes[i].name);
 	return 0;
@@ -1057,12 +1338,39 @@ static void trx_sched_queue_filter(struct llist_head *q, uint8_t chan_nr, uint8_
 	}
 }
 
+osmo_static_assert(_TRX_CHAN_MAX <= 64, l1sched_ts_active_chans_fits);
+/* The per-burst state of a logical channel shall stay within 64 bytes.  The
+ * chan_state[] array is not cache line aligned (talloc), so a state may still
+ * span two cache lines; what matters is the size of the whole array. */
+osmo_static_assert(sizeof(struct l1sched_chan_state) <= 64, l1sched_chan_state_size);
+
+/* Update the bitmasks of active logical channels and timeslots */
+static void trx_sched_update_active(struct l1sched_ts *l1ts, enum trx_chan_type chan, bool active)
+{
+	const struct gsm_bts_trx_ts *ts = l1ts->ts;
+	const struct l1sched_ts *peer = ts->vamos.peer != NULL ? ts->vamos.peer->priv : NULL;
+	struct gsm_bts_trx *trx = ts->trx;
+
+	if (active)
+		l1ts->active_chans |= (1ULL << chan);
+	else
+		l1ts->active_chans &= ~(1ULL << chan);
+
+	/* The timeslot needs to be scheduled if either the primary
+	 * or the shadow timeslot has at least one active channel */
+	if (l1ts->active_chans != 0 || (peer != NULL && peer->active_chans != 0))
+		trx->l1sched.active_ts |= (1 << ts->nr);
+	else
+		trx->l1sched.active_ts &= ~(1 << ts->nr);
+}
+
 static void _trx_sched_set_lchan(struct gsm_lchan *lchan,
 				 enum trx_chan_type chan,
 				 bool active)
 {
 	struct l1sched_ts *l1ts = lchan->ts->priv;
 	struct l1sched_chan_state *chan_state;
+	unsigned int i;
 
 	OSMO_ASSERT(l1ts != NULL);
 	chan_state = &l1ts->chan_state[chan];
@@ -1078,28 +1386,45 @@ static void _trx_sched_set_lchan(struct gsm_lchan *lchan,
 		/* Bind to generic 'struct gsm_lchan' */
 		chan_state->lchan = lchan;
 
+		chan_state->act = talloc_zero(l1ts, struct l1sched_chan_act_state);
+		OSMO_ASSERT(chan_state->act != NULL);
+
 		/* Allocate memory for Rx/Tx burst buffers.  Use the maximim size
 		 * of 24 * (2 * 58) bytes, which is sufficient to store up to 24 GMSK
 		 * modulated bursts for CSD or up to 8 8PSK modulated bursts for EGPRS. */
 		const size_t buf_size = 24 * GSM_NBITS_NB_GMSK_PAYLOAD;
 		if (trx_chan_desc[chan].dl_fn != NULL)
 			chan_state->dl_bursts = talloc_zero_size(l1ts, buf_size);
+		/* The backend may need more room for the Rx bursts */
 		if (trx_chan_desc[chan].ul_fn != NULL)
-			chan_state->ul_bursts = talloc_zero_size(l1ts, buf_size);
+			chan_state->ul_bursts = talloc_zero_size(l1ts, rx_bursts_size(chan));
 	} else {
 		chan_state->ho_rach_detect = 0;
 
-		/* Remove pending Tx prims belonging to this lchan */
-		trx_sched_queue_filter(&l1ts->dl_prims,
-				       trx_chan_desc[chan].chan_nr,
-				       trx_chan_desc[chan].link_id);
+		/* Remove pending Tx prims belonging to this lchan,
+		 * only the buckets in use need to be looked at */
+		for (i = 0; i < ARRAY_SIZE(l1ts->dl_prims_used); i++) {
+			uint64_t used = l1ts->dl_prims_used[i];
+
+			for (; used != 0; used &= used - 1) {
+				const unsigned int slot = i * 64 + __builtin_ctzll(used);
+
+				trx_sched_queue_filter(&l1ts->dl_prims[slot],
+						       trx_chan_desc[chan].chan_nr | lchan->ts->nr,
+						       trx_chan_desc[chan].link_id);
+				dl_prims_slot_update(l1ts, slot);
+			}
+		}
 
 		/* Release memory used by Rx/Tx burst buffers */
 		TALLOC_FREE(chan_state->dl_bursts);
 		TALLOC_FREE(chan_state->ul_bursts);
+		/* (including the keystream cache) */
+		TALLOC_FREE(chan_state->act);
 	}
 
 	chan_state->active = active;
+	trx_sched_update_active(l1ts, chan, active);
 }
 
 /* setting all logical channels given attributes to active/inactive */
@@ -1226,19 +1551,23 @@ int trx_sched_set_mode(struct gsm_bts_trx_ts *ts, uint8_t chan_nr, uint8_t rsl_c
 			chan_state->rsl_cmode = rsl_cmode;
 			chan_state->tch_mode = tch_mode;
 			chan_state->ho_rach_detect = handover;
+			/* (activation would reset the AMR state anyway) */
 			if (rsl_cmode == RSL_CMOD_SPD_SPEECH
-			 && tch_mode == GSM48_CMODE_SPEECH_AMR) {
-				chan_state->codecs = codecs;
-				chan_state->codec[0] = codec0;
-				chan_state->codec[1] = codec1;
-				chan_state->codec[2] = codec2;
-				chan_state->codec[3] = codec3;
-				chan_state->ul_ft = initial_id;
-				chan_state->dl_ft = initial_id;
-				chan_state->ul_cmr = initial_id;
-				chan_state->dl_cmr = initial_id;
-				chan_state->lqual_cb_sum = 0;
-				chan_state->lqual_cb_num = 0;
+			 && tch_mode == GSM48_CMODE_SPEECH_AMR
+			 && chan_state->act != NULL) {
+				struct l1sched_chan_act_state *act = chan_state->act;
+
+				act->codecs = codecs;
+				act->codec[0] = codec0;
+				act->codec[1] = codec1;
+				act->codec[2] = codec2;
+				act->codec[3] = codec3;
+				act->ul_ft = initial_id;
+				act->dl_ft = initial_id;
+				act->ul_cmr = initial_id;
+				act->dl_cmr = initial_id;
+				act->lqual_cb_sum = 0;
+				act->lqual_cb_num = 0;
 			}
 			rc = 0;
 		}
@@ -1284,6 +1613,13 @@ int trx_sched_set_cipher(struct gsm_lchan *lchan, uint8_t chan_nr, bool downlink
 		if (trx_chan_desc[i].chan_nr == (chan_nr & RSL_CHAN_NR_MASK)) {
 			struct l1sched_ts *l1ts = lchan->ts->priv;
 			struct l1sched_chan_state *l1cs = &l1ts->chan_state[i];
+			struct l1sched_chan_act_state *act = l1cs->act;
+
+			/* (activation would reset the ciphering anyway) */
+			if (act == NULL) {
+				rc = 0;
+				continue;
+			}
 
 			LOGPLCHAN(lchan, DL1C, LOGL_INFO, "Set A5/%d %s for %s\n",
 				  algo, (downlink) ? "downlink" : "uplink",
@@ -1291,13 +1627,19 @@ int trx_sched_set_cipher(struct gsm_lchan *lchan, uint8_t chan_nr, bool downlink
 
 			if (downlink) {
 				l1cs->dl_encr_algo = algo;
-				memcpy(l1cs->dl_encr_key, lchan->encr.key, lchan->encr.key_len);
-				l1cs->dl_encr_key_len = lchan->encr.key_len;
+				memcpy(act->dl_encr_key, lchan->encr.key, lchan->encr.key_len);
+				act->dl_encr_key_len = lchan->encr.key_len;
 			} else {
 				l1cs->ul_encr_algo = algo;
-				memcpy(l1cs->ul_encr_key, lchan->encr.key, lchan->encr.key_len);
-				l1cs->ul_encr_key_len = lchan->encr.key_len;
+				memcpy(act->ul_encr_key, lchan->encr.key, lchan->encr.key_len);
+				act->ul_encr_key_len = lchan->encr.key_len;
 			}
+
+			/* (Re)start the keystream cache with the new algorithm/key */
+			if (act->a5_cache == NULL && (l1cs->dl_encr_algo || l1cs->ul_encr_algo))
+				act->a5_cache = talloc_zero(act, struct a5_ks_cache);
+			if (act->a5_cache != NULL)
+				a5_ks_cache_reset(act->a5_cache);
 			rc = 0;
 		}
 	}
@@ -1335,7 +1677,7 @@ int _sched_rts(const struct l1sched_ts *l1ts, uint32_t fn)
 		return 0;
 
 	/* check if channel is active */
-	if (!l1ts->chan_state[chan].active)
+	if (!(l1ts->active_chans & (1ULL << chan)))
 	 	return -EINVAL;
 
 	/* There is no burst, just for logging */
@@ -1349,6 +1691,67 @@ int _sched_rts(const struct l1sched_ts *l1ts, uint32_t fn)
 	return func(l1ts, &dbr);
 }
 
+/* Number of upcoming frames of a logical channel to generate the keystreams for */
+#define L1SCHED_A5_LOOKAHEAD	4
+
+/* Get the keystream for a ciphered burst.  On a cache miss, the keystreams of
+ * this and the upcoming frames of the logical channel are generated at once.
+ * Downlink bursts are scheduled ahead of time, so Downlink misses also cover
+ * the Uplink keystreams of these frames.  If there is no cache, the keystream
+ * is generated into the given buffer. */
+const ubit_t *_sched_a5_ks(const struct l1sched_ts *l1ts,
+			   struct l1sched_chan_state *l1cs,
+			   enum trx_chan_type chan,
+			   enum a5_ks_dir dir, uint32_t fn,
+			   ubit_t *buf)
+{
+	struct l1sched_chan_act_state *act = l1cs->act;
+	const struct a5_ks_cipher dl = {
+		.algo = l1cs->dl_encr_algo,
+		.key = act->dl_encr_key,
+		.key_len = act->dl_encr_key_len,
+	};
+	const struct a5_ks_cipher ul = {
+		.algo = l1cs->ul_encr_algo,
+		.key = act->ul_encr_key,
+		.key_len = act->ul_encr_key_len,
+	};
+	const ubit_t *ks;
+	unsigned int i, n;
+
+	if (OSMO_UNLIKELY(act->a5_cache == NULL)) {
+		if (dir == A5_KS_DL)
+			osmo_a5(dl.algo, dl.key, fn, buf, NULL);
+		else
+			osmo_a5(ul.algo, ul.key, fn, NULL, buf);
+		return buf;
+	}
+
+	if ((ks = a5_ks_cache_get(act->a5_cache, dir, fn)) != NULL) {
+		_sched_ctr_add(l1ts->ctrs, L1SCHED_TS_CTR_A5_KS_HIT, 1);
+		return ks;
+	}
+
+	_sched_ctr_add(l1ts->ctrs, L1SCHED_TS_CTR_A5_KS_MISS, 1);
+
+	for (i = 0, n = 0; i < l1ts->mf_period && n < L1SCHED_A5_LOOKAHEAD; i++) {
+		const uint32_t fn_i = GSM_TDMA_FN_SUM(fn, i);
+		const struct trx_sched_frame *frame = &l1ts->mf_frames[fn_i % l1ts->mf_period];
+		const bool need_dl = dir == A5_KS_DL && frame->dl_chan == chan;
+		const bool need_ul = frame->ul_chan == chan;
+
+		if (!need_dl && !need_ul)
+			continue;
+		a5_ks_cache_gen(act->a5_cache, fn_i,
+				need_dl ? &dl : NULL,
+				need_ul ? &ul : NULL);
+		n++;
+	}
+
+	/* The requested frame is always the first one generated above */
+	return act->a5_cache->ent[fn % A5_KS_CACHE_SIZE].ks[dir];
+}
+
 static void trx_sched_apply_att(const struct gsm_lchan *lchan,
 				struct trx_dl_burst_req *br)
 {
@@ -1372,7 +1775,7 @@ static void trx_sched_apply_att(const struct gsm_lchan *lchan,
 /* process downlink burst */
 void _sched_dl_burst(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br)
 {
-	const struct l1sched_chan_state *l1cs;
+	struct l1sched_chan_state *l1cs;
 	const struct trx_sched_frame *frame;
 	uint8_t offset, period;
 	trx_sched_dl_func *func;
@@ -1389,12 +1792,12 @@ void _sched_dl_burst(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br)
 	br->bid = frame->dl_bid;
 	func = trx_chan_desc[br->chan].dl_fn;
 
-	l1cs = &l1ts->chan_state[br->chan];
-
 	/* check if channel is active */
-	if (!l1cs->active)
+	if (!(l1ts->active_chans & (1ULL << br->chan)))
 		return;
 
+	l1cs = &l1ts->chan_state[br->chan];
+
 	/* Training Sequence Code and Set */
 	br->tsc_set = l1ts->ts->tsc_set;
 	br->tsc = l1ts->ts->tsc;
@@ -1412,14 +1815,11 @@ void _sched_dl_burst(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br)
 
 	/* encrypt */
 	if (br->burst_len && l1cs->dl_encr_algo) {
-		ubit_t ks[114];
-		int i;
+		ubit_t buf[A5_KS_BURST_BITS];
+		const ubit_t *ks;
 
-		osmo_a5(l1cs->dl_encr_algo, l1cs->dl_encr_key, br->fn, ks, NULL);
-		for (i = 0; i < 57; i++) {
-			br->burst[i +  3] ^= ks[i];
-			br->burst[i + 88] ^= ks[i + 57];
-		}
+		ks = _sched_a5_ks(l1ts, l1cs, br->chan, A5_KS_DL, br->fn, buf);
+		a5_ks_encrypt_burst(br->burst, ks);
 	}
 }
 
@@ -1427,6 +1827,7 @@ static int trx_sched_calc_frame_loss(struct l1sched_ts *l1ts,
 				     struct l1sched_chan_state *l1cs,
 				     const struct trx_ul_burst_ind *bi)
 {
+	struct l1sched_chan_act_state *act = l1cs->act;
 	const struct trx_sched_frame *frame;
 	uint32_t elapsed_fs;
 	uint8_t offset, i;
@@ -1437,7 +1838,7 @@ static int trx_sched_calc_frame_loss(struct l1sched_ts *l1ts,
 	 * to synchronize and start burst transmission,
 	 * so let's wait until the first UL burst...
 	 */
-	if (l1cs->proc_tdma_fs == 0)
+	if (act->proc_tdma_fs == 0)
 		return 0;
 
 	/* Not applicable for some logical channels */
@@ -1454,12 +1855,12 @@ static int trx_sched_calc_frame_loss(struct l1sched_ts *l1ts,
 	}
 
 	/* How many frames elapsed since the last one? */
-	elapsed_fs = GSM_TDMA_FN_SUB(bi->fn, l1cs->last_tdma_fn);
+	elapsed_fs = GSM_TDMA_FN_SUB(bi->fn, act->last_tdma_fn);
 	if (elapsed_fs > l1ts->mf_period) { /* Too many! */
 		LOGL1SB(DL1P, LOGL_ERROR, l1ts, bi,
 			"Too many (>%u) contiguous TDMA frames=%u elapsed "
 			"since the last processed fn=%u\n", l1ts->mf_period,
-			elapsed_fs, l1cs->last_tdma_fn);
+			elapsed_fs, act->last_tdma_fn);
 		/* FIXME: how should this affect the measurements? */
 		return -EINVAL;
 	}
@@ -1473,18 +1874,18 @@ static int trx_sched_calc_frame_loss(struct l1sched_ts *l1ts,
 	 * Start counting from the last_fn + 1.
 	 */
 	for (i = 1; i < elapsed_fs; i++) {
-		fn_i = GSM_TDMA_FN_SUM(l1cs->last_tdma_fn, i);
+		fn_i = GSM_TDMA_FN_SUM(act->last_tdma_fn, i);
 		offset = fn_i % l1ts->mf_period;
 		frame = l1ts->mf_frames + offset;
 
 		if (frame->ul_chan == bi->chan)
-			l1cs->lost_tdma_fs++;
+			act->lost_tdma_fs++;
 	}
 
-	if (l1cs->lost_tdma_fs > 0) {
+	if (act->lost_tdma_fs > 0) {
 		LOGL1SB(DL1P, LOGL_NOTICE, l1ts, bi,
 			"At least %u TDMA frames were lost since the last "
-			"processed fn=%u\n", l1cs->lost_tdma_fs, l1cs->last_tdma_fn);
+			"processed fn=%u\n", act->lost_tdma_fs, act->last_tdma_fn);
 
 		/**
 		 * HACK: substitute lost bursts by zero-filled ones
@@ -1507,7 +1908,7 @@ static int trx_sched_calc_frame_loss(struct l1sched_ts *l1ts,
 		};
 
 		for (i = 1; i < elapsed_fs; i++) {
-			fn_i = GSM_TDMA_FN_SUM(l1cs->last_tdma_fn, i);
+			fn_i = GSM_TDMA_FN_SUM(act->last_tdma_fn, i);
 			offset = fn_i % l1ts->mf_period;
 			frame = l1ts->mf_frames + offset;
 			func = trx_chan_desc[frame->ul_chan].ul_fn;
@@ -1523,7 +1924,7 @@ static int trx_sched_calc_frame_loss(struct l1sched_ts *l1ts,
 
 			func(l1ts, &dbi);
 
-			l1cs->lost_tdma_fs--;
+			act->lost_tdma_fs--;
 		}
 	}
 
@@ -1534,7 +1935,7 @@ static int trx_sched_calc_frame_loss(struct l1sched_ts *l1ts,
 static void trx_sched_noise_meas(struct l1sched_chan_state *l1cs,
 				 const struct trx_ul_burst_ind *bi)
 {
-	int *Avg = &l1cs->meas.interf_avg;
+	int *Avg = &l1cs->interf_avg;
 
 	/* EWMA (Exponentially Weighted Moving Average):
 	*
@@ -1581,7 +1982,7 @@ int trx_sched_ul_burst(struct l1sched_ts *l1ts, struct trx_ul_burst_ind *bi)
 	func = trx_chan_desc[bi->chan].ul_fn;
 
 	/* check if channel is active */
-	if (!l1cs->active) {
+	if (!(l1ts->active_chans & (1ULL << bi->chan))) {
 		/* handle noise measurements on dedicated and idle channels */
 		if (TRX_CHAN_IS_DEDIC(bi->chan) || bi->chan == TRXC_IDLE)
 			trx_sched_noise_meas(l1cs, bi);
@@ -1596,8 +1997,8 @@ int trx_sched_ul_burst(struct l1sched_ts *l1ts, struct trx_ul_burst_ind *bi)
 	trx_sched_calc_frame_loss(l1ts, l1cs, bi);
 
 	/* update TDMA frame counters */
-	l1cs->last_tdma_fn = bi->fn;
-	l1cs->proc_tdma_fs++;
+	l1cs->act->last_tdma_fn = bi->fn;
+	l1cs->act->proc_tdma_fs++;
 
 	/* handle NOPE indications */
 	if (bi->flags & TRX_BI_F_NOPE_IND) {
@@ -1608,16 +2009,11 @@ int trx_sched_ul_burst(struct l1sched_ts *l1ts, struct trx_ul_burst_ind *bi)
 
 	/* decrypt */
 	if (bi->burst_len && l1cs->ul_encr_algo) {
-		ubit_t ks[114];
-		int i;
-
-		osmo_a5(l1cs->ul_encr_algo, l1cs->ul_encr_key, bi->fn, NULL, ks);
-		for (i = 0; i < 57; i++) {
-			if (ks[i])
-				bi->burst[i + 3] = - bi->burst[i + 3];
-			if (ks[i + 57])
-				bi->burst[i + 88] = - bi->burst[i + 88];
-		}
+		ubit_t buf[A5_KS_BURST_BITS];
+		const ubit_t *ks;
+
+		ks = _sched_a5_ks(l1ts, l1cs, bi->chan, A5_KS_UL, bi->fn, buf);
+		a5_ks_decrypt_burst(bi->burst, ks);
 	}
 
 	/* Invoke the logical channel handler */
@@ -0,0 +1,596 @@
+/* Lock-free SPSC ring buffers in POSIX shared memory */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* A shm_link consists of a single shared memory segment holding two
+ * rings, one per direction, plus two eventfds used for wakeups.  The
+ * server (the BTS) creates the segment and the eventfds, and hands
+ * the file descriptors over to the client through a unix domain
+ * socket (SCM_RIGHTS).
+ *
+ * Each ring carries variable length records (e.g. TRXD datagrams or
+ * PCU primitives), prefixed with a 32 bit length.  A record never
+ * wraps around the end of the data area: if it does not fit, a wrap
+ * marker is written and the record starts at offset 0.
+ *
+ * The consumer only asks for an eventfd wakeup when it found the ring
+ * empty, so a busy link does not cost a syscall per record. */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/shm_ring.h>
+
+#define SHM_LINK_MAGIC		0x4f534d52 /* "OSMR" */
+#define SHM_LINK_VERSION	1
+
+/* Record length marker: skip to the beginning of the data area */
+#define SHM_RING_WRAP		0xffffffff
+/* Alignment of records within the data area */
+#define SHM_RING_REC_ALIGN	8
+#define SHM_RING_REC_LEN(len) \
+	(((len) + sizeof(uint32_t) + SHM_RING_REC_ALIGN - 1) & ~(SHM_RING_REC_ALIGN - 1))
+
+/* Shared memory layout of a ring.  Producer and consumer owned fields
+ * live in separate cache lines to avoid false sharing. */
+struct shm_ring {
+	/*! size of the data area following this header */
+	uint32_t size;
+	/*! free-running producer position (written by the producer) */
+	_Alignas(64) _Atomic uint32_t head;
+	/*! free-running consumer position (written by the consumer) */
+	_Alignas(64) _Atomic uint32_t tail;
+	/*! set by the consumer when it wants an eventfd wakeup */
+	_Alignas(64) _Atomic uint32_t waiting;
+	_Alignas(64) uint8_t _pad[0];
+};
+
+/* Shared memory layout of the segment header */
+struct shm_seg_hdr {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t ring_size;
+	_Alignas(64) uint8_t _pad[0];
+};
+
+static inline uint8_t *shm_ring_data(struct shm_ring *ring)
+{
+	return (uint8_t *) ring + sizeof(*ring);
+}
+
+static inline size_t shm_seg_len(size_t ring_size)
+{
+	return sizeof(struct shm_seg_hdr) + 2 * (sizeof(struct shm_ring) + ring_size);
+}
+
+static inline bool shm_ring_size_valid(size_t ring_size)
+{
+	return ring_size >= SHM_RING_REC_ALIGN && (ring_size & (ring_size - 1)) == 0 &&
+	       ring_size <= UINT32_MAX / 2;
+}
+
+static void shm_link_setup_rings(struct shm_link *link, size_t ring_size)
+{
+	uint8_t *ptr = (uint8_t *) link->map + sizeof(struct shm_seg_hdr);
+	struct shm_ring *ring[2];
+
+	link->ring_size = ring_size;
+
+	ring[0] = (struct shm_ring *) ptr;
+	ring[1] = (struct shm_ring *) (ptr + sizeof(struct shm_ring) + ring_size);
+
+	/* Ring 0 is server -> client, ring 1 is client -> server */
+	if (link->role == SHM_LINK_ROLE_SERVER) {
+		link->tx = ring[0];
+		link->rx = ring[1];
+	} else {
+		link->tx = ring[1];
+		link->rx = ring[0];
+	}
+}
+
+/* Empty a ring; the consumer has not seen any record yet */
+static void shm_ring_reset(struct shm_ring *ring)
+{
+	atomic_store(&ring->head, 0);
+	atomic_store(&ring->tail, 0);
+	atomic_store(&ring->waiting, 1);
+}
+
+/* Discard a pending wakeup */
+static void shm_efd_reset(int efd)
+{
+	uint64_t val;
+
+	/* non-blocking, fails with EAGAIN once the counter is zero */
+	while (read(efd, &val, sizeof(val)) == sizeof(val))
+		;
+}
+
+static int shm_link_destructor(struct shm_link *link)
+{
+	if (link->map != NULL)
+		munmap(link->map, link->map_len);
+	if (link->shm_fd >= 0)
+		close(link->shm_fd);
+	if (link->efd_tx >= 0)
+		close(link->efd_tx);
+	if (link->efd_rx >= 0)
+		close(link->efd_rx);
+	if (link->role == SHM_LINK_ROLE_SERVER && link->name != NULL)
+		shm_unlink(link->name);
+	return 0;
+}
+
+static struct shm_link *shm_link_alloc(void *ctx, enum shm_link_role role)
+{
+	struct shm_link *link;
+
+	link = talloc_zero(ctx, struct shm_link);
+	if (link == NULL)
+		return NULL;
+
+	link->role = role;
+	link->shm_fd = -1;
+	link->efd_tx = -1;
+	link->efd_rx = -1;
+	talloc_set_destructor(link, shm_link_destructor);
+
+	return link;
+}
+
+/*! Create a new shared memory link (server side).
+ *  \param[in] ctx talloc context to allocate from.
+ *  \param[in] name name of the POSIX shared memory object (e.g. "/foo").
+ *  \param[in] ring_size size of the data area of each ring (power of two).
+ *  \returns a new link on success; NULL on error (errno is set). */
+struct shm_link *shm_link_create(void *ctx, const char *name, size_t ring_size)
+{
+	struct shm_seg_hdr *hdr;
+	struct shm_link *link;
+	int i;
+
+	if (!shm_ring_size_valid(ring_size)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	link = shm_link_alloc(ctx, SHM_LINK_ROLE_SERVER);
+	if (link == NULL) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	link->name = talloc_strdup(link, name);
+	link->map_len = shm_seg_len(ring_size);
+
+	/* Remove a stale object left behind by a previous instance */
+	shm_unlink(name);
+	link->shm_fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (link->shm_fd < 0)
+		goto error;
+	if (ftruncate(link->shm_fd, link->map_len) != 0)
+		goto error;
+
+	link->map = mmap(NULL, link->map_len, PROT_READ | PROT_WRITE,
+			 MAP_SHARED, link->shm_fd, 0);
+	if (link->map == MAP_FAILED) {
+		link->map = NULL;
+		goto error;
+	}
+
+	/* The server waits on efd_rx, the client on efd_tx */
+	link->efd_rx = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	link->efd_tx = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (link->efd_rx < 0 || link->efd_tx < 0)
+		goto error;
+
+	shm_link_setup_rings(link, ring_size);
+	link->tx->size = ring_size;
+	link->rx->size = ring_size;
+	shm_ring_reset(link->tx);
+	shm_ring_reset(link->rx);
+
+	/* Publish the header last, the client validates it */
+	hdr = (struct shm_seg_hdr *) link->map;
+	hdr->ring_size = ring_size;
+	hdr->version = SHM_LINK_VERSION;
+	atomic_thread_fence(memory_order_release);
+	hdr->magic = SHM_LINK_MAGIC;
+
+	return link;
+
+error:
+	i = errno;
+	talloc_free(link);
+	errno = i;
+	return NULL;
+}
+
+/*! Attach to a shared memory link created by the server (client side).
+ *  \param[in] ctx talloc context to allocate from.
+ *  \param[in] shm_fd file descriptor of the shared memory object.
+ *  \param[in] efd_srv eventfd the server waits on.
+ *  \param[in] efd_clnt eventfd the client waits on.
+ *  \returns a new link on success; NULL on error (errno is set).
+ *  The link takes ownership of the given file descriptors. */
+struct shm_link *shm_link_attach(void *ctx, int shm_fd, int efd_srv, int efd_clnt)
+{
+	const struct shm_seg_hdr *hdr;
+	struct shm_link *link;
+	uint32_t ring_size;
+	struct stat st;
+	int err;
+
+	link = shm_link_alloc(ctx, SHM_LINK_ROLE_CLIENT);
+	if (link == NULL) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	link->shm_fd = shm_fd;
+	link->efd_tx = efd_srv;
+	link->efd_rx = efd_clnt;
+
+	if (fstat(shm_fd, &st) != 0)
+		goto error;
+	if (st.st_size < sizeof(*hdr)) {
+		errno = EINVAL;
+		goto error;
+	}
+
+	link->map_len = st.st_size;
+	link->map = mmap(NULL, link->map_len, PROT_READ | PROT_WRITE,
+			 MAP_SHARED, shm_fd, 0);
+	if (link->map == MAP_FAILED) {
+		link->map = NULL;
+		goto error;
+	}
+
+	hdr = (const struct shm_seg_hdr *) link->map;
+	if (hdr->magic != SHM_LINK_MAGIC || hdr->version != SHM_LINK_VERSION) {
+		errno = EPROTO;
+		goto error;
+	}
+	atomic_thread_fence(memory_order_acquire);
+
+	/* Read once: it is validated and used from the local copy only */
+	ring_size = *(const volatile uint32_t *) &hdr->ring_size;
+	if (!shm_ring_size_valid(ring_size) || shm_seg_len(ring_size) > link->map_len) {
+		errno = EPROTO;
+		goto error;
+	}
+
+	shm_link_setup_rings(link, ring_size);
+
+	return link;
+
+error:
+	err = errno;
+	talloc_free(link);
+	errno = err;
+	return NULL;
+}
+
+/*! Empty both rings and discard pending wakeups (server side), so that
+ *  a new client can attach to a link a previous client left behind.
+ *  Must not be called while a client is attached. */
+void shm_link_reset(struct shm_link *link)
+{
+	OSMO_ASSERT(link->role == SHM_LINK_ROLE_SERVER);
+
+	shm_ring_reset(link->tx);
+	shm_ring_reset(link->rx);
+	shm_efd_reset(link->efd_tx);
+	shm_efd_reset(link->efd_rx);
+}
+
+/*! Release a shared memory link (unmap, close descriptors). */
+void shm_link_free(struct shm_link *link)
+{
+	talloc_free(link);
+}
+
+/*! Hand over the shared memory object and eventfds to a client, along
+ *  with a datagram of the protocol spoken on the unix domain socket.
+ *  \param[in] link server side link.
+ *  \param[in] sock_fd connected unix domain socket.
+ *  \param[in] buf datagram carrying the file descriptors.
+ *  \param[in] len length of buf (not 0).
+ *  \returns 0 on success; negative errno on error. */
+int shm_link_send_fds_msg(const struct shm_link *link, int sock_fd, const void *buf, size_t len)
+{
+	const int fds[] = { link->shm_fd, link->efd_rx, link->efd_tx };
+	union {
+		char buf[CMSG_SPACE(sizeof(fds))];
+		struct cmsghdr align;
+	} u;
+	struct iovec iov = { .iov_base = (void *) buf, .iov_len = len };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = u.buf,
+		.msg_controllen = sizeof(u.buf),
+	};
+	struct cmsghdr *cmsg;
+
+	OSMO_ASSERT(link->role == SHM_LINK_ROLE_SERVER);
+
+	memset(&u, 0x00, sizeof(u));
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	if (sendmsg(sock_fd, &msg, 0) != len)
+		return -errno;
+	return 0;
+}
+
+/*! Hand over the shared memory object and eventfds to a client.
+ *  \param[in] link server side link.
+ *  \param[in] sock_fd connected unix domain socket.
+ *  \returns 0 on success; negative errno on error. */
+int shm_link_send_fds(const struct shm_link *link, int sock_fd)
+{
+	uint32_t magic = SHM_LINK_MAGIC;
+
+	return shm_link_send_fds_msg(link, sock_fd, &magic, sizeof(magic));
+}
+
+/* Close the descriptors of all SCM_RIGHTS messages received along with
+ * a datagram we do not accept, so that a misbehaving peer can not make
+ * us leak them */
+static void shm_close_cmsg_fds(struct msghdr *msg)
+{
+	struct cmsghdr *cmsg;
+
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+		const uint8_t *data = CMSG_DATA(cmsg);
+		size_t i, num;
+		int fd;
+
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+		    cmsg->cmsg_len < CMSG_LEN(0))
+			continue;
+		num = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(fd);
+		for (i = 0; i < num; i++) {
+			memcpy(&fd, &data[i * sizeof(fd)], sizeof(fd));
+			close(fd);
+		}
+	}
+}
+
+/*! Receive a datagram, and attach to the link if it carries the file
+ *  descriptors sent by shm_link_send_fds_msg().
+ *  \param[in] ctx talloc context to allocate from.
+ *  \param[in] sock_fd connected unix domain socket.
+ *  \param[out] buf buffer for the datagram.
+ *  \param[in] buf_len size of buf.
+ *  \param[out] link new link, or NULL if the datagram carries no descriptors.
+ *  \param[in] flags flags for recvmsg(), e.g. MSG_DONTWAIT.
+ *  \returns length of the datagram; negative errno on error. */
+int shm_link_recv_msg(void *ctx, int sock_fd, void *buf, size_t buf_len,
+		      struct shm_link **link, int flags)
+{
+	int fds[3];
+	union {
+		char buf[CMSG_SPACE(sizeof(fds))];
+		struct cmsghdr align;
+	} u;
+	struct iovec iov = { .iov_base = buf, .iov_len = buf_len };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = u.buf,
+		.msg_controllen = sizeof(u.buf),
+	};
+	struct cmsghdr *cmsg;
+	int rc;
+
+	*link = NULL;
+
+	rc = recvmsg(sock_fd, &msg, flags | MSG_CMSG_CLOEXEC);
+	if (rc < 0)
+		return -errno;
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg == NULL)
+		return (msg.msg_flags & MSG_CTRUNC) ? -EPROTO : rc;
+	if ((msg.msg_flags & MSG_CTRUNC) ||
+	    cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+	    cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+		shm_close_cmsg_fds(&msg);
+		return -EPROTO;
+	}
+	memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+	*link = shm_link_attach(ctx, fds[0], fds[1], fds[2]);
+	if (*link == NULL)
+		return -errno;
+
+	return rc;
+}
+
+/*! Receive the file descriptors sent by shm_link_send_fds() and attach.
+ *  \param[in] ctx talloc context to allocate from.
+ *  \param[in] sock_fd connected unix domain socket.
+ *  \returns a new link on success; NULL on error (errno is set). */
+struct shm_link *shm_link_recv_fds(void *ctx, int sock_fd)
+{
+	struct shm_link *link;
+	uint32_t magic = 0;
+	int rc;
+
+	rc = shm_link_recv_msg(ctx, sock_fd, &magic, sizeof(magic), &link, 0);
+	if (rc < 0) {
+		errno = -rc;
+		return NULL;
+	}
+
+	if (rc != sizeof(magic) || magic != SHM_LINK_MAGIC || link == NULL) {
+		shm_link_free(link);
+		errno = EPROTO;
+		return NULL;
+	}
+
+	return link;
+}
+
+/*! Enqueue a record for the peer (producer side).
+ *  \returns 0 on success; -ENOSPC if the ring is full; -EMSGSIZE if the
+ *  record can never fit. */
+int shm_link_push(struct shm_link *link, const uint8_t *buf, size_t len)
+{
+	struct shm_ring *ring = link->tx;
+	const uint32_t size = link->ring_size;
+	const uint32_t mask = size - 1;
+	uint8_t *data = shm_ring_data(ring);
+	uint32_t head, tail, off, contig, need;
+	const uint32_t rec_len = SHM_RING_REC_LEN(len);
+	const uint32_t len32 = len;
+
+	if (OSMO_UNLIKELY(rec_len > size / 2))
+		return -EMSGSIZE;
+
+	head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+	off = head & mask;
+	contig = size - off;
+	need = rec_len + (contig < rec_len ? contig : 0);
+	if (OSMO_UNLIKELY(head - tail > size || size - (head - tail) < need))
+		return -ENOSPC;
+
+	/* The record does not fit in before the end: wrap around */
+	if (contig < rec_len) {
+		const uint32_t wrap = SHM_RING_WRAP;
+		memcpy(&data[off], &wrap, sizeof(wrap));
+		head += contig;
+		off = 0;
+	}
+
+	memcpy(&data[off], &len32, sizeof(len32));
+	memcpy(&data[off + sizeof(len32)], buf, len);
+
+	/* Publish the record; this pairs with the consumer arming the
+	 * wakeup flag and re-checking head (both sequentially consistent) */
+	atomic_store(&ring->head, head + rec_len);
+	if (atomic_exchange(&ring->waiting, 0) != 0) {
+		const uint64_t one = 1;
+		if (write(link->efd_tx, &one, sizeof(one)) != sizeof(one))
+			return -errno;
+	}
+
+	return 0;
+}
+
+/*! Dequeue a record sent by the peer (consumer side).
+ *  \returns length of the record on success; -EAGAIN if the ring is empty
+ *  (a wakeup is requested from the producer in this case); -EMSGSIZE if
+ *  the record did not fit into buf (it is dropped); -EIO if the ring is
+ *  corrupt (the peer must not be trusted anymore, nothing is consumed). */
+int shm_link_pop(struct shm_link *link, uint8_t *buf, size_t buf_len)
+{
+	struct shm_ring *ring = link->rx;
+	const uint32_t size = link->ring_size;
+	const uint32_t mask = size - 1;
+	const uint8_t *data = shm_ring_data(ring);
+	uint32_t head, tail, avail, off, skip, len;
+
+	tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+	if (head == tail) {
+		/* Ask for a wakeup, then re-check to not miss a record
+		 * published in between */
+		atomic_store(&ring->waiting, 1);
+		head = atomic_load(&ring->head);
+		if (head == tail)
+			return -EAGAIN;
+		atomic_store_explicit(&ring->waiting, 0, memory_order_relaxed);
+	}
+
+	/* Everything below comes from the peer: make sure it can not make
+	 * us read past the data area */
+	avail = head - tail;
+	off = tail & mask;
+	if (OSMO_UNLIKELY(avail > size || (off % SHM_RING_REC_ALIGN) != 0))
+		return -EIO;
+
+	memcpy(&len, &data[off], sizeof(len));
+	if (len == SHM_RING_WRAP) {
+		skip = size - off;
+		if (OSMO_UNLIKELY(skip >= avail))
+			return -EIO;
+		tail += skip;
+		avail -= skip;
+		off = 0;
+		memcpy(&len, &data[off], sizeof(len));
+	}
+
+	if (OSMO_UNLIKELY(len > size - off - sizeof(len) || SHM_RING_REC_LEN(len) > avail))
+		return -EIO;
+
+	if (OSMO_UNLIKELY(len > buf_len)) {
+		atomic_store_explicit(&ring->tail, tail + SHM_RING_REC_LEN(len),
+				      memory_order_release);
+		return -EMSGSIZE;
+	}
+
+	memcpy(buf, &data[off + sizeof(len)], len);
+	atomic_store_explicit(&ring->tail, tail + SHM_RING_REC_LEN(len),
+			      memory_order_release);
+
+	return len;
+}
+
+/*! Acknowledge an eventfd wakeup (consumer side). */
+void shm_link_rx_ack(struct shm_link *link)
+{
+	uint64_t val;
+
+	/* Non-blocking, nothing to do if there was no wakeup */
+	if (read(link->efd_rx, &val, sizeof(val)) < 0)
+		return;
+}
+
+/*! Check whether there are no records to be consumed. */
+bool shm_link_rx_empty(const struct shm_link *link)
+{
+	struct shm_ring *ring = link->rx;
+
+	return atomic_load_explicit(&ring->head, memory_order_acquire) ==
+	       atomic_load_explicit(&ring->tail, memory_order_relaxed);
+}
@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 #include <errno.h>
+#include <string.h>
 
 #include <osmocom/gsm/gsm_utils.h>
 #include <osmocom/gsm/sysinfo.h>
@@ -39,11 +40,17 @@ static inline uint8_t *get_si2q_inc_index(struct gsm_bts *bts)
 	return (uint8_t *)GSM_BTS_SI2Q(bts, i);
 }
 
+#define SI_VALID(si_valid, i) ((si_valid) & (1 << (i)))
+
+static void sched_add(struct bts_bcch_sched *sched, unsigned int tc, uint8_t si_type)
+{
+	sched->si[tc][sched->num[tc]++] = si_type;
+}
+
 /* Apply the rules from 05.02 6.3.1.3 Mapping of BCCH Data */
-uint8_t *bts_sysinfo_get(struct gsm_bts *bts, const struct gsm_time *g_time)
+void bts_sysinfo_sched_build(struct bts_bcch_sched *sched, uint32_t si_valid, bool pcu_connected)
 {
-	unsigned int tc4_cnt = 0;
-	unsigned int tc4_sub[4];
+	memset(sched, 0, sizeof(*sched));
 
 	/* System information type 2 bis or 2 ter messages are sent if
 	 * needed, as determined by the system operator.  If only one of
@@ -69,86 +76,78 @@ uint8_t *bts_sysinfo_get(struct gsm_bts *bts, const struct gsm_time *g_time)
 	 * 4 consecutive occurrences of TC = 4. */
 
 	/* We only implement BCCH Norm at this time */
-	switch (g_time->tc) {
-	case 0:
-		/* System Information Type 1 need only be sent if
-		 * frequency hopping is in use or when the NCH is
-		 * present in a cell. If the MS finds another message
-		 * when TC = 0, it can assume that System Information
-		 * Type 1 is not in use.  */
-		if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_1))
-			return GSM_BTS_SI(bts, SYSINFO_TYPE_1);
-		return GSM_BTS_SI(bts, SYSINFO_TYPE_2);
-	case 1:
-		/* A SI 2 message will be sent at least every time TC = 1. */
-		return GSM_BTS_SI(bts, SYSINFO_TYPE_2);
-	case 2:
-		return GSM_BTS_SI(bts, SYSINFO_TYPE_3);
-	case 3:
-		return GSM_BTS_SI(bts, SYSINFO_TYPE_4);
-	case 4:
-		/* iterate over 2ter, 2quater, 9, 13 */
-		/* determine how many SI we need to send on TC=4,
-		 * and which of them we send when */
-		if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2ter) && GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2bis)) {
-			tc4_sub[tc4_cnt] = SYSINFO_TYPE_2ter;
-			tc4_cnt += 1;
-		}
-		if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2quater) &&
-		    (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2bis) || GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2ter))) {
-			tc4_sub[tc4_cnt] = SYSINFO_TYPE_2quater;
-			tc4_cnt += 1;
-		}
-		if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_13) && pcu_connected()) {
-			tc4_sub[tc4_cnt] = SYSINFO_TYPE_13;
-			tc4_cnt += 1;
-		}
-		if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_9)) {
-			/* FIXME: check SI3 scheduling info! */
-			tc4_sub[tc4_cnt] = SYSINFO_TYPE_9;
-			tc4_cnt += 1;
-		}
-		/* simply send SI2 if we have nothing else to send */
-		if (tc4_cnt == 0)
-			return GSM_BTS_SI(bts, SYSINFO_TYPE_2);
-		else {
-			/* increment static counter by one, modulo count */
-			bts->si.tc4_ctr = (bts->si.tc4_ctr + 1) % tc4_cnt;
 
-			if (tc4_sub[bts->si.tc4_ctr] == SYSINFO_TYPE_2quater)
-				return get_si2q_inc_index(bts);
-
-			return GSM_BTS_SI(bts, tc4_sub[bts->si.tc4_ctr]);
-		}
-	case 5:
-		/* 2bis, 2ter, 2quater */
-		if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2bis) && !GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2ter))
-			return GSM_BTS_SI(bts, SYSINFO_TYPE_2bis);
-
-		else if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2ter) && !GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2bis))
-			return GSM_BTS_SI(bts, SYSINFO_TYPE_2ter);
-
-		else if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2bis) && GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2ter))
-			return GSM_BTS_SI(bts, SYSINFO_TYPE_2bis);
-
-		else if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2quater) &&
-			 !GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2bis) && !GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2ter))
-			return get_si2q_inc_index(bts);
-
-			/* simply send SI2 if we have nothing else to send */
-		else
-			return GSM_BTS_SI(bts, SYSINFO_TYPE_2);
-		break;
-	case 6:
-		return GSM_BTS_SI(bts, SYSINFO_TYPE_3);
-	case 7:
-		return GSM_BTS_SI(bts, SYSINFO_TYPE_4);
+	/* System Information Type 1 need only be sent if
+	 * frequency hopping is in use or when the NCH is
+	 * present in a cell. If the MS finds another message
+	 * when TC = 0, it can assume that System Information
+	 * Type 1 is not in use.  */
+	if (SI_VALID(si_valid, SYSINFO_TYPE_1))
+		sched_add(sched, 0, SYSINFO_TYPE_1);
+	else
+		sched_add(sched, 0, SYSINFO_TYPE_2);
+
+	/* A SI 2 message will be sent at least every time TC = 1. */
+	sched_add(sched, 1, SYSINFO_TYPE_2);
+	sched_add(sched, 2, SYSINFO_TYPE_3);
+	sched_add(sched, 3, SYSINFO_TYPE_4);
+
+	/* iterate over 2ter, 2quater, 9, 13 on TC=4 */
+	if (SI_VALID(si_valid, SYSINFO_TYPE_2ter) && SI_VALID(si_valid, SYSINFO_TYPE_2bis))
+		sched_add(sched, 4, SYSINFO_TYPE_2ter);
+	if (SI_VALID(si_valid, SYSINFO_TYPE_2quater) &&
+	    (SI_VALID(si_valid, SYSINFO_TYPE_2bis) || SI_VALID(si_valid, SYSINFO_TYPE_2ter)))
+		sched_add(sched, 4, SYSINFO_TYPE_2quater);
+	if (SI_VALID(si_valid, SYSINFO_TYPE_13) && pcu_connected)
+		sched_add(sched, 4, SYSINFO_TYPE_13);
+	if (SI_VALID(si_valid, SYSINFO_TYPE_9)) {
+		/* FIXME: check SI3 scheduling info! */
+		sched_add(sched, 4, SYSINFO_TYPE_9);
 	}
+	/* simply send SI2 if we have nothing else to send */
+	if (sched->num[4] == 0)
+		sched_add(sched, 4, SYSINFO_TYPE_2);
+
+	/* 2bis, 2ter, 2quater on TC=5 */
+	if (SI_VALID(si_valid, SYSINFO_TYPE_2bis))
+		sched_add(sched, 5, SYSINFO_TYPE_2bis);
+	else if (SI_VALID(si_valid, SYSINFO_TYPE_2ter))
+		sched_add(sched, 5, SYSINFO_TYPE_2ter);
+	else if (SI_VALID(si_valid, SYSINFO_TYPE_2quater))
+		sched_add(sched, 5, SYSINFO_TYPE_2quater);
+	else
+		sched_add(sched, 5, SYSINFO_TYPE_2);
+
+	sched_add(sched, 6, SYSINFO_TYPE_3);
+	sched_add(sched, 7, SYSINFO_TYPE_4);
+}
+
+/* Re-build the BCCH schedule, on changes of the SI or of the PCU connection */
+void bts_sysinfo_sched_update(struct gsm_bts *bts)
+{
+	bts_sysinfo_sched_build(&bts->si.sched, bts->si_valid, pcu_connected());
+}
+
+uint8_t *bts_sysinfo_get(struct gsm_bts *bts, const struct gsm_time *g_time)
+{
+	const struct bts_bcch_sched *sched = &bts->si.sched;
+	uint8_t si_type;
 
-	/* this should never bve reached. We must transmit a BCCH
+	/* This should never happen. We must transmit a BCCH
 	 * message on the normal BCCH in all cases. */
-	OSMO_ASSERT(0);
-	return 0;
+	OSMO_ASSERT(sched->num[g_time->tc] > 0);
+
+	if (sched->num[g_time->tc] > 1) {
+		/* increment counter by one, modulo count (only on TC=4) */
+		bts->si.tc4_ctr = (bts->si.tc4_ctr + 1) % sched->num[g_time->tc];
+		si_type = sched->si[g_time->tc][bts->si.tc4_ctr];
+	} else
+		si_type = sched->si[g_time->tc][0];
+
+	if (si_type == SYSINFO_TYPE_2quater)
+		return get_si2q_inc_index(bts);
+
+	return GSM_BTS_SI(bts, si_type);
 }
 
 uint8_t num_agch(const struct gsm_bts_trx *trx, const char * arg)
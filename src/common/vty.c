@@ -1298,6 +1298,7 @@ static const char *stringify_radio_link_timeout(int val)
 static void bts_dump_vty(struct vty *vty, const struct gsm_bts *bts)
 {
 	const struct gsm_bts_trx *trx;
+	uint64_t pag_blocks;
 
 	vty_out(vty, "BTS %u is of type '%s', in band %s, has CI %u LAC %u, "
 		"BSIC %u and %u TRX%s",
@@ -1339,6 +1340,12 @@ static void bts_dump_vty(struct vty *vty, const struct gsm_bts *bts)
 	vty_out(vty, "  Paging: queue length %d, buffer space %d%s",
 		paging_queue_length(bts->paging_state), paging_buffer_space(bts->paging_state),
 		VTY_NEWLINE);
+	pag_blocks = rate_ctr_group_get_ctr(bts->ctrs, BTS_CTR_PAGING_BLOCKS)->current;
+	if (pag_blocks > 0) {
+		vty_out(vty, "  Paging: %.2f identities per paging block%s",
+			(float) rate_ctr_group_get_ctr(bts->ctrs, BTS_CTR_PAGING_SENT)->current / pag_blocks,
+			VTY_NEWLINE);
+	}
 	vty_out(vty, "  OML Link state: %s.%s",
 		bts->oml_link ? "connected" : "disconnected", VTY_NEWLINE);
 	vty_out(vty, "  PH-RTS.ind FN advance average: %d, min: %d, max: %d%s",
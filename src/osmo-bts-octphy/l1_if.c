@@ -46,6 +46,7 @@
 #include <osmo-bts/handover.h>
 #include <osmo-bts/bts.h>
 #include <osmo-bts/nm_common_fsm.h>
+#include <osmo-bts/msgb_pool.h>
 
 #include "l1_if.h"
 #include "l1_oml.h"
@@ -81,7 +82,7 @@
 /* allocate a msgb for a Layer1 primitive */
 struct msgb *l1p_msgb_alloc(void)
 {
-	struct msgb *msg = msgb_alloc_headroom(1500, 24, "l1_prim");
+	struct msgb *msg = bts_msgb_pool_alloc(BTS_MSGB_POOL_PHY, 1500, 24, "l1_prim");
 	if (!msg)
 		return msg;
 
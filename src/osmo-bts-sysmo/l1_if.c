@@ -52,6 +52,7 @@
 #include <osmo-bts/dtx_dl_amr_fsm.h>
 #include <osmo-bts/tx_power.h>
 #include <osmo-bts/nm_common_fsm.h>
+#include <osmo-bts/msgb_pool.h>
 
 #include <sysmocom/femtobts/superfemto.h>
 #include <sysmocom/femtobts/gsml1prim.h>
@@ -228,7 +229,7 @@ int l1if_gsm_req_compl(struct femtol1_hdl *fl1h, struct msgb *msg,
 /* allocate a msgb containing a GsmL1_Prim_t */
 struct msgb *l1p_msgb_alloc(void)
 {
-	struct msgb *msg = msgb_alloc(sizeof(GsmL1_Prim_t), "l1_prim");
+	struct msgb *msg = bts_msgb_pool_alloc(BTS_MSGB_POOL_PHY, sizeof(GsmL1_Prim_t), 0, "l1_prim");
 
 	if (msg)
 		msg->l1h = msgb_put(msg, sizeof(GsmL1_Prim_t));
@@ -37,35 +37,35 @@ void trx_loop_amr_input(struct l1sched_chan_state *chan_state,
 {
 	const struct gsm_lchan *lchan = chan_state->lchan;
 	const struct amr_multirate_conf *cfg = &lchan->tch.amr_mr;
-	const uint8_t mi = chan_state->ul_ft; /* mode index 0..3 */
+	const uint8_t mi = chan_state->act->ul_ft; /* mode index 0..3 */
 	int lqual_cb = meas_set->ci_cb; /* cB (centibel) */
 
 	/* count per-block C/I samples for further averaging */
 	if (lchan->type == GSM_LCHAN_TCH_H) {
-		chan_state->lqual_cb_num += 2;
-		chan_state->lqual_cb_sum += (lqual_cb + lqual_cb);
+		chan_state->act->lqual_cb_num += 2;
+		chan_state->act->lqual_cb_sum += (lqual_cb + lqual_cb);
 	} else {
-		chan_state->lqual_cb_num++;
-		chan_state->lqual_cb_sum += lqual_cb;
+		chan_state->act->lqual_cb_num++;
+		chan_state->act->lqual_cb_sum += lqual_cb;
 	}
 
 	/* wait for MS to use the requested codec */
-	if (mi != chan_state->dl_cmr)
+	if (mi != chan_state->act->dl_cmr)
 		return;
 
 	/* count frames */
-	if (chan_state->lqual_cb_num < 48)
+	if (chan_state->act->lqual_cb_num < 48)
 		return;
 
 	/* calculate average (reuse lqual_cb variable) */
-	lqual_cb = chan_state->lqual_cb_sum / chan_state->lqual_cb_num;
+	lqual_cb = chan_state->act->lqual_cb_sum / chan_state->act->lqual_cb_num;
 
 	LOGPLCHAN(lchan, DLOOP, LOGL_DEBUG, "AMR link quality (C/I) is %d cB, "
 		  "codec mode[%u]=%u\n", lqual_cb, mi, cfg->mode[mi].mode);
 
 	/* reset the link quality measurements */
-	chan_state->lqual_cb_num = 0;
-	chan_state->lqual_cb_sum = 0;
+	chan_state->act->lqual_cb_num = 0;
+	chan_state->act->lqual_cb_sum = 0;
 
 	/* If the current codec mode can be degraded */
 	if (mi > 0) {
@@ -79,13 +79,13 @@ void trx_loop_amr_input(struct l1sched_chan_state *chan_state,
 				  "[%u]=%u -> [%u]=%u due to link quality %d cB < THR_MX_Dn=%d cB\n",
 				  mi, cfg->mode[mi].mode, mi - 1, cfg->mode[mi - 1].mode,
 				  lqual_cb, thresh_lower_cb);
-			chan_state->dl_cmr--;
+			chan_state->act->dl_cmr--;
 			return;
 		}
 	}
 
 	/* If the current codec mode can be upgraded */
-	if (mi < chan_state->codecs - 1) {
+	if (mi < chan_state->act->codecs - 1) {
 		/* The threshold/hysteresis is in 0.5 dB steps, convert to cB:
 		 * 1dB is 10cB, so 0.5dB is 5cB - this is why we multiply by 5. */
 		const int thresh_upper_cb = cfg->mode[mi].threshold * 5 \
@@ -97,7 +97,7 @@ void trx_loop_amr_input(struct l1sched_chan_state *chan_state,
 				  "[%u]=%u -> [%u]=%u due to link quality %d cB > THR_MX_Up=%d cB\n",
 				  mi, cfg->mode[mi].mode, mi + 1, cfg->mode[mi + 1].mode,
 				  lqual_cb, thresh_upper_cb);
-			chan_state->dl_cmr++;
+			chan_state->act->dl_cmr++;
 			return;
 		}
 	}
@@ -229,6 +229,9 @@ static uint8_t trx_set_bts(struct gsm_bts *bts)
 		osmo_fsm_inst_dispatch(l1h->provision_fi, TRX_PROV_EV_CFG_BSIC, (void*)(intptr_t)bsic);
 	}
 
+	/* ARFCN of C0 may have changed */
+	trx_sched_fh_update(bts);
+
 	return 0;
 }
 
@@ -244,6 +247,9 @@ static uint8_t trx_set_trx(struct gsm_bts_trx *trx)
 	if (trx != trx->bts->c0)
 		osmo_fsm_inst_dispatch(l1h->provision_fi, TRX_PROV_EV_CFG_ARFCN, (void *)(intptr_t)arfcn);
 
+	/* ARFCN may have changed */
+	trx_sched_fh_update(trx->bts);
+
 	/* Begin to ramp up the power if power reduction is set by OML and TRX
 	   is already running. Otherwise skip, power ramping will be started
 	   after TRX is running */
@@ -318,6 +324,9 @@ static uint8_t trx_set_ts(struct gsm_bts_trx_ts *ts)
 {
 	enum gsm_phys_chan_config pchan;
 
+	/* Hopping parameters may have changed */
+	trx_sched_fh_update(ts->trx->bts);
+
 	/* For dynamic timeslots, pick the pchan type that should currently be
 	 * active. This should only be called during init, PDCH transitions
 	 * will call trx_set_ts_as_pchan() directly. */
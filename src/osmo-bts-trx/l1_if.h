@@ -2,10 +2,14 @@
 #define L1_IF_H_TRX
 
 #include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/stat_item.h>
 
 #include <osmo-bts/scheduler.h>
 #include <osmo-bts/phy_link.h>
+#include <osmo-bts/shm_ring.h>
+#include <osmo-bts/fh_route.h>
 #include "trx_if.h"
+#include "trx_clk_filter.h"
 
 /*
  * TRX frame clock handling
@@ -24,6 +28,10 @@
  * accordingly: If we were transmitting too fast, we're delaying the
  * next interval timer accordingly.  If we were too slow, we immediately
  * send burst data for the missing frame numbers.
+ *
+ * In order to not get there in the first place, the clock indications
+ * also feed a drift tracking filter (see trx_clk_filter.c), which trims
+ * the interval of the timer to the actual frame rate of the TRX.
  */
 
 /* bts-trx specific rate counters */
@@ -32,6 +40,21 @@ enum {
 	BTSTRX_CTR_SCHED_DL_FH_NO_CARRIER,
 	BTSTRX_CTR_SCHED_DL_FH_CACHE_MISS,
 	BTSTRX_CTR_SCHED_UL_FH_NO_CARRIER,
+	BTSTRX_CTR_TRXD_RX_SYSCALLS,
+	BTSTRX_CTR_TRXD_RX_DGRAMS,
+	BTSTRX_CTR_TRXD_RX_OVERSIZE,
+	BTSTRX_CTR_TRXD_TX_SYSCALLS,
+	BTSTRX_CTR_TRXD_TX_DGRAMS,
+	BTSTRX_CTR_SCHED_UL_PDTCH_DEC,
+	BTSTRX_CTR_SCHED_UL_PDTCH_DEC_WASTED,
+	BTSTRX_CTR_SCHED_FH_TABLE_REBUILD,
+};
+
+/* bts-trx specific stat items */
+enum {
+	BTSTRX_STAT_CLK_DRIFT,
+	BTSTRX_STAT_CLK_CORR,
+	BTSTRX_STAT_CLK_JITTER,
 };
 
 /*! clock state of a given TRX */
@@ -45,6 +68,8 @@ struct osmo_trx_clock_state {
 		struct timespec tv;
 	} last_fn_timer;
 	struct {
+		/*! whether fn/tv below are set (a clock indication was received) */
+		bool valid;
 		/*! last FN we received a clock indication for */
 		uint32_t fn;
 		/*! time at which we received the last clock indication */
@@ -52,12 +77,21 @@ struct osmo_trx_clock_state {
 	} last_clk_ind;
 	/*! Osmocom FD wrapper for timerfd */
 	struct osmo_fd fn_timer_ofd;
+	/*! TRX clock drift tracking, trims the timer interval */
+	struct trx_clk_filter filter;
 };
 
 /* gsm_bts->model_priv, specific to osmo-bts-trx */
 struct bts_trx_priv {
 	struct osmo_trx_clock_state clk_s;
 	struct rate_ctr_group *ctrs;		/* bts-trx specific rate counters */
+	struct osmo_stat_item_group *stats;	/* bts-trx specific stat items */
+	struct fh_route *fh_route;		/* frequency hopping routing tables */
+
+	/* Downlink scheduler workers (see sched_workers.c) */
+	struct sched_worker_pool *sched_workers;
+	unsigned int sched_workers_num;		/* configured number of workers (0: disabled) */
+	int sched_workers_cpu;			/* first CPU to pin the workers to (-1: no pinning) */
 };
 
 struct trx_config {
@@ -118,8 +152,11 @@ struct trx_config {
 
 struct trx_l1h {
 	struct llist_head	trx_ctrl_list;
-	/* Latest RSPed cmd, used to catch duplicate RSPs from sent retransmissions */
-	struct trx_ctrl_msg 	*last_acked;
+	/* Number of cmds at the head of trx_ctrl_list which were sent and wait for a RSP */
+	unsigned int		trx_ctrl_in_flight;
+	/* Latest RSPed cmds, used to catch duplicate RSPs from sent retransmissions */
+	struct llist_head	trx_ctrl_acked;
+	unsigned int		trx_ctrl_acked_num;
 	/* Whether the code path is in the middle of handling a received message. */
 	bool			in_trx_ctrl_read_cb;
 	/* Whether the l1h->trx_ctrl_list was flushed by the callback handling a received message */
@@ -129,9 +166,25 @@ struct trx_l1h {
 	struct phy_instance	*phy_inst;
 
 	struct osmo_fd		trx_ofd_ctrl;
-	struct osmo_timer_list	trx_ctrl_timer;
 	struct osmo_fd		trx_ofd_data;
 
+	/* TRXD over shared memory rings (instead of trx_ofd_data) */
+	struct shm_link		*trxd_shm;
+	/* eventfd signalled by the transceiver */
+	struct osmo_fd		trxd_shm_ofd;
+	/* unix socket the transceiver connects to for obtaining the rings */
+	struct osmo_fd		trxd_shm_srv_ofd;
+	/* connection of the attached transceiver, if any */
+	struct osmo_fd		trxd_shm_peer_ofd;
+
+	/* Downlink burst buffer for each TS of the TRX (may belong to a
+	 * different PHY instance if freq. hopping is enabled, or be NULL) */
+	struct trx_dl_burst_req	*dl_br[TRX_NR_TS];
+
+	/* TRXD buffers of this PHY instance */
+	struct trx_data_tx_state data_tx;
+	struct trx_data_rx_state data_rx;
+
 	/* transceiver config */
 	struct trx_config	config;
 	struct osmo_fsm_inst	*provision_fi;
@@ -142,6 +195,8 @@ int l1if_provision_transceiver_trx(struct trx_l1h *l1h);
 int l1if_mph_time_ind(struct gsm_bts *bts, uint32_t fn);
 void l1if_trx_set_nominal_power(struct gsm_bts_trx *trx, int nominal_power);
 int l1if_trx_start_power_ramp(struct gsm_bts_trx *trx, ramp_compl_cb_t ramp_compl_cb);
+void trx_sched_fh_update(struct gsm_bts *bts);
+void bts_sched_fn(struct gsm_bts *bts, const uint32_t fn);
 enum gsm_phys_chan_config transceiver_chan_type_2_pchan(uint8_t type);
 
 #endif /* L1_IF_H_TRX */
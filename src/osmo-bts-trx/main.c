@@ -44,6 +44,7 @@
 #include <osmocom/core/gsmtap_util.h>
 #include <osmocom/core/bits.h>
 #include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/stat_item.h>
 #include <osmocom/core/stats.h>
 
 #include <osmo-bts/gsm_data.h>
@@ -78,6 +79,38 @@ static const struct rate_ctr_desc btstrx_ctr_desc[] = {
 		"trx_sched:ul_fh_no_carrier",
 		"Frequency hopping: no carrier found for an Uplink burst (check hopping parameters)"
 	},
+	[BTSTRX_CTR_TRXD_RX_SYSCALLS] = {
+		"trx_trxd:rx_syscalls",
+		"Number of recv()/recvmmsg() calls on TRXD sockets"
+	},
+	[BTSTRX_CTR_TRXD_RX_DGRAMS] = {
+		"trx_trxd:rx_dgrams",
+		"Number of datagrams received on TRXD sockets"
+	},
+	[BTSTRX_CTR_TRXD_RX_OVERSIZE] = {
+		"trx_trxd:rx_oversize",
+		"Number of TRXD datagrams dropped for exceeding the Rx buffer"
+	},
+	[BTSTRX_CTR_TRXD_TX_SYSCALLS] = {
+		"trx_trxd:tx_syscalls",
+		"Number of send()/sendmmsg() calls on TRXD sockets"
+	},
+	[BTSTRX_CTR_TRXD_TX_DGRAMS] = {
+		"trx_trxd:tx_dgrams",
+		"Number of datagrams sent on TRXD sockets"
+	},
+	[BTSTRX_CTR_SCHED_UL_PDTCH_DEC] = {
+		"trx_sched:ul_pdtch_dec",
+		"Number of PDTCH block decoding attempts (GPRS or EGPRS)"
+	},
+	[BTSTRX_CTR_SCHED_UL_PDTCH_DEC_WASTED] = {
+		"trx_sched:ul_pdtch_dec_wasted",
+		"Number of failed PDTCH block decoding attempts followed by a successful one"
+	},
+	[BTSTRX_CTR_SCHED_FH_TABLE_REBUILD] = {
+		"trx_sched:fh_table_rebuild",
+		"Frequency hopping: routing tables rebuilt (hopping parameters or ARFCNs changed)"
+	},
 };
 static const struct rate_ctr_group_desc btstrx_ctrg_desc = {
 	"bts-trx",
@@ -87,6 +120,31 @@ static const struct rate_ctr_group_desc btstrx_ctrg_desc = {
 	btstrx_ctr_desc
 };
 
+static const struct osmo_stat_item_desc btstrx_stat_desc[] = {
+	[BTSTRX_STAT_CLK_DRIFT] = {
+		"trx_clk:drift",
+		"Estimated drift of the TRX clock against the local clock",
+		"ppb", 16, 0
+	},
+	[BTSTRX_STAT_CLK_CORR] = {
+		"trx_clk:correction",
+		"Correction currently applied to the frame timer interval",
+		"ppb", 16, 0
+	},
+	[BTSTRX_STAT_CLK_JITTER] = {
+		"trx_clk:jitter",
+		"Residual jitter of the TRX clock indications",
+		"us", 16, 0
+	},
+};
+static const struct osmo_stat_item_group_desc btstrx_statg_desc = {
+	"bts-trx",
+	"osmo-bts-trx specific stat items",
+	OSMO_STATS_CLASS_GLOBAL,
+	ARRAY_SIZE(btstrx_stat_desc),
+	btstrx_stat_desc
+};
+
 /* dummy, since no direct dsp support */
 uint32_t trx_get_hlayer1(const struct gsm_bts_trx *trx)
 {
@@ -127,7 +185,11 @@ int bts_model_init(struct gsm_bts *bts)
 {
 	struct bts_trx_priv *bts_trx = talloc_zero(bts, struct bts_trx_priv);
 	bts_trx->clk_s.fn_timer_ofd.fd = -1;
+	trx_clk_filter_init(&bts_trx->clk_s.filter);
 	bts_trx->ctrs = rate_ctr_group_alloc(bts_trx, &btstrx_ctrg_desc, 0);
+	bts_trx->stats = osmo_stat_item_group_alloc(bts_trx, &btstrx_statg_desc, 0);
+	bts_trx->sched_workers_cpu = -1;
+	bts_trx->fh_route = fh_route_alloc(bts_trx);
 
 	bts->model_priv = bts_trx;
 	bts->variant = BTS_OSMO_TRX;
@@ -216,6 +278,9 @@ void bts_model_phy_link_set_defaults(struct phy_link *plink)
 	plink->u.osmotrx.rts_advance = 3;
 	/* attempt use newest TRXD version by default: */
 	plink->u.osmotrx.trxd_pdu_ver_max = TRX_DATA_PDU_VER;
+	/* one TRXC command at a time by default */
+	plink->u.osmotrx.trxc_window = 1;
+	plink->u.osmotrx.trxd_shm_path = talloc_strdup(plink, TRXD_SHM_DEF_PATH);
 }
 
 void bts_model_phy_instance_set_defaults(struct phy_instance *pinst)
@@ -21,10 +21,12 @@
  */
 
 #include <stdint.h>
+#include <limits.h>
 #include <errno.h>
 
 #include <osmocom/core/bits.h>
 #include <osmocom/core/utils.h>
+#include <osmocom/core/rate_ctr.h>
 #include <osmocom/coding/gsm0503_coding.h>
 
 #include <osmo-bts/bts.h>
@@ -35,9 +37,66 @@
 
 #include <sched_utils.h>
 
+#include "l1_if.h"
+
 /* Maximum size of a EGPRS message in bytes */
 #define EGPRS_0503_MAX_BYTES	155
 
+/* Stealing bits q(0..7) of GMSK modulated PDTCH blocks, 3GPP TS 45.003,
+ * section 5.1.1.  EGPRS MCS-1..4 use the same code as CS-4, the header
+ * type is what tells them apart. */
+static const sbit_t pdtch_gmsk_q_sbit[4][8] = {
+	{ -127, -127, -127, -127, -127, -127, -127, -127 }, /* CS-1 */
+	{ -127, -127,  127,  127, -127,  127,  127,  127 }, /* CS-2 */
+	{  127,  127, -127,  127,  127,  127,  127, -127 }, /* CS-3 */
+	{  127,  127,  127, -127,  127, -127, -127,  127 }, /* CS-4, MCS-1..4 */
+};
+
+/* Tell from the stealing bits of the 4 GMSK bursts whether the block
+ * may be EGPRS (CS-4 code), or is certainly plain GPRS (CS-1..3) */
+static bool pdtch_gmsk_may_be_egprs(const sbit_t *bursts_p)
+{
+	int corr, best_corr = INT_MIN;
+	unsigned int i, j, best = 0;
+	sbit_t q[8];
+
+	/* q(2i) and q(2i+1) are the hl/hu flags of burst i */
+	for (i = 0; i < 4; i++) {
+		q[i * 2 + 0] = bursts_p[i * 116 + 57];
+		q[i * 2 + 1] = bursts_p[i * 116 + 58];
+	}
+
+	for (i = 0; i < ARRAY_SIZE(pdtch_gmsk_q_sbit); i++) {
+		for (j = 0, corr = 0; j < 8; j++)
+			corr += q[j] * pdtch_gmsk_q_sbit[i][j];
+		if (corr > best_corr) {
+			best_corr = corr;
+			best = i;
+		}
+	}
+
+	return best == 3;
+}
+
+static int pdtch_decode_gmsk(uint8_t *l2, const sbit_t *bursts_p, bool egprs,
+			     int *n_errors, int *n_bits_total)
+{
+	if (egprs) {
+		return gsm0503_pdtch_egprs_decode(l2, bursts_p, GSM0503_GPRS_BURSTS_NBITS,
+						  NULL, n_errors, n_bits_total);
+	}
+
+	return gsm0503_pdtch_decode(l2, bursts_p, NULL, n_errors, n_bits_total);
+}
+
+static void pdtch_dec_ctr_add(const struct l1sched_ts *l1ts, unsigned int idx, int val)
+{
+	const struct bts_trx_priv *priv = l1ts->ts->trx->bts->model_priv;
+
+	if (OSMO_LIKELY(priv != NULL && val > 0))
+		rate_ctr_add2(priv->ctrs, idx, val);
+}
+
 /*! \brief a single PDTCH burst was received by the PHY, process it */
 int rx_pdtch_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi)
 {
@@ -106,17 +165,37 @@ int rx_pdtch_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi)
 	*mask = 0x0;
 
 	/*
-	 * Attempt to decode EGPRS bursts first. For 8-PSK EGPRS this is all we
-	 * do. Attempt GPRS decoding on EGPRS failure. If the burst is GPRS,
-	 * then we incur decoding overhead of 31 bits on the Type 3 EGPRS
-	 * header, which is tolerable.
+	 * 8-PSK modulated blocks can only be EGPRS (MCS-5..9).  GMSK modulated
+	 * blocks are either GPRS (CS-1..4) or EGPRS (MCS-1..4), the stealing
+	 * bits tell CS-1..3 apart.  For the CS-4 code, start with whatever
+	 * was decoded last on this PDTCH; a wrong guess costs one failed
+	 * decoding attempt, as the other decoder is tried next.
 	 */
-	rc = gsm0503_pdtch_egprs_decode(l2, bursts_p, n_bursts_bits,
-				NULL, &n_errors, &n_bits_total);
-
-	if ((bi->burst_len == GSM_BURST_LEN) && (rc < 0)) {
-		rc = gsm0503_pdtch_decode(l2, bursts_p, NULL,
-				  &n_errors, &n_bits_total);
+	if (bi->burst_len == GSM_BURST_LEN) {
+		bool egprs_first = chan_state->ul_egprs_gmsk &&
+				   pdtch_gmsk_may_be_egprs(bursts_p);
+		unsigned int attempts = 1;
+
+		rc = pdtch_decode_gmsk(l2, bursts_p, egprs_first,
+				       &n_errors, &n_bits_total);
+		if (rc <= 0) {
+			attempts++;
+			egprs_first = !egprs_first;
+			rc = pdtch_decode_gmsk(l2, bursts_p, egprs_first,
+					       &n_errors, &n_bits_total);
+		}
+
+		/* Remember the outcome, it orders the attempts next time */
+		if (rc > 0) {
+			chan_state->ul_egprs_gmsk = egprs_first;
+			pdtch_dec_ctr_add(l1ts, BTSTRX_CTR_SCHED_UL_PDTCH_DEC_WASTED, attempts - 1);
+		}
+		pdtch_dec_ctr_add(l1ts, BTSTRX_CTR_SCHED_UL_PDTCH_DEC, attempts);
+	} else {
+		/* 8-PSK, or NOPE.ind (assume GPRS bits, like above) */
+		rc = gsm0503_pdtch_egprs_decode(l2, bursts_p, n_bursts_bits,
+						NULL, &n_errors, &n_bits_total);
+		pdtch_dec_ctr_add(l1ts, BTSTRX_CTR_SCHED_UL_PDTCH_DEC, 1);
 	}
 
 	if (rc > 0) {
@@ -182,7 +261,7 @@ int tx_pdtch_fn(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br)
 		LOGL1SB(DL1P, LOGL_FATAL, l1ts, br, "Prim invalid length, please FIX! "
 			"(len=%u)\n", msgb_l2len(msg));
 		/* free message */
-		msgb_free(msg);
+		_sched_msgb_free(msg);
 		return -EINVAL;
 	} else if (rc == GSM0503_EGPRS_BURSTS_NBITS) {
 		*mod = TRX_MOD_T_8PSK;
@@ -191,7 +270,7 @@ int tx_pdtch_fn(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br)
 	}
 
 	/* free message */
-	msgb_free(msg);
+	_sched_msgb_free(msg);
 
 send_burst:
 	/* compose burst */
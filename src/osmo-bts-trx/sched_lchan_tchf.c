@@ -73,7 +73,7 @@ static int decode_fr_facch(struct l1sched_ts *l1ts,
 			   const struct trx_ul_burst_ind *bi)
 {
 	struct l1sched_chan_state *chan_state = &l1ts->chan_state[bi->chan];
-	const sbit_t *bursts_p = chan_state->ul_bursts;
+	const sbit_t *bursts_p = tch_ul_window(chan_state);
 	struct l1sched_meas_set meas_avg;
 	uint8_t data[GSM_MACBLOCK_LEN];
 	int n_errors, n_bits_total;
@@ -97,14 +97,28 @@ static int decode_fr_facch(struct l1sched_ts *l1ts,
 	return GSM_MACBLOCK_LEN;
 }
 
+/* TCH/F and TCH/H keep their Uplink bursts in a mirrored ring (see
+ * tch_ul_ring_push()), all other channels in a buffer of BUFMAX bursts. */
+size_t rx_bursts_size(enum trx_chan_type chan)
+{
+	switch (chan) {
+	case TRXC_TCHF:
+	case TRXC_TCHH_0:
+	case TRXC_TCHH_1:
+		return UL_RING_BUFMAX * BPLEN;
+	default:
+		return BUFMAX * BPLEN;
+	}
+}
+
 /* Process a single Uplink TCH/F burst received by the PHY.
  * This function is visualized in file 'doc/trx_sched_tch.txt'. */
 int rx_tchf_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi)
 {
 	struct l1sched_chan_state *chan_state = &l1ts->chan_state[bi->chan];
 	struct gsm_lchan *lchan = chan_state->lchan;
-	sbit_t *burst, *bursts_p = chan_state->ul_bursts;
-	uint32_t *mask = &chan_state->ul_mask;
+	const uint32_t *mask = &chan_state->ul_mask;
+	const sbit_t *bursts_p;
 	uint8_t rsl_cmode = chan_state->rsl_cmode;
 	uint8_t tch_mode = chan_state->tch_mode;
 	uint8_t tch_data[290]; /* large enough to hold 290 unpacked bits for CSD */
@@ -126,26 +140,14 @@ int rx_tchf_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi)
 
 	LOGL1SB(DL1P, LOGL_DEBUG, l1ts, bi, "Received TCH/F, bid=%u\n", bi->bid);
 
-	/* shift the buffer by 4 bursts leftwards */
-	if (bi->bid == 0) {
-		memmove(BUFPOS(bursts_p, 0), BUFPOS(bursts_p, 4), 20 * BPLEN);
-		memset(BUFPOS(bursts_p, 20), 0, 4 * BPLEN);
-		*mask = *mask << 4;
-	}
-
-	/* update mask */
-	*mask |= (1 << bi->bid);
+	/* store the burst at position 20 + bid of the window of 24 bursts,
+	 * the window moves by 4 bursts on bid 0 */
+	tch_ul_ring_push(chan_state, bi, 4);
+	bursts_p = tch_ul_window(chan_state);
 
 	/* store measurements */
 	trx_sched_meas_push(chan_state, bi);
 
-	/* copy burst to end of buffer of 24 bursts */
-	burst = BUFPOS(bursts_p, 20 + bi->bid);
-	if (bi->burst_len > 0) {
-		memcpy(burst, bi->burst + 3, 58);
-		memcpy(burst + 58, bi->burst + 87, 58);
-	}
-
 	/* wait until complete set of bursts */
 	if (bi->bid != 3)
 		return 0;
@@ -187,7 +189,7 @@ int rx_tchf_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi)
 		 * end of the DTX interval. To mark the end of the DTX interval
 		 * in the RTP stream as well, the voice frame after the
 		 * AFS_ONSET frame is used. */
-		if (chan_state->amr_last_dtx == AFS_ONSET)
+		if (chan_state->act->amr_last_dtx == AFS_ONSET)
 			lchan_set_marker(false, lchan);
 
 		/* Store AMR payload in tch-data with an offset of 2 bytes, so
@@ -198,16 +200,16 @@ int rx_tchf_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi)
 		 * do not know this before we actually decode the frame) */
 		amr = sizeof(struct amr_hdr);
 		rc = gsm0503_tch_afs_decode_dtx(tch_data + amr, BUFTAIL8(bursts_p),
-			amr_is_cmr, chan_state->codec, chan_state->codecs, &chan_state->ul_ft,
-			&chan_state->ul_cmr, &n_errors, &n_bits_total, &chan_state->amr_last_dtx);
+			amr_is_cmr, chan_state->act->codec, chan_state->act->codecs, &chan_state->act->ul_ft,
+			&chan_state->act->ul_cmr, &n_errors, &n_bits_total, &chan_state->act->amr_last_dtx);
 
 		/* Tag all frames that are not regular AMR voice frames as
 		 * SUB-Frames */
-		if (chan_state->amr_last_dtx != AMR_OTHER) {
+		if (chan_state->act->amr_last_dtx != AMR_OTHER) {
 			LOGL1SB(DL1P, LOGL_DEBUG, l1ts, bi,
 				"Received AMR DTX frame (rc=%d, BER %d/%d): %s\n",
 				rc, n_errors, n_bits_total,
-				gsm0503_amr_dtx_frame_name(chan_state->amr_last_dtx));
+				gsm0503_amr_dtx_frame_name(chan_state->act->amr_last_dtx));
 			is_sub = 1;
 		}
 
@@ -216,7 +218,7 @@ int rx_tchf_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi)
 		 * spurt. We update the SID status accordingly, but we do
 		 * not want the marker to be set, since this must only
 		 * happen when the talk spurt is over (see above) */
-		switch (chan_state->amr_last_dtx) {
+		switch (chan_state->act->amr_last_dtx) {
 		case AFS_SID_FIRST:
 		case AFS_SID_UPDATE:
 		case AFS_SID_UPDATE_CN:
@@ -225,7 +227,7 @@ int rx_tchf_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi)
 			break;
 		}
 
-		switch (chan_state->amr_last_dtx) {
+		switch (chan_state->act->amr_last_dtx) {
 		case AFS_SID_FIRST:
 		case AFS_SID_UPDATE_CN:
 			meas_avg_mode = SCHED_MEAS_AVG_M_S8N4;
@@ -238,14 +240,14 @@ int rx_tchf_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi)
 
 		/* only good speech frames get rtp header */
 		if (rc != GSM_MACBLOCK_LEN && rc >= 4) {
-			if (chan_state->amr_last_dtx == AMR_OTHER) {
-				ft = chan_state->codec[chan_state->ul_ft];
+			if (chan_state->act->amr_last_dtx == AMR_OTHER) {
+				ft = chan_state->act->codec[chan_state->act->ul_ft];
 			} else {
 				/* SID frames will always get Frame Type Index 8 (AMR_SID) */
 				ft = AMR_SID;
 			}
 			rc = osmo_amr_rtp_enc(tch_data,
-				chan_state->codec[chan_state->ul_cmr],
+				chan_state->act->codec[chan_state->act->ul_cmr],
 			        ft, AMR_GOOD);
 		}
 
@@ -361,7 +363,7 @@ void tch_dl_dequeue(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br,
 				l1sap = msgb_l1sap_prim(msg2);
 				if (l1sap->oph.primitive == PRIM_TCH) {
 					LOGL1SB(DL1P, LOGL_FATAL, l1ts, br, "TCH twice, please FIX!\n");
-					msgb_free(msg2);
+					_sched_msgb_free(msg2);
 				} else
 					*msg_facch = msg2;
 			}
@@ -371,7 +373,7 @@ void tch_dl_dequeue(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br,
 				l1sap = msgb_l1sap_prim(msg2);
 				if (l1sap->oph.primitive != PRIM_TCH) {
 					LOGL1SB(DL1P, LOGL_FATAL, l1ts, br, "FACCH twice, please FIX!\n");
-					msgb_free(msg2);
+					_sched_msgb_free(msg2);
 				} else
 					*msg_tch = msg2;
 			}
@@ -383,7 +385,7 @@ void tch_dl_dequeue(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br,
 		LOGL1SB(DL1P, LOGL_FATAL, l1ts, br, "Prim has odd len=%u != %u\n",
 			msgb_l2len(*msg_facch), GSM_MACBLOCK_LEN);
 		/* free message */
-		msgb_free(*msg_facch);
+		_sched_msgb_free(*msg_facch);
 		*msg_facch = NULL;
 	}
 
@@ -424,8 +426,8 @@ void tch_dl_dequeue(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br,
 				goto free_bad_msg;
 			}
 			ft = -1;
-			for (i = 0; i < chan_state->codecs; i++) {
-				if (chan_state->codec[i] == ft_codec)
+			for (i = 0; i < chan_state->act->codecs; i++) {
+				if (chan_state->act->codec[i] == ft_codec)
 					ft = i;
 			}
 			if (ft < 0) {
@@ -437,12 +439,12 @@ void tch_dl_dequeue(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br,
 				amr_is_cmr = !sched_tchf_dl_amr_cmi_map[br->fn % 26];
 			else /* TRXC_TCHH_0 or TRXC_TCHH_1 */
 				amr_is_cmr = !sched_tchh_dl_amr_cmi_map[br->fn % 26];
-			if (amr_is_cmr && chan_state->dl_ft != ft) {
+			if (amr_is_cmr && chan_state->act->dl_ft != ft) {
 				LOGL1SB(DL1P, LOGL_NOTICE, l1ts, br, "Codec (FT = %d) "
 					" of RTP cannot be changed now, but in next frame\n", ft_codec);
 				goto free_bad_msg;
 			}
-			chan_state->dl_ft = ft;
+			chan_state->act->dl_ft = ft;
 			if (bfi == AMR_BAD) {
 				LOGL1SB(DL1P, LOGL_NOTICE, l1ts, br, "Transmitting 'bad AMR frame'\n");
 				goto free_bad_msg;
@@ -484,7 +486,7 @@ inval_mode2:
 				len, msgb_l2len(*msg_tch));
 free_bad_msg:
 			/* free message */
-			msgb_free(*msg_tch);
+			_sched_msgb_free(*msg_tch);
 			*msg_tch = NULL;
 		}
 	}
@@ -494,7 +496,7 @@ struct msgb *tch_dummy_msgb(size_t size, uint8_t pad)
 {
 	struct msgb *msg;
 
-	msg = msgb_alloc(size, __func__);
+	msg = _sched_msgb_alloc(size, __func__);
 	OSMO_ASSERT(msg != NULL);
 
 	msg->l2h = msgb_put(msg, size);
@@ -568,10 +570,10 @@ int tx_tchf_fn(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br)
 				rc = gsm0503_tch_afs_encode(BUFPOS(bursts_p, 0),
 							    NULL, 0,
 							    !sched_tchf_dl_amr_cmi_map[br->fn % 26],
-							    chan_state->codec,
-							    chan_state->codecs,
-							    chan_state->dl_ft,
-							    chan_state->dl_cmr);
+							    chan_state->act->codec,
+							    chan_state->act->codecs,
+							    chan_state->act->dl_ft,
+							    chan_state->act->dl_cmr);
 				if (rc == 0)
 					goto send_burst;
 			}
@@ -607,10 +609,10 @@ int tx_tchf_fn(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br)
 		gsm0503_tch_afs_encode(BUFPOS(bursts_p, 0),
 				       msgb_l2(msg), msgb_l2len(msg),
 				       !sched_tchf_dl_amr_cmi_map[br->fn % 26],
-				       chan_state->codec,
-				       chan_state->codecs,
-				       chan_state->dl_ft,
-				       chan_state->dl_cmr);
+				       chan_state->act->codec,
+				       chan_state->act->codecs,
+				       chan_state->act->dl_ft,
+				       chan_state->act->dl_cmr);
 		break;
 	/* CSD (TCH/F9.6): 12.0 kbit/s radio interface rate */
 	case GSM48_CMODE_DATA_12k0:
@@ -652,8 +654,8 @@ int tx_tchf_fn(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br)
 	}
 
 	/* free messages */
-	msgb_free(msg_tch);
-	msgb_free(msg_facch);
+	_sched_msgb_free(msg_tch);
+	_sched_msgb_free(msg_facch);
 
 send_burst:
 	/* compose burst */
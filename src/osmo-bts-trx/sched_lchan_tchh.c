@@ -130,7 +130,7 @@ static int decode_hr_facch(struct l1sched_ts *l1ts,
 			   const struct trx_ul_burst_ind *bi)
 {
 	struct l1sched_chan_state *chan_state = &l1ts->chan_state[bi->chan];
-	const sbit_t *bursts_p = chan_state->ul_bursts;
+	const sbit_t *bursts_p = tch_ul_window(chan_state);
 	struct l1sched_meas_set meas_avg;
 	uint8_t data[GSM_MACBLOCK_LEN];
 	int n_errors, n_bits_total;
@@ -160,8 +160,8 @@ int rx_tchh_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi)
 {
 	struct l1sched_chan_state *chan_state = &l1ts->chan_state[bi->chan];
 	struct gsm_lchan *lchan = chan_state->lchan;
-	sbit_t *burst, *bursts_p = chan_state->ul_bursts;
-	uint32_t *mask = &chan_state->ul_mask;
+	const uint32_t *mask = &chan_state->ul_mask;
+	const sbit_t *bursts_p;
 	uint8_t rsl_cmode = chan_state->rsl_cmode;
 	uint8_t tch_mode = chan_state->tch_mode;
 	uint8_t tch_data[240]; /* large enough to hold 240 unpacked bits for CSD */
@@ -184,26 +184,14 @@ int rx_tchh_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi)
 
 	LOGL1SB(DL1P, LOGL_DEBUG, l1ts, bi, "Received TCH/H, bid=%u\n", bi->bid);
 
-	/* shift the buffer by 2 bursts leftwards */
-	if (bi->bid == 0) {
-		memmove(BUFPOS(bursts_p, 0), BUFPOS(bursts_p, 2), 20 * BPLEN);
-		memset(BUFPOS(bursts_p, 20), 0, 2 * BPLEN);
-		*mask = *mask << 2;
-	}
-
-	/* update mask */
-	*mask |= (1 << bi->bid);
+	/* store the burst at position 20 + bid of the window of 24 bursts,
+	 * the window moves by 2 bursts on bid 0 */
+	tch_ul_ring_push(chan_state, bi, 2);
+	bursts_p = tch_ul_window(chan_state);
 
 	/* store measurements */
 	trx_sched_meas_push(chan_state, bi);
 
-	/* copy burst to end of buffer of 24 bursts */
-	burst = BUFPOS(bursts_p, 20 + bi->bid);
-	if (bi->burst_len > 0) {
-		memcpy(burst, bi->burst + 3, 58);
-		memcpy(burst + 58, bi->burst + 87, 58);
-	}
-
 	/* wait until complete set of bursts */
 	if (bi->bid != 1)
 		return 0;
@@ -251,7 +239,7 @@ int rx_tchh_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi)
 		 */
 
 		/* See comment in function rx_tchf_fn() */
-		switch (chan_state->amr_last_dtx) {
+		switch (chan_state->act->amr_last_dtx) {
 		case AHS_ONSET:
 		case AHS_SID_FIRST_INH:
 		case AHS_SID_UPDATE_INH:
@@ -265,23 +253,23 @@ int rx_tchh_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi)
 		amr = sizeof(struct amr_hdr);
 		rc = gsm0503_tch_ahs_decode_dtx(tch_data + amr, BUFTAIL8(bursts_p),
 						!sched_tchh_ul_facch_map[bi->fn % 26],
-						!fn_is_cmi, chan_state->codec,
-						chan_state->codecs, &chan_state->ul_ft,
-						&chan_state->ul_cmr, &n_errors, &n_bits_total,
-						&chan_state->amr_last_dtx);
+						!fn_is_cmi, chan_state->act->codec,
+						chan_state->act->codecs, &chan_state->act->ul_ft,
+						&chan_state->act->ul_cmr, &n_errors, &n_bits_total,
+						&chan_state->act->amr_last_dtx);
 
 		/* Tag all frames that are not regular AMR voice frames
 		   as SUB-Frames */
-		if (chan_state->amr_last_dtx != AMR_OTHER) {
+		if (chan_state->act->amr_last_dtx != AMR_OTHER) {
 			LOGL1SB(DL1P, LOGL_DEBUG, l1ts, bi,
 				"Received AMR DTX frame (rc=%d, BER %d/%d): %s\n",
 				rc, n_errors, n_bits_total,
-				gsm0503_amr_dtx_frame_name(chan_state->amr_last_dtx));
+				gsm0503_amr_dtx_frame_name(chan_state->act->amr_last_dtx));
 			is_sub = 1;
 		}
 
 		/* See comment in function rx_tchf_fn() */
-		switch (chan_state->amr_last_dtx) {
+		switch (chan_state->act->amr_last_dtx) {
 		case AHS_SID_FIRST_P1:
 		case AHS_SID_FIRST_P2:
 		case AHS_SID_UPDATE:
@@ -291,7 +279,7 @@ int rx_tchh_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi)
 			break;
 		}
 
-		switch (chan_state->amr_last_dtx) {
+		switch (chan_state->act->amr_last_dtx) {
 		case AHS_SID_FIRST_P1:
 		case AHS_SID_FIRST_P2:
 		case AHS_SID_UPDATE:
@@ -307,14 +295,14 @@ int rx_tchh_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi)
 
 		/* only good speech frames get rtp header */
 		if (rc != GSM_MACBLOCK_LEN && rc >= 4) {
-			if (chan_state->amr_last_dtx == AMR_OTHER) {
-				ft = chan_state->codec[chan_state->ul_ft];
+			if (chan_state->act->amr_last_dtx == AMR_OTHER) {
+				ft = chan_state->act->codec[chan_state->act->ul_ft];
 			} else {
 				/* SID frames will always get Frame Type Index 8 (AMR_SID) */
 				ft = AMR_SID;
 			}
 			rc = osmo_amr_rtp_enc(tch_data,
-				chan_state->codec[chan_state->ul_cmr],
+				chan_state->act->codec[chan_state->act->ul_cmr],
 			        ft, AMR_GOOD);
 		}
 
@@ -440,7 +428,7 @@ int tx_tchh_fn(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br)
 	if (chan_state->dl_ongoing_facch) {
 		/* FACCH/H shall not be scheduled at wrong FNs */
 		OSMO_ASSERT(msg_facch == NULL);
-		msgb_free(msg_tch); /* drop 2nd speech frame */
+		_sched_msgb_free(msg_tch); /* drop 2nd speech frame */
 		chan_state->dl_ongoing_facch = 0;
 		goto send_burst;
 	}
@@ -480,10 +468,10 @@ int tx_tchh_fn(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br)
 				rc = gsm0503_tch_ahs_encode(BUFPOS(bursts_p, 0),
 							    NULL, 0,
 							    !sched_tchh_dl_amr_cmi_map[br->fn % 26],
-							    chan_state->codec,
-							    chan_state->codecs,
-							    chan_state->dl_ft,
-							    chan_state->dl_cmr);
+							    chan_state->act->codec,
+							    chan_state->act->codecs,
+							    chan_state->act->dl_ft,
+							    chan_state->act->dl_cmr);
 				if (rc == 0)
 					goto send_burst;
 			}
@@ -529,10 +517,10 @@ int tx_tchh_fn(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br)
 		gsm0503_tch_ahs_encode(BUFPOS(bursts_p, 0),
 				       msgb_l2(msg), msgb_l2len(msg),
 				       !sched_tchh_dl_amr_cmi_map[br->fn % 26],
-				       chan_state->codec,
-				       chan_state->codecs,
-				       chan_state->dl_ft,
-				       chan_state->dl_cmr);
+				       chan_state->act->codec,
+				       chan_state->act->codecs,
+				       chan_state->act->dl_ft,
+				       chan_state->act->dl_cmr);
 		break;
 	/* CSD (TCH/H4.8): 6.0 kbit/s radio interface rate */
 	case GSM48_CMODE_DATA_6k0:
@@ -555,8 +543,8 @@ int tx_tchh_fn(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br)
 	}
 
 	/* free messages */
-	msgb_free(msg_tch);
-	msgb_free(msg_facch);
+	_sched_msgb_free(msg_tch);
+	_sched_msgb_free(msg_facch);
 
 send_burst:
 	/* compose burst */
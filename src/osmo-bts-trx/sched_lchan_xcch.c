@@ -176,7 +176,7 @@ int tx_data_fn(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br)
 		LOGL1SB(DL1P, LOGL_FATAL, l1ts, br, "Prim has odd len=%u != %u\n",
 			msgb_l2len(msg), GSM_MACBLOCK_LEN);
 		/* free message */
-		msgb_free(msg);
+		_sched_msgb_free(msg);
 		return -EINVAL;
 	}
 
@@ -186,7 +186,7 @@ int tx_data_fn(struct l1sched_ts *l1ts, struct trx_dl_burst_req *br)
 	gsm0503_xcch_encode(bursts_p, msg->l2h);
 
 	/* free message */
-	msgb_free(msg);
+	_sched_msgb_free(msg);
 
 send_burst:
 	/* compose burst */
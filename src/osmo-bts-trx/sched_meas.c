@@ -0,0 +1,121 @@
+/* Uplink measurement history of the TRX scheduler */
+
+/* (C) 2013 by Andreas Eversberg <jolly@eversberg.eu>
+ * (C) 2015 by Alexander Chemeris <Alexander.Chemeris@fairwaves.co>
+ * (C) 2015-2017 by Harald Welte <laforge@gnumonks.org>
+ * (C) 2020-2021 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdint.h>
+
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/scheduler.h>
+#include <osmo-bts/scheduler_backend.h>
+
+/* Add a set of UL burst measurements to the history */
+void trx_sched_meas_push(struct l1sched_chan_state *chan_state,
+			 const struct trx_ul_burst_ind *bi)
+{
+	unsigned int hist_size = ARRAY_SIZE(chan_state->act->meas.buf);
+	unsigned int current = chan_state->act->meas.current;
+
+	chan_state->act->meas.buf[current] = (struct l1sched_meas_set) {
+		.fn = bi->fn,
+		.ci_cb = (bi->flags & TRX_BI_F_CI_CB) ? bi->ci_cb : 0,
+		.toa256 = bi->toa256,
+		.rssi = bi->rssi,
+	};
+
+	chan_state->act->meas.current = (current + 1) % hist_size;
+}
+
+/* Measurement averaging mode sets: [MODE] = { SHIFT, NUM } */
+static const uint8_t trx_sched_meas_modeset[][2] = {
+	[SCHED_MEAS_AVG_M_S24N22] = { 24, 22 },
+	[SCHED_MEAS_AVG_M_S22N22] = { 22, 22 },
+	[SCHED_MEAS_AVG_M_S4N4] = { 4, 4 },
+	[SCHED_MEAS_AVG_M_S8N8] = { 8, 8 },
+	[SCHED_MEAS_AVG_M_S6N4] = { 6, 4 },
+	[SCHED_MEAS_AVG_M_S6N6] = { 6, 6 },
+	[SCHED_MEAS_AVG_M_S8N4] = { 8, 4 },
+	[SCHED_MEAS_AVG_M_S6N2] = { 6, 2 },
+	[SCHED_MEAS_AVG_M_S4N2] = { 4, 2 },
+};
+
+/* Calculate the AVG of n measurements from the history */
+void trx_sched_meas_avg(const struct l1sched_chan_state *chan_state,
+			struct l1sched_meas_set *avg,
+			enum sched_meas_avg_mode mode)
+{
+	unsigned int hist_size = ARRAY_SIZE(chan_state->act->meas.buf);
+	unsigned int current = chan_state->act->meas.current;
+	const struct l1sched_meas_set *set;
+	unsigned int pos, i;
+
+	float rssi_sum = 0;
+	int toa256_sum = 0;
+	int ci_cb_sum = 0;
+
+	const unsigned int shift = trx_sched_meas_modeset[mode][0];
+	const unsigned int num = trx_sched_meas_modeset[mode][1];
+
+	/* Calculate the sum of n entries starting from pos */
+	for (i = 0; i < num; i++) {
+		pos = (current + hist_size - shift + i) % hist_size;
+		set = &chan_state->act->meas.buf[pos];
+
+		rssi_sum   += set->rssi;
+		toa256_sum += set->toa256;
+		ci_cb_sum  += set->ci_cb;
+	}
+
+	/* First sample contains TDMA frame number of the first burst */
+	pos = (current + hist_size - shift) % hist_size;
+	set = &chan_state->act->meas.buf[pos];
+
+	/* Calculate the average for each value */
+	*avg = (struct l1sched_meas_set) {
+		.fn     = set->fn, /* first burst */
+		.rssi   = (rssi_sum   / num),
+		.toa256 = (toa256_sum / num),
+		.ci_cb  = (ci_cb_sum  / num),
+	};
+
+	LOGP(DMEAS, LOGL_DEBUG, "%s%sMeasurement AVG (num=%u, shift=%u): "
+	     "RSSI %f, ToA256 %d, C/I %d cB\n",
+	     chan_state->lchan ? gsm_lchan_name(chan_state->lchan) : "",
+	     chan_state->lchan ? " " : "",
+	     num, shift, avg->rssi, avg->toa256, avg->ci_cb);
+}
+
+/* Lookup TDMA frame number of the N-th sample in the history */
+uint32_t trx_sched_lookup_fn(const struct l1sched_chan_state *chan_state,
+			     const unsigned int shift)
+{
+	const unsigned int hist_size = ARRAY_SIZE(chan_state->act->meas.buf);
+	const unsigned int current = chan_state->act->meas.current;
+	unsigned int pos;
+
+	/* First sample contains TDMA frame number of the first burst */
+	pos = (current + hist_size - shift) % hist_size;
+	return chan_state->act->meas.buf[pos].fn;
+}
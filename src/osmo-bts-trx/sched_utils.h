@@ -22,6 +22,9 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
+
+#include <osmo-bts/scheduler.h>
 
 /* Burst Payload LENgth (short alias) */
 #define BPLEN GSM_NBITS_NB_GMSK_PAYLOAD
@@ -35,6 +38,75 @@
 #define BUFPOS(buf, n) &buf[(n) * BPLEN]
 #define BUFTAIL8(buf) BUFPOS(buf, (BUFMAX - 8))
 
+/* Uplink TCH burst history.  Rather than shifting the whole buffer by one
+ * block on every new block, the last BUFMAX bursts are kept in a ring of
+ * BUFMAX slots.  Each slot is mirrored BUFMAX slots further, so that the
+ * window starting at 'ul_ring_pos' is always contiguous and can be handed
+ * to the decoders as is. */
+#define UL_RING_BUFMAX (2 * BUFMAX)
+
+/* The newest block starts at burst 20 of the window, just like it used to
+ * with the shifted buffer.  On TCH/H, the 2 bursts behind it stay zeroed. */
+#define UL_RING_NEWEST 20
+
+/* Return the window of the last BUFMAX Uplink bursts */
+static inline sbit_t *tch_ul_window(const struct l1sched_chan_state *chan_state)
+{
+	return BUFPOS(chan_state->ul_bursts, chan_state->ul_ring_pos);
+}
+
+/* Store (or zero-fill, if burst is NULL) the n-th burst of the window */
+static inline void tch_ul_ring_put(struct l1sched_chan_state *chan_state,
+				   unsigned int n, const sbit_t *burst)
+{
+	const unsigned int pos = (chan_state->ul_ring_pos + n) % BUFMAX;
+	sbit_t *slot = BUFPOS(chan_state->ul_bursts, pos);
+
+	if (burst != NULL) {
+		memcpy(slot, burst + 3, 58);
+		memcpy(slot + 58, burst + 87, 58);
+	} else {
+		memset(slot, 0, BPLEN);
+	}
+
+	memcpy(BUFPOS(chan_state->ul_bursts, pos + BUFMAX), slot, BPLEN);
+}
+
+/* Store an Uplink burst of a block of 'n' bursts (4 on TCH/F, 2 on TCH/H)
+ * at UL_RING_NEWEST + bid, advancing the window on the first burst.
+ * The slots entering the window still hold the bursts which just left it,
+ * they are zero-filled lazily unless overwritten (see 'ul_ring_fill'). */
+static inline void tch_ul_ring_push(struct l1sched_chan_state *chan_state,
+				    const struct trx_ul_burst_ind *bi,
+				    unsigned int n)
+{
+	uint8_t *fill = &chan_state->ul_ring_fill;
+	unsigned int i;
+
+	if (bi->bid == 0) {
+		for (i = 0; i < n; i++) {
+			if (~*fill & (1 << i))
+				tch_ul_ring_put(chan_state, UL_RING_NEWEST + i, NULL);
+		}
+		chan_state->ul_ring_pos = (chan_state->ul_ring_pos + n) % BUFMAX;
+		chan_state->ul_mask = chan_state->ul_mask << n;
+		*fill = 0x00;
+		/* TCH/H: nothing is ever stored behind the newest block */
+		for (i = UL_RING_NEWEST + n; i < BUFMAX; i++)
+			tch_ul_ring_put(chan_state, i, NULL);
+	}
+
+	chan_state->ul_mask |= (1 << bi->bid);
+
+	/* NOPE.ind and friends come without a burst, they leave the slot
+	 * untouched (zero, unless written before the window moved) */
+	if (bi->burst_len > 0)
+		tch_ul_ring_put(chan_state, UL_RING_NEWEST + bi->bid, bi->burst);
+	else if (~*fill & (1 << bi->bid))
+		tch_ul_ring_put(chan_state, UL_RING_NEWEST + bi->bid, NULL);
+	*fill |= (1 << bi->bid);
+}
+
 extern void *tall_bts_ctx;
 
 #define BAD_DATA_MSG_FMT "Received bad data (rc=%d, BER %d/%d) ending at fn=%u/%u"
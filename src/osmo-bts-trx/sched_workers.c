@@ -0,0 +1,314 @@
+/* Worker threads for generating Downlink bursts in parallel */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* The main thread does everything touching the shared state (L1SAP, L2,
+ * the PCU and the sockets), and then hands out one job per TRX for the
+ * channel coding and ciphering of its Downlink bursts.  The jobs are
+ * taken from a lock-free counter by the workers and the main thread
+ * itself, so a single TRX never waits for a thread to wake up.  Each
+ * job carries its own l1sched_dl_ctx: the msgb allocated or freed, the
+ * messages logged and the rate counters updated by a job only reach
+ * talloc, the logging core and the counter groups once the main thread
+ * has collected all jobs. */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/bts.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/scheduler.h>
+#include <osmo-bts/scheduler_backend.h>
+
+#include "sched_workers.h"
+
+struct sched_worker_job {
+	struct gsm_bts_trx *trx;
+	struct l1sched_dl_ctx dl_ctx;
+};
+
+struct sched_worker {
+	struct sched_worker_pool *pool;
+	unsigned int nr;
+	pthread_t thread;
+	bool started;
+	/* posted by the main thread for each round of jobs */
+	sem_t wakeup;
+};
+
+struct sched_worker_pool {
+	struct gsm_bts *bts;
+	sched_worker_func *func;
+	int first_cpu;
+
+	struct sched_worker *workers;
+	unsigned int num_workers;
+
+	struct sched_worker_job *jobs;
+	unsigned int num_jobs;
+
+	/* index of the next job to be taken */
+	atomic_uint next_job;
+	/* number of threads (including the main one) still busy */
+	atomic_uint busy;
+	/* posted by the last worker finishing, if not the main thread */
+	sem_t done;
+	atomic_bool stop;
+};
+
+/* Take and run jobs until there are none left */
+static void sched_worker_pool_work(struct sched_worker_pool *pool)
+{
+	unsigned int i;
+
+	while ((i = atomic_fetch_add(&pool->next_job, 1)) < pool->num_jobs) {
+		struct sched_worker_job *job = &pool->jobs[i];
+
+		l1sched_dl_ctx_enter(&job->dl_ctx);
+		pool->func(job->trx);
+		l1sched_dl_ctx_enter(NULL);
+	}
+}
+
+/* Returns true if the caller was the last one to finish */
+static inline bool sched_worker_pool_finish(struct sched_worker_pool *pool)
+{
+	return atomic_fetch_sub(&pool->busy, 1) == 1;
+}
+
+static void *sched_worker_main(void *arg)
+{
+	struct sched_worker *w = arg;
+	struct sched_worker_pool *pool = w->pool;
+
+	while (true) {
+		while (sem_wait(&w->wakeup) != 0)
+			continue; /* EINTR */
+		if (atomic_load(&pool->stop))
+			break;
+
+		sched_worker_pool_work(pool);
+		if (sched_worker_pool_finish(pool))
+			sem_post(&pool->done);
+	}
+
+	return NULL;
+}
+
+static int sched_worker_start(struct sched_worker *w, int cpu)
+{
+	pthread_attr_t attr;
+	sigset_t set, oldset;
+	int rc;
+
+	pthread_attr_init(&attr);
+	if (cpu >= 0) {
+		cpu_set_t cpuset;
+
+		CPU_ZERO(&cpuset);
+		CPU_SET(cpu, &cpuset);
+		rc = pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+		if (rc != 0) {
+			LOGP(DL1C, LOGL_ERROR, "Failed to pin scheduler worker #%u "
+			     "to cpu=%d: %s\n", w->nr, cpu, strerror(rc));
+		}
+	}
+
+	/* Signals shall be delivered to the main thread only */
+	sigfillset(&set);
+	pthread_sigmask(SIG_BLOCK, &set, &oldset);
+	rc = pthread_create(&w->thread, &attr, &sched_worker_main, w);
+	pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+	pthread_attr_destroy(&attr);
+
+	if (rc != 0) {
+		LOGP(DL1C, LOGL_ERROR, "Failed to start scheduler worker #%u "
+		     "(cpu=%d): %s\n", w->nr, cpu, strerror(rc));
+		return -rc;
+	}
+
+	w->started = true;
+
+	rc = pthread_setname_np(w->thread, "sched-worker");
+	if (rc != 0) {
+		LOGP(DL1C, LOGL_NOTICE, "Failed to set the name of scheduler worker #%u: %s\n",
+		     w->nr, strerror(rc));
+	}
+
+	return 0;
+}
+
+/* (Re)allocate the job array, so that each TRX has its own job */
+static void sched_worker_pool_setup_jobs(struct sched_worker_pool *pool)
+{
+	unsigned int i;
+
+	for (i = 0; i < pool->num_jobs; i++)
+		l1sched_dl_ctx_release(&pool->jobs[i].dl_ctx);
+	talloc_free(pool->jobs);
+
+	pool->num_jobs = pool->bts->num_trx;
+	pool->jobs = talloc_zero_array(pool, struct sched_worker_job, pool->num_jobs);
+	OSMO_ASSERT(pool->jobs != NULL);
+
+	for (i = 0; i < pool->num_jobs; i++)
+		l1sched_dl_ctx_init(&pool->jobs[i].dl_ctx);
+}
+
+static int sched_worker_pool_destructor(struct sched_worker_pool *pool)
+{
+	unsigned int i;
+
+	atomic_store(&pool->stop, true);
+	for (i = 0; i < pool->num_workers; i++) {
+		struct sched_worker *w = &pool->workers[i];
+
+		if (!w->started)
+			continue;
+		sem_post(&w->wakeup);
+		pthread_join(w->thread, NULL);
+	}
+
+	for (i = 0; i < pool->num_workers; i++)
+		sem_destroy(&pool->workers[i].wakeup);
+	sem_destroy(&pool->done);
+
+	for (i = 0; i < pool->num_jobs; i++)
+		l1sched_dl_ctx_release(&pool->jobs[i].dl_ctx);
+
+	return 0;
+}
+
+/*! Allocate a pool of Downlink scheduler worker threads.
+ *  \param[in] ctx talloc context to allocate the pool from.
+ *  \param[in] bts BTS instance, whose TRXs shall be processed.
+ *  \param[in] num_workers number of worker threads (in addition to the main thread).
+ *  \param[in] first_cpu pin the workers to consecutive CPUs starting from this one (-1: no pinning).
+ *  \param[in] func job function, called for each TRX from any of the threads.
+ *  \returns pointer to the pool on success; NULL on error. */
+struct sched_worker_pool *sched_worker_pool_alloc(void *ctx, struct gsm_bts *bts,
+						  unsigned int num_workers, int first_cpu,
+						  sched_worker_func *func)
+{
+	struct sched_worker_pool *pool;
+	unsigned int i;
+
+	OSMO_ASSERT(num_workers > 0 && num_workers <= SCHED_WORKERS_MAX);
+
+	pool = talloc_zero(ctx, struct sched_worker_pool);
+	if (pool == NULL)
+		return NULL;
+
+	pool->bts = bts;
+	pool->func = func;
+	pool->first_cpu = first_cpu;
+	pool->num_workers = num_workers;
+	pool->workers = talloc_zero_array(pool, struct sched_worker, num_workers);
+	OSMO_ASSERT(pool->workers != NULL);
+
+	sem_init(&pool->done, 0, 0);
+	for (i = 0; i < num_workers; i++) {
+		pool->workers[i].pool = pool;
+		pool->workers[i].nr = i;
+		sem_init(&pool->workers[i].wakeup, 0, 0);
+	}
+	talloc_set_destructor(pool, sched_worker_pool_destructor);
+
+	sched_worker_pool_setup_jobs(pool);
+
+	for (i = 0; i < num_workers; i++) {
+		int cpu = first_cpu >= 0 ? first_cpu + i : -1;
+		if (sched_worker_start(&pool->workers[i], cpu) != 0) {
+			talloc_free(pool);
+			return NULL;
+		}
+	}
+
+	LOGP(DL1C, LOGL_NOTICE, "Started %u Downlink scheduler worker(s)\n", num_workers);
+
+	return pool;
+}
+
+/*! Stop the worker threads and free the pool */
+void sched_worker_pool_free(struct sched_worker_pool *pool)
+{
+	talloc_free(pool);
+}
+
+unsigned int sched_worker_pool_size(const struct sched_worker_pool *pool)
+{
+	return pool->num_workers;
+}
+
+int sched_worker_pool_first_cpu(const struct sched_worker_pool *pool)
+{
+	return pool->first_cpu;
+}
+
+/*! Run the job function for each TRX of the BTS, and wait for completion.
+ *  To be called from the main thread only. */
+void sched_worker_pool_run(struct sched_worker_pool *pool)
+{
+	struct gsm_bts_trx *trx;
+	unsigned int i = 0;
+
+	if (pool->num_jobs != pool->bts->num_trx)
+		sched_worker_pool_setup_jobs(pool);
+
+	llist_for_each_entry(trx, &pool->bts->trx_list, list) {
+		struct sched_worker_job *job = &pool->jobs[i++];
+
+		job->trx = trx;
+		l1sched_dl_ctx_refill(&job->dl_ctx);
+	}
+
+	atomic_store(&pool->next_job, 0);
+	atomic_store(&pool->busy, pool->num_workers + 1);
+
+	/* sem_post() implies a memory barrier, so the workers see the jobs */
+	for (i = 0; i < pool->num_workers; i++)
+		sem_post(&pool->workers[i].wakeup);
+
+	/* Take jobs on the main thread too */
+	sched_worker_pool_work(pool);
+
+	/* Wait for the workers, unless the main thread was the last one */
+	if (!sched_worker_pool_finish(pool)) {
+		while (sem_wait(&pool->done) != 0)
+			continue; /* EINTR */
+	}
+
+	/* Now free the msgb, log and update the counters for the jobs */
+	for (i = 0; i < pool->num_jobs; i++)
+		l1sched_dl_ctx_flush(&pool->jobs[i].dl_ctx);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <osmo-bts/gsm_data.h>
+
+/* Maximum number of Downlink scheduler worker threads */
+#define SCHED_WORKERS_MAX	16
+
+struct sched_worker_pool;
+
+/*! Job function, generates the Downlink bursts of a single TRX */
+typedef void sched_worker_func(struct gsm_bts_trx *trx);
+
+struct sched_worker_pool *sched_worker_pool_alloc(void *ctx, struct gsm_bts *bts,
+						  unsigned int num_workers, int first_cpu,
+						  sched_worker_func *func);
+void sched_worker_pool_free(struct sched_worker_pool *pool);
+unsigned int sched_worker_pool_size(const struct sched_worker_pool *pool);
+int sched_worker_pool_first_cpu(const struct sched_worker_pool *pool);
+void sched_worker_pool_run(struct sched_worker_pool *pool);
@@ -49,6 +49,7 @@
 
 #include "l1_if.h"
 #include "trx_if.h"
+#include "sched_workers.h"
 
 #include "btsconfig.h"
 
@@ -112,8 +113,8 @@ static void lchan_report_interf_meas(const struct gsm_lchan *lchan)
 	OSMO_ASSERT(dcch < ARRAY_SIZE(l1ts->chan_state));
 	OSMO_ASSERT(acch < ARRAY_SIZE(l1ts->chan_state));
 
-	interf_avg = (l1ts->chan_state[dcch].meas.interf_avg +
-		      l1ts->chan_state[acch].meas.interf_avg) / 2;
+	interf_avg = (l1ts->chan_state[dcch].interf_avg +
+		      l1ts->chan_state[acch].interf_avg) / 2;
 
 	gsm_lchan_interf_meas_push((struct gsm_lchan *) lchan, interf_avg);
 }
@@ -131,6 +132,10 @@ static void bts_report_interf_meas(const struct gsm_bts *bts)
 
 		for (tn = 0; tn < ARRAY_SIZE(trx->ts); tn++) {
 			const struct gsm_bts_trx_ts *ts = &trx->ts[tn];
+
+			/* Skip timeslots without a multiframe layout */
+			if (~trx->l1sched.mf_ts & (1 << tn))
+				continue;
 			for (ln = 0; ln < ARRAY_SIZE(ts->lchan); ln++)
 				lchan_report_interf_meas(&ts->lchan[ln]);
 		}
@@ -141,24 +146,23 @@ static void bts_report_interf_meas(const struct gsm_bts *bts)
 static struct phy_instance *dlfh_route_br(const struct trx_dl_burst_req *br,
 					  struct gsm_bts_trx_ts *ts)
 {
+	struct bts_trx_priv *priv = (struct bts_trx_priv *) ts->trx->bts->model_priv;
 	const struct gsm_bts_trx *trx;
 	struct gsm_time time;
 	uint16_t idx;
 
-	gsm_fn2gsmtime(&time, br->fn);
+	/* Check the routing tables first, so we eliminate frequent lookups */
+	trx = fh_route_dl(priv->fh_route, ts, br->fn);
+	if (OSMO_LIKELY(trx != NULL))
+		return trx->pinst;
 
-	/* Check the "cache" first, so we eliminate frequent lookups */
+	/* The tables may not be (re)built yet, lookup the transceiver */
+	gsm_fn2gsmtime(&time, br->fn);
 	idx = gsm0502_hop_seq_gen(&time, SCHED_FH_PARAMS_VALS(ts), NULL);
-	if (ts->fh_trx_list[idx] != NULL)
-		return ts->fh_trx_list[idx]->pinst;
-
-	struct bts_trx_priv *priv = (struct bts_trx_priv *) ts->trx->bts->model_priv;
 
-	/* The "cache" may not be filled yet, lookup the transceiver */
 	llist_for_each_entry(trx, &ts->trx->bts->trx_list, list) {
 		if (trx->arfcn == ts->hopping.arfcn_list[idx]) {
 			rate_ctr_inc2(priv->ctrs, BTSTRX_CTR_SCHED_DL_FH_CACHE_MISS);
-			ts->fh_trx_list[idx] = trx;
 			return trx->pinst;
 		}
 	}
@@ -172,6 +176,24 @@ static struct phy_instance *dlfh_route_br(const struct trx_dl_burst_req *br,
 	return NULL;
 }
 
+/* Rebuild the frequency hopping routing tables, to be called whenever
+ * the hopping parameters of a timeslot or the ARFCN of a TRX may have
+ * changed; nothing is done if they did not */
+void trx_sched_fh_update(struct gsm_bts *bts)
+{
+	struct bts_trx_priv *priv = (struct bts_trx_priv *) bts->model_priv;
+
+	if (!fh_route_changed(priv->fh_route, bts))
+		return;
+
+	if (fh_route_rebuild(priv->fh_route, bts) != 0) {
+		LOGP(DL1C, LOGL_ERROR, "Failed to rebuild frequency hopping routing tables\n");
+		return;
+	}
+
+	rate_ctr_inc2(priv->ctrs, BTSTRX_CTR_SCHED_FH_TABLE_REBUILD);
+}
+
 static void bts_sched_init_buffers(struct gsm_bts *bts, const uint32_t fn)
 {
 	struct gsm_bts_trx *trx;
@@ -214,21 +236,31 @@ static void bts_sched_flush_buffers(struct gsm_bts *bts)
 	const struct gsm_bts_trx *trx;
 	unsigned int tn;
 
+	/* Build the TRXD PDUs for all transceivers first... */
 	llist_for_each_entry(trx, &bts->trx_list, list) {
 		const struct phy_instance *pinst = trx->pinst;
 		struct trx_l1h *l1h = pinst->u.osmotrx.hdl;
 
+		trx_if_tx_begin(l1h);
+
 		for (tn = 0; tn < TRX_NR_TS; tn++) {
 			const struct trx_dl_burst_req *br;
 
 			br = &pinst->u.osmotrx.br[tn];
 			if (!br->burst_len)
 				continue;
-			trx_if_send_burst(l1h, br);
+			trx_if_tx_append(l1h, br);
 		}
 
 		/* Batch all timeslots into a single TRXD PDU */
-		trx_if_send_burst(l1h, NULL);
+		trx_if_tx_finish(l1h);
+	}
+
+	/* ... then send them back-to-back */
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		struct trx_l1h *l1h = trx->pinst->u.osmotrx.hdl;
+
+		trx_if_tx_send(l1h);
 	}
 }
 
@@ -266,11 +298,107 @@ static void _sched_dl_shadow_burst(const struct gsm_bts_trx_ts *ts,
 	}
 }
 
+/* send RTS and resolve the Downlink burst buffers for each TS of a TRX */
+static void bts_sched_rts_trx(struct gsm_bts_trx *trx, const uint32_t fn)
+{
+	const struct phy_link *plink = trx->pinst->phy_link;
+	struct trx_l1h *l1h = trx->pinst->u.osmotrx.hdl;
+	uint8_t active_ts = trx->l1sched.active_ts;
+	unsigned int tn;
+
+	/* Timeslots without active channels have no bursts */
+	memset(&l1h->dl_br[0], 0x00, sizeof(l1h->dl_br));
+
+	/* we don't schedule, if power is off */
+	if (!trx_if_powered(l1h))
+		return;
+
+	/* process every active TS of TRX */
+	for (; active_ts != 0; active_ts &= active_ts - 1) {
+		struct phy_instance *pinst = trx->pinst;
+		struct gsm_bts_trx_ts *ts;
+		struct l1sched_ts *l1ts;
+		struct trx_dl_burst_req *br;
+
+		tn = __builtin_ctz(active_ts);
+		ts = &trx->ts[tn];
+		l1ts = ts->priv;
+
+		/* ready-to-send */
+		TRACE(OSMO_BTS_TRX_DL_RTS_START(trx->nr, tn, fn));
+		_sched_rts(l1ts, GSM_TDMA_FN_SUM(fn, plink->u.osmotrx.clock_advance
+						   + plink->u.osmotrx.rts_advance));
+		TRACE(OSMO_BTS_TRX_DL_RTS_DONE(trx->nr, tn, fn));
+
+		/* pre-initialized buffer for the Downlink burst */
+		br = &pinst->u.osmotrx.br[tn];
+
+		/* resolve PHY instance if freq. hopping is enabled */
+		if (ts->hopping.enabled) {
+			pinst = dlfh_route_br(br, ts);
+			/* simply use a different buffer (if any) */
+			br = pinst != NULL ? &pinst->u.osmotrx.br[tn] : NULL;
+		}
+
+		l1h->dl_br[tn] = br;
+	}
+}
+
+/* populate the Downlink burst buffers for each TS of a TRX,
+ * may be called from a scheduler worker thread (see sched_workers.c) */
+static void bts_sched_dl_trx(struct gsm_bts_trx *trx)
+{
+	const struct trx_l1h *l1h = trx->pinst->u.osmotrx.hdl;
+	unsigned int tn;
+
+	for (tn = 0; tn < ARRAY_SIZE(trx->ts); tn++) {
+		struct gsm_bts_trx_ts *ts = &trx->ts[tn];
+		struct trx_dl_burst_req *br = l1h->dl_br[tn];
+
+		if (br == NULL)
+			continue;
+
+		/* get burst for the primary timeslot */
+		_sched_dl_burst(ts->priv, br);
+
+		/* get burst for the shadow timeslot */
+		_sched_dl_shadow_burst(ts->vamos.peer, br);
+	}
+}
+
+/* (re)start or stop the scheduler workers, if the configuration has changed */
+static void bts_sched_workers_update(struct gsm_bts *bts)
+{
+	struct bts_trx_priv *priv = (struct bts_trx_priv *) bts->model_priv;
+	struct sched_worker_pool *pool = priv->sched_workers;
+
+	if (pool != NULL) {
+		if (sched_worker_pool_size(pool) == priv->sched_workers_num &&
+		    sched_worker_pool_first_cpu(pool) == priv->sched_workers_cpu)
+			return;
+		sched_worker_pool_free(pool);
+		priv->sched_workers = NULL;
+	}
+
+	if (priv->sched_workers_num == 0)
+		return;
+
+	priv->sched_workers = sched_worker_pool_alloc(priv, bts,
+						      priv->sched_workers_num,
+						      priv->sched_workers_cpu,
+						      &bts_sched_dl_trx);
+	if (priv->sched_workers == NULL) {
+		LOGP(DL1C, LOGL_ERROR, "Failed to start the scheduler workers, "
+		     "falling back to single-threaded operation\n");
+		priv->sched_workers_num = 0;
+	}
+}
+
 /* schedule all frames of all TRX for given FN */
-static void bts_sched_fn(struct gsm_bts *bts, const uint32_t fn)
+void bts_sched_fn(struct gsm_bts *bts, const uint32_t fn)
 {
+	struct bts_trx_priv *priv = (struct bts_trx_priv *) bts->model_priv;
 	struct gsm_bts_trx *trx;
-	unsigned int tn;
 
 	/* Report interference measurements */
 	if (fn % 104 == 0) /* SACCH period */
@@ -282,46 +410,19 @@ static void bts_sched_fn(struct gsm_bts *bts, const uint32_t fn)
 	/* Initialize Downlink burst buffers */
 	bts_sched_init_buffers(bts, fn);
 
-	/* Populate Downlink burst buffers for each TRX/TS */
-	llist_for_each_entry(trx, &bts->trx_list, list) {
-		const struct phy_link *plink = trx->pinst->phy_link;
-		struct trx_l1h *l1h = trx->pinst->u.osmotrx.hdl;
-
-		/* we don't schedule, if power is off */
-		if (!trx_if_powered(l1h))
-			continue;
+	/* Send RTS for each TRX/TS, this involves L2 and thus the main thread */
+	llist_for_each_entry(trx, &bts->trx_list, list)
+		bts_sched_rts_trx(trx, fn);
+	/* The RTS_REQ of all PDCH are batched now, hand them to the PCU */
+	pcu_sock_flush();
 
-		/* process every TS of TRX */
-		for (tn = 0; tn < ARRAY_SIZE(trx->ts); tn++) {
-			struct phy_instance *pinst = trx->pinst;
-			struct gsm_bts_trx_ts *ts = &trx->ts[tn];
-			struct l1sched_ts *l1ts = ts->priv;
-			struct trx_dl_burst_req *br;
-
-			/* ready-to-send */
-			TRACE(OSMO_BTS_TRX_DL_RTS_START(trx->nr, tn, fn));
-			_sched_rts(l1ts, GSM_TDMA_FN_SUM(fn, plink->u.osmotrx.clock_advance
-							   + plink->u.osmotrx.rts_advance));
-			TRACE(OSMO_BTS_TRX_DL_RTS_DONE(trx->nr, tn, fn));
-
-			/* pre-initialized buffer for the Downlink burst */
-			br = &pinst->u.osmotrx.br[tn];
-
-			/* resolve PHY instance if freq. hopping is enabled */
-			if (ts->hopping.enabled) {
-				pinst = dlfh_route_br(br, ts);
-				if (pinst == NULL)
-					continue;
-				/* simply use a different buffer */
-				br = &pinst->u.osmotrx.br[tn];
-			}
-
-			/* get burst for the primary timeslot */
-			_sched_dl_burst(l1ts, br);
-
-			/* get burst for the shadow timeslot */
-			_sched_dl_shadow_burst(ts->vamos.peer, br);
-		}
+	/* Populate Downlink burst buffers for each TRX/TS */
+	bts_sched_workers_update(bts);
+	if (priv->sched_workers != NULL) {
+		sched_worker_pool_run(priv->sched_workers);
+	} else {
+		llist_for_each_entry(trx, &bts->trx_list, list)
+			bts_sched_dl_trx(trx);
 	}
 
 	/* Send everything to the PHY */
@@ -332,27 +433,17 @@ static void bts_sched_fn(struct gsm_bts *bts, const uint32_t fn)
 static struct gsm_bts_trx *ulfh_route_bi(const struct trx_ul_burst_ind *bi,
 					 const struct gsm_bts_trx *src_trx)
 {
+	struct bts_trx_priv *priv = (struct bts_trx_priv *) src_trx->bts->model_priv;
 	struct gsm_bts_trx *trx;
-	struct gsm_time time;
-	uint16_t arfcn;
-
-	gsm_fn2gsmtime(&time, bi->fn);
-
-	llist_for_each_entry(trx, &src_trx->bts->trx_list, list) {
-		const struct gsm_bts_trx_ts *ts = &trx->ts[bi->tn];
-		if (!ts->hopping.enabled)
-			continue;
 
-		arfcn = gsm0502_hop_seq_gen(&time, SCHED_FH_PARAMS_VALS(ts), ts->hopping.arfcn_list);
-		if (src_trx->arfcn == arfcn)
-			return trx;
-	}
+	trx = fh_route_ul(priv->fh_route, src_trx, bi->tn, bi->fn);
+	if (OSMO_LIKELY(trx != NULL))
+		return trx;
 
 	LOGPTRX(src_trx, DL1C, LOGL_DEBUG, "Failed to find the transceiver (RF carrier) "
 		"for an Uplink burst (fn=%u, tn=%u, " SCHED_FH_PARAMS_FMT ")\n",
 		bi->fn, bi->tn, SCHED_FH_PARAMS_VALS(&src_trx->ts[bi->tn]));
 
-	struct bts_trx_priv *priv = (struct bts_trx_priv *) src_trx->bts->model_priv;
 	rate_ctr_inc2(priv->ctrs, BTSTRX_CTR_SCHED_UL_FH_NO_CARRIER);
 
 	return NULL;
@@ -488,6 +579,7 @@ int trx_sched_clock_started(struct gsm_bts *bts)
 	osmo_fd_close(&tcs->fn_timer_ofd);
 	memset(tcs, 0, sizeof(*tcs));
 	tcs->fn_timer_ofd.fd = -1;
+	trx_clk_filter_init(&tcs->filter);
 	/* Set up timeout to shutdown BTS if no clock ind is received in a few
 	 * seconds. Upon clock ind receival, fn_timer_ofd will be reused and
 	 * timeout won't trigger.
@@ -526,6 +618,18 @@ static int trx_setup_clock(struct gsm_bts *bts, struct osmo_trx_clock_state *tcs
 	return 0;
 }
 
+/*! convert the given period in micro-seconds into a 'struct timespec' */
+static inline void period_to_timespec(double period_us, struct timespec *ts)
+{
+	int64_t period_ns = (int64_t)(period_us * 1000);
+
+	/* never arm the timer with a zero (i.e. disabled) or negative value */
+	if (period_ns < 1000)
+		period_ns = 1000;
+	ts->tv_sec = period_ns / 1000000000;
+	ts->tv_nsec = period_ns % 1000000000;
+}
+
 /*! called every time we receive a clock indication from TRX */
 int trx_sched_clock(struct gsm_bts *bts, uint32_t fn)
 {
@@ -535,7 +639,9 @@ int trx_sched_clock(struct gsm_bts *bts, uint32_t fn)
 	int elapsed_fn;
 	int64_t elapsed_us, elapsed_us_since_clk, elapsed_fn_since_clk, error_us_since_clk;
 	unsigned int fn_caught_up = 0;
-	const struct timespec interval = { .tv_sec = 0, .tv_nsec = GSM_TDMA_FN_DURATION_nS };
+	struct timespec interval, first;
+	bool prev_clk_ind_valid;
+	double period_us;
 
 	/* reset lost counter */
 	tcs->fn_without_clock_ind = 0;
@@ -554,20 +660,12 @@ int trx_sched_clock(struct gsm_bts *bts, uint32_t fn)
 	 * now reports in the clock indication.   Positive elapsed_fn
 	 * values mean we still have a backlog to process */
 
-	/* calculate elapsed time +fn since last clk ind */
+	/* calculate elapsed time +fn since last clk ind (if any) */
+	prev_clk_ind_valid = tcs->last_clk_ind.valid;
 	elapsed_us_since_clk = compute_elapsed_us(&tcs->last_clk_ind.tv, &tv_now);
 	elapsed_fn_since_clk = compute_elapsed_fn(tcs->last_clk_ind.fn, fn);
-	/* error (delta) between local clock since last CLK and CLK based on FN clock at TRX */
-	error_us_since_clk = elapsed_us_since_clk - (GSM_TDMA_FN_DURATION_uS * elapsed_fn_since_clk);
-	LOGP(DL1C, LOGL_INFO, "TRX Clock Ind: elapsed_us=%7"PRId64", "
-		"elapsed_fn=%3"PRId64", error_us=%+5"PRId64"\n",
-		elapsed_us_since_clk, elapsed_fn_since_clk, error_us_since_clk);
-
-	/* TODO: put this computed error_us_since_clk into some filter
-	 * function and use that to adjust our regular timer interval to
-	 * compensate for clock drift between the PC clock and the
-	 * TRX/SDR clock */
 
+	tcs->last_clk_ind.valid = true;
 	tcs->last_clk_ind.tv = tv_now;
 	tcs->last_clk_ind.fn = fn;
 
@@ -575,19 +673,44 @@ int trx_sched_clock(struct gsm_bts *bts, uint32_t fn)
 	if (elapsed_fn > MAX_FN_SKEW || elapsed_fn < -MAX_FN_SKEW) {
 		LOGP(DL1C, LOGL_NOTICE, "GSM clock skew: old fn=%u, "
 			"new fn=%u\n", tcs->last_fn_timer.fn, fn);
+		/* start over, the next clock indication seeds the filter */
+		trx_clk_filter_reset(&tcs->filter);
+		period_to_timespec(trx_clk_filter_period_us(&tcs->filter), &interval);
 		return trx_setup_clock(bts, tcs, &tv_now, &interval, fn);
 	}
 
+	if (prev_clk_ind_valid) {
+		/* error (delta) between local clock since last CLK and CLK based on FN clock at TRX */
+		error_us_since_clk = elapsed_us_since_clk - (GSM_TDMA_FN_DURATION_uS * elapsed_fn_since_clk);
+		LOGP(DL1C, LOGL_INFO, "TRX Clock Ind: elapsed_us=%7"PRId64", "
+			"elapsed_fn=%3"PRId64", error_us=%+5"PRId64"\n",
+			elapsed_us_since_clk, elapsed_fn_since_clk, error_us_since_clk);
+
+		/* track the drift between the PC clock and the TRX/SDR clock, and
+		 * adjust our regular timer interval to compensate for it */
+		period_us = trx_clk_filter_update(&tcs->filter, elapsed_us_since_clk, elapsed_fn_since_clk,
+						  elapsed_us, elapsed_fn);
+		osmo_stat_item_set(osmo_stat_item_group_get_item(bts_trx->stats, BTSTRX_STAT_CLK_DRIFT),
+				   (int32_t)(tcs->filter.drift_ppm * 1000));
+		osmo_stat_item_set(osmo_stat_item_group_get_item(bts_trx->stats, BTSTRX_STAT_CLK_CORR),
+				   (int32_t)(tcs->filter.corr_ppm * 1000));
+		osmo_stat_item_set(osmo_stat_item_group_get_item(bts_trx->stats, BTSTRX_STAT_CLK_JITTER),
+				   (int32_t)tcs->filter.jitter_us);
+		LOGP(DL1C, LOGL_INFO, "TRX Clock drift: %+.3fppm, correction: %+.3fppm, jitter: %.0fus\n",
+			tcs->filter.drift_ppm, tcs->filter.corr_ppm, tcs->filter.jitter_us);
+	} else {
+		period_us = trx_clk_filter_period_us(&tcs->filter);
+	}
+	period_to_timespec(period_us, &interval);
+
 	LOGP(DL1C, LOGL_INFO, "GSM clock jitter: %" PRId64 "us (elapsed_fn=%d)\n",
 		elapsed_fn * GSM_TDMA_FN_DURATION_uS - elapsed_us, elapsed_fn);
 
 	/* too many frames have been processed already */
 	if (elapsed_fn < 0) {
-		struct timespec first = interval;
 		/* set clock to the time or last FN should have been
 		 * transmitted. */
-		first.tv_nsec += (0 - elapsed_fn) * GSM_TDMA_FN_DURATION_nS;
-		normalize_timespec(&first);
+		period_to_timespec(period_us * (1 - elapsed_fn), &first);
 		LOGP(DL1C, LOGL_NOTICE, "We were %d FN faster than TRX, compensating\n", -elapsed_fn);
 		/* set time to the time our next FN has to be transmitted */
 		osmo_timerfd_schedule(&tcs->fn_timer_ofd, &first, &interval);
@@ -603,8 +726,13 @@ int trx_sched_clock(struct gsm_bts *bts, uint32_t fn)
 	if (fn_caught_up) {
 		LOGP(DL1C, LOGL_NOTICE, "We were %d FN slower than TRX, compensated\n", elapsed_fn);
 		tcs->last_fn_timer.tv = tv_now;
+		elapsed_us = 0;
 	}
 
+	/* re-arm the timer with the (trimmed) interval, keeping its phase */
+	period_to_timespec(period_us - elapsed_us, &first);
+	osmo_timerfd_schedule(&tcs->fn_timer_ofd, &first, &interval);
+
 	return 0;
 }
 
@@ -618,92 +746,3 @@ void _sched_act_rach_det(struct gsm_bts_trx *trx, uint8_t tn, uint8_t ss, int ac
 	else
 		trx_if_cmd_nohandover(l1h, tn, ss);
 }
-
-/* Add a set of UL burst measurements to the history */
-void trx_sched_meas_push(struct l1sched_chan_state *chan_state,
-			 const struct trx_ul_burst_ind *bi)
-{
-	unsigned int hist_size = ARRAY_SIZE(chan_state->meas.buf);
-	unsigned int current = chan_state->meas.current;
-
-	chan_state->meas.buf[current] = (struct l1sched_meas_set) {
-		.fn = bi->fn,
-		.ci_cb = (bi->flags & TRX_BI_F_CI_CB) ? bi->ci_cb : 0,
-		.toa256 = bi->toa256,
-		.rssi = bi->rssi,
-	};
-
-	chan_state->meas.current = (current + 1) % hist_size;
-}
-
-/* Measurement averaging mode sets: [MODE] = { SHIFT, NUM } */
-static const uint8_t trx_sched_meas_modeset[][2] = {
-	[SCHED_MEAS_AVG_M_S24N22] = { 24, 22 },
-	[SCHED_MEAS_AVG_M_S22N22] = { 22, 22 },
-	[SCHED_MEAS_AVG_M_S4N4] = { 4, 4 },
-	[SCHED_MEAS_AVG_M_S8N8] = { 8, 8 },
-	[SCHED_MEAS_AVG_M_S6N4] = { 6, 4 },
-	[SCHED_MEAS_AVG_M_S6N6] = { 6, 6 },
-	[SCHED_MEAS_AVG_M_S8N4] = { 8, 4 },
-	[SCHED_MEAS_AVG_M_S6N2] = { 6, 2 },
-	[SCHED_MEAS_AVG_M_S4N2] = { 4, 2 },
-};
-
-/* Calculate the AVG of n measurements from the history */
-void trx_sched_meas_avg(const struct l1sched_chan_state *chan_state,
-			struct l1sched_meas_set *avg,
-			enum sched_meas_avg_mode mode)
-{
-	unsigned int hist_size = ARRAY_SIZE(chan_state->meas.buf);
-	unsigned int current = chan_state->meas.current;
-	const struct l1sched_meas_set *set;
-	unsigned int pos, i;
-
-	float rssi_sum = 0;
-	int toa256_sum = 0;
-	int ci_cb_sum = 0;
-
-	const unsigned int shift = trx_sched_meas_modeset[mode][0];
-	const unsigned int num = trx_sched_meas_modeset[mode][1];
-
-	/* Calculate the sum of n entries starting from pos */
-	for (i = 0; i < num; i++) {
-		pos = (current + hist_size - shift + i) % hist_size;
-		set = &chan_state->meas.buf[pos];
-
-		rssi_sum   += set->rssi;
-		toa256_sum += set->toa256;
-		ci_cb_sum  += set->ci_cb;
-	}
-
-	/* First sample contains TDMA frame number of the first burst */
-	pos = (current + hist_size - shift) % hist_size;
-	set = &chan_state->meas.buf[pos];
-
-	/* Calculate the average for each value */
-	*avg = (struct l1sched_meas_set) {
-		.fn     = set->fn, /* first burst */
-		.rssi   = (rssi_sum   / num),
-		.toa256 = (toa256_sum / num),
-		.ci_cb  = (ci_cb_sum  / num),
-	};
-
-	LOGP(DMEAS, LOGL_DEBUG, "%s%sMeasurement AVG (num=%u, shift=%u): "
-	     "RSSI %f, ToA256 %d, C/I %d cB\n",
-	     chan_state->lchan ? gsm_lchan_name(chan_state->lchan) : "",
-	     chan_state->lchan ? " " : "",
-	     num, shift, avg->rssi, avg->toa256, avg->ci_cb);
-}
-
-/* Lookup TDMA frame number of the N-th sample in the history */
-uint32_t trx_sched_lookup_fn(const struct l1sched_chan_state *chan_state,
-			     const unsigned int shift)
-{
-	const unsigned int hist_size = ARRAY_SIZE(chan_state->meas.buf);
-	const unsigned int current = chan_state->meas.current;
-	unsigned int pos;
-
-	/* First sample contains TDMA frame number of the first burst */
-	pos = (current + hist_size - shift) % hist_size;
-	return chan_state->meas.buf[pos].fn;
-}
@@ -0,0 +1,169 @@
+/* Clock drift tracking filter for the TRX frame clock */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* The local frame timer (CLOCK_MONOTONIC) and the TRX/SDR clock are never
+ * exactly the same frequency.  Instead of letting them drift apart until
+ * a whole frame has to be skipped or caught up, the frame period of the
+ * local timer is continuously trimmed:
+ *
+ *  - A Kalman filter tracks the offset (us) and the drift (ppm) of the
+ *    TRX clock, using the local arrival time of each clock indication
+ *    as a (jittery) measurement of the offset.  The drift is modelled
+ *    as a random walk.
+ *
+ *  - The timer period is the nominal one, scaled by the estimated drift,
+ *    plus a proportional correction of the remaining phase error of the
+ *    timer, spread over the interval until the next clock indication.
+ *    The timer is steered to expire half a frame ahead of the clock
+ *    indications, so that their jitter does not make the frame number
+ *    reported by the TRX flap between two timer expiries (which would
+ *    trigger the catch-up / slow-down paths of trx_sched_clock()).
+ *
+ * The filter is free of any I/O, so that it can be driven by a simulation
+ * (see tests/trx_clk). */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "trx_clk_filter.h"
+
+/* GSM TDMA frame duration: 120 ms / 26 */
+#define TRX_CLK_FN_DURATION_US	(120000.0 / 26)
+
+/* Clock indications further apart than this are not used as measurements */
+#define TRX_CLK_MAX_ELAPSED_FN	(26 * 51 * 16)
+
+/* Initial uncertainty of the drift estimate */
+#define TRX_CLK_INIT_DRIFT_PPM	100.0
+
+/*! Initialize the parameters and reset the estimates */
+void trx_clk_filter_init(struct trx_clk_filter *f)
+{
+	memset(f, 0, sizeof(*f));
+
+	f->nominal_us = TRX_CLK_FN_DURATION_US;
+	f->meas_jitter_us = 100.0;
+	f->drift_walk_ppm = 0.01;
+	f->phase_gain = 0.5;
+	f->max_corr_ppm = 500.0;
+}
+
+/*! Reset the estimates, e.g. after the clock was lost */
+void trx_clk_filter_reset(struct trx_clk_filter *f)
+{
+	f->valid = false;
+	f->offset_us = 0.0;
+	f->phase_us = 0.0;
+	f->drift_ppm = 0.0;
+	memset(f->cov, 0, sizeof(f->cov));
+	f->corr_ppm = 0.0;
+	f->jitter_us = 0.0;
+	f->updates = 0;
+}
+
+static double clamp(double val, double limit)
+{
+	if (val > limit)
+		return limit;
+	if (val < -limit)
+		return -limit;
+	return val;
+}
+
+/*! Process a clock indication.
+ *  \param[inout] f the filter.
+ *  \param[in] elapsed_us local time elapsed since the previous clock indication.
+ *  \param[in] elapsed_fn TDMA frames elapsed since the previous clock indication.
+ *  \param[in] timer_elapsed_us local time elapsed since the last timer expiry.
+ *  \param[in] timer_elapsed_fn TDMA frames the TRX is ahead of the last timer expiry.
+ *  \returns the frame period (in us) to be used from now on. */
+double trx_clk_filter_update(struct trx_clk_filter *f,
+			     int64_t elapsed_us, int64_t elapsed_fn,
+			     int64_t timer_elapsed_us, int64_t timer_elapsed_fn)
+{
+	const double r = f->meas_jitter_us * f->meas_jitter_us;
+	double t_s, innov, s, k0, k1, phase_err_us;
+	double p00, p01, p10, p11;
+
+	/* Not a usable measurement (first indication, clock reset, ...) */
+	if (elapsed_fn <= 0 || elapsed_fn > TRX_CLK_MAX_ELAPSED_FN || elapsed_us <= 0)
+		return trx_clk_filter_period_us(f);
+
+	/* The sum of the per-interval errors is the offset of the TRX clock
+	 * since the first clock indication; the jitter does not accumulate */
+	f->offset_us += elapsed_us - f->nominal_us * elapsed_fn;
+	t_s = f->nominal_us * elapsed_fn / 1000000.0;
+
+	if (!f->valid) {
+		f->valid = true;
+		f->phase_us = f->offset_us;
+		f->drift_ppm = 0.0;
+		f->cov[0][0] = r;
+		f->cov[0][1] = f->cov[1][0] = 0.0;
+		f->cov[1][1] = TRX_CLK_INIT_DRIFT_PPM * TRX_CLK_INIT_DRIFT_PPM;
+		goto out;
+	}
+
+	/* Predict: the offset grows by drift (ppm = us/s) times the interval */
+	f->phase_us += f->drift_ppm * t_s;
+	p00 = f->cov[0][0] + t_s * (f->cov[1][0] + f->cov[0][1]) + t_s * t_s * f->cov[1][1];
+	p01 = f->cov[0][1] + t_s * f->cov[1][1];
+	p10 = f->cov[1][0] + t_s * f->cov[1][1];
+	p11 = f->cov[1][1] + f->drift_walk_ppm * f->drift_walk_ppm * t_s;
+
+	/* Update with the measured offset */
+	innov = f->offset_us - f->phase_us;
+	s = p00 + r;
+	k0 = p00 / s;
+	k1 = p10 / s;
+
+	f->phase_us += k0 * innov;
+	f->drift_ppm += k1 * innov;
+	f->cov[0][0] = (1.0 - k0) * p00;
+	f->cov[0][1] = (1.0 - k0) * p01;
+	f->cov[1][0] = p10 - k1 * p00;
+	f->cov[1][1] = p11 - k1 * p01;
+
+	/* Residual jitter: average absolute innovation */
+	f->jitter_us += ((innov < 0 ? -innov : innov) - f->jitter_us) / 16;
+
+out:
+	f->updates++;
+
+	/* Phase error of the timer (positive if late), against the middle
+	 * of the frame the TRX reported */
+	phase_err_us = timer_elapsed_fn * f->nominal_us - timer_elapsed_us + f->nominal_us / 2;
+	f->phase_err_us = phase_err_us;
+
+	/* Trim the period by the drift, and correct the phase error of the
+	 * timer by the time the next clock indication is expected */
+	f->corr_ppm = clamp(f->drift_ppm - f->phase_gain * phase_err_us / t_s,
+			    f->max_corr_ppm);
+
+	return trx_clk_filter_period_us(f);
+}
+
+/*! Frame period (in us) according to the current estimates */
+double trx_clk_filter_period_us(const struct trx_clk_filter *f)
+{
+	return f->nominal_us * (1.0 + f->corr_ppm / 1000000.0);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+/* Clock drift tracking filter for the TRX frame clock */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*! Drift tracking filter state, see trx_clk_filter.c */
+struct trx_clk_filter {
+	/* Parameters, set by trx_clk_filter_init() */
+	double nominal_us;	/*!< nominal TDMA frame period */
+	double meas_jitter_us;	/*!< expected jitter of the clock indications */
+	double drift_walk_ppm;	/*!< expected drift wander (per square root of a second) */
+	double phase_gain;	/*!< part of the phase error corrected until the next clock indication */
+	double max_corr_ppm;	/*!< limit of the period correction */
+
+	/* Estimates */
+	bool valid;		/*!< at least one clock indication was processed */
+	double offset_us;	/*!< measured offset of the TRX clock (accumulated error) */
+	double phase_us;	/*!< estimated offset of the TRX clock */
+	double drift_ppm;	/*!< estimated drift of the TRX clock against the local one */
+	double cov[2][2];	/*!< covariance of (phase_us, drift_ppm) */
+	double phase_err_us;	/*!< last phase error of the local frame timer */
+	double corr_ppm;	/*!< period correction currently applied */
+	double jitter_us;	/*!< residual jitter (average absolute innovation) */
+	unsigned int updates;	/*!< number of clock indications processed */
+};
+
+void trx_clk_filter_init(struct trx_clk_filter *f);
+void trx_clk_filter_reset(struct trx_clk_filter *f);
+double trx_clk_filter_update(struct trx_clk_filter *f,
+			     int64_t elapsed_us, int64_t elapsed_fn,
+			     int64_t timer_elapsed_us, int64_t timer_elapsed_fn);
+double trx_clk_filter_period_us(const struct trx_clk_filter *f);
@@ -26,6 +26,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdint.h>
 #include <unistd.h>
@@ -33,6 +34,8 @@
 #include <errno.h>
 #include <string.h>
 
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 
 #include <osmocom/core/select.h>
@@ -41,11 +44,13 @@
 #include <osmocom/core/talloc.h>
 #include <osmocom/core/bits.h>
 #include <osmocom/core/fsm.h>
+#include <osmocom/core/rate_ctr.h>
 
 #include <osmo-bts/phy_link.h>
 #include <osmo-bts/logging.h>
 #include <osmo-bts/bts.h>
 #include <osmo-bts/scheduler.h>
+#include <osmo-bts/shm_ring.h>
 
 #include "l1_if.h"
 #include "trx_if.h"
@@ -158,19 +163,13 @@ static int trx_clk_read_cb(struct osmo_fd *ofd, unsigned int what)
  * TRX ctrl socket
  */
 
-/* send first ctrl message and start timer */
-static void trx_ctrl_send(struct trx_l1h *l1h)
+/* send a ctrl message and (re-)start its retransmission timer */
+static void trx_ctrl_send_msg(struct trx_l1h *l1h, struct trx_ctrl_msg *tcm)
 {
-	struct trx_ctrl_msg *tcm;
 	char buf[TRXC_MSG_BUF_SIZE];
 	int len;
 	ssize_t snd_len;
 
-	/* get first command */
-	if (llist_empty(&l1h->trx_ctrl_list))
-		return;
-	tcm = llist_entry(l1h->trx_ctrl_list.next, struct trx_ctrl_msg, list);
-
 	len = snprintf(buf, sizeof(buf), "CMD %s%s%s", tcm->cmd, tcm->params_len ? " ":"", tcm->params);
 	OSMO_ASSERT(len < sizeof(buf));
 
@@ -184,35 +183,96 @@ static void trx_ctrl_send(struct trx_l1h *l1h)
 	}
 
 	/* start timer */
-	osmo_timer_schedule(&l1h->trx_ctrl_timer, 2, 0);
+	osmo_timer_schedule(&tcm->timer, 2, 0);
 }
 
-/* send first ctrl message and start timer */
-static void trx_ctrl_timer_cb(void *data)
+/* POWERON/POWEROFF change the state of the transceiver the other commands
+ * depend on, and old transceivers reject SETFORMAT with 'RSP ERR 1', which
+ * can only be matched if nothing else is in flight.  So these commands are
+ * only sent when nothing else is in flight, and nothing is sent behind
+ * them until they are acknowledged. */
+static bool trx_ctrl_is_barrier(const struct trx_ctrl_msg *tcm)
 {
-	struct trx_l1h *l1h = data;
-	struct trx_ctrl_msg *tcm = NULL;
+	return !strcmp(tcm->cmd, "POWERON") || !strcmp(tcm->cmd, "POWEROFF") ||
+	       !strcmp(tcm->cmd, "SETFORMAT");
+}
+
+/* Two commands may not be in flight together if their responses could not
+ * be told apart (see cmd_matches_rsp()), or if they act on the same state
+ * and a retransmission could thus reorder them. */
+static bool trx_ctrl_conflicts(const struct trx_ctrl_msg *a, const struct trx_ctrl_msg *b)
+{
+	bool a_ho = !strcmp(a->cmd, "HANDOVER") || !strcmp(a->cmd, "NOHANDOVER");
+	bool b_ho = !strcmp(b->cmd, "HANDOVER") || !strcmp(b->cmd, "NOHANDOVER");
+
+	if (a_ho && b_ho)
+		return true;
+	if (strcmp(a->cmd, b->cmd))
+		return false;
+	/* one SETSLOT per timeslot: "<TN> <TS_TYPE>..." */
+	if (!strcmp(a->cmd, "SETSLOT"))
+		return strtoul(a->params, NULL, 10) == strtoul(b->params, NULL, 10);
+	return true;
+}
+
+/* send queued ctrl messages, as long as the window allows.  Messages are
+ * always sent in the order they were queued, so the ones in flight are
+ * at the head of the queue. */
+static void trx_ctrl_send(struct trx_l1h *l1h)
+{
+	const struct phy_link *plink = l1h->phy_inst->phy_link;
+	unsigned int window = OSMO_MAX(plink->u.osmotrx.trxc_window, 1);
+	struct trx_ctrl_msg *tcm, *prev;
+
+	llist_for_each_entry(tcm, &l1h->trx_ctrl_list, list) {
+		if (tcm->in_flight) {
+			if (trx_ctrl_is_barrier(tcm))
+				return;
+			continue;
+		}
+
+		if (l1h->trx_ctrl_in_flight >= window)
+			return;
+		if (l1h->trx_ctrl_in_flight > 0 && trx_ctrl_is_barrier(tcm))
+			return;
+		llist_for_each_entry(prev, &l1h->trx_ctrl_list, list) {
+			if (!prev->in_flight)
+				break;
+			if (trx_ctrl_conflicts(prev, tcm))
+				return;
+		}
 
-	/* get first command */
-	OSMO_ASSERT(!llist_empty(&l1h->trx_ctrl_list));
-	tcm = llist_entry(l1h->trx_ctrl_list.next, struct trx_ctrl_msg, list);
+		tcm->in_flight = true;
+		l1h->trx_ctrl_in_flight++;
+		trx_ctrl_send_msg(l1h, tcm);
+		if (trx_ctrl_is_barrier(tcm))
+			return;
+	}
+}
+
+/* no response to a ctrl message in flight: send it again */
+static void trx_ctrl_timer_cb(void *data)
+{
+	struct trx_ctrl_msg *tcm = data;
+	struct trx_l1h *l1h = tcm->l1h;
 
 	LOGPPHI(l1h->phy_inst, DTRX, LOGL_NOTICE, "No satisfactory response from transceiver(CMD %s%s%s)\n",
 		tcm->cmd, tcm->params_len ? " ":"", tcm->params);
 
-	trx_ctrl_send(l1h);
+	trx_ctrl_send_msg(l1h, tcm);
 }
 
 void trx_if_init(struct trx_l1h *l1h)
 {
-	l1h->trx_ctrl_timer.cb = trx_ctrl_timer_cb;
-	l1h->trx_ctrl_timer.data = l1h;
-
 	/* initialize ctrl queue */
 	INIT_LLIST_HEAD(&l1h->trx_ctrl_list);
+	INIT_LLIST_HEAD(&l1h->trx_ctrl_acked);
 
 	l1h->trx_ofd_ctrl.fd = -1;
 	l1h->trx_ofd_data.fd = -1;
+	l1h->trxd_shm_ofd.fd = -1;
+	l1h->trxd_shm_srv_ofd.fd = -1;
+	l1h->trxd_shm_peer_ofd.fd = -1;
 }
 
 /*! Send a new TRX control command.
@@ -253,6 +313,8 @@ int trx_ctrl_cmd_cb(struct trx_l1h *l1h, int critical, void *cb,
 	}
 	tcm->critical = critical;
 	tcm->cb = cb;
+	tcm->l1h = l1h;
+	osmo_timer_setup(&tcm->timer, trx_ctrl_timer_cb, tcm);
 
 	/* Avoid adding consecutive duplicate messages, eg: two consecutive POWEROFF */
 	if (!llist_empty(&l1h->trx_ctrl_list))
@@ -269,10 +331,10 @@ int trx_ctrl_cmd_cb(struct trx_l1h *l1h, int critical, void *cb,
 		tcm->cmd, tcm->params_len ? " " : "", tcm->params);
 	llist_add_tail(&tcm->list, &l1h->trx_ctrl_list);
 
-	/* send message, if we didn't already have pending messages.
+	/* send message, if the window allows.
 	 * If we are in the rx_rsp callback code path, skip sending, the
 	 * callback will do so when returning to it. */
-	if (prev == NULL && !l1h->in_trx_ctrl_read_cb)
+	if (!l1h->in_trx_ctrl_read_cb)
 		trx_ctrl_send(l1h);
 
 	return 0;
@@ -494,6 +556,59 @@ static bool cmd_matches_rsp(struct trx_ctrl_msg *tcm, struct trx_ctrl_rsp *rsp)
 	return true;
 }
 
+/* find the (oldest) command in flight the response is for */
+static struct trx_ctrl_msg *trx_ctrl_find_rsp(struct trx_l1h *l1h, struct trx_ctrl_rsp *rsp)
+{
+	struct trx_ctrl_msg *tcm;
+
+	llist_for_each_entry(tcm, &l1h->trx_ctrl_list, list) {
+		if (!tcm->in_flight)
+			break;
+		if (cmd_matches_rsp(tcm, rsp))
+			return tcm;
+	}
+
+	return NULL;
+}
+
+/* RSP from a retransmission of an already acknowledged command? */
+static bool trx_ctrl_rsp_is_dup(struct trx_l1h *l1h, struct trx_ctrl_rsp *rsp)
+{
+	struct trx_ctrl_msg *tcm;
+
+	llist_for_each_entry(tcm, &l1h->trx_ctrl_acked, list) {
+		if (cmd_matches_rsp(tcm, rsp))
+			return true;
+	}
+
+	return false;
+}
+
+/* remove an acknowledged command from the send queue, keep the latest
+ * ones (as many as may be in flight) to catch duplicate RSPs */
+static void trx_ctrl_ack(struct trx_l1h *l1h, struct trx_ctrl_msg *tcm)
+{
+	const struct phy_link *plink = l1h->phy_inst->phy_link;
+	unsigned int window = OSMO_MAX(plink->u.osmotrx.trxc_window, 1);
+	struct trx_ctrl_msg *old;
+
+	osmo_timer_del(&tcm->timer);
+	tcm->in_flight = false;
+	OSMO_ASSERT(l1h->trx_ctrl_in_flight > 0);
+	l1h->trx_ctrl_in_flight--;
+
+	llist_del(&tcm->list);
+	llist_add_tail(&tcm->list, &l1h->trx_ctrl_acked);
+	l1h->trx_ctrl_acked_num++;
+
+	while (l1h->trx_ctrl_acked_num > window) {
+		old = llist_first_entry(&l1h->trx_ctrl_acked, struct trx_ctrl_msg, list);
+		llist_del(&old->list);
+		talloc_free(old);
+		l1h->trx_ctrl_acked_num--;
+	}
+}
+
 static int trx_ctrl_rx_rsp_poweron(struct trx_l1h *l1h, struct trx_ctrl_rsp *rsp)
 {
 	trx_if_cmd_poweronoff_cb *cb = (trx_if_cmd_poweronoff_cb*) rsp->cb;
@@ -686,41 +801,47 @@ static int trx_ctrl_read_cb(struct osmo_fd *ofd, unsigned int what)
 
 	LOGPPHI(l1h->phy_inst, DTRX, LOGL_INFO, "Response message: '%s'\n", buf);
 
-	/* abort timer and send next message, if any */
-	osmo_timer_del(&l1h->trx_ctrl_timer);
-
 	/* get command for response message */
-	if (llist_empty(&l1h->trx_ctrl_list)) {
+	tcm = trx_ctrl_find_rsp(l1h, &rsp);
+	if (!tcm) {
 		/* RSP from a retransmission, skip it */
-		if (l1h->last_acked && cmd_matches_rsp(l1h->last_acked, &rsp)) {
+		if (trx_ctrl_rsp_is_dup(l1h, &rsp)) {
 			LOGPPHI(l1h->phy_inst, DTRX, LOGL_NOTICE, "Discarding duplicated RSP "
 				"from old CMD '%s'\n", buf);
 			return 0;
 		}
-		LOGPPHI(l1h->phy_inst, DTRX, LOGL_NOTICE, "Response message without command\n");
-		return -EINVAL;
-	}
-	tcm = llist_entry(l1h->trx_ctrl_list.next, struct trx_ctrl_msg,
-		list);
+		if (l1h->trx_ctrl_in_flight == 0) {
+			LOGPPHI(l1h->phy_inst, DTRX, LOGL_NOTICE, "Response message without command\n");
+			return -EINVAL;
+		}
 
-	/* check if response matches command */
-	if (!cmd_matches_rsp(tcm, &rsp)) {
-		/* RSP from a retransmission, skip it */
-		if (l1h->last_acked && cmd_matches_rsp(l1h->last_acked, &rsp)) {
-			LOGPPHI(l1h->phy_inst, DTRX, LOGL_NOTICE, "Discarding duplicated RSP "
-				"from old CMD '%s'\n", buf);
+		/* With several commands in flight, there is no telling which
+		 * one this is the response to: drop it, the retransmission
+		 * timers take care of the command(s) it was meant for. */
+		if (l1h->trx_ctrl_in_flight > 1) {
+			LOGPPHI(l1h->phy_inst, DTRX, LOGL_NOTICE, "Response message '%s' does "
+				"not match any of the %u commands in flight, discarding\n",
+				buf, l1h->trx_ctrl_in_flight);
 			return 0;
 		}
+
+		/* Only one command in flight, this is presumably its response */
+		tcm = llist_first_entry(&l1h->trx_ctrl_list, struct trx_ctrl_msg, list);
 		LOGPPHI(l1h->phy_inst, DTRX, (tcm->critical) ? LOGL_FATAL : LOGL_NOTICE,
 			"Response message '%s' does not match command "
 			"message 'CMD %s%s%s'\n",
 			buf, tcm->cmd, tcm->params_len ? " ":"", tcm->params);
 
 		/* We may get 'RSP ERR 1' for non-critical commands */
-		if (tcm->critical)
+		if (tcm->critical) {
+			osmo_timer_del(&tcm->timer);
 			goto rsp_error;
+		}
 	}
 
+	/* abort retransmission timer of the command */
+	osmo_timer_del(&tcm->timer);
+
 	rsp.cb = tcm->cb;
 
 	/* check for response code */
@@ -734,24 +855,20 @@ static int trx_ctrl_read_cb(struct osmo_fd *ofd, unsigned int what)
 	if (rc == -EINVAL)
 		goto rsp_error;
 
-	/* re-schedule last cmd in rc seconds time */
+	/* re-schedule the cmd in rc seconds time */
 	if (rc > 0) {
 		/* The queue may have been flushed in the trx_ctrl_rx_rsp(): */
-		if (!llist_empty(&l1h->trx_ctrl_list))
-			osmo_timer_schedule(&l1h->trx_ctrl_timer, rc, 0);
+		if (!flushed)
+			osmo_timer_schedule(&tcm->timer, rc, 0);
 		return 0;
 	}
 
-	if (!flushed) {
-		/* Remove command from list, save it to last_acked and removed
-		 * previous last_acked */
-		llist_del(&tcm->list);
-		talloc_free(l1h->last_acked);
-		l1h->last_acked = tcm;
-	} /* else: tcm was freed by trx_if_flush(), do not access it. */
-
+	/* Remove command from list, save it to the acked ones */
+	if (!flushed)
+		trx_ctrl_ack(l1h, tcm);
+	/* else: tcm was freed by trx_if_flush(), do not access it. */
 
-	/* Send next message waiting in the list: */
+	/* Send next messages waiting in the list: */
 	trx_ctrl_send(l1h);
 
 	return 0;
@@ -787,6 +904,9 @@ static const uint8_t trx_data_mod_val[] = {
 	[TRX_MOD_T_AQPSK]	= 0x60, /* .11xx... */
 };
 
+/* Max. length of a Downlink PDU header (TRXDv2, the first PDU) */
+#define TRX_DL_HDR_LEN_MAX	(1 + 1 + 1 + 1 + 1 + 3 + 4)
+
 /* Header dissector for TRXDv0 (and part of TRXDv1) */
 static inline void trx_data_handle_hdr_v0_part(struct trx_ul_burst_ind *bi,
 					       const uint8_t *buf)
@@ -1012,27 +1132,29 @@ static const char *trx_data_desc_msg(const struct trx_ul_burst_ind *bi)
 	return buf;
 }
 
-/* TRXD buffer used by Rx/Tx handlers */
-static uint8_t trx_data_buf[TRXD_MSG_BUF_SIZE];
+/* Increment a TRXD I/O counter of the BTS this PHY instance belongs to */
+static inline void trx_data_ctr_add(const struct trx_l1h *l1h,
+				    unsigned int idx, int val)
+{
+	const struct phy_instance *pinst = l1h->phy_inst;
+	struct bts_trx_priv *priv;
 
-/* Parse TRXD message from transceiver, compose an UL burst indication. */
-static int trx_data_read_cb(struct osmo_fd *ofd, unsigned int what)
+	/* PHY instance may be not associated with a TRX instance */
+	if (OSMO_UNLIKELY(pinst->trx == NULL))
+		return;
+
+	priv = (struct bts_trx_priv *) pinst->trx->bts->model_priv;
+	rate_ctr_add2(priv->ctrs, idx, val);
+}
+
+/* Parse TRXD datagram from transceiver, compose UL burst indication(s). */
+static int trx_data_handle_dgram(struct trx_l1h *l1h,
+				 const uint8_t *buf, ssize_t buf_len)
 {
-	const uint8_t *buf = &trx_data_buf[0];
-	struct trx_l1h *l1h = ofd->data;
 	struct trx_ul_burst_ind bi;
-	ssize_t hdr_len, buf_len;
+	ssize_t hdr_len;
 	uint8_t pdu_ver;
 
-	buf_len = recv(ofd->fd, trx_data_buf, sizeof(trx_data_buf), 0);
-	if (OSMO_UNLIKELY(buf_len <= 0)) {
-		strerror_r(errno, (char *) trx_data_buf, sizeof(trx_data_buf));
-		LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
-			"recv() failed on TRXD with rc=%zd (%s)\n",
-			buf_len, trx_data_buf);
-		return buf_len;
-	}
-
 	/* Parse PDU version first */
 	pdu_ver = buf[0] >> 4;
 
@@ -1120,40 +1242,256 @@ static int trx_data_read_cb(struct osmo_fd *ofd, unsigned int what)
 	return 0;
 }
 
-/*! Send burst data for given FN/timeslot to TRX
+/* Drain all pending TRXD datagrams, up to TRXD_MMSG_MAX per recvmmsg() call */
+static int trx_data_read_batch(struct trx_l1h *l1h, struct osmo_fd *ofd)
+{
+	struct trx_data_rx_state *rx = &l1h->data_rx;
+	struct mmsghdr msgs[TRXD_MMSG_MAX];
+	struct iovec iov[TRXD_MMSG_MAX];
+	int i, num;
+
+	/* Batched I/O is off by default, don't keep the buffers around for nothing */
+	if (OSMO_UNLIKELY(rx->mmsg_buf == NULL)) {
+		rx->mmsg_buf = talloc_zero_size(l1h, TRXD_MMSG_MAX * TRXD_MMSG_BUF_SIZE);
+		if (rx->mmsg_buf == NULL)
+			return -ENOMEM;
+	}
+
+	memset(&msgs[0], 0x00, sizeof(msgs));
+	for (i = 0; i < ARRAY_SIZE(msgs); i++) {
+		iov[i] = (struct iovec) {
+			.iov_base = &rx->mmsg_buf[i][0],
+			.iov_len = TRXD_MMSG_BUF_SIZE,
+		};
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	/* All buffers filled: there may be more, read until EAGAIN */
+	do {
+		num = recvmmsg(ofd->fd, &msgs[0], ARRAY_SIZE(msgs), MSG_DONTWAIT, NULL);
+		if (num < 0) {
+			/* The socket is drained, this is not an error */
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return 0;
+			LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
+				"recvmmsg() failed on TRXD with rc=%d (%s)\n",
+				num, strerror(errno));
+			return -errno;
+		}
+
+		trx_data_ctr_add(l1h, BTSTRX_CTR_TRXD_RX_SYSCALLS, 1);
+		trx_data_ctr_add(l1h, BTSTRX_CTR_TRXD_RX_DGRAMS, num);
+
+		for (i = 0; i < num; i++) {
+			if (OSMO_UNLIKELY(msgs[i].msg_hdr.msg_flags & MSG_TRUNC)) {
+				LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
+					"Rx TRXD datagram exceeds %u bytes, dropping\n",
+					TRXD_MMSG_BUF_SIZE);
+				trx_data_ctr_add(l1h, BTSTRX_CTR_TRXD_RX_OVERSIZE, 1);
+				continue;
+			}
+			if (OSMO_UNLIKELY(msgs[i].msg_len == 0))
+				continue;
+			/* A malformed datagram shall not affect the others */
+			trx_data_handle_dgram(l1h, &rx->mmsg_buf[i][0], msgs[i].msg_len);
+		}
+	} while (num == ARRAY_SIZE(msgs));
+
+	return 0;
+}
+
+/* Read TRXD message(s) from transceiver, compose UL burst indications. */
+static int trx_data_read_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct trx_l1h *l1h = ofd->data;
+	uint8_t *buf = &l1h->data_rx.buf[0];
+	ssize_t buf_len;
+
+	if (l1h->phy_inst->phy_link->u.osmotrx.trxd_batch_io)
+		return trx_data_read_batch(l1h, ofd);
+
+	/* MSG_TRUNC: get the real length of a datagram exceeding the buffer */
+	buf_len = recv(ofd->fd, buf, sizeof(l1h->data_rx.buf), MSG_TRUNC);
+	if (OSMO_UNLIKELY(buf_len <= 0)) {
+		LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
+			"recv() failed on TRXD with rc=%zd (%s)\n",
+			buf_len, strerror(errno));
+		return buf_len;
+	}
+
+	trx_data_ctr_add(l1h, BTSTRX_CTR_TRXD_RX_SYSCALLS, 1);
+	trx_data_ctr_add(l1h, BTSTRX_CTR_TRXD_RX_DGRAMS, 1);
+
+	if (OSMO_UNLIKELY(buf_len > sizeof(l1h->data_rx.buf))) {
+		LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
+			"Rx TRXD datagram exceeds %u bytes, dropping\n",
+			TRXD_MMSG_BUF_SIZE);
+		trx_data_ctr_add(l1h, BTSTRX_CTR_TRXD_RX_OVERSIZE, 1);
+		return -EINVAL;
+	}
+
+	return trx_data_handle_dgram(l1h, buf, buf_len);
+}
+
+static void trx_shm_peer_close(struct trx_l1h *l1h);
+
+/* Consume TRXD datagrams from the shared memory ring */
+static int trx_data_shm_read_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct trx_l1h *l1h = ofd->data;
+	uint8_t *buf = &l1h->data_rx.buf[0];
+	int len;
+
+	shm_link_rx_ack(l1h->trxd_shm);
+
+	/* Drain the ring, a wakeup is requested once it is empty */
+	while ((len = shm_link_pop(l1h->trxd_shm, buf, sizeof(l1h->data_rx.buf))) != -EAGAIN) {
+		if (OSMO_UNLIKELY(len == -EIO)) {
+			/* the ring is reset before the next transceiver attaches */
+			LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
+				"The shm ring of the transceiver is corrupt, dropping it\n");
+			trx_shm_peer_close(l1h);
+			break;
+		}
+		if (OSMO_UNLIKELY(len == -EMSGSIZE)) {
+			LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
+				"Rx TRXD datagram exceeds %u bytes, dropping\n",
+				TRXD_MMSG_BUF_SIZE);
+			trx_data_ctr_add(l1h, BTSTRX_CTR_TRXD_RX_OVERSIZE, 1);
+			continue;
+		}
+		if (OSMO_UNLIKELY(len <= 0)) {
+			LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
+				"Rx malformed TRXD datagram from the shm ring (rc=%d)\n", len);
+			continue;
+		}
+
+		trx_data_ctr_add(l1h, BTSTRX_CTR_TRXD_RX_DGRAMS, 1);
+		trx_data_handle_dgram(l1h, buf, len);
+	}
+
+	return 0;
+}
+
+/* Enqueue a number of TRXD datagrams into the shared memory ring */
+static int trx_data_send_shm(struct trx_l1h *l1h, const struct iovec *iov, unsigned int num)
+{
+	unsigned int i;
+	int rc;
+
+	for (i = 0; i < num; i++) {
+		rc = shm_link_push(l1h->trxd_shm, iov[i].iov_base, iov[i].iov_len);
+		if (OSMO_UNLIKELY(rc < 0)) {
+			LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
+				"Failed to enqueue TRXD datagram into the shm ring (%s)\n",
+				strerror(-rc));
+			return -2;
+		}
+	}
+
+	trx_data_ctr_add(l1h, BTSTRX_CTR_TRXD_TX_DGRAMS, num);
+
+	return 0;
+}
+
+/* Send a number of TRXD datagrams using as few sendmmsg() calls as possible */
+static int trx_data_send_batch(struct trx_l1h *l1h, struct iovec *iov, unsigned int num)
+{
+	struct mmsghdr msgs[TRXD_MMSG_MAX];
+	unsigned int i, sent = 0;
+	int rc;
+
+	OSMO_ASSERT(num <= ARRAY_SIZE(msgs));
+
+	memset(&msgs[0], 0x00, sizeof(msgs[0]) * num);
+	for (i = 0; i < num; i++) {
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	/* sendmmsg() may return early, so loop until all are sent */
+	while (sent < num) {
+		rc = sendmmsg(l1h->trx_ofd_data.fd, &msgs[sent], num - sent, 0);
+		if (OSMO_UNLIKELY(rc <= 0)) {
+			LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
+				"sendmmsg() failed on TRXD with rc=%d (%s)\n",
+				rc, strerror(errno));
+			return -2;
+		}
+
+		trx_data_ctr_add(l1h, BTSTRX_CTR_TRXD_TX_SYSCALLS, 1);
+		trx_data_ctr_add(l1h, BTSTRX_CTR_TRXD_TX_DGRAMS, rc);
+		sent += rc;
+	}
+
+	return 0;
+}
+
+/* Send a number of TRXD datagrams, one send() call per datagram */
+static int trx_data_send_each(struct trx_l1h *l1h, const struct iovec *iov, unsigned int num)
+{
+	ssize_t snd_len;
+	unsigned int i;
+
+	for (i = 0; i < num; i++) {
+		snd_len = send(l1h->trx_ofd_data.fd, iov[i].iov_base, iov[i].iov_len, 0);
+		if (OSMO_UNLIKELY(snd_len <= 0)) {
+			LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
+				"send() failed on TRXD with rc=%zd (%s)\n",
+				snd_len, strerror(errno));
+			return -2;
+		}
+	}
+
+	trx_data_ctr_add(l1h, BTSTRX_CTR_TRXD_TX_SYSCALLS, num);
+	trx_data_ctr_add(l1h, BTSTRX_CTR_TRXD_TX_DGRAMS, num);
+
+	return 0;
+}
+
+/*! Begin building the TRXD datagram(s) for a new TDMA frame
+ *  \param[inout] l1h TRX Layer1 handle referring to TX */
+void trx_if_tx_begin(struct trx_l1h *l1h)
+{
+	struct trx_data_tx_state *tx = &l1h->data_tx;
+
+	/* The PDU version and I/O mode must not change within a frame */
+	tx->pdu_ver = l1h->config.trxd_pdu_ver_use;
+	tx->batch_io = l1h->phy_inst->phy_link->u.osmotrx.trxd_batch_io;
+
+	tx->pdu_num = 0;
+	tx->dgram_num = 0;
+	tx->last_pdu = NULL;
+	tx->pos = &tx->buf[0];
+}
+
+/*! Append a burst to the TRXD datagram(s) being built
  *  \param[inout] l1h TRX Layer1 handle referring to TX
  *  \param[in] br Downlink burst request structure
  *  \returns 0 on success; negative on error */
-int trx_if_send_burst(struct trx_l1h *l1h, const struct trx_dl_burst_req *br)
+int trx_if_tx_append(struct trx_l1h *l1h, const struct trx_dl_burst_req *br)
 {
-	uint8_t pdu_ver = l1h->config.trxd_pdu_ver_use;
-	static uint8_t *buf = &trx_data_buf[0];
-	static uint8_t *last_pdu = NULL;
-	static unsigned int pdu_num = 0;
-	ssize_t snd_len, buf_len;
+	struct trx_data_tx_state *tx = &l1h->data_tx;
+	uint8_t *buf = tx->pos;
 
-	/* Make sure that the PHY is powered on */
-	if (OSMO_UNLIKELY(!trx_if_powered(l1h))) {
+	/* Make sure that the PDU (with the largest header) fits */
+	if (OSMO_UNLIKELY(tx->dgram_num >= ARRAY_SIZE(tx->iov) ||
+			  &tx->buf[sizeof(tx->buf)] - buf < TRX_DL_HDR_LEN_MAX + br->burst_len)) {
 		LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
-			"Ignoring Tx data, transceiver is powered off\n");
-		return -ENODEV;
-	}
-
-	/* Burst batching breaker */
-	if (br == NULL) {
-		if (pdu_num > 0)
-			goto sendall;
-		return -ENOMSG;
+			"Tx TRXD buffer is full, dropping burst (fn=%u, tn=%u)\n",
+			br->fn, br->tn);
+		return -ENOSPC;
 	}
 
 	/* Pointer to the last encoded PDU */
-	last_pdu = &buf[0];
+	tx->last_pdu = buf;
 
-	switch (pdu_ver) {
+	switch (tx->pdu_ver) {
 	/* Both versions have the same PDU format */
 	case 0: /* TRXDv0 */
 	case 1: /* TRXDv1 */
-		buf[0] = ((pdu_ver & 0x0f) << 4) | br->tn;
+		buf[0] = ((tx->pdu_ver & 0x0f) << 4) | br->tn;
 		osmo_store32be(br->fn, buf + 1);
 		buf[5] = br->att;
 		buf += 6;
@@ -1169,8 +1507,8 @@ int trx_if_send_burst(struct trx_l1h *l1h, const struct trx_dl_burst_req *br)
 		buf[4] = (uint8_t) br->scpir;
 		buf[5] = buf[6] = buf[7] = 0x00; /* Spare */
 		/* Some fields are not present in batched PDUs */
-		if (pdu_num == 0) {
-			buf[0] |= (pdu_ver & 0x0f) << 4;
+		if (tx->pdu_num == 0) {
+			buf[0] |= (tx->pdu_ver & 0x0f) << 4;
 			osmo_store32be(br->fn, buf + 8);
 			buf += 4;
 		}
@@ -1185,36 +1523,79 @@ int trx_if_send_burst(struct trx_l1h *l1h, const struct trx_dl_burst_req *br)
 	memcpy(buf, br->burst, br->burst_len);
 	buf += br->burst_len;
 
+	/* TRXDv0/v1: each PDU is a separate datagram */
+	if (tx->pdu_ver < 2)
+		tx->iov[tx->dgram_num++] = (struct iovec) { tx->last_pdu, buf - tx->last_pdu };
+
 	/* One more PDU in the buffer */
-	pdu_num++;
+	tx->pos = buf;
+	tx->pdu_num++;
+
+	/* TRXDv0/v1: send the datagrams once all iovecs are used */
+	if (tx->dgram_num == ARRAY_SIZE(tx->iov)) {
+		tx->pos = &tx->buf[0];
+		return trx_if_tx_send(l1h);
+	}
+
+	return 0;
+}
 
-	/* TRXDv2: wait for the batching breaker */
-	if (pdu_ver >= 2)
+/*! Finish building the TRXD datagram(s) for the current TDMA frame
+ *  \param[inout] l1h TRX Layer1 handle referring to TX
+ *  \returns number of datagrams ready to be sent */
+int trx_if_tx_finish(struct trx_l1h *l1h)
+{
+	struct trx_data_tx_state *tx = &l1h->data_tx;
+
+	if (tx->pdu_num == 0)
 		return 0;
 
-sendall:
+	/* TRXDv2: all PDUs are batched into a single datagram */
+	if (tx->pdu_ver >= 2) {
+		/* Unset BATCH.ind in the last PDU */
+		tx->last_pdu[1] &= ~(1 << 7);
+		tx->iov[0] = (struct iovec) { &tx->buf[0], tx->pos - &tx->buf[0] };
+		tx->dgram_num = 1;
+	}
+
 	LOGPPHI(l1h->phy_inst, DTRX, LOGL_DEBUG,
-		"Tx TRXDv%u datagram with %u PDU(s)\n",
-		pdu_ver, pdu_num);
+		"Tx TRXDv%u: %u PDU(s) in %u datagram(s)\n",
+		tx->pdu_ver, tx->pdu_num, tx->dgram_num);
+
+	return tx->dgram_num;
+}
+
+/*! Send the TRXD datagram(s) built by trx_if_tx_{begin,append,finish}()
+ *  \param[inout] l1h TRX Layer1 handle referring to TX
+ *  \returns 0 on success; negative on error */
+int trx_if_tx_send(struct trx_l1h *l1h)
+{
+	struct trx_data_tx_state *tx = &l1h->data_tx;
+	unsigned int num = tx->dgram_num;
 
-	/* TRXDv2: unset BATCH.ind in the last PDU */
-	if (pdu_ver >= 2)
-		last_pdu[1] &= ~(1 << 7);
+	if (num == 0)
+		return -ENOMSG;
 
-	buf_len = buf - &trx_data_buf[0];
-	buf = &trx_data_buf[0];
-	pdu_num = 0;
+	/* The datagrams are consumed, regardless of the outcome */
+	tx->dgram_num = 0;
+	tx->pdu_num = 0;
 
-	snd_len = send(l1h->trx_ofd_data.fd, trx_data_buf, buf_len, 0);
-	if (OSMO_UNLIKELY(snd_len <= 0)) {
-		strerror_r(errno, (char *) trx_data_buf, sizeof(trx_data_buf));
+	/* Make sure that the PHY is powered on */
+	if (OSMO_UNLIKELY(!trx_if_powered(l1h))) {
 		LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
-			"send() failed on TRXD with rc=%zd (%s)\n",
-			snd_len, trx_data_buf);
-		return -2;
+			"Ignoring Tx data, transceiver is powered off\n");
+		return -ENODEV;
 	}
 
-	return 0;
+	if (l1h->trxd_shm != NULL) {
+		/* Nobody would consume them before a transceiver attaches */
+		if (l1h->trxd_shm_peer_ofd.fd < 0)
+			return -ENOTCONN;
+		return trx_data_send_shm(l1h, &tx->iov[0], num);
+	}
+	if (tx->batch_io)
+		return trx_data_send_batch(l1h, &tx->iov[0], num);
+	return trx_data_send_each(l1h, &tx->iov[0], num);
 }
 
 
@@ -1227,24 +1608,179 @@ void trx_if_flush(struct trx_l1h *l1h)
 {
 	struct trx_ctrl_msg *tcm;
 
-	/* free ctrl message list */
+	/* free ctrl message list, there's no point in keeping the retrans timers armed */
 	while (!llist_empty(&l1h->trx_ctrl_list)) {
 		tcm = llist_entry(l1h->trx_ctrl_list.next, struct trx_ctrl_msg,
 			list);
+		osmo_timer_del(&tcm->timer);
 		llist_del(&tcm->list);
 		talloc_free(tcm);
 	}
-	talloc_free(l1h->last_acked);
-	l1h->last_acked = NULL;
+	l1h->trx_ctrl_in_flight = 0;
 
-	/* Tx queue is now empty, so there's no point in keeping the retrans timer armed: */
-	osmo_timer_del(&l1h->trx_ctrl_timer);
+	while (!llist_empty(&l1h->trx_ctrl_acked)) {
+		tcm = llist_entry(l1h->trx_ctrl_acked.next, struct trx_ctrl_msg,
+			list);
+		llist_del(&tcm->list);
+		talloc_free(tcm);
+	}
+	l1h->trx_ctrl_acked_num = 0;
 
 	/* If we are in read_cb, signal to the returning code path that we freed the list. */
 	if (l1h->in_trx_ctrl_read_cb)
 		l1h->flushed_while_in_trx_ctrl_read_cb = true;
 }
 
+/* the transceiver went away, another one may attach */
+static void trx_shm_peer_close(struct trx_l1h *l1h)
+{
+	if (l1h->trxd_shm_peer_ofd.fd < 0)
+		return;
+
+	osmo_fd_unregister(&l1h->trxd_shm_peer_ofd);
+	close(l1h->trxd_shm_peer_ofd.fd);
+	l1h->trxd_shm_peer_ofd.fd = -1;
+}
+
+/* the transceiver sends nothing on its connection, only closes it */
+static int trx_shm_peer_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct trx_l1h *l1h = ofd->data;
+	uint8_t buf[16];
+	int rc;
+
+	rc = recv(ofd->fd, buf, sizeof(buf), MSG_DONTWAIT);
+	if (rc > 0 || (rc < 0 && errno == EAGAIN))
+		return 0;
+
+	LOGPPHI(l1h->phy_inst, DTRX, LOGL_NOTICE,
+		"Transceiver detached from the TRXD shm rings\n");
+	trx_shm_peer_close(l1h);
+	return 0;
+}
+
+/* accept connection coming from the transceiver, hand over the TRXD rings */
+static int trx_shm_accept_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct trx_l1h *l1h = ofd->data;
+	struct sockaddr_un un_addr;
+	socklen_t len = sizeof(un_addr);
+	int fd, rc;
+
+	fd = accept(ofd->fd, (struct sockaddr *) &un_addr, &len);
+	if (fd < 0) {
+		LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
+			"Failed to accept a TRXD shm connection\n");
+		return -1;
+	}
+
+	/* The rings have a single producer and a single consumer */
+	if (l1h->trxd_shm_peer_ofd.fd >= 0) {
+		LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
+			"Rejecting a TRXD shm connection, a transceiver is attached already\n");
+		close(fd);
+		return 0;
+	}
+
+	/* A previous transceiver may have left records and positions behind */
+	shm_link_reset(l1h->trxd_shm);
+
+	rc = shm_link_send_fds(l1h->trxd_shm, fd);
+	if (rc < 0) {
+		LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
+			"Failed to hand over the TRXD shm rings (%s)\n", strerror(-rc));
+		close(fd);
+		return 0;
+	}
+
+	/* The connection is kept open until the transceiver goes away */
+	osmo_fd_setup(&l1h->trxd_shm_peer_ofd, fd, OSMO_FD_READ, trx_shm_peer_cb, l1h, 0);
+	if (osmo_fd_register(&l1h->trxd_shm_peer_ofd) != 0) {
+		LOGPPHI(l1h->phy_inst, DTRX, LOGL_ERROR,
+			"Failed to register the TRXD shm connection\n");
+		close(fd);
+		l1h->trxd_shm_peer_ofd.fd = -1;
+		return 0;
+	}
+
+	LOGPPHI(l1h->phy_inst, DTRX, LOGL_NOTICE,
+		"Transceiver attached to the TRXD shm rings\n");
+	return 0;
+}
+
+/*! close the TRXD shared memory rings and the handshake socket */
+static void trx_shm_close(struct trx_l1h *l1h)
+{
+	trx_shm_peer_close(l1h);
+
+	if (l1h->trxd_shm_srv_ofd.fd >= 0) {
+		osmo_fd_unregister(&l1h->trxd_shm_srv_ofd);
+		close(l1h->trxd_shm_srv_ofd.fd);
+		l1h->trxd_shm_srv_ofd.fd = -1;
+	}
+
+	/* The eventfd is owned (and closed) by the shm_link */
+	if (l1h->trxd_shm_ofd.fd >= 0) {
+		osmo_fd_unregister(&l1h->trxd_shm_ofd);
+		l1h->trxd_shm_ofd.fd = -1;
+	}
+
+	shm_link_free(l1h->trxd_shm);
+	l1h->trxd_shm = NULL;
+}
+
+/*! open the TRXD shared memory rings and the handshake socket */
+static int trx_shm_open(struct trx_l1h *l1h)
+{
+	struct phy_instance *pinst = l1h->phy_inst;
+	struct phy_link *plink = pinst->phy_link;
+	char name[64], path[108];
+	int rc;
+
+	snprintf(name, sizeof(name), "/osmo-bts-trxd.%d.%d", plink->num, pinst->num);
+	snprintf(path, sizeof(path), "%s.%d.%d", plink->u.osmotrx.trxd_shm_path,
+		 plink->num, pinst->num);
+
+	l1h->trxd_shm = shm_link_create(l1h, name, SHM_RING_DEF_SIZE);
+	if (l1h->trxd_shm == NULL) {
+		LOGPPHI(pinst, DTRX, LOGL_ERROR, "Could not create TRXD shm rings %s: %s\n",
+			name, strerror(errno));
+		return -EIO;
+	}
+
+	osmo_fd_setup(&l1h->trxd_shm_ofd, l1h->trxd_shm->efd_rx, OSMO_FD_READ,
+		      trx_data_shm_read_cb, l1h, 0);
+	rc = osmo_fd_register(&l1h->trxd_shm_ofd);
+	if (rc < 0) {
+		l1h->trxd_shm_ofd.fd = -1;
+		goto error;
+	}
+
+	rc = osmo_sock_unix_init(SOCK_SEQPACKET, 0, path, OSMO_SOCK_F_BIND);
+	if (rc < 0) {
+		LOGPPHI(pinst, DTRX, LOGL_ERROR, "Could not create %s unix socket: %s\n",
+			path, strerror(errno));
+		goto error;
+	}
+
+	osmo_fd_setup(&l1h->trxd_shm_srv_ofd, rc, OSMO_FD_READ, trx_shm_accept_cb, l1h, 0);
+	rc = osmo_fd_register(&l1h->trxd_shm_srv_ofd);
+	if (rc < 0) {
+		close(l1h->trxd_shm_srv_ofd.fd);
+		l1h->trxd_shm_srv_ofd.fd = -1;
+		goto error;
+	}
+
+	LOGPPHI(pinst, DTRX, LOGL_NOTICE, "Waiting for the transceiver to attach "
+		"to TRXD shm rings via %s\n", path);
+
+	return 0;
+
+error:
+	trx_shm_close(l1h);
+	return rc;
+}
+
 /*! close the TRX for given handle (data + control socket) */
 void trx_if_close(struct trx_l1h *l1h)
 {
@@ -1256,6 +1792,7 @@ void trx_if_close(struct trx_l1h *l1h)
 	/* close sockets */
 	trx_udp_close(&l1h->trx_ofd_ctrl);
 	trx_udp_close(&l1h->trx_ofd_data);
+	trx_shm_close(l1h);
 }
 
 /*! compute UDP port number used for TRX protocol */
@@ -1290,6 +1827,11 @@ static int trx_if_open(struct trx_l1h *l1h)
 			  compute_port(pinst, true, false), trx_ctrl_read_cb);
 	if (rc < 0)
 		return rc;
+
+	/* TRXD over shared memory rings */
+	if (plink->u.osmotrx.trxd_use_shm)
+		return trx_shm_open(l1h);
+
 	rc = trx_udp_open(l1h, &l1h->trx_ofd_data,
 			  plink->u.osmotrx.local_ip,
 			  compute_port(pinst, false, true),
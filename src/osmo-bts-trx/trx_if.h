@@ -1,13 +1,51 @@
 #pragma once
 
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+
+#include <osmocom/core/timer.h>
+
 /* TRXC read/send buffer size */
 #define TRXC_MSG_BUF_SIZE	1500
-/* TRXD read/send buffer size (max. lo MTU) */
-#define TRXD_MSG_BUF_SIZE	65536
+/* Maximum number of TRXD datagrams per recvmmsg()/sendmmsg() call */
+#define TRXD_MMSG_MAX		16
+/* TRXD per-datagram buffer size: the largest valid datagram is a TRXDv2
+ * batch of 16 PDUs (8 timeslots, each with a VAMOS shadow PDU) carrying
+ * 8-PSK soft-bits, 16 * (12 + 444) = 7296 bytes.  Anything larger is
+ * not TRXD, it is dropped and counted (trx_trxd:rx_oversize). */
+#define TRXD_MMSG_BUF_SIZE	8192
+/* Maximum number of TRXC commands in flight (see 'osmotrx trxc-window') */
+#define TRXC_WINDOW_MAX		16
+/* Default unix socket path prefix for the TRXD shared memory handshake */
+#define TRXD_SHM_DEF_PATH	"/tmp/osmo-bts-trxd"
 
 struct trx_dl_burst_req;
 struct trx_l1h;
 
+/* TRXD Tx state: PDUs of one TDMA frame being built for a PHY instance */
+struct trx_data_tx_state {
+	/* PDU version and I/O mode latched for the current frame */
+	uint8_t			pdu_ver;
+	bool			batch_io;
+	/* number of PDUs encoded / datagrams ready to be sent */
+	unsigned int		pdu_num;
+	unsigned int		dgram_num;
+	/* the last encoded PDU and the current write position in buf */
+	uint8_t			*last_pdu;
+	uint8_t			*pos;
+	struct iovec		iov[TRXD_MMSG_MAX];
+	uint8_t			buf[TRXD_MMSG_BUF_SIZE];
+};
+
+/* TRXD Rx state: datagram buffers of a PHY instance */
+struct trx_data_rx_state {
+	/* for recv() and the shm ring */
+	uint8_t			buf[TRXD_MMSG_BUF_SIZE];
+	/* TRXD_MMSG_MAX buffers for recvmmsg(), allocated on first use */
+	uint8_t			(*mmsg_buf)[TRXD_MMSG_BUF_SIZE];
+};
+
 struct trx_ctrl_msg {
 	struct llist_head	list;
 	char 			cmd[28];
@@ -16,6 +54,11 @@ struct trx_ctrl_msg {
 	int			params_len;
 	int			critical;
 	void 			*cb;
+	/* sent to the transceiver and waiting for the RSP */
+	bool			in_flight;
+	/* retransmission timer, armed while in flight */
+	struct osmo_timer_list	timer;
+	struct trx_l1h		*l1h;
 };
 
 typedef void trx_if_cmd_generic_cb(struct trx_l1h *l1h, int rc);
@@ -40,7 +83,10 @@ int trx_if_cmd_txtune(struct trx_l1h *l1h, uint16_t arfcn, trx_if_cmd_generic_cb
 int trx_if_cmd_handover(struct trx_l1h *l1h, uint8_t tn, uint8_t ss);
 int trx_if_cmd_nohandover(struct trx_l1h *l1h, uint8_t tn, uint8_t ss);
 int trx_if_cmd_rfmute(struct trx_l1h *l1h, bool mute);
-int trx_if_send_burst(struct trx_l1h *l1h, const struct trx_dl_burst_req *br);
+void trx_if_tx_begin(struct trx_l1h *l1h);
+int trx_if_tx_append(struct trx_l1h *l1h, const struct trx_dl_burst_req *br);
+int trx_if_tx_finish(struct trx_l1h *l1h);
+int trx_if_tx_send(struct trx_l1h *l1h);
 int trx_if_powered(struct trx_l1h *l1h);
 
 /* The latest supported TRXD PDU version */
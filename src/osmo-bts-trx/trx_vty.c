@@ -47,6 +47,7 @@
 #include "l1_if.h"
 #include "trx_if.h"
 #include "amr_loop.h"
+#include "sched_workers.h"
 
 #define X(x) (1 << x)
 
@@ -104,9 +105,9 @@ DEFUN(show_transceiver, show_transceiver_cmd, "show transceiver",
 			vty_out(vty, "  timeslot #%u (%s)%s",
 				tn, mf->name, VTY_NEWLINE);
 			vty_out(vty, "    pending DL prims    : %u%s",
-				llist_count(&l1ts->dl_prims), VTY_NEWLINE);
+				trx_sched_dl_prims_count(l1ts), VTY_NEWLINE);
 			vty_out(vty, "    interference        : %ddBm%s",
-				l1ts->chan_state[TRXC_IDLE].meas.interf_avg,
+				l1ts->chan_state[TRXC_IDLE].interf_avg,
 				VTY_NEWLINE);
 		}
 	}
@@ -587,6 +588,109 @@ DEFUN_USRATTR(cfg_phy_trxd_max_version, cfg_phy_trxd_max_version_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN_ATTR(cfg_phy_trxd_batch_io, cfg_phy_trxd_batch_io_cmd,
+	   "osmotrx trxd-batch-io",
+	   OSMOTRX_STR
+	   "Use batched I/O (recvmmsg()/sendmmsg()) on TRXD sockets\n",
+	   CMD_ATTR_IMMEDIATE)
+{
+	struct phy_link *plink = vty->index;
+
+	plink->u.osmotrx.trxd_batch_io = true;
+
+	return CMD_SUCCESS;
+}
+
+DEFUN_ATTR(cfg_phy_no_trxd_batch_io, cfg_phy_no_trxd_batch_io_cmd,
+	   "no osmotrx trxd-batch-io",
+	   NO_STR OSMOTRX_STR
+	   "Use one recv()/send() call per datagram on TRXD sockets (default)\n",
+	   CMD_ATTR_IMMEDIATE)
+{
+	struct phy_link *plink = vty->index;
+
+	plink->u.osmotrx.trxd_batch_io = false;
+
+	return CMD_SUCCESS;
+}
+
+DEFUN_ATTR(cfg_phy_trxc_window, cfg_phy_trxc_window_cmd,
+	   "osmotrx trxc-window <1-16>",
+	   OSMOTRX_STR
+	   "Maximum number of TRXC commands waiting for a response at a time\n"
+	   "Number of commands (default 1)\n",
+	   CMD_ATTR_IMMEDIATE)
+{
+	struct phy_link *plink = vty->index;
+
+	plink->u.osmotrx.trxc_window = atoi(argv[0]);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN_USRATTR(cfg_phy_trxd_transport, cfg_phy_trxd_transport_cmd,
+	      X(BTS_VTY_TRX_POWERCYCLE),
+	      "osmotrx trxd-transport (udp|shm)",
+	      OSMOTRX_STR
+	      "Set the transport used for TRXD (burst data)\n"
+	      "UDP datagrams (default)\n"
+	      "Shared memory rings (transceiver must run on the same host)\n")
+{
+	struct phy_link *plink = vty->index;
+
+	plink->u.osmotrx.trxd_use_shm = (strcmp(argv[0], "shm") == 0);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN_USRATTR(cfg_phy_trxd_shm_path, cfg_phy_trxd_shm_path_cmd,
+	      X(BTS_VTY_TRX_POWERCYCLE),
+	      "osmotrx trxd-shm-socket PATH",
+	      OSMOTRX_STR
+	      "Set the unix socket path prefix used for attaching to the TRXD shared memory rings\n"
+	      "Path prefix, suffixed with '.<phy>.<instance>'\n")
+{
+	struct phy_link *plink = vty->index;
+
+	osmo_talloc_replace_string(plink, &plink->u.osmotrx.trxd_shm_path, argv[0]);
+
+	return CMD_SUCCESS;
+}
+
+#define SCHED_WORKERS_STR \
+	"Generate the Downlink bursts of different TRX on multiple threads\n" \
+	"Number of worker threads in addition to the main thread (0: disabled)\n"
+
+static int set_sched_workers(struct vty *vty, unsigned int num, int cpu)
+{
+	struct gsm_bts *bts = vty->index;
+	struct bts_trx_priv *priv = (struct bts_trx_priv *) bts->model_priv;
+
+	/* The scheduler picks up the new values on the next TDMA frame */
+	priv->sched_workers_num = num;
+	priv->sched_workers_cpu = cpu;
+
+	return CMD_SUCCESS;
+}
+
+DEFUN_ATTR(cfg_bts_sched_workers, cfg_bts_sched_workers_cmd,
+	   "osmotrx sched-workers <0-" OSMO_STRINGIFY_VAL(SCHED_WORKERS_MAX) ">",
+	   OSMOTRX_STR SCHED_WORKERS_STR,
+	   CMD_ATTR_IMMEDIATE)
+{
+	return set_sched_workers(vty, atoi(argv[0]), -1);
+}
+
+DEFUN_ATTR(cfg_bts_sched_workers_pin, cfg_bts_sched_workers_pin_cmd,
+	   "osmotrx sched-workers <1-" OSMO_STRINGIFY_VAL(SCHED_WORKERS_MAX) "> pin-cpu <0-1023>",
+	   OSMOTRX_STR SCHED_WORKERS_STR
+	   "Pin the worker threads to consecutive CPUs\n"
+	   "CPU to pin the first worker thread to\n",
+	   CMD_ATTR_IMMEDIATE)
+{
+	return set_sched_workers(vty, atoi(argv[0]), atoi(argv[1]));
+}
+
 void bts_model_config_write_phy(struct vty *vty, const struct phy_link *plink)
 {
 	if (plink->u.osmotrx.local_ip)
@@ -613,6 +717,18 @@ void bts_model_config_write_phy(struct vty *vty, const struct phy_link *plink)
 
 	if (plink->u.osmotrx.trxd_pdu_ver_max != TRX_DATA_PDU_VER)
 		vty_out(vty, " osmotrx trxd-max-version %d%s", plink->u.osmotrx.trxd_pdu_ver_max, VTY_NEWLINE);
+
+	if (plink->u.osmotrx.trxd_batch_io)
+		vty_out(vty, " osmotrx trxd-batch-io%s", VTY_NEWLINE);
+
+	if (plink->u.osmotrx.trxc_window != 1)
+		vty_out(vty, " osmotrx trxc-window %u%s", plink->u.osmotrx.trxc_window, VTY_NEWLINE);
+
+	if (plink->u.osmotrx.trxd_use_shm)
+		vty_out(vty, " osmotrx trxd-transport shm%s", VTY_NEWLINE);
+	if (strcmp(plink->u.osmotrx.trxd_shm_path, TRXD_SHM_DEF_PATH) != 0)
+		vty_out(vty, " osmotrx trxd-shm-socket %s%s",
+			plink->u.osmotrx.trxd_shm_path, VTY_NEWLINE);
 }
 
 void bts_model_config_write_phy_inst(struct vty *vty, const struct phy_instance *pinst)
@@ -646,6 +762,15 @@ void bts_model_config_write_phy_inst(struct vty *vty, const struct phy_instance
 
 void bts_model_config_write_bts(struct vty *vty, const struct gsm_bts *bts)
 {
+	const struct bts_trx_priv *priv = (const struct bts_trx_priv *) bts->model_priv;
+
+	if (priv->sched_workers_num == 0)
+		return;
+
+	vty_out(vty, " osmotrx sched-workers %u", priv->sched_workers_num);
+	if (priv->sched_workers_cpu >= 0)
+		vty_out(vty, " pin-cpu %d", priv->sched_workers_cpu);
+	vty_out(vty, "%s", VTY_NEWLINE);
 }
 
 void bts_model_config_write_trx(struct vty *vty, const struct gsm_bts_trx *trx)
@@ -665,6 +790,9 @@ int bts_model_vty_init(void *ctx)
 
 	install_element(ENABLE_NODE, &test_send_trxc_cmd);
 
+	install_element(BTS_NODE, &cfg_bts_sched_workers_cmd);
+	install_element(BTS_NODE, &cfg_bts_sched_workers_pin_cmd);
+
 	install_element(TRX_NODE, &cfg_trx_nominal_power_cmd);
 	install_element(TRX_NODE, &cfg_trx_no_nominal_power_cmd);
 
@@ -680,6 +808,11 @@ int bts_model_vty_init(void *ctx)
 	install_element(PHY_NODE, &cfg_phy_setbsic_cmd);
 	install_element(PHY_NODE, &cfg_phy_no_setbsic_cmd);
 	install_element(PHY_NODE, &cfg_phy_trxd_max_version_cmd);
+	install_element(PHY_NODE, &cfg_phy_trxd_batch_io_cmd);
+	install_element(PHY_NODE, &cfg_phy_no_trxd_batch_io_cmd);
+	install_element(PHY_NODE, &cfg_phy_trxc_window_cmd);
+	install_element(PHY_NODE, &cfg_phy_trxd_transport_cmd);
+	install_element(PHY_NODE, &cfg_phy_trxd_shm_path_cmd);
 
 	install_element(PHY_INST_NODE, &cfg_phyinst_rxgain_cmd);
 	install_element(PHY_INST_NODE, &cfg_phyinst_tx_atten_cmd);
@@ -449,6 +449,11 @@ int rx_tchh_fn(struct l1sched_ts *l1ts, const struct trx_ul_burst_ind *bi)
 	return 0;
 }
 
+size_t rx_bursts_size(enum trx_chan_type chan)
+{
+	return 24 * GSM_NBITS_NB_GMSK_PAYLOAD;
+}
+
 void _sched_act_rach_det(struct gsm_bts_trx *trx, uint8_t tn, uint8_t ss, int activate)
 {
 }
@@ -20,14 +20,25 @@
 #include <osmo-bts/bts.h>
 #include <osmo-bts/bts_sm.h>
 #include <osmo-bts/logging.h>
+#include <osmo-bts/l1sap.h>
 #include <osmo-bts/paging.h>
 #include <osmo-bts/gsm_data.h>
+#include <osmo-bts/a5_ks.h>
+#include <osmo-bts/scheduler.h>
+#include <osmo-bts/scheduler_backend.h>
 
 #include <osmocom/core/talloc.h>
 #include <osmocom/core/application.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/gsm/a5.h>
+#include <osmocom/gsm/protocol/gsm_08_58.h>
 
 #include <errno.h>
+#include <inttypes.h>
 #include <unistd.h>
+#include <time.h>
+#include <stdlib.h>
+#include <string.h>
 
 static struct gsm_bts *bts;
 
@@ -65,6 +76,208 @@ static void test_cipher_parsing(void)
 	ASSERT_TRUE(bts_supports_cipher(bts, 0x9) == -ENOTSUP);
 }
 
+/* Number of TDMA frames for the keystream tests (a multiple of 104) */
+#define KS_FRAMES	(104 * 40)
+/* Uplink bursts arrive a few frames after the Downlink bursts of the same
+ * frame have been scheduled (clock-advance plus the transceiver delay) */
+#define KS_UL_DELAY	3
+
+static const uint8_t ks_key[16] = {
+	0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+	0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+};
+
+static const uint8_t ks_ul_key[16] = {
+	0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+	0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+};
+
+/* Normally provided by the PHY specific part of the scheduler */
+void _sched_act_rach_det(struct gsm_bts_trx *trx, uint8_t tn, uint8_t ss, int activate)
+{
+}
+
+/* Generate the keystream per burst and cipher bit by bit,
+ * the way the scheduler used to do it */
+static void ks_ref_dl(int algo, const uint8_t *key, uint32_t fn, ubit_t *burst)
+{
+	ubit_t ks[114];
+	int i;
+
+	osmo_a5(algo, key, fn, ks, NULL);
+	for (i = 0; i < 57; i++) {
+		burst[i +  3] ^= ks[i];
+		burst[i + 88] ^= ks[i + 57];
+	}
+}
+
+static void ks_ref_ul(int algo, const uint8_t *key, uint32_t fn, sbit_t *burst)
+{
+	ubit_t ks[114];
+	int i;
+
+	osmo_a5(algo, key, fn, NULL, ks);
+	for (i = 0; i < 57; i++) {
+		if (ks[i])
+			burst[i + 3] = - burst[i + 3];
+		if (ks[i + 57])
+			burst[i + 88] = - burst[i + 88];
+	}
+}
+
+static void ks_random_bursts(ubit_t *dl_burst, sbit_t *ul_burst)
+{
+	unsigned int i;
+
+	for (i = 0; i < 148; i++) {
+		dl_burst[i] = rand() & 1;
+		ul_burst[i] = (rand() % 255) - 127;
+	}
+}
+
+/* Activate the TCH/F on TS1 of C0, ciphered with the given algorithm and
+ * ks_key, and with ks_ul_key in Uplink if requested */
+static struct l1sched_ts *ks_chan_act(int algo, bool other_ul_key)
+{
+	struct gsm_bts_trx_ts *ts = &bts->c0->ts[1];
+	struct gsm_lchan *lchan = &ts->lchan[0];
+	const uint8_t chan_nr = RSL_CHAN_Bm_ACCHs | ts->nr;
+
+	lchan->encr.alg_id = algo + 1;
+	lchan->encr.key_len = algo == 4 ? 16 : 8;
+	memcpy(lchan->encr.key, ks_key, lchan->encr.key_len);
+
+	ASSERT_TRUE(trx_sched_set_lchan(lchan, chan_nr, LID_DEDIC, true) == 0);
+	ASSERT_TRUE(trx_sched_set_cipher(lchan, chan_nr, true) == 0);
+	if (other_ul_key)
+		memcpy(lchan->encr.key, ks_ul_key, lchan->encr.key_len);
+	ASSERT_TRUE(trx_sched_set_cipher(lchan, chan_nr, false) == 0);
+
+	return ts->priv;
+}
+
+static void ks_chan_rel(struct l1sched_ts *l1ts)
+{
+	struct gsm_bts_trx_ts *ts = l1ts->ts;
+
+	ASSERT_TRUE(trx_sched_set_lchan(&ts->lchan[0], RSL_CHAN_Bm_ACCHs | ts->nr,
+					LID_DEDIC, false) == 0);
+}
+
+static bool ks_tchf_frame(const struct l1sched_ts *l1ts, uint32_t fn)
+{
+	const struct trx_sched_frame *frame = &l1ts->mf_frames[fn % l1ts->mf_period];
+
+	/* (Downlink and Uplink of a TCH/F are in the same frames) */
+	return frame->dl_chan == TRXC_TCHF && frame->ul_chan == TRXC_TCHF;
+}
+
+static uint64_t ks_ctr(const struct l1sched_ts *l1ts, unsigned int idx)
+{
+	return rate_ctr_group_get_ctr(l1ts->ctrs, idx)->current;
+}
+
+/* (Un)cipher the bursts of a TCH/F using the keystreams the scheduler looks
+ * up, in the order of the scheduler: Downlink ahead of the Uplink */
+static void test_sched_a5_ks(int algo, bool other_ul_key)
+{
+	struct l1sched_ts *l1ts = ks_chan_act(algo, other_ul_key);
+	struct l1sched_chan_state *l1cs = &l1ts->chan_state[TRXC_TCHF];
+	const uint8_t *ul_key = other_ul_key ? ks_ul_key : ks_key;
+	const uint64_t hits = ks_ctr(l1ts, L1SCHED_TS_CTR_A5_KS_HIT);
+	const uint64_t misses = ks_ctr(l1ts, L1SCHED_TS_CTR_A5_KS_MISS);
+	ubit_t dl_ref[148], dl_burst[148], buf[A5_KS_BURST_BITS];
+	sbit_t ul_ref[148], ul_burst[148];
+	unsigned int dl_bursts = 0, ul_bursts = 0;
+	const ubit_t *ks;
+	uint32_t fn;
+
+	ASSERT_TRUE(l1cs->act->a5_cache != NULL);
+
+	for (fn = 0; fn < KS_FRAMES + KS_UL_DELAY; fn++) {
+		if (fn < KS_FRAMES && ks_tchf_frame(l1ts, fn)) {
+			ks_random_bursts(dl_ref, ul_ref);
+			memcpy(dl_burst, dl_ref, sizeof(dl_burst));
+
+			ks_ref_dl(algo, ks_key, fn, dl_ref);
+			ks = _sched_a5_ks(l1ts, l1cs, TRXC_TCHF, A5_KS_DL, fn, buf);
+			a5_ks_encrypt_burst(dl_burst, ks);
+
+			ASSERT_TRUE(memcmp(dl_ref, dl_burst, sizeof(dl_ref)) == 0);
+			dl_bursts++;
+		}
+
+		if (fn >= KS_UL_DELAY && ks_tchf_frame(l1ts, fn - KS_UL_DELAY)) {
+			ks_random_bursts(dl_ref, ul_ref);
+			memcpy(ul_burst, ul_ref, sizeof(ul_burst));
+
+			ks_ref_ul(algo, ul_key, fn - KS_UL_DELAY, ul_ref);
+			ks = _sched_a5_ks(l1ts, l1cs, TRXC_TCHF, A5_KS_UL, fn - KS_UL_DELAY, buf);
+			a5_ks_decrypt_burst(ul_burst, ks);
+
+			ASSERT_TRUE(memcmp(ul_ref, ul_burst, sizeof(ul_ref)) == 0);
+			ul_bursts++;
+		}
+	}
+
+	printf("A5/%d, %s Uplink key: %u DL and %u UL bursts (un)ciphered like before, "
+	       "using %u instead of %u osmo_a5() calls (%" PRIu64 " hits, %" PRIu64 " misses)\n",
+	       algo, other_ul_key ? "other" : "same", dl_bursts, ul_bursts,
+	       l1cs->act->a5_cache->a5_calls, dl_bursts + ul_bursts,
+	       ks_ctr(l1ts, L1SCHED_TS_CTR_A5_KS_HIT) - hits,
+	       ks_ctr(l1ts, L1SCHED_TS_CTR_A5_KS_MISS) - misses);
+
+	ks_chan_rel(l1ts);
+}
+
+static double elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+/* Per-burst cost of the ciphering, printed to stderr (timing dependent) */
+static void bench_sched_a5_ks(int algo)
+{
+	struct l1sched_ts *l1ts = ks_chan_act(algo, false);
+	struct l1sched_chan_state *l1cs = &l1ts->chan_state[TRXC_TCHF];
+	ubit_t dl_burst[148], buf[A5_KS_BURST_BITS];
+	sbit_t ul_burst[148];
+	struct timespec start, end;
+	double ref_ns, cache_ns;
+	unsigned int bursts = 0;
+	uint32_t fn;
+
+	ks_random_bursts(dl_burst, ul_burst);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (fn = 0; fn < KS_FRAMES; fn++) {
+		if (!ks_tchf_frame(l1ts, fn))
+			continue;
+		ks_ref_dl(algo, ks_key, fn, dl_burst);
+		ks_ref_ul(algo, ks_key, fn, ul_burst);
+		bursts++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ref_ns = elapsed_ns(&start, &end) / bursts;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (fn = 0; fn < KS_FRAMES; fn++) {
+		if (!ks_tchf_frame(l1ts, fn))
+			continue;
+		a5_ks_encrypt_burst(dl_burst, _sched_a5_ks(l1ts, l1cs, TRXC_TCHF,
+							   A5_KS_DL, fn, buf));
+		a5_ks_decrypt_burst(ul_burst, _sched_a5_ks(l1ts, l1cs, TRXC_TCHF,
+							   A5_KS_UL, fn, buf));
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	cache_ns = elapsed_ns(&start, &end) / bursts;
+
+	fprintf(stderr, "A5/%d: DL+UL burst %7.1f ns (per burst), %7.1f ns (cached)\n",
+		algo, ref_ns, cache_ns);
+
+	ks_chan_rel(l1ts);
+}
+
 int main(int argc, char **argv)
 {
 	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
@@ -80,6 +293,25 @@ int main(int argc, char **argv)
 	}
 
 	test_cipher_parsing();
+
+	/* TCH/F on TS1 of C0 for the keystream tests */
+	trx_sched_init(bts->c0);
+	bts->c0->ts[1].pchan = GSM_PCHAN_TCH_F;
+	bts->c0->ts[1].lchan[0].type = GSM_LCHAN_TCH_F;
+	ASSERT_TRUE(trx_sched_set_pchan(&bts->c0->ts[1], GSM_PCHAN_TCH_F) == 0);
+
+	srand(0x5a5a);
+	test_sched_a5_ks(1, false);
+	test_sched_a5_ks(1, true);
+	test_sched_a5_ks(3, false);
+	test_sched_a5_ks(3, true);
+	test_sched_a5_ks(4, false);
+	test_sched_a5_ks(4, true);
+
+	bench_sched_a5_ks(1);
+	bench_sched_a5_ks(3);
+	bench_sched_a5_ks(4);
+
 	printf("Success\n");
 
 	return 0;
@@ -0,0 +1,271 @@
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/gsm/gsm0502.h>
+#include <osmocom/gsm/gsm_utils.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/bts_sm.h>
+#include <osmo-bts/bts_trx.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/fh_route.h>
+
+#define ASSERT_TRUE(rc) \
+	if (!(rc)) { \
+		printf("Assert failed in %s:%d.\n",  \
+		       __FILE__, __LINE__);          \
+		abort();			     \
+	}
+
+/* Step over the TDMA frame numbers (prime, so all T1/T2/T3 combinations are hit) */
+#define FN_STEP		97
+/* Number of bursts per TRX count for the benchmark */
+#define BENCH_BURSTS	200000
+
+static struct gsm_bts *bts;
+
+/* The former (linear) Downlink lookup, used as the reference */
+static const struct gsm_bts_trx *ref_route_dl(const struct gsm_bts_trx_ts *ts, uint32_t fn)
+{
+	const struct gsm_bts_trx *trx;
+	struct gsm_time time;
+	uint16_t idx;
+
+	gsm_fn2gsmtime(&time, fn);
+	idx = gsm0502_hop_seq_gen(&time, ts->hopping.hsn, ts->hopping.maio,
+				  ts->hopping.arfcn_num, NULL);
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		if (trx->arfcn == ts->hopping.arfcn_list[idx])
+			return trx;
+	}
+
+	return NULL;
+}
+
+/* The former (linear) Uplink lookup, used as the reference */
+static const struct gsm_bts_trx *ref_route_ul(const struct gsm_bts_trx *src_trx,
+					      uint8_t tn, uint32_t fn)
+{
+	const struct gsm_bts_trx *trx;
+	struct gsm_time time;
+	uint16_t arfcn;
+
+	gsm_fn2gsmtime(&time, fn);
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		const struct gsm_bts_trx_ts *ts = &trx->ts[tn];
+		if (!ts->hopping.enabled)
+			continue;
+
+		arfcn = gsm0502_hop_seq_gen(&time, ts->hopping.hsn, ts->hopping.maio,
+					    ts->hopping.arfcn_num, ts->hopping.arfcn_list);
+		if (src_trx->arfcn == arfcn)
+			return trx;
+	}
+
+	return NULL;
+}
+
+/* Allocate TRXs as needed and configure hopping on TS1..7 of all of them */
+static void setup_hopping(unsigned int num_trx)
+{
+	struct gsm_bts_trx *trx;
+	unsigned int tn, i;
+
+	while (bts->num_trx < num_trx)
+		gsm_bts_trx_alloc(bts);
+
+	llist_for_each_entry(trx, &bts->trx_list, list)
+		trx->arfcn = 10 + 5 * trx->nr;
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		for (tn = 1; tn < TRX_NR_TS; tn++) {
+			struct gsm_bts_trx_ts *ts = &trx->ts[tn];
+			const struct gsm_bts_trx *t;
+
+			ts->hopping.enabled = true;
+			/* TS7 uses the cyclic sequence */
+			ts->hopping.hsn = (tn == 7) ? 0 : tn * 9;
+			ts->hopping.maio = trx->nr;
+
+			i = 0;
+			llist_for_each_entry(t, &bts->trx_list, list)
+				ts->hopping.arfcn_list[i++] = t->arfcn;
+			ts->hopping.arfcn_num = i;
+		}
+	}
+}
+
+static void test_route(struct fh_route *fr)
+{
+	const struct gsm_bts_trx *trx, *src;
+	unsigned int num_dl = 0, num_ul = 0;
+	unsigned int tn;
+	uint32_t fn;
+
+	for (fn = 0; fn < 2 * FH_SEQ_PERIOD; fn += FN_STEP) {
+		llist_for_each_entry(trx, &bts->trx_list, list) {
+			for (tn = 1; tn < TRX_NR_TS; tn++) {
+				ASSERT_TRUE(fh_route_dl(fr, &trx->ts[tn], fn) == ref_route_dl(&trx->ts[tn], fn));
+				num_dl++;
+			}
+		}
+
+		llist_for_each_entry(src, &bts->trx_list, list) {
+			for (tn = 1; tn < TRX_NR_TS; tn++) {
+				ASSERT_TRUE(fh_route_ul(fr, src, tn, fn) == ref_route_ul(src, tn, fn));
+				num_ul++;
+			}
+		}
+
+		/* TS0 is not hopping */
+		ASSERT_TRUE(fh_route_dl(fr, &bts->c0->ts[0], fn) == NULL);
+		ASSERT_TRUE(fh_route_ul(fr, bts->c0, 0, fn) == NULL);
+	}
+
+	printf("%s(): %2u TRX: %u DL and %u UL bursts routed like the reference\n",
+	       __func__, bts->num_trx, num_dl, num_ul);
+}
+
+/* The tables shall only be rebuilt if the hopping configuration changed */
+static void test_changed(struct fh_route *fr)
+{
+	struct gsm_bts_trx_ts *ts = &bts->c0->ts[1];
+	unsigned int rebuilds = fr->rebuilds;
+	uint16_t arfcn;
+
+	ASSERT_TRUE(!fh_route_changed(fr, bts));
+
+	/* ARFCN of a TRX */
+	arfcn = bts->c0->arfcn;
+	bts->c0->arfcn = 1023;
+	ASSERT_TRUE(fh_route_changed(fr, bts));
+	bts->c0->arfcn = arfcn;
+	ASSERT_TRUE(!fh_route_changed(fr, bts));
+
+	/* MAIO and MA of a timeslot */
+	ts->hopping.maio++;
+	ASSERT_TRUE(fh_route_changed(fr, bts));
+	ts->hopping.maio--;
+	ts->hopping.arfcn_list[0]++;
+	ASSERT_TRUE(fh_route_changed(fr, bts));
+	ts->hopping.arfcn_list[0]--;
+
+	/* ARFCNs beyond the MA length do not matter */
+	ts->hopping.arfcn_list[ts->hopping.arfcn_num]++;
+	ASSERT_TRUE(!fh_route_changed(fr, bts));
+	ts->hopping.arfcn_list[ts->hopping.arfcn_num]--;
+
+	/* Hopping disabled on a timeslot */
+	ts->hopping.enabled = false;
+	ASSERT_TRUE(fh_route_changed(fr, bts));
+	ASSERT_TRUE(fh_route_rebuild(fr, bts) == 0);
+	ASSERT_TRUE(!fh_route_changed(fr, bts));
+	ts->hopping.enabled = true;
+	ASSERT_TRUE(fh_route_rebuild(fr, bts) == 0);
+
+	printf("%s(): tables rebuilt %u times\n", __func__, fr->rebuilds - rebuilds);
+}
+
+static double elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+/* Per-burst cost of the Uplink routing, printed to stderr (timing dependent) */
+static void bench_route_ul(struct fh_route *fr)
+{
+	const struct gsm_bts_trx *trx_list[bts->num_trx];
+	const struct gsm_bts_trx *src, *trx;
+	struct timespec start, end;
+	unsigned int i, hits = 0;
+	double ref_ns, tbl_ns;
+
+	llist_for_each_entry(trx, &bts->trx_list, list)
+		trx_list[trx->nr] = trx;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < BENCH_BURSTS; i++) {
+		src = trx_list[i % bts->num_trx];
+		trx = ref_route_ul(src, 1 + i % 7, (i * FN_STEP) % GSM_TDMA_HYPERFRAME);
+		hits += (trx != NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ref_ns = elapsed_ns(&start, &end) / BENCH_BURSTS;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < BENCH_BURSTS; i++) {
+		src = trx_list[i % bts->num_trx];
+		trx = fh_route_ul(fr, src, 1 + i % 7, (i * FN_STEP) % GSM_TDMA_HYPERFRAME);
+		hits -= (trx != NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	tbl_ns = elapsed_ns(&start, &end) / BENCH_BURSTS;
+
+	ASSERT_TRUE(hits == 0);
+
+	fprintf(stderr, "%2u TRX: UL routing %7.1f ns/burst (reference), "
+		"%5.1f ns/burst (tables)\n", bts->num_trx, ref_ns, tbl_ns);
+}
+
+int main(int argc, char **argv)
+{
+	static const unsigned int num_trx[] = { 1, 2, 4, 8, 16 };
+	struct fh_route *fr;
+	unsigned int i;
+
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+
+	g_bts_sm = gsm_bts_sm_alloc(tall_bts_ctx);
+	bts = gsm_bts_alloc(g_bts_sm, 0);
+	if (bts_init(bts) < 0) {
+		fprintf(stderr, "unable to open bts\n");
+		exit(1);
+	}
+
+	fr = fh_route_alloc(tall_bts_ctx);
+	ASSERT_TRUE(fr != NULL);
+
+	for (i = 0; i < ARRAY_SIZE(num_trx); i++) {
+		setup_hopping(num_trx[i]);
+
+		ASSERT_TRUE(fh_route_changed(fr, bts));
+		ASSERT_TRUE(fh_route_rebuild(fr, bts) == 0);
+		test_route(fr);
+		bench_route_ul(fr);
+	}
+
+	test_changed(fr);
+
+	printf("Routing tables rebuilt %u times\n", fr->rebuilds);
+	printf("Success\n");
+
+	return 0;
+}
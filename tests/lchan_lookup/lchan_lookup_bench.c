@@ -0,0 +1,210 @@
+/* Benchmark of the chan_nr to lchan lookups.
+ *
+ * Every PH-RTS.ind, PH-DATA.ind and TCH.ind on L1SAP resolves its chan_nr
+ * with get_lchan_by_chan_nr(), and every RSL message with
+ * rsl_lchan_lookup().  This program measures the lookups per second of
+ * both, with the lookup tables of the TRX (see
+ * gsm_bts_trx_chan_nr_map_update()) and with the decoders they replace,
+ * on a TRX with a mix of timeslot configurations and a pseudo-random
+ * sequence of chan_nr.  This is not part of the testsuite, run it
+ * manually:
+ *
+ *   ./lchan_lookup_bench --num 100000000
+ */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/bts_sm.h>
+#include <osmo-bts/bts_trx.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/l1sap.h>
+#include <osmo-bts/gsm_data.h>
+
+#include "lchan_lookup_ref.h"
+
+/* Number of chan_nr in the pseudo-random sequence */
+#define BENCH_SEQ_LEN	4096
+
+static const enum gsm_phys_chan_config bench_pchan[8] = {
+	GSM_PCHAN_CCCH_SDCCH4,
+	GSM_PCHAN_SDCCH8_SACCH8C,
+	GSM_PCHAN_TCH_F,
+	GSM_PCHAN_TCH_F,
+	GSM_PCHAN_TCH_H,
+	GSM_PCHAN_TCH_H,
+	GSM_PCHAN_OSMO_DYN,
+	GSM_PCHAN_PDCH,
+};
+
+static unsigned int num_lookups = 100000000;
+static uint8_t seq[BENCH_SEQ_LEN];
+
+/* Deterministic pseudo-random numbers, so that the results are reproducible */
+static uint32_t rand_state = 0x2342;
+
+static uint32_t bench_rand(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return rand_state >> 8;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void print_help(void)
+{
+	printf("Usage: lchan_lookup_bench [options]\n"
+	       "  -n --num N         Lookups per measurement (default %u)\n",
+	       num_lookups);
+}
+
+static void handle_options(int argc, char **argv)
+{
+	while (1) {
+		int option_index = 0, c;
+		static const struct option long_options[] = {
+			{ "help", 0, 0, 'h' },
+			{ "num", 1, 0, 'n' },
+			{ 0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "hn:", long_options, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			print_help();
+			exit(0);
+		case 'n':
+			num_lookups = atoi(optarg);
+			break;
+		default:
+			print_help();
+			exit(1);
+		}
+	}
+
+	if (num_lookups < BENCH_SEQ_LEN) {
+		print_help();
+		exit(1);
+	}
+}
+
+/* The chan_nr of an lchan on the given timeslot, as L1 or the BSC would send it */
+static uint8_t bench_chan_nr(unsigned int tn)
+{
+	switch (bench_pchan[tn]) {
+	case GSM_PCHAN_CCCH_SDCCH4:
+		if (bench_rand() % 2)
+			return RSL_CHAN_PCH_AGCH | tn;
+		return RSL_CHAN_SDCCH4_ACCH | ((bench_rand() % 4) << 3) | tn;
+	case GSM_PCHAN_SDCCH8_SACCH8C:
+		return RSL_CHAN_SDCCH8_ACCH | ((bench_rand() % 8) << 3) | tn;
+	case GSM_PCHAN_TCH_H:
+		return RSL_CHAN_Lm_ACCHs | ((bench_rand() % 2) << 3) | tn;
+	case GSM_PCHAN_OSMO_DYN:
+		return RSL_CHAN_OSMO_PDCH | tn;
+	default:
+		return RSL_CHAN_Bm_ACCHs | tn;
+	}
+}
+
+static void report(const char *name, unsigned int num, uint64_t ns, uintptr_t sum)
+{
+	printf("%-32s: %6.2f ns/lookup, %6.1f M lookups/s (%lx)\n", name,
+	       (double) ns / num, ns ? (double) num * 1000 / ns : 0.0,
+	       (unsigned long) (sum & 0xff));
+}
+
+int main(int argc, char **argv)
+{
+	struct gsm_bts_trx *trx;
+	struct gsm_bts *bts;
+	uintptr_t sum;
+	uint64_t start;
+	unsigned int i;
+	int rc;
+
+	handle_options(argc, argv);
+
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+
+	g_bts_sm = gsm_bts_sm_alloc(tall_bts_ctx);
+	if (!g_bts_sm) {
+		fprintf(stderr, "Failed to create BTS Site Manager structure\n");
+		exit(1);
+	}
+	bts = gsm_bts_alloc(g_bts_sm, 0);
+	if (bts_init(bts) < 0) {
+		fprintf(stderr, "unable to open bts\n");
+		exit(1);
+	}
+
+	trx = bts->c0;
+	for (i = 0; i < ARRAY_SIZE(trx->ts); i++)
+		trx->ts[i].pchan = bench_pchan[i];
+	for (i = 0; i < ARRAY_SIZE(seq); i++)
+		seq[i] = bench_chan_nr(bench_rand() % ARRAY_SIZE(trx->ts));
+
+	printf("%u lookups of %u different chan_nr\n", num_lookups, (unsigned int) ARRAY_SIZE(seq));
+
+	/* The sums of the pointers keep the compiler from dropping the lookups */
+	start = now_ns();
+	for (i = 0, sum = 0; i < num_lookups; i++)
+		sum += (uintptr_t) get_lchan_by_chan_nr(trx, seq[i % BENCH_SEQ_LEN]);
+	report("get_lchan_by_chan_nr() (table)", num_lookups, now_ns() - start, sum);
+
+	start = now_ns();
+	for (i = 0, sum = 0; i < num_lookups; i++)
+		sum += (uintptr_t) ref_get_lchan_by_chan_nr(trx, seq[i % BENCH_SEQ_LEN]);
+	report("get_lchan_by_chan_nr() (decoder)", num_lookups, now_ns() - start, sum);
+
+	start = now_ns();
+	for (i = 0, sum = 0; i < num_lookups; i++)
+		sum += (uintptr_t) rsl_lchan_lookup(trx, seq[i % BENCH_SEQ_LEN], &rc) + rc;
+	report("rsl_lchan_lookup() (table)", num_lookups, now_ns() - start, sum);
+
+	start = now_ns();
+	for (i = 0, sum = 0; i < num_lookups; i++)
+		sum += (uintptr_t) ref_rsl_lchan_lookup(trx, seq[i % BENCH_SEQ_LEN], &rc) + rc;
+	report("rsl_lchan_lookup() (decoder)", num_lookups, now_ns() - start, sum);
+
+	return 0;
+}
@@ -0,0 +1,126 @@
+/* The chan_nr decoders as they were before the lookup tables (see
+ * gsm_bts_trx_chan_nr_map_update()), for comparison */
+
+#pragma once
+
+#include <errno.h>
+#include <stdbool.h>
+
+#include <osmocom/gsm/protocol/gsm_08_58.h>
+
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/bts_trx.h>
+#include <osmo-bts/l1sap.h>
+
+/* rsl_lchan_lookup() */
+static struct gsm_lchan *ref_rsl_lchan_lookup(struct gsm_bts_trx *trx, uint8_t chan_nr,
+					      int *rc)
+{
+	uint8_t ts_nr = chan_nr & 0x07;
+	uint8_t cbits = chan_nr >> 3;
+	uint8_t lch_idx;
+	struct gsm_bts_trx_ts *ts = &trx->ts[ts_nr];
+	bool ok = true;
+
+	if (rc)
+		*rc = -EINVAL;
+
+	switch (cbits) {
+	case ABIS_RSL_CHAN_NR_CBITS_OSMO_VAMOS_Bm_ACCHs:
+		if (ts->vamos.peer == NULL)
+			return NULL;
+		ts = ts->vamos.peer;
+		/* fall-through */
+	case ABIS_RSL_CHAN_NR_CBITS_Bm_ACCHs:
+		lch_idx = 0;	/* TCH/F */
+		if (ts->pchan != GSM_PCHAN_TCH_F &&
+		    ts->pchan != GSM_PCHAN_PDCH &&
+		    ts->pchan != GSM_PCHAN_TCH_F_PDCH &&
+		    ts->pchan != GSM_PCHAN_OSMO_DYN)
+			ok = false;
+		break;
+	case ABIS_RSL_CHAN_NR_CBITS_OSMO_VAMOS_Lm_ACCHs(0):
+	case ABIS_RSL_CHAN_NR_CBITS_OSMO_VAMOS_Lm_ACCHs(1):
+		if (ts->vamos.peer == NULL)
+			return NULL;
+		ts = ts->vamos.peer;
+		/* fall-through */
+	case ABIS_RSL_CHAN_NR_CBITS_Lm_ACCHs(0):
+	case ABIS_RSL_CHAN_NR_CBITS_Lm_ACCHs(1):
+		lch_idx = cbits & 0x1;	/* TCH/H */
+		if (ts->pchan != GSM_PCHAN_TCH_H &&
+		    ts->pchan != GSM_PCHAN_OSMO_DYN)
+			ok = false;
+		break;
+	case ABIS_RSL_CHAN_NR_CBITS_SDCCH4_ACCH(0):
+	case ABIS_RSL_CHAN_NR_CBITS_SDCCH4_ACCH(1):
+	case ABIS_RSL_CHAN_NR_CBITS_SDCCH4_ACCH(2):
+	case ABIS_RSL_CHAN_NR_CBITS_SDCCH4_ACCH(3):
+		lch_idx = cbits & 0x3;	/* SDCCH/4 */
+		if (ts->pchan != GSM_PCHAN_CCCH_SDCCH4 &&
+		    ts->pchan != GSM_PCHAN_CCCH_SDCCH4_CBCH)
+			ok = false;
+		break;
+	case ABIS_RSL_CHAN_NR_CBITS_SDCCH8_ACCH(0):
+	case ABIS_RSL_CHAN_NR_CBITS_SDCCH8_ACCH(1):
+	case ABIS_RSL_CHAN_NR_CBITS_SDCCH8_ACCH(2):
+	case ABIS_RSL_CHAN_NR_CBITS_SDCCH8_ACCH(3):
+	case ABIS_RSL_CHAN_NR_CBITS_SDCCH8_ACCH(4):
+	case ABIS_RSL_CHAN_NR_CBITS_SDCCH8_ACCH(5):
+	case ABIS_RSL_CHAN_NR_CBITS_SDCCH8_ACCH(6):
+	case ABIS_RSL_CHAN_NR_CBITS_SDCCH8_ACCH(7):
+		lch_idx = cbits & 0x7;	/* SDCCH/8 */
+		if (ts->pchan != GSM_PCHAN_SDCCH8_SACCH8C &&
+		    ts->pchan != GSM_PCHAN_SDCCH8_SACCH8C_CBCH &&
+		    ts->pchan != GSM_PCHAN_OSMO_DYN)
+			ok = false;
+		break;
+	case ABIS_RSL_CHAN_NR_CBITS_BCCH:
+	case ABIS_RSL_CHAN_NR_CBITS_RACH:
+	case ABIS_RSL_CHAN_NR_CBITS_PCH_AGCH:
+		lch_idx = 0;
+		if (ts->pchan != GSM_PCHAN_CCCH &&
+		    ts->pchan != GSM_PCHAN_CCCH_SDCCH4 &&
+		    ts->pchan != GSM_PCHAN_CCCH_SDCCH4_CBCH)
+			ok = false;
+		/* FIXME: we should not return first sdcch4 !!! */
+		break;
+	case ABIS_RSL_CHAN_NR_CBITS_OSMO_PDCH:
+		lch_idx = 0;
+		if (ts->pchan != GSM_PCHAN_OSMO_DYN)
+			ok = false;
+		break;
+	default:
+		return NULL;
+	}
+
+	if (rc && ok)
+		*rc = 0;
+
+	return &ts->lchan[lch_idx];
+}
+
+/* get_lchan_by_chan_nr() */
+static struct gsm_lchan *ref_get_lchan_by_chan_nr(struct gsm_bts_trx *trx,
+						  unsigned int chan_nr)
+{
+	struct gsm_bts_trx_ts *ts;
+	unsigned int tn, ss;
+
+	tn = L1SAP_CHAN2TS(chan_nr);
+	ts = &trx->ts[tn];
+
+	if (L1SAP_IS_CHAN_VAMOS(chan_nr)) {
+		if (ts->vamos.peer == NULL)
+			return NULL;
+		ts = ts->vamos.peer;
+	}
+
+	if (L1SAP_IS_CHAN_CBCH(chan_nr))
+		ss = 2; /* CBCH is always on sub-slot 2 */
+	else
+		ss = l1sap_chan2ss(chan_nr);
+	OSMO_ASSERT(ss < ARRAY_SIZE(ts->lchan));
+
+	return &ts->lchan[ss];
+}
@@ -0,0 +1,130 @@
+/* Check the chan_nr lookup tables (see gsm_bts_trx_chan_nr_map_update())
+ * against the decoders they replace, for all chan_nr and pchan. */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/bts_sm.h>
+#include <osmo-bts/bts_trx.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/l1sap.h>
+#include <osmo-bts/gsm_data.h>
+
+#include "lchan_lookup_ref.h"
+
+#define ASSERT_TRUE(rc) \
+	if (!(rc)) { \
+		printf("Assert failed in %s:%d.\n",  \
+		       __FILE__, __LINE__);          \
+		abort();			     \
+	}
+
+static void set_pchan(struct gsm_bts_trx *trx, enum gsm_phys_chan_config pchan)
+{
+	unsigned int tn;
+
+	for (tn = 0; tn < ARRAY_SIZE(trx->ts); tn++) {
+		trx->ts[tn].pchan = pchan;
+		if (trx->ts[tn].vamos.peer != NULL)
+			trx->ts[tn].vamos.peer->pchan = pchan;
+	}
+}
+
+/* Compare the lookups of all 256 chan_nr, return the number of valid RSL ones */
+static unsigned int check_lookups(struct gsm_bts_trx *trx)
+{
+	unsigned int chan_nr, num_valid = 0;
+
+	for (chan_nr = 0; chan_nr < 256; chan_nr++) {
+		struct gsm_lchan *lchan, *ref_lchan;
+		int rc = 1, ref_rc = 1;
+
+		lchan = rsl_lchan_lookup(trx, chan_nr, &rc);
+		ref_lchan = ref_rsl_lchan_lookup(trx, chan_nr, &ref_rc);
+		ASSERT_TRUE(lchan == ref_lchan);
+		ASSERT_TRUE(rc == ref_rc);
+		ASSERT_TRUE(rsl_lchan_lookup(trx, chan_nr, NULL) == ref_lchan);
+		if (rc == 0)
+			num_valid++;
+
+		lchan = get_lchan_by_chan_nr(trx, chan_nr);
+		ref_lchan = ref_get_lchan_by_chan_nr(trx, chan_nr);
+		ASSERT_TRUE(lchan == ref_lchan);
+	}
+
+	return num_valid;
+}
+
+static void test_pchan(struct gsm_bts_trx *trx, enum gsm_phys_chan_config pchan)
+{
+	unsigned int num_valid, num_valid_vamos;
+
+	set_pchan(trx, pchan);
+	num_valid = check_lookups(trx);
+
+	gsm_bts_trx_init_shadow_ts(trx);
+	set_pchan(trx, pchan);
+	num_valid_vamos = check_lookups(trx);
+
+	gsm_bts_trx_free_shadow_ts(trx);
+	set_pchan(trx, pchan);
+	ASSERT_TRUE(check_lookups(trx) == num_valid);
+
+	printf("%-20s: %3u valid RSL chan_nr, %3u with VAMOS\n",
+	       gsm_pchan_name(pchan), num_valid, num_valid_vamos);
+}
+
+int main(int argc, char **argv)
+{
+	struct gsm_bts *bts;
+	unsigned int pchan;
+
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+
+	g_bts_sm = gsm_bts_sm_alloc(tall_bts_ctx);
+	if (!g_bts_sm) {
+		fprintf(stderr, "Failed to create BTS Site Manager structure\n");
+		exit(1);
+	}
+	bts = gsm_bts_alloc(g_bts_sm, 0);
+	if (bts_init(bts) < 0) {
+		fprintf(stderr, "unable to open bts\n");
+		exit(1);
+	}
+
+	printf("Testing the chan_nr lookup tables against the decoders\n");
+
+	for (pchan = GSM_PCHAN_NONE; pchan < _GSM_PCHAN_MAX; pchan++)
+		test_pchan(bts->c0, pchan);
+
+	printf("Success\n");
+
+	return 0;
+}
@@ -145,8 +145,11 @@ static void test_sacch_get(void)
 
 	/* initialize the input. */
 	for (i = 1; i < _MAX_SYSINFO_TYPE; ++i) {
-		lchan.si.valid |= (1 << i);
-		memset(GSM_LCHAN_SI(&lchan, i), i, GSM_MACBLOCK_LEN);
+		struct gsm_sacch_si *si = sacch_si_alloc(ctx);
+
+		memset(si->buf, i, GSM_MACBLOCK_LEN);
+		lchan_sacch_si_set(&lchan, i, si);
+		sacch_si_put(si);
 	}
 
 	/* It will start with '1' */
@@ -159,6 +162,8 @@ static void test_sacch_get(void)
 		//printf("i=%d (%%=%d) -> data[0]=%d\n", i, off, data[0]);
 		OSMO_ASSERT(data[0] == off);
 	}
+
+	lchan_sacch_si_clear(&lchan);
 }
 
 static void test_bts_supports_cm(void)
@@ -0,0 +1,252 @@
+/* Check the msgb pools (see bts_msgb_pool_alloc()): a pooled msgb must
+ * look exactly like a fresh one, and once the pools have grown to the
+ * working set, a steady flow of primitives must not allocate at all. */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/logging.h>
+#include <osmo-bts/l1sap.h>
+#include <osmo-bts/msgb_pool.h>
+
+#define ASSERT_TRUE(rc) \
+	if (!(rc)) { \
+		printf("Assert failed in %s:%d.\n",  \
+		       __FILE__, __LINE__);          \
+		abort();			     \
+	}
+
+/* Primitives allocated per frame, and for how many frames they live */
+#define NUM_L1SAP	8
+#define NUM_RTP		2
+#define NUM_PHY		4
+#define NUM_PRIMS	(NUM_L1SAP + NUM_RTP + NUM_PHY)
+#define DELAY		10
+
+static void *msgb_ctx;
+static struct msgb *in_flight[DELAY][NUM_PRIMS];
+
+/* Deterministic pseudo-random numbers, so that the results are reproducible */
+static uint32_t rand_state = 0x2342;
+
+static uint32_t test_rand(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return rand_state >> 8;
+}
+
+static bool is_zero(const uint8_t *buf, unsigned int len)
+{
+	unsigned int i;
+
+	for (i = 0; i < len; i++) {
+		if (buf[i] != 0)
+			return false;
+	}
+
+	return true;
+}
+
+/* Check a msgb against a fresh msgb_alloc_headroom(size, headroom), and scribble over it */
+static void check_msgb(struct msgb *msg, uint16_t size, uint16_t headroom, uint16_t len)
+{
+	ASSERT_TRUE(msg != NULL);
+	ASSERT_TRUE(msg->data_len == size);
+	ASSERT_TRUE(msgb_headroom(msg) == headroom);
+	ASSERT_TRUE(msgb_length(msg) == len);
+	ASSERT_TRUE(msgb_tailroom(msg) == size - headroom - len);
+	ASSERT_TRUE(msg->l2h == NULL && msg->l3h == NULL && msg->dst == NULL);
+	ASSERT_TRUE(is_zero(msg->_data, size));
+
+	memset(msg->cb, 0xff, sizeof(msg->cb));
+	memset(msgb_put(msg, msgb_tailroom(msg)), 0xff, size - headroom - len);
+	msg->l2h = msg->data;
+	msg->dst = msg;
+}
+
+static struct msgb *alloc_l1sap(unsigned int l2_len)
+{
+	struct msgb *msg = l1sap_msgb_alloc(l2_len);
+
+	check_msgb(msg, L1SAP_MSGB_HEADROOM + sizeof(struct osmo_phsap_prim) + l2_len,
+		   L1SAP_MSGB_HEADROOM, sizeof(struct osmo_phsap_prim));
+	ASSERT_TRUE(msg->l1h == msg->head + L1SAP_MSGB_HEADROOM);
+	return msg;
+}
+
+static struct msgb *alloc_phy(unsigned int size)
+{
+	struct msgb *msg = bts_msgb_pool_alloc(BTS_MSGB_POOL_PHY, size, 24, "l1_prim");
+
+	check_msgb(msg, size, 24, 0);
+	return msg;
+}
+
+/* One frame: free the primitives of DELAY frames ago, allocate new ones */
+static void run_frame(unsigned int fn)
+{
+	struct msgb **prims = in_flight[fn % DELAY];
+	unsigned int i;
+
+	for (i = 0; i < NUM_PRIMS; i++) {
+		msgb_free(prims[i]);
+		prims[i] = NULL;
+	}
+
+	for (i = 0; i < NUM_L1SAP; i++)
+		prims[i] = alloc_l1sap(test_rand() % (BTS_MSGB_POOL_L1SAP_L2_LEN + 1));
+	for (i = 0; i < NUM_RTP; i++)
+		prims[NUM_L1SAP + i] = alloc_l1sap(512);
+	for (i = 0; i < NUM_PHY; i++)
+		prims[NUM_L1SAP + NUM_RTP + i] = alloc_phy(24 + test_rand() % (BTS_MSGB_POOL_PHY_SIZE - 23));
+}
+
+static void print_stats(void)
+{
+	static const char * const names[] = { "l1sap", "rtp", "phy" };
+	struct bts_msgb_pool_stats st;
+	unsigned int i;
+
+	for (i = 0; i < _NUM_BTS_MSGB_POOL; i++) {
+		bts_msgb_pool_get_stats(i, &st);
+		printf("  %-5s: %u hits, %u misses, %u fallbacks, %u msgb (%u free)\n",
+		       names[i], st.hits, st.misses, st.fallbacks, st.num, st.num_free);
+	}
+}
+
+static void test_reuse(void)
+{
+	struct bts_msgb_pool_stats st, st2;
+	struct msgb *msg, *msg2;
+
+	printf("Testing the reuse of pooled msgb\n");
+
+	bts_msgb_pool_get_stats(BTS_MSGB_POOL_L1SAP, &st);
+	msg = alloc_l1sap(23);
+	msgb_free(msg);
+	msg2 = alloc_l1sap(0);
+	ASSERT_TRUE(msg2 == msg);
+	msgb_free(msg2);
+	bts_msgb_pool_get_stats(BTS_MSGB_POOL_L1SAP, &st2);
+	ASSERT_TRUE(st2.hits == st.hits + 2 && st2.misses == st.misses);
+	ASSERT_TRUE(st2.num == st.num && st2.num_free == st.num_free);
+}
+
+static void test_steady_state(void)
+{
+	struct bts_msgb_pool_stats st[_NUM_BTS_MSGB_POOL], st2;
+	size_t blocks;
+	unsigned int fn, i;
+
+	printf("Testing the pools under a steady flow of primitives\n");
+
+	for (fn = 0; fn < 2 * DELAY; fn++)
+		run_frame(fn);
+	printf("After %u frames:\n", fn);
+	print_stats();
+
+	for (i = 0; i < _NUM_BTS_MSGB_POOL; i++)
+		bts_msgb_pool_get_stats(i, &st[i]);
+	blocks = talloc_total_blocks(msgb_ctx);
+
+	bts_msgb_pool_set_no_alloc(true);
+	for (; fn < 1000; fn++)
+		run_frame(fn);
+	bts_msgb_pool_set_no_alloc(false);
+
+	printf("After %u frames:\n", fn);
+	print_stats();
+
+	ASSERT_TRUE(talloc_total_blocks(msgb_ctx) == blocks);
+	for (i = 0; i < _NUM_BTS_MSGB_POOL; i++) {
+		bts_msgb_pool_get_stats(i, &st2);
+		ASSERT_TRUE(st2.misses == st[i].misses);
+		ASSERT_TRUE(st2.fallbacks == 0);
+		ASSERT_TRUE(st2.num == st[i].num);
+	}
+}
+
+static void test_oversized(void)
+{
+	struct bts_msgb_pool_stats st, st2;
+	struct msgb *msg;
+
+	printf("Testing an allocation larger than the pool buffers\n");
+
+	bts_msgb_pool_get_stats(BTS_MSGB_POOL_PHY, &st);
+	msg = alloc_phy(BTS_MSGB_POOL_PHY_SIZE + 1);
+	msgb_free(msg);
+	bts_msgb_pool_get_stats(BTS_MSGB_POOL_PHY, &st2);
+	ASSERT_TRUE(st2.misses == st.misses + 1);
+	ASSERT_TRUE(st2.fallbacks == st.fallbacks + 1);
+	ASSERT_TRUE(st2.num == st.num && st2.num_free == st.num_free);
+}
+
+static void test_release(void)
+{
+	struct bts_msgb_pool_stats st;
+	unsigned int i, j;
+
+	printf("Testing the release of the pools\n");
+
+	/* the primitives still in flight are freed after the pools */
+	bts_msgb_pool_release();
+	for (i = 0; i < _NUM_BTS_MSGB_POOL; i++) {
+		bts_msgb_pool_get_stats(i, &st);
+		ASSERT_TRUE(st.num_free == 0);
+	}
+
+	for (i = 0; i < DELAY; i++) {
+		for (j = 0; j < NUM_PRIMS; j++)
+			msgb_free(in_flight[i][j]);
+	}
+	for (i = 0; i < _NUM_BTS_MSGB_POOL; i++) {
+		bts_msgb_pool_get_stats(i, &st);
+		ASSERT_TRUE(st.num == 0);
+	}
+	ASSERT_TRUE(talloc_total_blocks(msgb_ctx) == 1);
+}
+
+int main(int argc, char **argv)
+{
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_ctx = msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+
+	bts_msgb_pool_init(tall_bts_ctx);
+
+	test_reuse();
+	test_steady_state();
+	test_oversized();
+	test_release();
+
+	printf("Success\n");
+
+	return 0;
+}
@@ -0,0 +1,339 @@
+/* Osmux frames received on the BTS socket shall reach the lchan which is
+ * connected to the sending peer with the circuit ID of the frame. Batches
+ * sent by the BTS shall survive a full socket buffer or a short sendmmsg(). */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/codec/codec.h>
+#include <osmocom/netif/osmux.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/bts_sm.h>
+#include <osmo-bts/bts_trx.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/osmux.h>
+
+#define ASSERT_TRUE(rc) \
+	if (!(rc)) { \
+		printf("Assert failed in %s:%d.\n",  \
+		       __FILE__, __LINE__);          \
+		abort();			     \
+	}
+
+#define NUM_PEERS	2
+#define NUM_LCHANS	3
+
+/* A remote Osmux endpoint (e.g. the MGW), on an ephemeral port */
+struct peer {
+	int fd;
+	struct sockaddr_in addr;
+	uint8_t seq;
+};
+
+static struct gsm_bts *bts;
+static struct sockaddr_in bts_addr;
+static struct peer peers[NUM_PEERS];
+static struct gsm_lchan *lchans[NUM_LCHANS];
+/* Frames delivered to each lchan */
+static unsigned int rx_frames[NUM_LCHANS];
+
+/* Applied to the next sendmmsg() call of the BTS, then reset */
+static struct {
+	/* fail with this errno */
+	int err;
+	/* send at most this many datagrams */
+	unsigned int max;
+} sendmmsg_fault;
+
+/* Overrides the libc function for the BTS, to make it fail on purpose */
+int sendmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+	if (sendmmsg_fault.err) {
+		errno = sendmmsg_fault.err;
+		sendmmsg_fault.err = 0;
+		return -1;
+	}
+	if (sendmmsg_fault.max && vlen > sendmmsg_fault.max)
+		vlen = sendmmsg_fault.max;
+	sendmmsg_fault.max = 0;
+	return syscall(SYS_sendmmsg, sockfd, msgvec, vlen, flags);
+}
+
+static void peer_open(struct peer *p)
+{
+	socklen_t len = sizeof(p->addr);
+
+	p->fd = socket(AF_INET, SOCK_DGRAM, 0);
+	ASSERT_TRUE(p->fd >= 0);
+
+	memset(&p->addr, 0, sizeof(p->addr));
+	p->addr.sin_family = AF_INET;
+	p->addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	ASSERT_TRUE(bind(p->fd, (struct sockaddr *) &p->addr, sizeof(p->addr)) == 0);
+	ASSERT_TRUE(getsockname(p->fd, (struct sockaddr *) &p->addr, &len) == 0);
+}
+
+/* Send an Osmux batch holding one AMR 12.2 frame for the given circuit */
+static void peer_send(struct peer *p, uint8_t cid)
+{
+	uint8_t buf[sizeof(struct osmux_hdr) + 31];
+	struct osmux_hdr *osmuxh = (struct osmux_hdr *) buf;
+
+	memset(buf, 0x2b, sizeof(buf));
+	osmuxh->ft = OSMUX_FT_VOICE_AMR;
+	osmuxh->ctr = 0; /* one frame */
+	osmuxh->amr_f = 0;
+	osmuxh->amr_q = 1;
+	osmuxh->rtp_m = 0;
+	osmuxh->seq = p->seq++;
+	osmuxh->circuit_id = cid;
+	osmuxh->amr_cmr = 0;
+	osmuxh->amr_ft = AMR_12_2;
+	ASSERT_TRUE(osmo_amr_bytes(AMR_12_2) == sizeof(buf) - sizeof(*osmuxh));
+
+	ASSERT_TRUE(sendto(p->fd, buf, sizeof(buf), 0, (struct sockaddr *) &bts_addr,
+			   sizeof(bts_addr)) == sizeof(buf));
+}
+
+/* Stand-in for scheduled_from_osmux_tx_rtp_cb() */
+static void rx_rtp_cb(struct msgb *msg, void *data)
+{
+	unsigned int *count = data;
+
+	(*count)++;
+	msgb_free(msg);
+}
+
+/* Let the BTS read the socket and the Osmux output timers expire */
+static void run_bts(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < 100; i++) {
+		osmo_select_main(1);
+		usleep(1000);
+	}
+}
+
+static void print_rx_frames(const char *what)
+{
+	unsigned int i;
+
+	printf("%s:\n", what);
+	for (i = 0; i < NUM_LCHANS; i++) {
+		printf("  lchan %u: %u frames\n", i, rx_frames[i]);
+		rx_frames[i] = 0;
+	}
+}
+
+static void lchan_connect(unsigned int i, const struct peer *p, uint8_t remote_cid)
+{
+	struct gsm_lchan *lchan = lchans[i];
+
+	ASSERT_TRUE(lchan_osmux_init(lchan, 98) == 0);
+	osmux_xfrm_output_set_tx_cb(lchan->abis_ip.osmux.out, rx_rtp_cb, &rx_frames[i]);
+
+	lchan->abis_ip.connect_ip = p->addr.sin_addr.s_addr;
+	lchan->abis_ip.connect_port = ntohs(p->addr.sin_port);
+	lchan->abis_ip.osmux.remote_cid = remote_cid;
+	ASSERT_TRUE(lchan_osmux_connect(lchan) == 0);
+	ASSERT_TRUE(lchan_osmux_connected(lchan));
+}
+
+static uint8_t local_cid(unsigned int i)
+{
+	return lchans[i]->abis_ip.osmux.local_cid;
+}
+
+static void test_osmux_rx(void)
+{
+	printf("\n%s()\n", __func__);
+
+	/* lchans 0 and 2 are connected to the same peer */
+	lchan_connect(0, &peers[0], 10);
+	lchan_connect(1, &peers[1], 11);
+	lchan_connect(2, &peers[0], 12);
+	ASSERT_TRUE(local_cid(0) != local_cid(1) && local_cid(0) != local_cid(2));
+	ASSERT_TRUE(lchans[0]->abis_ip.osmux.in == lchans[2]->abis_ip.osmux.in);
+	ASSERT_TRUE(lchans[0]->abis_ip.osmux.in != lchans[1]->abis_ip.osmux.in);
+
+	peer_send(&peers[0], local_cid(0));
+	peer_send(&peers[1], local_cid(1));
+	peer_send(&peers[0], local_cid(2));
+	run_bts();
+	print_rx_frames("Each peer sends to the CIDs of its lchans");
+
+	peer_send(&peers[1], local_cid(0));
+	peer_send(&peers[0], local_cid(1));
+	run_bts();
+	print_rx_frames("Each peer sends to a CID of the other peer's lchan");
+
+	lchan_osmux_release(lchans[0]);
+	peer_send(&peers[0], local_cid(0));
+	peer_send(&peers[0], local_cid(2));
+	run_bts();
+	print_rx_frames("lchan 0 released, its peer sends to both of its former CIDs");
+
+	lchan_osmux_release(lchans[1]);
+	lchan_osmux_release(lchans[2]);
+}
+
+static uint64_t bts_ctr(unsigned int idx)
+{
+	return rate_ctr_group_get_ctr(bts->ctrs, idx)->current;
+}
+
+/* Have each lchan send one AMR 12.2 frame, and each peer's batch delivered */
+static void bts_send(void)
+{
+	/* octet aligned: CMR, TOC (FT=7, Q=1), speech bits */
+	uint8_t amr[2 + 31] = { 0xf0, 0x3c };
+	unsigned int i;
+
+	for (i = 0; i < NUM_LCHANS; i++)
+		ASSERT_TRUE(lchan_osmux_send_frame(lchans[i], amr, sizeof(amr), 160, false) == 0);
+	osmux_xfrm_input_deliver(lchans[0]->abis_ip.osmux.in);
+	osmux_xfrm_input_deliver(lchans[1]->abis_ip.osmux.in);
+}
+
+static void print_tx(const char *what)
+{
+	static uint64_t dgrams, syscalls;
+	uint8_t buf[512];
+	unsigned int i;
+
+	printf("%s:\n", what);
+	printf("  osmux:tx:syscalls +%" PRIu64 ", osmux:tx:dgrams +%" PRIu64 "\n",
+	       bts_ctr(BTS_CTR_OSMUX_TX_SYSCALLS) - syscalls,
+	       bts_ctr(BTS_CTR_OSMUX_TX_DGRAMS) - dgrams);
+	syscalls = bts_ctr(BTS_CTR_OSMUX_TX_SYSCALLS);
+	dgrams = bts_ctr(BTS_CTR_OSMUX_TX_DGRAMS);
+
+	for (i = 0; i < NUM_PEERS; i++) {
+		unsigned int n = 0;
+
+		while (recv(peers[i].fd, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+			n++;
+		printf("  peer %u: %u datagrams\n", i, n);
+	}
+}
+
+static void test_osmux_tx(void)
+{
+	unsigned int i;
+
+	printf("\n%s()\n", __func__);
+
+	/* lchans 0 and 2 are connected to the same peer */
+	lchan_connect(0, &peers[0], 20);
+	lchan_connect(1, &peers[1], 21);
+	lchan_connect(2, &peers[0], 22);
+	/* Start from zero */
+	print_tx("Connected");
+
+	/* Three batches to each peer, queued to be sent together */
+	for (i = 0; i < 3; i++)
+		bts_send();
+	run_bts();
+	print_tx("Six batches sent");
+
+	for (i = 0; i < 3; i++)
+		bts_send();
+	sendmmsg_fault.max = 2;
+	run_bts();
+	print_tx("Six batches sent, the first sendmmsg() only takes two");
+
+	for (i = 0; i < 3; i++)
+		bts_send();
+	sendmmsg_fault.err = EAGAIN;
+	run_bts();
+	print_tx("Six batches sent, the socket buffer is full at first");
+
+	for (i = 0; i < 3; i++)
+		bts_send();
+	sendmmsg_fault.err = ENETUNREACH;
+	run_bts();
+	print_tx("Six batches sent, the first one fails");
+
+	for (i = 0; i < NUM_LCHANS; i++)
+		lchan_osmux_release(lchans[i]);
+}
+
+int main(int argc, char **argv)
+{
+	socklen_t len = sizeof(bts_addr);
+	unsigned int i;
+
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+
+	g_bts_sm = gsm_bts_sm_alloc(tall_bts_ctx);
+	if (!g_bts_sm) {
+		fprintf(stderr, "Failed to create BTS Site Manager structure\n");
+		exit(1);
+	}
+	bts = gsm_bts_alloc(g_bts_sm, 0);
+	if (bts_init(bts) < 0) {
+		fprintf(stderr, "unable to open bts\n");
+		exit(1);
+	}
+
+	/* Bind to an ephemeral port, so that parallel test runs don't collide */
+	bts->osmux.use = OSMUX_USAGE_ON;
+	bts->osmux.local_port = 0;
+	ASSERT_TRUE(bts_osmux_open(bts) == 0);
+	ASSERT_TRUE(getsockname(bts->osmux.fd.fd, (struct sockaddr *) &bts_addr, &len) == 0);
+
+	for (i = 0; i < NUM_LCHANS; i++)
+		lchans[i] = &bts->c0->ts[1 + i].lchan[0];
+
+	for (i = 0; i < NUM_PEERS; i++)
+		peer_open(&peers[i]);
+
+	test_osmux_rx();
+	test_osmux_tx();
+
+	for (i = 0; i < NUM_PEERS; i++)
+		close(peers[i].fd);
+
+	printf("Success\n");
+
+	return 0;
+}
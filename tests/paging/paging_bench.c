@@ -0,0 +1,300 @@
+/* Benchmark of the paging queue under a synthetic paging storm.
+ *
+ * A stand-in for the BSC adds paging identities (a mix of TMSIs and
+ * IMSIs, with a share of re-pagings of recently paged subscribers) at the
+ * given rate, while the CCCH blocks of the simulated TDMA frames take
+ * them out of the queue with paging_gen_msg().  The frames are simulated,
+ * so the queue sees the load of the given duration at full speed.  The
+ * mean time spent in paging_add_identity() and paging_gen_msg(), the
+ * worst case of the latter, the paging counters and the identities per
+ * paging block are reported.  This is not part of the testsuite, run it
+ * manually:
+ *
+ *   ./paging_bench --rate 100000 --duration 60 --dup 20 --lifetime 2
+ */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/gsm/gsm_utils.h>
+#include <osmocom/gsm/gsm48.h>
+#include <osmocom/gsm/protocol/gsm_04_08.h>
+#include <osmocom/gsm/protocol/gsm_08_58.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/bts_sm.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/paging.h>
+#include <osmo-bts/gsm_data.h>
+
+/* Recently paged identities, candidates for re-paging */
+#define BENCH_RECENT	1024
+
+struct bench_id {
+	uint8_t group;
+	uint8_t lv[9];
+};
+
+static struct {
+	unsigned int rate;	/* pagings per minute */
+	unsigned int duration;	/* simulated seconds */
+	unsigned int dup;	/* share of re-pagings (%) */
+	unsigned int imsi;	/* share of IMSIs (%) */
+	unsigned int queue_max;
+	unsigned int lifetime;
+} cfg = {
+	.rate = 100000,
+	.duration = 60,
+	.dup = 20,
+	.imsi = 10,
+	.queue_max = 200,
+	.lifetime = 0,
+};
+
+static struct gsm_bts *bts;
+static struct bench_id recent[BENCH_RECENT];
+static unsigned int num_recent;
+
+/* Deterministic pseudo-random numbers, so that the results are reproducible */
+static uint32_t rand_state = 0x2342;
+
+static uint32_t bench_rand(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return rand_state >> 8;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Mobile Identity LV of a random TMSI or 15 digit IMSI, see 3GPP TS 24.008 10.5.1.4 */
+static void bench_new_id(struct bench_id *id, unsigned int num_groups)
+{
+	unsigned int i;
+
+	if (bench_rand() % 100 < cfg.imsi) {
+		uint8_t digits[15];
+
+		for (i = 0; i < sizeof(digits); i++)
+			digits[i] = bench_rand() % 10;
+		id->lv[0] = 8;
+		id->lv[1] = (digits[0] << 4) | 0x08 | GSM_MI_TYPE_IMSI;
+		for (i = 1; i < 8; i++)
+			id->lv[i + 1] = (digits[2 * i] << 4) | digits[2 * i - 1];
+		/* the paging group follows from the last three digits */
+		id->group = (digits[12] * 100 + digits[13] * 10 + digits[14]) % num_groups;
+	} else {
+		id->lv[0] = 5;
+		id->lv[1] = 0xf0 | GSM_MI_TYPE_TMSI;
+		for (i = 0; i < 4; i++)
+			id->lv[i + 2] = bench_rand();
+		id->group = bench_rand() % num_groups;
+	}
+}
+
+static void print_help(void)
+{
+	printf("Usage: paging_bench [options]\n"
+	       "  -r --rate N        Pagings per minute (default %u)\n"
+	       "  -d --duration N    Simulated seconds (default %u)\n"
+	       "  -D --dup N         Re-page N %% of the time (default %u)\n"
+	       "  -i --imsi N        Page N %% by IMSI, by TMSI otherwise (default %u)\n"
+	       "  -q --queue-size N  Maximum paging queue length (default %u)\n"
+	       "  -l --lifetime N    Paging lifetime in seconds (default %u)\n",
+	       cfg.rate, cfg.duration, cfg.dup, cfg.imsi, cfg.queue_max, cfg.lifetime);
+}
+
+static void handle_options(int argc, char **argv)
+{
+	while (1) {
+		int option_index = 0, c;
+		static const struct option long_options[] = {
+			{ "help", 0, 0, 'h' },
+			{ "rate", 1, 0, 'r' },
+			{ "duration", 1, 0, 'd' },
+			{ "dup", 1, 0, 'D' },
+			{ "imsi", 1, 0, 'i' },
+			{ "queue-size", 1, 0, 'q' },
+			{ "lifetime", 1, 0, 'l' },
+			{ 0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "hr:d:D:i:q:l:", long_options, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			print_help();
+			exit(0);
+		case 'r':
+			cfg.rate = atoi(optarg);
+			break;
+		case 'd':
+			cfg.duration = atoi(optarg);
+			break;
+		case 'D':
+			cfg.dup = atoi(optarg);
+			break;
+		case 'i':
+			cfg.imsi = atoi(optarg);
+			break;
+		case 'q':
+			cfg.queue_max = atoi(optarg);
+			break;
+		case 'l':
+			cfg.lifetime = atoi(optarg);
+			break;
+		default:
+			print_help();
+			exit(1);
+		}
+	}
+
+	if (cfg.duration < 1 || cfg.dup > 100 || cfg.imsi > 100 ||
+	    cfg.queue_max < 1 || cfg.queue_max > 1024 || cfg.lifetime > 60) {
+		print_help();
+		exit(1);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	/* first frames of the CCCH blocks in a 51-multiframe */
+	static const uint8_t ccch_t3[] = { 6, 12, 16, 22, 26, 32, 36, 42, 46 };
+	struct gsm48_control_channel_descr chan_desc = {
+		.ccch_conf = RSL_BCCH_CCCH_CONF_1_NC,
+		.bs_ag_blks_res = 1,
+		.bs_pa_mfrms = 0,
+	};
+	struct paging_state *ps;
+	uint8_t out_buf[GSM_MACBLOCK_LEN];
+	uint64_t add_ns = 0, gen_ns = 0, gen_max_ns = 0, sent, blocks;
+	unsigned int num_add = 0, num_gen = 0, num_dup = 0, num_full = 0;
+	unsigned int num_groups, i;
+	uint32_t fn, num_fn, acc = 0;
+
+	handle_options(argc, argv);
+
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+	/* Dropped pagings are logged, keep quiet */
+	log_set_log_level(osmo_stderr_target, LOGL_FATAL);
+
+	g_bts_sm = gsm_bts_sm_alloc(tall_bts_ctx);
+	if (!g_bts_sm) {
+		fprintf(stderr, "Failed to create BTS Site Manager structure\n");
+		exit(1);
+	}
+	bts = gsm_bts_alloc(g_bts_sm, 0);
+	if (bts_init(bts) < 0) {
+		fprintf(stderr, "unable to open bts\n");
+		exit(1);
+	}
+
+	ps = bts->paging_state;
+	paging_si_update(ps, &chan_desc);
+	paging_set_queue_max(ps, cfg.queue_max);
+	paging_set_lifetime(ps, cfg.lifetime);
+	num_groups = gsm48_number_of_paging_subchannels(&chan_desc);
+
+	printf("Paging %u/min for %u s, %u%% re-paging, %u%% IMSI, queue size %u, lifetime %u s\n",
+	       cfg.rate, cfg.duration, cfg.dup, cfg.imsi, cfg.queue_max, cfg.lifetime);
+
+	/* one TDMA frame lasts 60/13 ms */
+	num_fn = (uint64_t) cfg.duration * 13000 / 60;
+	for (fn = 0; fn < num_fn; fn++) {
+		struct gsm_time g_time;
+		uint64_t start;
+		int rc;
+
+		/* the pagings due in this frame: rate / 60 * 60 / 13000 */
+		for (acc += cfg.rate; acc >= 13000; acc -= 13000) {
+			struct bench_id id;
+
+			if (num_recent > 0 && bench_rand() % 100 < cfg.dup) {
+				id = recent[bench_rand() % OSMO_MIN(num_recent, BENCH_RECENT)];
+			} else {
+				bench_new_id(&id, num_groups);
+				recent[num_recent++ % BENCH_RECENT] = id;
+			}
+
+			start = now_ns();
+			rc = paging_add_identity(ps, id.group, id.lv, 0);
+			add_ns += now_ns() - start;
+			num_add++;
+
+			if (rc == -EEXIST)
+				num_dup++;
+			else if (rc == -ENOSPC)
+				num_full++;
+		}
+
+		/* only the CCCH blocks not reserved for AGCH carry pagings */
+		for (i = chan_desc.bs_ag_blks_res; i < ARRAY_SIZE(ccch_t3); i++) {
+			if (fn % 51 == ccch_t3[i])
+				break;
+		}
+		if (i == ARRAY_SIZE(ccch_t3))
+			continue;
+
+		gsm_fn2gsmtime(&g_time, fn);
+		start = now_ns();
+		paging_gen_msg(ps, out_buf, &g_time, &rc);
+		start = now_ns() - start;
+		gen_ns += start;
+		if (start > gen_max_ns)
+			gen_max_ns = start;
+		num_gen++;
+	}
+
+	printf("paging_add_identity(): %u calls, %.0f ns/call, %u duplicates, %u dropped (queue full)\n",
+	       num_add, num_add ? (double) add_ns / num_add : 0.0, num_dup, num_full);
+	printf("paging_gen_msg(): %u calls, %.0f ns/call, max %.1f us\n",
+	       num_gen, num_gen ? (double) gen_ns / num_gen : 0.0, gen_max_ns / 1000.0);
+	sent = rate_ctr_group_get_ctr(bts->ctrs, BTS_CTR_PAGING_SENT)->current;
+	blocks = rate_ctr_group_get_ctr(bts->ctrs, BTS_CTR_PAGING_BLOCKS)->current;
+	printf("paging:sent %" PRIu64 ", paging:blocks %" PRIu64 " (%.2f identities per block), "
+	       "paging:drop %" PRIu64 ", paging:cong %" PRIu64 ", queue length %d\n",
+	       sent, blocks, blocks ? (double) sent / blocks : 0.0,
+	       rate_ctr_group_get_ctr(bts->ctrs, BTS_CTR_PAGING_DROP)->current,
+	       rate_ctr_group_get_ctr(bts->ctrs, BTS_CTR_PAGING_CONG)->current,
+	       paging_queue_length(ps));
+
+	return 0;
+}
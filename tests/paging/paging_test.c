@@ -30,6 +30,7 @@
 #include <osmo-bts/notification.h>
 
 #include <unistd.h>
+#include <errno.h>
 
 static struct gsm_bts *bts;
 
@@ -126,6 +127,193 @@ static void test_paging_sleep(void)
 	ASSERT_TRUE(paging_queue_length(bts->paging_state) == 0);
 }
 
+static void paging_test_gen(uint32_t fn, int *is_empty)
+{
+	uint8_t out_buf[GSM_MACBLOCK_LEN];
+	struct gsm_time g_time;
+	int rc;
+
+	gsm_fn2gsmtime(&g_time, fn);
+	rc = paging_gen_msg(bts->paging_state, out_buf, &g_time, is_empty);
+	ASSERT_TRUE(rc == 23);
+}
+
+static void test_paging_lifetime(void)
+{
+	int rc;
+	int is_empty = -1;
+	printf("Testing paging lifetime and duplicates.\n");
+
+	paging_set_lifetime(bts->paging_state, 2);
+
+	/* add paging entry, a duplicate is refused */
+	rc = paging_add_identity(bts->paging_state, 0, static_ilv, 0);
+	ASSERT_TRUE(rc == 0);
+	rc = paging_add_identity(bts->paging_state, 0, static_ilv, 0);
+	ASSERT_TRUE(rc == -EEXIST);
+	ASSERT_TRUE(paging_queue_length(bts->paging_state) == 1);
+
+	/* sent, but kept for its lifetime */
+	paging_test_gen(6, &is_empty);
+	ASSERT_TRUE(is_empty == 0);
+	ASSERT_TRUE(paging_queue_length(bts->paging_state) == 1);
+
+	/* ~1.2 s later: the duplicate restarts the lifetime */
+	paging_test_gen(51 * 5 + 6, &is_empty);
+	ASSERT_TRUE(paging_queue_length(bts->paging_state) == 1);
+	rc = paging_add_identity(bts->paging_state, 0, static_ilv, 0);
+	ASSERT_TRUE(rc == -EEXIST);
+
+	/* ~2.4 s: not expired yet */
+	paging_test_gen(51 * 10 + 6, &is_empty);
+	ASSERT_TRUE(paging_queue_length(bts->paging_state) == 1);
+
+	/* ~3.5 s: expired */
+	paging_test_gen(51 * 15 + 6, &is_empty);
+	ASSERT_TRUE(paging_group_queue_empty(bts->paging_state, 0));
+	ASSERT_TRUE(paging_queue_length(bts->paging_state) == 0);
+
+	paging_set_lifetime(bts->paging_state, 0);
+}
+
+static void test_paging_packing(void)
+{
+	static const uint8_t imsi2_ilv[] = {
+		0x08, 0x59, 0x51, 0x30, 0x99, 0x00, 0x00, 0x00, 0x29
+	};
+	uint8_t tmsi_lv[] = { 0x05, 0xf4, 0x00, 0x00, 0x00, 0x00 };
+	uint8_t out_buf[GSM_MACBLOCK_LEN];
+	struct gsm_time g_time;
+	int rc, i;
+	int is_empty = -1;
+	printf("Testing that paging blocks are packed.\n");
+
+	/* Two IMSIs ahead of four TMSIs in the queue */
+	for (i = 1; i <= 4; i++) {
+		tmsi_lv[5] = i;
+		rc = paging_add_identity(bts->paging_state, 0, tmsi_lv, 0);
+		ASSERT_TRUE(rc == 0);
+	}
+	rc = paging_add_identity(bts->paging_state, 0, static_ilv, 0);
+	ASSERT_TRUE(rc == 0);
+	rc = paging_add_identity(bts->paging_state, 0, imsi2_ilv, 0);
+	ASSERT_TRUE(rc == 0);
+	ASSERT_TRUE(paging_queue_length(bts->paging_state) == 6);
+
+	/* Type 3 with the four TMSIs, the IMSI at the head of the queue stays there */
+	gsm_fn2gsmtime(&g_time, 51 * 16 + 6);
+	rc = paging_gen_msg(bts->paging_state, out_buf, &g_time, &is_empty);
+	ASSERT_TRUE(rc == 23);
+	ASSERT_TRUE(out_buf[2] == GSM48_MT_RR_PAG_REQ_3);
+	ASSERT_TRUE(out_buf[7] == 4 && out_buf[11] == 3 && out_buf[15] == 2 && out_buf[19] == 1);
+	ASSERT_TRUE(paging_queue_length(bts->paging_state) == 2);
+
+	/* Type 1 with both IMSIs */
+	gsm_fn2gsmtime(&g_time, 51 * 18 + 6);
+	rc = paging_gen_msg(bts->paging_state, out_buf, &g_time, &is_empty);
+	ASSERT_TRUE(rc == 23);
+	ASSERT_TRUE(out_buf[2] == GSM48_MT_RR_PAG_REQ_1);
+	ASSERT_TRUE(!memcmp(out_buf + 4, imsi2_ilv, imsi2_ilv[0] + 1));
+	ASSERT_TRUE(out_buf[13] == GSM48_IE_MOBILE_ID);
+	ASSERT_TRUE(!memcmp(out_buf + 14, static_ilv, static_ilv[0] + 1));
+	ASSERT_TRUE(paging_queue_length(bts->paging_state) == 0);
+
+	/* An IMSI ahead of eight TMSIs: it is left at the head of the queue only once */
+	for (i = 1; i <= 8; i++) {
+		tmsi_lv[5] = i;
+		rc = paging_add_identity(bts->paging_state, 0, tmsi_lv, 0);
+		ASSERT_TRUE(rc == 0);
+	}
+	rc = paging_add_identity(bts->paging_state, 0, static_ilv, 0);
+	ASSERT_TRUE(rc == 0);
+	ASSERT_TRUE(paging_queue_length(bts->paging_state) == 9);
+
+	gsm_fn2gsmtime(&g_time, 51 * 20 + 6);
+	rc = paging_gen_msg(bts->paging_state, out_buf, &g_time, &is_empty);
+	ASSERT_TRUE(rc == 23);
+	ASSERT_TRUE(out_buf[2] == GSM48_MT_RR_PAG_REQ_3);
+	ASSERT_TRUE(out_buf[7] == 8 && out_buf[11] == 7 && out_buf[15] == 6 && out_buf[19] == 5);
+	ASSERT_TRUE(paging_queue_length(bts->paging_state) == 5);
+
+	/* Type 2 with the IMSI, although four TMSIs are still queued */
+	gsm_fn2gsmtime(&g_time, 51 * 22 + 6);
+	rc = paging_gen_msg(bts->paging_state, out_buf, &g_time, &is_empty);
+	ASSERT_TRUE(rc == 23);
+	ASSERT_TRUE(out_buf[2] == GSM48_MT_RR_PAG_REQ_2);
+	ASSERT_TRUE(out_buf[7] == 4 && out_buf[11] == 3);
+	ASSERT_TRUE(!memcmp(out_buf + 14, static_ilv + 1, static_ilv[0]));
+	ASSERT_TRUE(paging_queue_length(bts->paging_state) == 2);
+
+	gsm_fn2gsmtime(&g_time, 51 * 24 + 6);
+	rc = paging_gen_msg(bts->paging_state, out_buf, &g_time, &is_empty);
+	ASSERT_TRUE(rc == 23);
+	ASSERT_TRUE(out_buf[2] == GSM48_MT_RR_PAG_REQ_1);
+	ASSERT_TRUE(out_buf[9] == 2 && out_buf[16] == 1);
+	ASSERT_TRUE(paging_queue_length(bts->paging_state) == 0);
+}
+
+static void test_paging_packing_etws(void)
+{
+	uint8_t tmsi_lv[] = { 0x05, 0xf4, 0x00, 0x00, 0x00, 0x00 };
+	uint8_t out_buf[GSM_MACBLOCK_LEN];
+	struct gsm_time g_time;
+	int rc, fn, i;
+	int is_empty = -1;
+	printf("Testing that paging blocks are packed next to an ETWS notification.\n");
+
+	/* Two pages: 14 octets leave no room for identities, 1 octet for 15 */
+	bts->etws.prim_notif_len = 15;
+	bts->etws.prim_notif = talloc_zero_size(bts, bts->etws.prim_notif_len);
+	bts->etws.page_size = 14;
+	bts->etws.num_pages = 2;
+	bts->etws.next_page = 0;
+
+	/* A TMSI, an IMSI and another TMSI in the queue */
+	tmsi_lv[5] = 2;
+	rc = paging_add_identity(bts->paging_state, 0, tmsi_lv, 0);
+	ASSERT_TRUE(rc == 0);
+	rc = paging_add_identity(bts->paging_state, 0, static_ilv, 0);
+	ASSERT_TRUE(rc == 0);
+	tmsi_lv[5] = 1;
+	rc = paging_add_identity(bts->paging_state, 0, tmsi_lv, 0);
+	ASSERT_TRUE(rc == 0);
+	ASSERT_TRUE(paging_queue_length(bts->paging_state) == 3);
+
+	for (i = 0, fn = 51 * 26 + 6; i < 4; i++, fn += 51 * 2) {
+		gsm_fn2gsmtime(&g_time, fn);
+		rc = paging_gen_msg(bts->paging_state, out_buf, &g_time, &is_empty);
+		ASSERT_TRUE(rc == 23);
+		ASSERT_TRUE(out_buf[2] == GSM48_MT_RR_PAG_REQ_1);
+
+		switch (i) {
+		case 0:
+		case 2:
+			/* First page, only the empty identity */
+			ASSERT_TRUE(out_buf[4] == 1 && out_buf[5] == 0xf0);
+			ASSERT_TRUE(paging_queue_length(bts->paging_state) == (i == 0 ? 3 : 1));
+			break;
+		case 1:
+			/* Second page, both TMSIs: the IMSI does not fit after the first one */
+			ASSERT_TRUE(out_buf[4] == 5 && out_buf[9] == 1);
+			ASSERT_TRUE(out_buf[10] == GSM48_IE_MOBILE_ID);
+			ASSERT_TRUE(out_buf[11] == 5 && out_buf[16] == 2);
+			ASSERT_TRUE(paging_queue_length(bts->paging_state) == 1);
+			break;
+		case 3:
+			/* Second page, the IMSI */
+			ASSERT_TRUE(!memcmp(out_buf + 4, static_ilv, static_ilv[0] + 1));
+			ASSERT_TRUE(paging_queue_length(bts->paging_state) == 0);
+			break;
+		}
+	}
+
+	TALLOC_FREE(bts->etws.prim_notif);
+	bts->etws.prim_notif_len = 0;
+	bts->etws.page_size = 0;
+	bts->etws.num_pages = 0;
+	bts->etws.next_page = 0;
+}
+
 /* Set up a dummy trx with a valid setting for bs_ag_blks_res in SI3 */
 static struct gsm_bts_trx *test_is_ccch_for_agch_setup(uint8_t bs_ag_blks_res)
 {
@@ -361,6 +549,9 @@ int main(int argc, char **argv)
 
 	test_paging_smoke();
 	test_paging_sleep();
+	test_paging_lifetime();
+	test_paging_packing();
+	test_paging_packing_etws();
 	test_is_ccch_for_agch();
 	test_paging_rest_octets1();
 	test_paging_rest_octets2();
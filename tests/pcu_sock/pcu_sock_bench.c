@@ -0,0 +1,257 @@
+/* Throughput of the PCU socket, with a stand-in PCU in the same process.
+ *
+ * For each MAC block the BTS sends what a busy cell sends to the PCU: a
+ * TIME_IND, and an RTS_REQ and a DATA_IND for each PDCH.  The stand-in
+ * PCU reads them off the unix socket after each block.  The primitives
+ * per second, the bytes carried by the socket and the primitives per
+ * write() are reported, in the full form, or after the PCU asked for
+ * compact primitives (--compact) or batches of them (--batch).  This is
+ * not part of the testsuite, run it manually:
+ *
+ *   ./pcu_sock_bench --pdch 64 --blocks 100000
+ *   ./pcu_sock_bench --pdch 64 --blocks 100000 --compact
+ *   ./pcu_sock_bench --pdch 64 --blocks 100000 --batch
+ */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/bts_sm.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/pcu_if.h>
+#include <osmo-bts/gsm_data.h>
+
+#include "pcu_standin.h"
+
+#define PCU_SOCK_PATH		"pcu_sock_bench.sock"
+#define BENCH_BLOCKS_DEFAULT	10000
+
+static struct {
+	unsigned int blocks;
+	unsigned int num_pdch;
+	bool compact;
+	bool batch;
+} cfg = {
+	.blocks = BENCH_BLOCKS_DEFAULT,
+	.num_pdch = 8,
+};
+
+static struct gsm_bts *bts;
+static struct pcu_standin pcu;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void print_help(const char *prog)
+{
+	printf("Usage: %s [OPTIONS]\n"
+	       "  -h --help            This text\n"
+	       "  -b --blocks NUM      Number of MAC blocks (default %u)\n"
+	       "  -p --pdch NUM        Number of PDCH (default 8)\n"
+	       "  -c --compact         Ask for compact primitives\n"
+	       "  -B --batch           Ask for batches of compact primitives\n",
+	       prog, BENCH_BLOCKS_DEFAULT);
+}
+
+static void handle_options(int argc, char **argv)
+{
+	while (1) {
+		int option_idx = 0, c;
+		static const struct option long_options[] = {
+			{ "help", 0, 0, 'h' },
+			{ "blocks", 1, 0, 'b' },
+			{ "pdch", 1, 0, 'p' },
+			{ "compact", 0, 0, 'c' },
+			{ "batch", 0, 0, 'B' },
+			{ 0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "hb:p:cB",
+				long_options, &option_idx);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			print_help(argv[0]);
+			exit(0);
+		case 'b':
+			cfg.blocks = atoi(optarg);
+			break;
+		case 'p':
+			cfg.num_pdch = atoi(optarg);
+			break;
+		case 'c':
+			cfg.compact = true;
+			break;
+		case 'B':
+			cfg.batch = true;
+			break;
+		default:
+			print_help(argv[0]);
+			exit(2);
+		}
+	}
+
+	if (cfg.blocks < 1 || cfg.num_pdch < 1) {
+		fprintf(stderr, "Invalid arguments\n");
+		exit(2);
+	}
+}
+
+/* Let the BTS accept, read and write until there is nothing left to do */
+static void bts_pump(void)
+{
+	while (osmo_select_main(1) > 0)
+		;
+}
+
+/* Stand-in PCU: read all pending primitives, return their number */
+static unsigned int pcu_drain(uint64_t *bytes)
+{
+	uint8_t buf[PCU_IF_BATCH_MAX_LEN];
+	const struct gsm_pcu_if *pcu_prim = (const struct gsm_pcu_if *) buf;
+	unsigned int num = 0;
+	int rc;
+
+	while ((rc = pcu_standin_recv(&pcu, buf, sizeof(buf), false)) > 0) {
+		*bytes += rc;
+		if (pcu_prim->msg_type == PCU_IF_MSG_BATCH)
+			num += pcu_prim->u.batch.num;
+		else
+			num++;
+	}
+
+	return num;
+}
+
+static void pcu_connect(void)
+{
+	uint64_t bytes = 0;
+
+	OSMO_ASSERT(pcu_standin_connect(&pcu, PCU_SOCK_PATH) == 0);
+
+	/* the INFO_IND sent on accept */
+	bts_pump();
+	OSMO_ASSERT(pcu_drain(&bytes) == 1);
+
+	if (cfg.compact || cfg.batch) {
+		OSMO_ASSERT(pcu_standin_send_txt(&pcu, bts->nr,
+						 cfg.batch ? PCU_BATCH_MODE : PCU_COMPACT_MODE) == 0);
+		bts_pump();
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct gsm_bts_trx_ts *ts;
+	uint8_t data[GSM_MACBLOCK_LEN];
+	uint64_t bytes = 0, start, elapsed, writes;
+	unsigned int num = 0, sent = 0, i, j;
+	uint32_t fn = 0;
+
+	handle_options(argc, argv);
+
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+	log_set_log_level(osmo_stderr_target, LOGL_ERROR);
+
+	g_bts_sm = gsm_bts_sm_alloc(tall_bts_ctx);
+	if (!g_bts_sm) {
+		fprintf(stderr, "Failed to create BTS Site Manager structure\n");
+		exit(1);
+	}
+	bts = gsm_bts_alloc(g_bts_sm, 0);
+	if (bts_init(bts) < 0) {
+		fprintf(stderr, "unable to open bts\n");
+		exit(1);
+	}
+
+	/* room for all primitives of a block in the queue of the BTS */
+	unlink(PCU_SOCK_PATH);
+	OSMO_ASSERT(pcu_sock_init(PCU_SOCK_PATH, 1 + 2 * cfg.num_pdch) == 0);
+	pcu_connect();
+
+	memset(data, 0x2b, sizeof(data));
+	ts = &bts->c0->ts[7];
+
+	writes = rate_ctr_group_get_ctr(bts->ctrs, BTS_CTR_PCU_TX_WRITES)->current;
+	start = now_ns();
+	for (i = 0; i < cfg.blocks; i++) {
+		OSMO_ASSERT(pcu_tx_time_ind(fn) == 0);
+		for (j = 0; j < cfg.num_pdch; j++) {
+			OSMO_ASSERT(pcu_tx_rts_req(ts, 0, fn, 871, i % 12) == 0);
+			OSMO_ASSERT(pcu_tx_data_ind(ts, PCU_IF_SAPI_PDTCH, fn, 871, i % 12,
+						    data, sizeof(data), -60, 10, 3, 100) == 0);
+		}
+		sent += 1 + 2 * cfg.num_pdch;
+
+		/* the socket buffer may not hold a whole block */
+		while (num < sent) {
+			bts_pump();
+			num += pcu_drain(&bytes);
+		}
+
+		/* next MAC block: 4, 4, 5 frames */
+		fn = (fn + ((i % 3) == 2 ? 5 : 4)) % GSM_TDMA_HYPERFRAME;
+	}
+	elapsed = now_ns() - start;
+	writes = rate_ctr_group_get_ctr(bts->ctrs, BTS_CTR_PCU_TX_WRITES)->current - writes;
+
+	OSMO_ASSERT(num == sent);
+
+	printf("%s primitives, %u PDCH, %u MAC blocks:\n",
+	       cfg.batch ? "Batches of compact" : cfg.compact ? "Compact" : "Full",
+	       cfg.num_pdch, cfg.blocks);
+	printf("  %u primitives in %.3f s: %.0f primitives/s\n",
+	       num, elapsed / 1e9, num / (elapsed / 1e9));
+	printf("  %" PRIu64 " bytes on the socket: %.1f bytes/primitive, %.1f MB/s\n",
+	       bytes, (double) bytes / num, bytes / (elapsed / 1e3));
+	printf("  %" PRIu64 " writes: %.1f primitives/write\n",
+	       writes, (double) num / writes);
+
+	pcu_standin_close(&pcu);
+	bts_pump();
+	pcu_sock_exit();
+	unlink(PCU_SOCK_PATH);
+
+	return 0;
+}
@@ -0,0 +1,273 @@
+/* Round-trip latency of the PCU interface, with a stand-in PCU in a child
+ * process.
+ *
+ * The BTS sends an RTS_REQ for a PDCH, the stand-in PCU answers it with a
+ * DATA_REQ for the same block, which the BTS passes down to the PHY.  The
+ * time from pcu_tx_rts_req() until the PH-DATA.req reaches the PHY is the
+ * part of the RTS advance spent on the PCU interface.  Its median, 99th
+ * percentile and maximum are reported, over the unix socket, or over the
+ * shared memory rings after the PCU asked for them (--shm).  This is not
+ * part of the testsuite, run it manually:
+ *
+ *   ./pcu_sock_rtt --count 100000
+ *   ./pcu_sock_rtt --count 100000 --shm
+ */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <sys/wait.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/bts_sm.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/l1sap.h>
+#include <osmo-bts/pcu_if.h>
+#include <osmo-bts/gsm_data.h>
+
+#include "pcu_standin.h"
+
+#define PCU_SOCK_PATH		"pcu_sock_rtt.sock"
+#define RTT_COUNT_DEFAULT	10000
+#define RTT_WARMUP		100
+
+static struct {
+	unsigned int count;
+	bool compact;
+	bool shm;
+} cfg = {
+	.count = RTT_COUNT_DEFAULT,
+};
+
+static struct gsm_bts *bts;
+static bool pdch_req_rcvd;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void print_help(const char *prog)
+{
+	printf("Usage: %s [OPTIONS]\n"
+	       "  -h --help            This text\n"
+	       "  -n --count NUM       Number of round trips (default %u)\n"
+	       "  -c --compact         Ask for compact primitives\n"
+	       "  -s --shm             Ask for the shared memory rings\n",
+	       prog, RTT_COUNT_DEFAULT);
+}
+
+static void handle_options(int argc, char **argv)
+{
+	while (1) {
+		int option_idx = 0, c;
+		static const struct option long_options[] = {
+			{ "help", 0, 0, 'h' },
+			{ "count", 1, 0, 'n' },
+			{ "compact", 0, 0, 'c' },
+			{ "shm", 0, 0, 's' },
+			{ 0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "hn:cs",
+				long_options, &option_idx);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			print_help(argv[0]);
+			exit(0);
+		case 'n':
+			cfg.count = atoi(optarg);
+			break;
+		case 'c':
+			cfg.compact = true;
+			break;
+		case 's':
+			cfg.shm = true;
+			break;
+		default:
+			print_help(argv[0]);
+			exit(2);
+		}
+	}
+
+	if (cfg.count < 1) {
+		fprintf(stderr, "Invalid arguments\n");
+		exit(2);
+	}
+}
+
+/* The PHY: the PDTCH block answering the RTS_REQ arrived */
+int bts_model_l1sap_down(struct gsm_bts_trx *trx, struct osmo_phsap_prim *l1sap)
+{
+	if (OSMO_PRIM_HDR(&l1sap->oph) == OSMO_PRIM(PRIM_PH_DATA, PRIM_OP_REQUEST))
+		pdch_req_rcvd = true;
+
+	if (l1sap->oph.msg)
+		msgb_free(l1sap->oph.msg);
+	return 0;
+}
+
+/* Stand-in PCU: answer each RTS_REQ with a DATA_REQ, until the BTS closes
+ * the connection */
+static void pcu_child(uint8_t bts_nr)
+{
+	struct pcu_standin pcu;
+	uint8_t buf[PCU_IF_BATCH_MAX_LEN];
+	const struct gsm_pcu_if *pcu_prim = (const struct gsm_pcu_if *) buf;
+	const struct gsm_pcu_if_rts_req *rts_req = &pcu_prim->u.rts_req;
+	struct gsm_pcu_if data_req;
+	size_t len;
+	int rc;
+
+	if (pcu_standin_connect(&pcu, PCU_SOCK_PATH) != 0)
+		exit(1);
+
+	if (cfg.compact)
+		pcu_standin_send_txt(&pcu, bts_nr, PCU_COMPACT_MODE);
+	if (cfg.shm)
+		pcu_standin_send_txt(&pcu, bts_nr, PCU_SHM_MODE);
+
+	/* full size unless the BTS accepts compact primitives */
+	len = cfg.compact ? PCUIF_HDR_SIZE + sizeof(data_req.u.data_req) : sizeof(data_req);
+
+	while ((rc = pcu_standin_recv(&pcu, buf, sizeof(buf), true)) > 0) {
+		if (pcu_prim->msg_type != PCU_IF_MSG_RTS_REQ)
+			continue;
+
+		memset(&data_req, 0, sizeof(data_req));
+		data_req.msg_type = PCU_IF_MSG_DATA_REQ;
+		data_req.bts_nr = pcu_prim->bts_nr;
+		data_req.u.data_req.sapi = PCU_IF_SAPI_PDTCH;
+		data_req.u.data_req.len = GSM_MACBLOCK_LEN;
+		memset(data_req.u.data_req.data, 0x2b, GSM_MACBLOCK_LEN);
+		data_req.u.data_req.fn = rts_req->fn;
+		data_req.u.data_req.arfcn = rts_req->arfcn;
+		data_req.u.data_req.trx_nr = rts_req->trx_nr;
+		data_req.u.data_req.ts_nr = rts_req->ts_nr;
+		data_req.u.data_req.block_nr = rts_req->block_nr;
+
+		if (pcu_standin_send(&pcu, &data_req, len) != 0)
+			break;
+	}
+
+	pcu_standin_close(&pcu);
+	exit(rc < 0 ? 1 : 0);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	const uint64_t *x = a, *y = b;
+
+	return (*x > *y) - (*x < *y);
+}
+
+int main(int argc, char **argv)
+{
+	struct gsm_bts_trx_ts *ts;
+	uint64_t *rtt, start;
+	uint32_t fn = 0;
+	unsigned int i;
+	pid_t pid;
+
+	handle_options(argc, argv);
+
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+	log_set_log_level(osmo_stderr_target, LOGL_FATAL);
+
+	g_bts_sm = gsm_bts_sm_alloc(tall_bts_ctx);
+	if (!g_bts_sm) {
+		fprintf(stderr, "Failed to create BTS Site Manager structure\n");
+		exit(1);
+	}
+	bts = gsm_bts_alloc(g_bts_sm, 0);
+	if (bts_init(bts) < 0) {
+		fprintf(stderr, "unable to open bts\n");
+		exit(1);
+	}
+
+	/* an active PDCH, for the BTS to accept the DATA_REQ */
+	ts = &bts->c0->ts[7];
+	ts->pchan = GSM_PCHAN_PDCH;
+	ts->lchan[0].state = LCHAN_S_ACTIVE;
+
+	rtt = talloc_array(tall_bts_ctx, uint64_t, cfg.count);
+	OSMO_ASSERT(rtt != NULL);
+
+	unlink(PCU_SOCK_PATH);
+	OSMO_ASSERT(pcu_sock_init(PCU_SOCK_PATH, 100) == 0);
+
+	fflush(stdout);
+	pid = fork();
+	OSMO_ASSERT(pid >= 0);
+	if (pid == 0)
+		pcu_child(bts->nr);
+
+	/* the first round trips are not counted: they may still take the
+	 * socket, before the BTS handed the rings over */
+	for (i = 0; i < RTT_WARMUP + cfg.count; i++) {
+		pdch_req_rcvd = false;
+		start = now_ns();
+		OSMO_ASSERT(pcu_tx_rts_req(ts, 0, fn, 871, i % 12) == 0);
+		while (!pdch_req_rcvd)
+			osmo_select_main(0);
+		if (i >= RTT_WARMUP)
+			rtt[i - RTT_WARMUP] = now_ns() - start;
+
+		/* next MAC block: 4, 4, 5 frames */
+		fn = (fn + ((i % 3) == 2 ? 5 : 4)) % GSM_TDMA_HYPERFRAME;
+	}
+
+	qsort(rtt, cfg.count, sizeof(*rtt), cmp_u64);
+
+	printf("%s primitives over the %s, %u round trips (RTS_REQ to PH-DATA.req):\n",
+	       cfg.compact ? "Compact" : "Full", cfg.shm ? "shared memory rings" : "socket",
+	       cfg.count);
+	printf("  p50 %.1f us, p99 %.1f us, max %.1f us\n",
+	       rtt[cfg.count / 2] / 1e3, rtt[(uint64_t) cfg.count * 99 / 100] / 1e3,
+	       rtt[cfg.count - 1] / 1e3);
+
+	/* the stand-in PCU exits when the BTS closes the connection */
+	pcu_sock_exit();
+	waitpid(pid, NULL, 0);
+	unlink(PCU_SOCK_PATH);
+	talloc_free(rtt);
+
+	return 0;
+}
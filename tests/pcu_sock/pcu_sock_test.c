@@ -0,0 +1,411 @@
+/* Test the PCU socket with a stand-in PCU: the primitives of the BTS must
+ * carry the same content in the full and in the compact form (after the
+ * PCU asked for it with a TXT_IND in the compact form itself), in batches
+ * of primitives in both directions, and through the shared memory rings. */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/bts_sm.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/pcu_if.h>
+#include <osmo-bts/gsm_data.h>
+
+#include "pcu_standin.h"
+
+#define ASSERT_TRUE(rc) \
+	if (!(rc)) { \
+		printf("Assert failed in %s:%d.\n",  \
+		       __FILE__, __LINE__);          \
+		abort();			     \
+	}
+
+#define PCU_SOCK_PATH	"pcu_sock_test.sock"
+
+static struct gsm_bts *bts;
+static struct pcu_standin pcu;
+
+/* Let the BTS accept, read and write until there is nothing left to do */
+static void bts_pump(void)
+{
+	while (osmo_select_main(1) > 0)
+		;
+}
+
+/* Stand-in PCU: receive the next primitive of the BTS */
+static int pcu_recv(struct gsm_pcu_if *pcu_prim)
+{
+	int rc;
+
+	bts_pump();
+
+	memset(pcu_prim, 0, sizeof(*pcu_prim));
+	rc = pcu_standin_recv(&pcu, pcu_prim, sizeof(*pcu_prim), false);
+	ASSERT_TRUE(rc > 0 && rc >= PCUIF_HDR_SIZE);
+
+	return rc;
+}
+
+static void pcu_connect(void)
+{
+	struct gsm_pcu_if pcu_prim;
+	int rc;
+
+	ASSERT_TRUE(pcu_standin_connect(&pcu, PCU_SOCK_PATH) == 0);
+
+	/* the BTS sends an INFO_IND on accept */
+	rc = pcu_recv(&pcu_prim);
+	ASSERT_TRUE(rc == sizeof(pcu_prim));
+	ASSERT_TRUE(pcu_prim.msg_type == PCU_IF_MSG_INFO_IND);
+	ASSERT_TRUE(pcu_prim.u.info_ind.version == PCU_IF_VERSION);
+	printf("Stand-in PCU connected, BTS supports compact primitives: %s\n",
+	       pcu_prim.u.info_ind.flags & PCU_IF_FLAG_COMPACT ? "yes" : "no");
+}
+
+/* Ask for compact primitives, with a TXT_IND in the compact form */
+static void pcu_req_compact(void)
+{
+	ASSERT_TRUE(pcu_standin_send_txt(&pcu, bts->nr, PCU_COMPACT_MODE) == 0);
+	bts_pump();
+}
+
+static uint64_t ctr_get(unsigned int idx)
+{
+	return rate_ctr_group_get_ctr(bts->ctrs, idx)->current;
+}
+
+/* Append a primitive of len bytes to a batch */
+static void batch_add(struct gsm_pcu_if *batch_prim, const struct gsm_pcu_if *pcu_prim, size_t len)
+{
+	struct gsm_pcu_if_batch *batch = &batch_prim->u.batch;
+	struct gsm_pcu_if_batch_entry *entry = (void *) &batch->data[batch->length];
+
+	entry->length = len;
+	memcpy(entry->prim, pcu_prim, len);
+	batch->num++;
+	batch->length += sizeof(*entry) + len;
+}
+
+/* Ask for batches, with a batch of two TXT_IND */
+static void pcu_req_batch(void)
+{
+	uint8_t buf[PCU_IF_BATCH_MAX_LEN] = { 0 };
+	struct gsm_pcu_if *batch_prim = (struct gsm_pcu_if *) buf;
+	struct gsm_pcu_if txt = {
+		.msg_type = PCU_IF_MSG_TXT_IND,
+		.bts_nr = bts->nr,
+	};
+	uint64_t rx_prims = ctr_get(BTS_CTR_PCU_RX_PRIMS);
+	uint64_t rx_reads = ctr_get(BTS_CTR_PCU_RX_READS);
+	size_t len;
+
+	batch_prim->msg_type = PCU_IF_MSG_BATCH;
+	batch_prim->bts_nr = bts->nr;
+	txt.u.txt_ind.type = PCU_COMPACT_MODE;
+	batch_add(batch_prim, &txt, PCUIF_HDR_SIZE + 1 + 1);
+	txt.u.txt_ind.type = PCU_BATCH_MODE;
+	batch_add(batch_prim, &txt, PCUIF_HDR_SIZE + 1 + 1);
+
+	len = PCUIF_HDR_SIZE + sizeof(batch_prim->u.batch) + batch_prim->u.batch.length;
+	ASSERT_TRUE(pcu_standin_send(&pcu, buf, len) == 0);
+	bts_pump();
+
+	ASSERT_TRUE(ctr_get(BTS_CTR_PCU_RX_PRIMS) - rx_prims == 2);
+	ASSERT_TRUE(ctr_get(BTS_CTR_PCU_RX_READS) - rx_reads == 1);
+}
+
+/* Receive a batch and print its primitives */
+static void pcu_recv_batch(void)
+{
+	uint8_t buf[PCU_IF_BATCH_MAX_LEN];
+	const struct gsm_pcu_if *batch_prim = (const struct gsm_pcu_if *) buf;
+	const struct gsm_pcu_if_batch_entry *entry;
+	unsigned int i, offs = 0;
+	int rc;
+
+	rc = pcu_standin_recv(&pcu, buf, sizeof(buf), false);
+	ASSERT_TRUE(rc > 0 && rc >= PCUIF_HDR_SIZE + sizeof(batch_prim->u.batch));
+	ASSERT_TRUE(batch_prim->msg_type == PCU_IF_MSG_BATCH);
+	ASSERT_TRUE(rc == PCUIF_HDR_SIZE + sizeof(batch_prim->u.batch) + batch_prim->u.batch.length);
+
+	printf("  batch of %u primitives, %d bytes:", batch_prim->u.batch.num, rc);
+	for (i = 0; i < batch_prim->u.batch.num; i++) {
+		const struct gsm_pcu_if *pcu_prim;
+
+		entry = (const struct gsm_pcu_if_batch_entry *) &batch_prim->u.batch.data[offs];
+		pcu_prim = (const struct gsm_pcu_if *) entry->prim;
+		printf(" %02x(%u)", pcu_prim->msg_type, entry->length);
+		offs += sizeof(*entry) + entry->length;
+	}
+	printf("\n");
+	ASSERT_TRUE(offs == batch_prim->u.batch.length);
+}
+
+static void test_batch(void)
+{
+	uint8_t data[GSM_MACBLOCK_LEN];
+	uint8_t buf[PCU_IF_BATCH_MAX_LEN];
+	struct gsm_pcu_if *pcu_prim;
+	uint64_t tx_prims, tx_writes;
+	struct msgb *msg;
+	unsigned int tn;
+	int rc;
+
+	memset(data, 0x2b, sizeof(data));
+
+	pcu_req_batch();
+	printf("Batches of primitives:\n");
+
+	/* a MAC block on four PDCH: one batch */
+	tx_prims = ctr_get(BTS_CTR_PCU_TX_PRIMS);
+	tx_writes = ctr_get(BTS_CTR_PCU_TX_WRITES);
+	ASSERT_TRUE(pcu_tx_time_ind(4) == 0);
+	for (tn = 4; tn < 8; tn++) {
+		struct gsm_bts_trx_ts *ts = &bts->c0->ts[tn];
+
+		ASSERT_TRUE(pcu_tx_rts_req(ts, 0, 4, 871, 1) == 0);
+		ASSERT_TRUE(pcu_tx_data_ind(ts, PCU_IF_SAPI_PDTCH, 4, 871, 1, data, sizeof(data),
+					    -60, 10, 3, 100) == 0);
+	}
+	bts_pump();
+	pcu_recv_batch();
+	ASSERT_TRUE(ctr_get(BTS_CTR_PCU_TX_PRIMS) - tx_prims == 9);
+	ASSERT_TRUE(ctr_get(BTS_CTR_PCU_TX_WRITES) - tx_writes == 1);
+
+	/* each TIME_IND starts a new batch */
+	ASSERT_TRUE(pcu_tx_time_ind(8) == 0);
+	ASSERT_TRUE(pcu_tx_rts_req(&bts->c0->ts[7], 0, 8, 871, 2) == 0);
+	ASSERT_TRUE(pcu_tx_time_ind(13) == 0);
+	ASSERT_TRUE(pcu_tx_rts_req(&bts->c0->ts[7], 0, 13, 871, 3) == 0);
+	bts_pump();
+	pcu_recv_batch();
+	pcu_recv_batch();
+
+	printf("  %" PRIu64 " primitives in %" PRIu64 " writes to the PCU\n",
+	       ctr_get(BTS_CTR_PCU_TX_PRIMS) - tx_prims, ctr_get(BTS_CTR_PCU_TX_WRITES) - tx_writes);
+
+	/* a primitive too large for a batch is sent on its own, in order */
+	ASSERT_TRUE(pcu_tx_time_ind(17) == 0);
+	msg = msgb_alloc(PCU_IF_BATCH_MAX_LEN, "pcu_sock_test");
+	ASSERT_TRUE(msg != NULL);
+	pcu_prim = (struct gsm_pcu_if *) msgb_put(msg, PCU_IF_BATCH_MAX_LEN - PCUIF_HDR_SIZE);
+	memset(pcu_prim, 0, msgb_length(msg));
+	pcu_prim->msg_type = PCU_IF_MSG_DATA_IND;
+	pcu_prim->bts_nr = bts->nr;
+	ASSERT_TRUE(pcu_sock_send(msg) == 0);
+	ASSERT_TRUE(pcu_tx_rts_req(&bts->c0->ts[7], 0, 17, 871, 4) == 0);
+	bts_pump();
+	pcu_recv_batch();
+	rc = pcu_standin_recv(&pcu, buf, sizeof(buf), false);
+	ASSERT_TRUE(rc == PCU_IF_BATCH_MAX_LEN - PCUIF_HDR_SIZE);
+	printf("  %02x on its own, %d bytes\n", buf[0], rc);
+	pcu_recv_batch();
+
+	/* flushed by the frame tick: written right away, later primitives
+	 * go into a new batch */
+	tx_writes = ctr_get(BTS_CTR_PCU_TX_WRITES);
+	ASSERT_TRUE(pcu_tx_time_ind(21) == 0);
+	ASSERT_TRUE(pcu_tx_rts_req(&bts->c0->ts[7], 0, 21, 871, 5) == 0);
+	pcu_sock_flush();
+	ASSERT_TRUE(pcu_tx_rts_req(&bts->c0->ts[6], 0, 21, 871, 5) == 0);
+	pcu_sock_flush();
+	printf("  %" PRIu64 " writes by pcu_sock_flush()\n",
+	       ctr_get(BTS_CTR_PCU_TX_WRITES) - tx_writes);
+	pcu_recv_batch();
+	pcu_recv_batch();
+}
+
+static void print_len(const char *name, int len)
+{
+	if (len == sizeof(struct gsm_pcu_if))
+		printf("  %-13s sizeof(struct gsm_pcu_if)\n", name);
+	else
+		printf("  %-13s %d bytes\n", name, len);
+}
+
+static void test_prims(void)
+{
+	static const uint8_t lv[] = { 0x05, 0xf4, 0x01, 0x02, 0x03, 0x04 };
+	static const uint8_t app_data[] = { 0xde, 0xad };
+	struct gsm_bts_trx_ts *ts = &bts->c0->ts[7];
+	uint8_t data[GSM_MACBLOCK_LEN];
+	struct gsm_pcu_if pcu_prim;
+	int len;
+
+	memset(data, 0x2b, sizeof(data));
+
+	ASSERT_TRUE(pcu_tx_time_ind(4) == 0);
+	len = pcu_recv(&pcu_prim);
+	ASSERT_TRUE(pcu_prim.msg_type == PCU_IF_MSG_TIME_IND);
+	ASSERT_TRUE(pcu_prim.u.time_ind.fn == 4);
+	print_len("TIME_IND", len);
+
+	ASSERT_TRUE(pcu_tx_rts_req(ts, 0, 4, 871, 1) == 0);
+	len = pcu_recv(&pcu_prim);
+	ASSERT_TRUE(pcu_prim.msg_type == PCU_IF_MSG_RTS_REQ);
+	ASSERT_TRUE(pcu_prim.u.rts_req.sapi == PCU_IF_SAPI_PDTCH);
+	ASSERT_TRUE(pcu_prim.u.rts_req.fn == 4);
+	ASSERT_TRUE(pcu_prim.u.rts_req.arfcn == 871);
+	ASSERT_TRUE(pcu_prim.u.rts_req.ts_nr == 7);
+	ASSERT_TRUE(pcu_prim.u.rts_req.block_nr == 1);
+	print_len("RTS_REQ", len);
+
+	ASSERT_TRUE(pcu_tx_data_ind(ts, PCU_IF_SAPI_PDTCH, 8, 871, 2, data, sizeof(data),
+				    -60, 10, 3, 100) == 0);
+	len = pcu_recv(&pcu_prim);
+	ASSERT_TRUE(pcu_prim.msg_type == PCU_IF_MSG_DATA_IND);
+	ASSERT_TRUE(pcu_prim.u.data_ind.len == sizeof(data));
+	ASSERT_TRUE(memcmp(pcu_prim.u.data_ind.data, data, sizeof(data)) == 0);
+	ASSERT_TRUE(pcu_prim.u.data_ind.fn == 8);
+	ASSERT_TRUE(pcu_prim.u.data_ind.rssi == -60);
+	ASSERT_TRUE(pcu_prim.u.data_ind.lqual_cb == 100);
+	print_len("DATA_IND", len);
+
+	ASSERT_TRUE(pcu_tx_rach_ind(bts->nr, 0, 7, 2, 0x42, 12, 0,
+				    GSM_L1_BURST_TYPE_ACCESS_0, PCU_IF_SAPI_PRACH) == 0);
+	len = pcu_recv(&pcu_prim);
+	ASSERT_TRUE(pcu_prim.msg_type == PCU_IF_MSG_RACH_IND);
+	ASSERT_TRUE(pcu_prim.u.rach_ind.ra == 0x42);
+	ASSERT_TRUE(pcu_prim.u.rach_ind.fn == 12);
+	ASSERT_TRUE(pcu_prim.u.rach_ind.ts_nr == 7);
+	print_len("RACH_IND", len);
+
+	ASSERT_TRUE(pcu_tx_interf_ind(bts->c0, 104) == 0);
+	len = pcu_recv(&pcu_prim);
+	ASSERT_TRUE(pcu_prim.msg_type == PCU_IF_MSG_INTERF_IND);
+	ASSERT_TRUE(pcu_prim.u.interf_ind.fn == 104);
+	print_len("INTERF_IND", len);
+
+	ASSERT_TRUE(pcu_tx_data_cnf(0x12345678, PCU_IF_SAPI_AGCH_2) == 0);
+	len = pcu_recv(&pcu_prim);
+	ASSERT_TRUE(pcu_prim.msg_type == PCU_IF_MSG_DATA_CNF_2);
+	ASSERT_TRUE(pcu_prim.u.data_cnf2.msg_id == 0x12345678);
+	print_len("DATA_CNF_2", len);
+
+	ASSERT_TRUE(pcu_tx_pag_req(lv, 0) == 0);
+	len = pcu_recv(&pcu_prim);
+	ASSERT_TRUE(pcu_prim.msg_type == PCU_IF_MSG_PAG_REQ);
+	ASSERT_TRUE(memcmp(pcu_prim.u.pag_req.identity_lv, lv, sizeof(lv)) == 0);
+	print_len("PAG_REQ", len);
+
+	ASSERT_TRUE(pcu_tx_app_info_req(bts, 0, sizeof(app_data), app_data) == 0);
+	len = pcu_recv(&pcu_prim);
+	ASSERT_TRUE(pcu_prim.msg_type == PCU_IF_MSG_APP_INFO_REQ);
+	ASSERT_TRUE(pcu_prim.u.app_info_req.len == sizeof(app_data));
+	ASSERT_TRUE(memcmp(pcu_prim.u.app_info_req.data, app_data, sizeof(app_data)) == 0);
+	print_len("APP_INFO_REQ", len);
+}
+
+static void test_shm(void)
+{
+	uint64_t rx_prims, rx_reads, tx_writes;
+	struct gsm_pcu_if pcu_prim;
+	int len;
+
+	printf("Shared memory rings:\n");
+
+	/* the BTS answers on the socket, with the rings */
+	ASSERT_TRUE(pcu_standin_send_txt(&pcu, bts->nr, PCU_SHM_MODE) == 0);
+	len = pcu_recv(&pcu_prim);
+	ASSERT_TRUE(pcu_prim.msg_type == PCU_IF_MSG_TXT_IND);
+	ASSERT_TRUE(pcu_prim.u.txt_ind.type == PCU_SHM_MODE);
+	ASSERT_TRUE(pcu.shm != NULL);
+	printf("  TXT_IND (PCU_SHM_MODE) with the rings, %d bytes\n", len);
+
+	/* no batches and no writes: each primitive is a record of the ring */
+	tx_writes = ctr_get(BTS_CTR_PCU_TX_WRITES);
+	ASSERT_TRUE(pcu_tx_time_ind(17) == 0);
+	ASSERT_TRUE(pcu_tx_rts_req(&bts->c0->ts[7], 0, 17, 871, 4) == 0);
+	len = pcu_recv(&pcu_prim);
+	ASSERT_TRUE(pcu_prim.msg_type == PCU_IF_MSG_TIME_IND);
+	ASSERT_TRUE(pcu_prim.u.time_ind.fn == 17);
+	print_len("TIME_IND", len);
+	len = pcu_recv(&pcu_prim);
+	ASSERT_TRUE(pcu_prim.msg_type == PCU_IF_MSG_RTS_REQ);
+	ASSERT_TRUE(pcu_prim.u.rts_req.block_nr == 4);
+	print_len("RTS_REQ", len);
+	ASSERT_TRUE(ctr_get(BTS_CTR_PCU_TX_WRITES) == tx_writes);
+
+	/* the PCU sends through the ring as well */
+	rx_prims = ctr_get(BTS_CTR_PCU_RX_PRIMS);
+	rx_reads = ctr_get(BTS_CTR_PCU_RX_READS);
+	ASSERT_TRUE(pcu_standin_send_txt(&pcu, bts->nr, PCU_COMPACT_MODE) == 0);
+	bts_pump();
+	ASSERT_TRUE(ctr_get(BTS_CTR_PCU_RX_PRIMS) - rx_prims == 1);
+	ASSERT_TRUE(ctr_get(BTS_CTR_PCU_RX_READS) == rx_reads);
+	printf("  TXT_IND received by the BTS through the ring\n");
+}
+
+int main(int argc, char **argv)
+{
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+
+	g_bts_sm = gsm_bts_sm_alloc(tall_bts_ctx);
+	if (!g_bts_sm) {
+		fprintf(stderr, "Failed to create BTS Site Manager structure\n");
+		exit(1);
+	}
+	bts = gsm_bts_alloc(g_bts_sm, 0);
+	if (bts_init(bts) < 0) {
+		fprintf(stderr, "unable to open bts\n");
+		exit(1);
+	}
+
+	ASSERT_TRUE(pcu_sock_init(PCU_SOCK_PATH, 100) == 0);
+	pcu_connect();
+
+	printf("Full primitives:\n");
+	test_prims();
+
+	pcu_req_compact();
+	printf("Compact primitives:\n");
+	test_prims();
+
+	test_batch();
+
+	test_shm();
+
+	pcu_standin_close(&pcu);
+	bts_pump();
+	ASSERT_TRUE(!pcu_connected());
+
+	pcu_sock_exit();
+	unlink(PCU_SOCK_PATH);
+
+	printf("Success\n");
+
+	return 0;
+}
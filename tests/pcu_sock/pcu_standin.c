@@ -0,0 +1,145 @@
+/* A stand-in for osmo-pcu, for the PCU socket tests and benchmarks */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* This is what a PCU has to do for using the shared memory rings:
+ *
+ *  - ask for them with a TXT_IND of type PCU_SHM_MODE;
+ *  - receive every datagram on the socket with recvmsg(), the TXT_IND
+ *    answering the request carries the file descriptors of the rings;
+ *  - from then on, read the ring first, and wait on both the socket
+ *    and the eventfd of the ring. */
+
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/pcu_if.h>
+#include <osmo-bts/shm_ring.h>
+
+#include "pcu_standin.h"
+
+/*! Connect to the PCU socket of the BTS.
+ *  \returns 0 on success; negative errno on error. */
+int pcu_standin_connect(struct pcu_standin *pcu, const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+	pcu->shm = NULL;
+	pcu->fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if (pcu->fd < 0)
+		return -errno;
+
+	osmo_strlcpy(addr.sun_path, path, sizeof(addr.sun_path));
+	if (connect(pcu->fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+		int rc = -errno;
+		close(pcu->fd);
+		pcu->fd = -1;
+		return rc;
+	}
+
+	return 0;
+}
+
+/*! Disconnect from the BTS, detach from the rings. */
+void pcu_standin_close(struct pcu_standin *pcu)
+{
+	shm_link_free(pcu->shm);
+	pcu->shm = NULL;
+	if (pcu->fd >= 0)
+		close(pcu->fd);
+	pcu->fd = -1;
+}
+
+/*! Send a TXT_IND without text (in the compact form), e.g. PCU_SHM_MODE. */
+int pcu_standin_send_txt(struct pcu_standin *pcu, uint8_t bts_nr, enum gsm_pcu_if_text_type type)
+{
+	struct gsm_pcu_if pcu_prim = {
+		.msg_type = PCU_IF_MSG_TXT_IND,
+		.bts_nr = bts_nr,
+		.u.txt_ind.type = type,
+	};
+
+	return pcu_standin_send(pcu, &pcu_prim, PCUIF_HDR_SIZE + 1 + 1);
+}
+
+/*! Send a primitive (or batch) to the BTS, through the ring if attached.
+ *  \returns 0 on success; negative errno on error. */
+int pcu_standin_send(struct pcu_standin *pcu, const void *buf, size_t len)
+{
+	if (pcu->shm != NULL)
+		return shm_link_push(pcu->shm, buf, len);
+
+	if (send(pcu->fd, buf, len, 0) != len)
+		return -errno;
+	return 0;
+}
+
+/* Read the next datagram from the socket, attach to the rings it carries */
+static int pcu_standin_recv_sock(struct pcu_standin *pcu, void *buf, size_t buf_len)
+{
+	struct shm_link *shm;
+	int rc;
+
+	rc = shm_link_recv_msg(NULL, pcu->fd, buf, buf_len, &shm, MSG_DONTWAIT);
+	if (shm != NULL) {
+		shm_link_free(pcu->shm);
+		pcu->shm = shm;
+	}
+
+	return rc;
+}
+
+/*! Receive the next primitive (or batch) from the BTS.
+ *  \param[in] wait block until there is one.
+ *  \returns its length; 0 if the BTS closed the connection; -EAGAIN if
+ *  there is none (and wait is false); other negative errno on error. */
+int pcu_standin_recv(struct pcu_standin *pcu, void *buf, size_t buf_len, bool wait)
+{
+	struct pollfd pfd[2];
+	int rc;
+
+	while (1) {
+		/* the BTS only writes to the socket before the handover */
+		if (pcu->shm != NULL) {
+			rc = shm_link_pop(pcu->shm, buf, buf_len);
+			if (rc != -EAGAIN)
+				return rc;
+		}
+
+		rc = pcu_standin_recv_sock(pcu, buf, buf_len);
+		if (rc != -EAGAIN || !wait)
+			return rc;
+
+		/* the ring asked for a wakeup when it found nothing */
+		pfd[0] = (struct pollfd) { .fd = pcu->fd, .events = POLLIN };
+		pfd[1] = (struct pollfd) { .fd = pcu->shm ? pcu->shm->efd_rx : -1, .events = POLLIN };
+		if (poll(pfd, ARRAY_SIZE(pfd), -1) < 0)
+			return -errno;
+		if (pcu->shm != NULL && (pfd[1].revents & POLLIN))
+			shm_link_rx_ack(pcu->shm);
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+/* A stand-in for osmo-pcu: the PCU side of the PCU socket and, once the
+ * BTS handed them over, of the shared memory rings (see PCU_SHM_MODE). */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <osmo-bts/pcuif_proto.h>
+
+struct shm_link;
+
+struct pcu_standin {
+	/*! connection to the PCU socket of the BTS */
+	int fd;
+	/*! rings handed over by the BTS, or NULL */
+	struct shm_link *shm;
+};
+
+int pcu_standin_connect(struct pcu_standin *pcu, const char *path);
+void pcu_standin_close(struct pcu_standin *pcu);
+
+int pcu_standin_send_txt(struct pcu_standin *pcu, uint8_t bts_nr, enum gsm_pcu_if_text_type type);
+int pcu_standin_send(struct pcu_standin *pcu, const void *buf, size_t len);
+int pcu_standin_recv(struct pcu_standin *pcu, void *buf, size_t buf_len, bool wait);
@@ -0,0 +1,191 @@
+/* Memory footprint of the lchans of a BTS with 8 TRX.
+ *
+ * Reports sizeof(struct gsm_lchan), what it was when each lchan carried
+ * its own matrix of SACCH filling buffers, and the resident set size
+ * (VmRSS) of the process before and after allocating the TRX and letting
+ * all lchans reference the SACCH filling of the BTS, as on activation.
+ * With --vamos, the shadow timeslots of all TRX are allocated as well.
+ * Only the current layout is measured: the figures with a matrix per lchan
+ * are computed from the structure layout.
+ * This is not part of the testsuite, run it manually:
+ *
+ *   ./sacch_si_mem --vamos
+ */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/sysinfo.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/bts_sm.h>
+#include <osmo-bts/bts_trx.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/gsm_data.h>
+
+#define NUM_TRX		8
+
+/* The SI types sent on the SACCH */
+static const uint8_t sacch_si[] = {
+	SYSINFO_TYPE_5,
+	SYSINFO_TYPE_5bis,
+	SYSINFO_TYPE_5ter,
+	SYSINFO_TYPE_6,
+};
+
+static bool vamos;
+
+/* Resident set size of this process in kB, from /proc/self/status */
+static long vm_rss_kb(void)
+{
+	char line[128];
+	long kb = -1;
+	FILE *f;
+
+	f = fopen("/proc/self/status", "r");
+	if (f == NULL)
+		return -1;
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (sscanf(line, "VmRSS: %ld kB", &kb) == 1)
+			break;
+	}
+	fclose(f);
+
+	return kb;
+}
+
+static void print_help(void)
+{
+	printf("Usage: sacch_si_mem [options]\n"
+	       "  -v --vamos         Allocate the shadow timeslots of all TRX\n");
+}
+
+static void handle_options(int argc, char **argv)
+{
+	while (1) {
+		int option_index = 0, c;
+		static const struct option long_options[] = {
+			{ "help", 0, 0, 'h' },
+			{ "vamos", 0, 0, 'v' },
+			{ 0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "hv", long_options, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			print_help();
+			exit(0);
+		case 'v':
+			vamos = true;
+			break;
+		default:
+			print_help();
+			exit(1);
+		}
+	}
+}
+
+/* Let the lchans of a timeslot reference the SACCH filling of the BTS */
+static unsigned int ts_sacch_si_set(struct gsm_bts_trx_ts *ts)
+{
+	struct gsm_bts *bts = ts->trx->bts;
+	unsigned int ln, i;
+
+	for (ln = 0; ln < ARRAY_SIZE(ts->lchan); ln++) {
+		for (i = 0; i < ARRAY_SIZE(sacch_si); i++)
+			lchan_sacch_si_set(&ts->lchan[ln], sacch_si[i], bts->sacch_si[sacch_si[i]]);
+	}
+
+	return ln;
+}
+
+int main(int argc, char **argv)
+{
+	const size_t matrix_size = sizeof(sysinfo_buf_t) * _MAX_SYSINFO_TYPE * SI2Q_MAX_NUM;
+	const size_t msg_size = sizeof(((struct gsm_lchan *)NULL)->si.msg);
+	struct gsm_bts_trx *trx;
+	struct gsm_bts *bts;
+	unsigned int num_lchan = 0, tn, i;
+	long rss_before, rss_after;
+
+	handle_options(argc, argv);
+
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+
+	g_bts_sm = gsm_bts_sm_alloc(tall_bts_ctx);
+	if (!g_bts_sm) {
+		fprintf(stderr, "Failed to create BTS Site Manager structure\n");
+		exit(1);
+	}
+	bts = gsm_bts_alloc(g_bts_sm, 0);
+	if (bts_init(bts) < 0) {
+		fprintf(stderr, "unable to open bts\n");
+		exit(1);
+	}
+
+	/* the SACCH filling of the BTS, as installed by RSL SACCH FILLING */
+	for (i = 0; i < ARRAY_SIZE(sacch_si); i++) {
+		struct gsm_sacch_si *si = sacch_si_alloc(bts);
+
+		memset(si->buf, GSM_MACBLOCK_PADDING, sizeof(si->buf));
+		bts->sacch_si[sacch_si[i]] = si;
+		bts->si_valid |= (1 << sacch_si[i]);
+	}
+
+	rss_before = vm_rss_kb();
+
+	for (i = 1; i < NUM_TRX; i++)
+		gsm_bts_trx_alloc(bts);
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		if (vamos)
+			gsm_bts_trx_init_shadow_ts(trx);
+		for (tn = 0; tn < ARRAY_SIZE(trx->ts); tn++) {
+			num_lchan += ts_sacch_si_set(&trx->ts[tn]);
+			if (trx->ts[tn].vamos.peer != NULL)
+				num_lchan += ts_sacch_si_set(trx->ts[tn].vamos.peer);
+		}
+	}
+
+	rss_after = vm_rss_kb();
+
+	printf("sizeof(struct gsm_lchan): %zu bytes (%zu bytes with a SACCH filling matrix per lchan)\n",
+	       sizeof(struct gsm_lchan), sizeof(struct gsm_lchan) - msg_size + matrix_size);
+	printf("%u TRX%s: %u lchans, %zu bytes of lchans (%zu bytes with a SACCH filling matrix per lchan)\n",
+	       NUM_TRX, vamos ? " with shadow timeslots" : "", num_lchan,
+	       num_lchan * sizeof(struct gsm_lchan),
+	       num_lchan * (sizeof(struct gsm_lchan) - msg_size + matrix_size));
+	printf("VmRSS: %ld kB before, %ld kB after allocating the TRX (+%ld kB)\n",
+	       rss_before, rss_after, rss_after - rss_before);
+
+	return 0;
+}
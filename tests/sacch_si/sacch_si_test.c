@@ -0,0 +1,150 @@
+/* Check the reference counting of the shared SACCH filling messages (see
+ * lchan_sacch_si_set()): lchans following the BTS share one message per SI
+ * type, an lchan specific override replaces only the reference of that
+ * lchan, and a message is freed with its last reference. */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/sysinfo.h>
+
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/lchan.h>
+
+#define ASSERT_TRUE(rc) \
+	if (!(rc)) { \
+		printf("Assert failed in %s:%d.\n",  \
+		       __FILE__, __LINE__);          \
+		abort();			     \
+	}
+
+#define NUM_LCHAN	4
+
+static void *ctx;
+static struct gsm_lchan lchan[NUM_LCHAN];
+
+static struct gsm_sacch_si *make_si(uint8_t fill)
+{
+	struct gsm_sacch_si *si = sacch_si_alloc(ctx);
+
+	memset(si->buf, fill, sizeof(si->buf));
+	return si;
+}
+
+static void test_shared(void)
+{
+	struct gsm_sacch_si *si5, *si6;
+	unsigned int i;
+
+	printf("Testing lchans sharing the SACCH filling of the BTS\n");
+
+	/* the BTS holds one reference of each */
+	si5 = make_si(0x05);
+	si6 = make_si(0x06);
+
+	for (i = 0; i < NUM_LCHAN; i++) {
+		lchan_sacch_si_set(&lchan[i], SYSINFO_TYPE_5, si5);
+		lchan_sacch_si_set(&lchan[i], SYSINFO_TYPE_6, si6);
+		ASSERT_TRUE(GSM_LCHAN_SI(&lchan[i], SYSINFO_TYPE_5) == si5->buf);
+		ASSERT_TRUE(lchan[i].si.valid == ((1 << SYSINFO_TYPE_5) | (1 << SYSINFO_TYPE_6)));
+	}
+	printf("SI5 refcnt=%u, SI6 refcnt=%u, %zu blocks\n",
+	       si5->refcnt, si6->refcnt, talloc_total_blocks(ctx));
+
+	/* setting the same message again must not change the count */
+	lchan_sacch_si_set(&lchan[0], SYSINFO_TYPE_5, si5);
+	ASSERT_TRUE(si5->refcnt == NUM_LCHAN + 1);
+
+	/* the BTS drops SI6: the lchans keep it until they follow */
+	sacch_si_put(si6);
+	ASSERT_TRUE(si6->refcnt == NUM_LCHAN);
+	for (i = 0; i < NUM_LCHAN; i++)
+		lchan_sacch_si_set(&lchan[i], SYSINFO_TYPE_6, NULL);
+	ASSERT_TRUE(lchan[0].si.valid == (1 << SYSINFO_TYPE_5));
+	printf("SI6 disabled: SI5 refcnt=%u, %zu blocks\n", si5->refcnt, talloc_total_blocks(ctx));
+
+	for (i = 0; i < NUM_LCHAN; i++)
+		lchan_sacch_si_clear(&lchan[i]);
+	sacch_si_put(si5);
+	ASSERT_TRUE(talloc_total_blocks(ctx) == 1);
+}
+
+static void test_override(void)
+{
+	struct gsm_sacch_si *si5, *si5_new, *own;
+	unsigned int i;
+
+	printf("Testing an lchan specific override\n");
+
+	si5 = make_si(0x05);
+	for (i = 0; i < NUM_LCHAN; i++)
+		lchan_sacch_si_set(&lchan[i], SYSINFO_TYPE_5, si5);
+
+	/* SACCH INFO MODIFY on lchan 1: it gets its own message */
+	own = make_si(0x55);
+	lchan_sacch_si_set(&lchan[1], SYSINFO_TYPE_5, own);
+	lchan[1].si.overridden |= (1 << SYSINFO_TYPE_5);
+	sacch_si_put(own);
+	printf("override: SI5 refcnt=%u, own refcnt=%u\n", si5->refcnt, own->refcnt);
+	ASSERT_TRUE(((uint8_t *)GSM_LCHAN_SI(&lchan[1], SYSINFO_TYPE_5))[0] == 0x55);
+	ASSERT_TRUE(((uint8_t *)GSM_LCHAN_SI(&lchan[0], SYSINFO_TYPE_5))[0] == 0x05);
+	ASSERT_TRUE(((uint8_t *)GSM_LCHAN_SI(&lchan[2], SYSINFO_TYPE_5))[0] == 0x05);
+
+	/* SACCH FILLING with a new SI5: the BTS replaces its message, the
+	 * lchans following the BTS move on, the overridden one does not */
+	si5_new = make_si(0x15);
+	sacch_si_put(si5);
+	for (i = 0; i < NUM_LCHAN; i++) {
+		if (i == 1)
+			continue;
+		lchan_sacch_si_set(&lchan[i], SYSINFO_TYPE_5, si5_new);
+	}
+	printf("new SI5: refcnt=%u, own refcnt=%u, %zu blocks\n",
+	       si5_new->refcnt, own->refcnt, talloc_total_blocks(ctx));
+	ASSERT_TRUE(((uint8_t *)GSM_LCHAN_SI(&lchan[1], SYSINFO_TYPE_5))[0] == 0x55);
+	ASSERT_TRUE(((uint8_t *)GSM_LCHAN_SI(&lchan[3], SYSINFO_TYPE_5))[0] == 0x15);
+
+	/* the override is released with the lchan */
+	lchan_sacch_si_clear(&lchan[1]);
+	ASSERT_TRUE(lchan[1].si.valid == 0 && lchan[1].si.overridden == 0);
+	printf("lchan 1 cleared: %zu blocks\n", talloc_total_blocks(ctx));
+
+	for (i = 0; i < NUM_LCHAN; i++)
+		lchan_sacch_si_clear(&lchan[i]);
+	sacch_si_put(si5_new);
+	ASSERT_TRUE(talloc_total_blocks(ctx) == 1);
+}
+
+int main(int argc, char **argv)
+{
+	ctx = talloc_named_const(NULL, 0, "sacch_si_test");
+
+	test_shared();
+	test_override();
+
+	printf("Success\n");
+
+	return 0;
+}
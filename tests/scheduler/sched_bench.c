@@ -0,0 +1,569 @@
+/* Free-running benchmark of the osmo-bts-trx L1 scheduler.
+ *
+ * The scheduler is normally clocked by the 4.615 ms frame timer (or by
+ * the clock indications of a transceiver), so its throughput cannot be
+ * measured on a live system.  This program runs it as fast as possible:
+ *
+ *  - each TDMA frame is scheduled by bts_sched_fn() (with the Downlink
+ *    scheduler workers, if requested), with stand-ins for trx_if.c and
+ *    l1_if.c (see sched_trx_stubs.c);
+ *  - a stand-in for the upper layers, triggered by the time indication,
+ *    fills the Downlink queues of the active logical channels (AMR speech,
+ *    L2 fill frames, CS-1 blocks), BCCH/CCCH take the regular L1SAP path
+ *    through the common code;
+ *  - a fake transceiver loops each Downlink burst back as an Uplink
+ *    burst of the same logical channel (or sends NOPE.ind), so that
+ *    the Uplink decoders have realistic work to do.
+ *
+ * The frame rate, the p50/p99/max processing time per frame and the share
+ * of each stage are reported.  This is not part of the testsuite, run it
+ * manually:
+ *
+ *   ./sched_bench --num-trx 4 --tchf 20 --sdcch8 4 --pdch 6 --cipher 3 --workers 2
+ *
+ * The cache behaviour can be compared with perf(1):
+ *
+ *   perf stat -e cache-references,cache-misses,L1-dcache-load-misses ./sched_bench ...
+ */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/bits.h>
+#include <osmocom/codec/codec.h>
+#include <osmocom/gsm/protocol/gsm_04_08.h>
+#include <osmocom/gsm/protocol/gsm_08_58.h>
+#include <osmocom/netif/amr.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/bts_sm.h>
+#include <osmo-bts/bts_trx.h>
+#include <osmo-bts/l1sap.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/phy_link.h>
+#include <osmo-bts/scheduler.h>
+#include <osmo-bts/scheduler_backend.h>
+
+#include "l1_if.h"
+#include "sched_trx_stubs.h"
+
+/* Default number of TDMA frames: 16 51-multiframes of 26-multiframes */
+#define BENCH_FRAMES_DEFAULT	(26 * 51 * 16)
+
+enum bench_stage {
+	BENCH_STAGE_L2,
+	BENCH_STAGE_DL,
+	BENCH_STAGE_UL,
+	_BENCH_STAGE_NUM
+};
+
+static const char *bench_stage_names[_BENCH_STAGE_NUM] = {
+	[BENCH_STAGE_L2]	= "L2 stand-in",
+	[BENCH_STAGE_DL]	= "bts_sched_fn()",
+	[BENCH_STAGE_UL]	= "Uplink bursts",
+};
+
+static struct {
+	unsigned int num_trx;
+	unsigned int frames;
+	unsigned int num_tchf;
+	unsigned int num_sdcch8;
+	unsigned int num_pdch;
+	unsigned int num_workers;
+	int cipher;		/* A5/x, 0 means no ciphering */
+	bool uplink;
+} cfg = {
+	.num_trx = 1,
+	.frames = BENCH_FRAMES_DEFAULT,
+	.num_tchf = ~0U,	/* all free timeslots, unless given */
+	.uplink = true,
+};
+
+/* The last Downlink bursts of each logical channel of a timeslot, looped
+ * back as Uplink bursts by the fake transceiver */
+struct bench_ts {
+	ubit_t dl[_TRX_CHAN_MAX][4][GSM_BURST_LEN];
+	uint8_t dl_valid[_TRX_CHAN_MAX];	/* bitmask of block IDs */
+};
+
+static struct gsm_bts *bts;
+static struct bench_ts *bench_ts;
+static uint64_t stage_ns[_BENCH_STAGE_NUM];
+static unsigned int num_bursts[_BENCH_STAGE_NUM];
+
+/* Primitives of the common part (BCCH/CCCH) go to the scheduler queues,
+ * like in osmo-bts-trx/l1_if.c */
+int bts_model_l1sap_down(struct gsm_bts_trx *trx, struct osmo_phsap_prim *l1sap)
+{
+	struct msgb *msg = l1sap->oph.msg;
+
+	switch (OSMO_PRIM_HDR(&l1sap->oph)) {
+	case OSMO_PRIM(PRIM_PH_DATA, PRIM_OP_REQUEST):
+		if (!msg)
+			break;
+		return trx_sched_ph_data_req(trx, l1sap);
+	case OSMO_PRIM(PRIM_TCH, PRIM_OP_REQUEST):
+		if (!msg)
+			break;
+		return trx_sched_tch_req(trx, l1sap);
+	default:
+		break;
+	}
+
+	if (msg)
+		msgb_free(msg);
+	return 0;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void set_cipher(struct gsm_lchan *lchan, uint8_t chan_nr)
+{
+	unsigned int i;
+
+	if (cfg.cipher == 0)
+		return;
+
+	lchan->encr.alg_id = RSL_ENC_ALG_A5(cfg.cipher);
+	lchan->encr.key_len = cfg.cipher == 4 ? 16 : 8;
+	for (i = 0; i < lchan->encr.key_len; i++)
+		lchan->encr.key[i] = rand();
+
+	OSMO_ASSERT(trx_sched_set_cipher(lchan, chan_nr, true) == 0);
+	OSMO_ASSERT(trx_sched_set_cipher(lchan, chan_nr, false) == 0);
+}
+
+static void setup_tchf(struct gsm_bts_trx_ts *ts)
+{
+	struct gsm_lchan *lchan = &ts->lchan[0];
+	const uint8_t chan_nr = RSL_CHAN_Bm_ACCHs | ts->nr;
+
+	lchan->type = GSM_LCHAN_TCH_F;
+	ts->pchan = GSM_PCHAN_TCH_F;
+	OSMO_ASSERT(trx_sched_set_pchan(ts, ts->pchan) == 0);
+	OSMO_ASSERT(trx_sched_set_lchan(lchan, chan_nr, LID_DEDIC, true) == 0);
+	OSMO_ASSERT(trx_sched_set_lchan(lchan, chan_nr, LID_SACCH, true) == 0);
+	/* AMR with a single mode: 12.2 kbit/s */
+	OSMO_ASSERT(trx_sched_set_mode(ts, chan_nr, RSL_CMOD_SPD_SPEECH,
+				       GSM48_CMODE_SPEECH_AMR, 1, AMR_12_2,
+				       0, 0, 0, 0, 0) == 0);
+	set_cipher(lchan, chan_nr);
+}
+
+static void setup_sdcch8(struct gsm_bts_trx_ts *ts)
+{
+	unsigned int ss;
+
+	ts->pchan = GSM_PCHAN_SDCCH8_SACCH8C;
+	OSMO_ASSERT(trx_sched_set_pchan(ts, ts->pchan) == 0);
+
+	for (ss = 0; ss < 8; ss++) {
+		struct gsm_lchan *lchan = &ts->lchan[ss];
+		const uint8_t chan_nr = RSL_CHAN_SDCCH8_ACCH + (ss << 3) + ts->nr;
+
+		lchan->type = GSM_LCHAN_SDCCH;
+		OSMO_ASSERT(trx_sched_set_lchan(lchan, chan_nr, LID_DEDIC, true) == 0);
+		OSMO_ASSERT(trx_sched_set_lchan(lchan, chan_nr, LID_SACCH, true) == 0);
+		set_cipher(lchan, chan_nr);
+	}
+}
+
+static void setup_pdch(struct gsm_bts_trx_ts *ts)
+{
+	struct gsm_lchan *lchan = &ts->lchan[0];
+	const uint8_t chan_nr = RSL_CHAN_OSMO_PDCH | ts->nr;
+
+	lchan->type = GSM_LCHAN_PDTCH;
+	ts->pchan = GSM_PCHAN_PDCH;
+	OSMO_ASSERT(trx_sched_set_pchan(ts, ts->pchan) == 0);
+	/* PDTCH and PTCCH */
+	OSMO_ASSERT(trx_sched_set_lchan(lchan, chan_nr, LID_DEDIC, true) == 0);
+	OSMO_ASSERT(trx_sched_set_lchan(lchan, chan_nr, LID_SACCH, true) == 0);
+}
+
+/* TS0 on C0 is BCCH+CCCH, the other timeslots get the configured channel
+ * mix in this order: TCH/F, SDCCH/8, PDCH; the rest stays idle (TCH/F) */
+static void setup_trx(void)
+{
+	unsigned int num_tchf = 0, num_sdcch8 = 0, num_pdch = 0;
+	struct gsm_bts_trx *trx;
+	unsigned int tn;
+
+	while (bts->num_trx < cfg.num_trx)
+		gsm_bts_trx_alloc(bts);
+
+	sched_trx_stub_setup_bts(bts);
+	((struct bts_trx_priv *) bts->model_priv)->sched_workers_num = cfg.num_workers;
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		trx_sched_init(trx);
+
+		for (tn = 0; tn < ARRAY_SIZE(trx->ts); tn++) {
+			struct gsm_bts_trx_ts *ts = &trx->ts[tn];
+
+			ts->tsc_set = 0;
+			ts->tsc = 0;
+
+			if (trx == bts->c0 && tn == 0) {
+				ts->pchan = GSM_PCHAN_CCCH;
+				OSMO_ASSERT(trx_sched_set_pchan(ts, ts->pchan) == 0);
+			} else if (num_tchf < cfg.num_tchf) {
+				setup_tchf(ts);
+				num_tchf++;
+			} else if (num_sdcch8 < cfg.num_sdcch8) {
+				setup_sdcch8(ts);
+				num_sdcch8++;
+			} else if (num_pdch < cfg.num_pdch) {
+				setup_pdch(ts);
+				num_pdch++;
+			} else {
+				ts->lchan[0].type = GSM_LCHAN_TCH_F;
+				ts->pchan = GSM_PCHAN_TCH_F;
+				OSMO_ASSERT(trx_sched_set_pchan(ts, ts->pchan) == 0);
+			}
+		}
+	}
+
+	OSMO_ASSERT(trx_sched_set_bcch_ccch(&bts->c0->ts[0].lchan[CCCH_LCHAN], true) == 0);
+
+	printf("Channel mix: %u TRX, BCCH+CCCH, %u TCH/F (AMR 12.2), %u SDCCH/8, "
+	       "%u PDCH (CS-1), %u idle TS; %u workers; ciphering: ",
+	       cfg.num_trx, num_tchf, num_sdcch8, num_pdch,
+	       cfg.num_trx * TRX_NR_TS - 1 - num_tchf - num_sdcch8 - num_pdch,
+	       cfg.num_workers);
+	if (cfg.cipher)
+		printf("A5/%d\n", cfg.cipher);
+	else
+		printf("off\n");
+	printf("Channel state: %zu bytes per logical channel (%zu bytes per timeslot), "
+	       "%zu bytes more per active logical channel\n",
+	       sizeof(struct l1sched_chan_state),
+	       sizeof(((struct l1sched_ts *)NULL)->chan_state),
+	       sizeof(struct l1sched_chan_act_state));
+}
+
+/* Stand-in for the upper layers: a frame for each Downlink block of the
+ * active dedicated channels, like L2 / RTP / the PCU would provide */
+static void l2_fill_block(struct gsm_bts_trx_ts *ts, enum trx_chan_type chan, uint32_t fn)
+{
+	const struct trx_chan_desc *desc = &trx_chan_desc[chan];
+	struct osmo_phsap_prim *l1sap;
+	struct msgb *msg;
+	unsigned int i;
+
+	if (chan == TRXC_TCHF) {
+		uint8_t payload[sizeof(struct amr_hdr) + 31];
+		int len;
+
+		for (i = sizeof(struct amr_hdr); i < sizeof(payload); i++)
+			payload[i] = rand();
+		len = osmo_amr_rtp_enc(payload, AMR_12_2, AMR_12_2, AMR_GOOD);
+		OSMO_ASSERT(len > 0);
+
+		msg = l1sap_msgb_alloc(len);
+		l1sap = msgb_l1sap_prim(msg);
+		osmo_prim_init(&l1sap->oph, SAP_GSM_PH, PRIM_TCH, PRIM_OP_REQUEST, msg);
+		l1sap->u.tch.chan_nr = desc->chan_nr | ts->nr;
+		l1sap->u.tch.fn = fn;
+		msg->l2h = msgb_put(msg, len);
+		memcpy(msg->l2h, payload, len);
+
+		trx_sched_tch_req(ts->trx, l1sap);
+		return;
+	}
+
+	/* L2 fill frames (SDCCH, SACCH) and CS-1 blocks (PDTCH) */
+	msg = l1sap_msgb_alloc(GSM_MACBLOCK_LEN);
+	l1sap = msgb_l1sap_prim(msg);
+	osmo_prim_init(&l1sap->oph, SAP_GSM_PH, PRIM_PH_DATA, PRIM_OP_REQUEST, msg);
+	l1sap->u.data.chan_nr = desc->chan_nr | ts->nr;
+	l1sap->u.data.link_id = desc->link_id;
+	l1sap->u.data.fn = fn;
+	msg->l2h = msgb_put(msg, GSM_MACBLOCK_LEN);
+	for (i = 0; i < GSM_MACBLOCK_LEN; i++)
+		msg->l2h[i] = rand();
+
+	trx_sched_ph_data_req(ts->trx, l1sap);
+}
+
+/* Stand-in for the upper layers, called by bts_sched_fn() */
+static void time_ind_cb(struct gsm_bts *bts, uint32_t fn)
+{
+	const struct phy_link *plink = bts->c0->pinst->phy_link;
+	const uint64_t start = now_ns();
+	struct gsm_bts_trx *trx;
+
+	/* the RTS is for a later frame, see bts_sched_rts_trx() */
+	fn = GSM_TDMA_FN_SUM(fn, plink->u.osmotrx.clock_advance + plink->u.osmotrx.rts_advance);
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		uint8_t active_ts = trx->l1sched.active_ts;
+
+		for (; active_ts != 0; active_ts &= active_ts - 1) {
+			struct gsm_bts_trx_ts *ts = &trx->ts[__builtin_ctz(active_ts)];
+			const struct l1sched_ts *l1ts = ts->priv;
+			const struct trx_sched_frame *frame;
+
+			/* BCCH/CCCH are served by the common code through L1SAP */
+			frame = &l1ts->mf_frames[fn % l1ts->mf_period];
+			if (frame->dl_bid == 0 && (l1ts->active_chans & (1ULL << frame->dl_chan)) &&
+			    (TRX_CHAN_IS_DEDIC(frame->dl_chan) || frame->dl_chan == TRXC_PDTCH))
+				l2_fill_block(ts, frame->dl_chan, fn);
+		}
+	}
+
+	stage_ns[BENCH_STAGE_L2] += now_ns() - start;
+}
+
+/* Downlink bursts sent by bts_sched_fn(), kept for the fake transceiver */
+static void burst_cb(const struct gsm_bts_trx *trx, const struct trx_dl_burst_req *br)
+{
+	struct bench_ts *bt = &bench_ts[trx->nr * TRX_NR_TS + br->tn];
+
+	num_bursts[BENCH_STAGE_DL]++;
+	if (br->burst_len != GSM_BURST_LEN || br->chan == TRXC_IDLE)
+		return;
+
+	memcpy(bt->dl[br->chan][br->bid], br->burst, GSM_BURST_LEN);
+	bt->dl_valid[br->chan] |= (1 << br->bid);
+}
+
+/* Fake transceiver: an Uplink burst (or NOPE.ind) for every timeslot */
+static void stage_ul(struct gsm_bts_trx *trx, uint32_t fn)
+{
+	unsigned int tn;
+
+	for (tn = 0; tn < ARRAY_SIZE(trx->ts); tn++) {
+		struct l1sched_ts *l1ts = trx->ts[tn].priv;
+		const struct bench_ts *bt = &bench_ts[trx->nr * TRX_NR_TS + tn];
+		const struct trx_sched_frame *frame;
+		struct trx_ul_burst_ind bi = {
+			.flags = TRX_BI_F_MOD_TYPE | TRX_BI_F_CI_CB,
+			.fn = fn,
+			.tn = tn,
+			.toa256 = 0,
+			.rssi = -60,
+			.mod = TRX_MOD_T_GMSK,
+			.ci_cb = 200,
+		};
+
+		if (!l1ts->mf_index)
+			continue;
+
+		frame = &l1ts->mf_frames[fn % l1ts->mf_period];
+		if (bt->dl_valid[frame->ul_chan] & (1 << frame->ul_bid)) {
+			osmo_ubit2sbit(bi.burst, bt->dl[frame->ul_chan][frame->ul_bid], GSM_BURST_LEN);
+			bi.burst_len = GSM_BURST_LEN;
+			num_bursts[BENCH_STAGE_UL]++;
+		} else {
+			bi.flags = TRX_BI_F_NOPE_IND;
+		}
+
+		trx_sched_ul_burst(l1ts, &bi);
+	}
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+	const uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+static void bench_run(void)
+{
+	uint32_t *fn_ns = calloc(cfg.frames, sizeof(*fn_ns));
+	uint64_t start, total_ns = 0;
+	struct gsm_bts_trx *trx;
+	unsigned int i;
+
+	OSMO_ASSERT(fn_ns != NULL);
+
+	sched_trx_stub_time_ind_cb = &time_ind_cb;
+	sched_trx_stub_burst_cb = &burst_cb;
+
+	start = now_ns();
+	for (i = 0; i < cfg.frames; i++) {
+		const uint32_t fn = i % GSM_TDMA_HYPERFRAME;
+		uint64_t t0, t1, t2;
+
+		t0 = now_ns();
+		bts_sched_fn(bts, fn);
+		t1 = now_ns();
+		if (cfg.uplink) {
+			llist_for_each_entry(trx, &bts->trx_list, list)
+				stage_ul(trx, fn);
+		}
+		t2 = now_ns();
+
+		stage_ns[BENCH_STAGE_DL] += t1 - t0;
+		stage_ns[BENCH_STAGE_UL] += t2 - t1;
+		fn_ns[i] = t2 - t0;
+	}
+	total_ns = now_ns() - start;
+
+	/* the L2 stand-in is called by bts_sched_fn() */
+	stage_ns[BENCH_STAGE_DL] -= stage_ns[BENCH_STAGE_L2];
+
+	qsort(fn_ns, cfg.frames, sizeof(*fn_ns), &cmp_u32);
+
+	printf("%u frames in %.3f s: %.0f frames/s (%.1fx real time), "
+	       "%u DL bursts, %u UL bursts\n",
+	       cfg.frames, total_ns / 1e9, cfg.frames / (total_ns / 1e9),
+	       cfg.frames * GSM_TDMA_FN_DURATION_nS / (double) total_ns,
+	       num_bursts[BENCH_STAGE_DL], num_bursts[BENCH_STAGE_UL]);
+	printf("Time per frame: p50 %.1f us, p99 %.1f us, max %.1f us (budget %.1f us)\n",
+	       fn_ns[cfg.frames / 2] / 1e3, fn_ns[(uint64_t) cfg.frames * 99 / 100] / 1e3,
+	       fn_ns[cfg.frames - 1] / 1e3, GSM_TDMA_FN_DURATION_nS / 1e3);
+	for (i = 0; i < _BENCH_STAGE_NUM; i++) {
+		printf("  %-20s %8.1f us/frame (%4.1f%%)\n", bench_stage_names[i],
+		       stage_ns[i] / 1e3 / cfg.frames, 100.0 * stage_ns[i] / total_ns);
+	}
+
+	free(fn_ns);
+}
+
+static void print_help(const char *prog)
+{
+	printf("Usage: %s [OPTIONS]\n"
+	       "  -h --help            This text\n"
+	       "  -n --num-trx NUM     Number of transceivers (default 1)\n"
+	       "  -f --frames NUM      Number of TDMA frames (default %u)\n"
+	       "  -t --tchf NUM        Number of TCH/F (AMR) timeslots (default: all free)\n"
+	       "  -s --sdcch8 NUM      Number of SDCCH/8 timeslots\n"
+	       "  -p --pdch NUM        Number of PDCH timeslots\n"
+	       "  -c --cipher ALGO     Cipher TCH/F and SDCCH/8 using A5/ALGO (1..4)\n"
+	       "  -w --workers NUM     Number of Downlink scheduler workers (default 0)\n"
+	       "  -U --no-uplink       Do not loop back the Downlink bursts\n",
+	       prog, BENCH_FRAMES_DEFAULT);
+}
+
+static void handle_options(int argc, char **argv)
+{
+	while (1) {
+		int option_idx = 0, c;
+		static const struct option long_options[] = {
+			{ "help", 0, 0, 'h' },
+			{ "num-trx", 1, 0, 'n' },
+			{ "frames", 1, 0, 'f' },
+			{ "tchf", 1, 0, 't' },
+			{ "sdcch8", 1, 0, 's' },
+			{ "pdch", 1, 0, 'p' },
+			{ "cipher", 1, 0, 'c' },
+			{ "workers", 1, 0, 'w' },
+			{ "no-uplink", 0, 0, 'U' },
+			{ 0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "hn:f:t:s:p:c:w:U",
+				long_options, &option_idx);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			print_help(argv[0]);
+			exit(0);
+		case 'n':
+			cfg.num_trx = atoi(optarg);
+			break;
+		case 'f':
+			cfg.frames = atoi(optarg);
+			break;
+		case 't':
+			cfg.num_tchf = atoi(optarg);
+			break;
+		case 's':
+			cfg.num_sdcch8 = atoi(optarg);
+			break;
+		case 'p':
+			cfg.num_pdch = atoi(optarg);
+			break;
+		case 'c':
+			cfg.cipher = atoi(optarg);
+			break;
+		case 'w':
+			cfg.num_workers = atoi(optarg);
+			break;
+		case 'U':
+			cfg.uplink = false;
+			break;
+		default:
+			print_help(argv[0]);
+			exit(2);
+		}
+	}
+
+	if (cfg.num_trx < 1 || cfg.frames < 1 || cfg.cipher < 0 || cfg.cipher > 4) {
+		fprintf(stderr, "Invalid arguments\n");
+		exit(2);
+	}
+
+	/* By default, fill up the timeslots without SDCCH/8 and PDCH with TCH/F */
+	if (cfg.num_tchf == ~0U) {
+		const unsigned int num_ts = cfg.num_trx * TRX_NR_TS - 1;
+		const unsigned int num_other = cfg.num_sdcch8 + cfg.num_pdch;
+
+		cfg.num_tchf = num_ts > num_other ? num_ts - num_other : 0;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	handle_options(argc, argv);
+	srand(0x5a5a);
+
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+	/* Idle channels and undecodable bursts log a lot, keep quiet */
+	log_set_log_level(osmo_stderr_target, LOGL_FATAL);
+
+	g_bts_sm = gsm_bts_sm_alloc(tall_bts_ctx);
+	bts = gsm_bts_alloc(g_bts_sm, 0);
+	if (bts_init(bts) < 0) {
+		fprintf(stderr, "unable to open bts\n");
+		exit(1);
+	}
+
+	bench_ts = talloc_zero_array(tall_bts_ctx, struct bench_ts, cfg.num_trx * TRX_NR_TS);
+	OSMO_ASSERT(bench_ts != NULL);
+
+	setup_trx();
+	bench_run();
+
+	return 0;
+}
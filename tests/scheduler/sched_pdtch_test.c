@@ -0,0 +1,264 @@
+/* Test which decoder rx_pdtch_fn() tries first for an Uplink PDTCH block,
+ * and that the blocks are decoded the same whatever the order. */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/bits.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/coding/gsm0503_coding.h>
+#include <osmocom/gsm/protocol/gsm_08_58.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/bts_sm.h>
+#include <osmo-bts/bts_trx.h>
+#include <osmo-bts/l1sap.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/scheduler.h>
+#include <osmo-bts/scheduler_backend.h>
+
+#include "l1_if.h"
+
+#define ASSERT_TRUE(rc) \
+	if (!(rc)) { \
+		printf("Assert failed in %s:%d.\n",  \
+		       __FILE__, __LINE__);          \
+		abort();			     \
+	}
+
+/* The PDCH under test */
+#define PDCH_TN		7
+
+static struct gsm_bts *bts;
+static struct gsm_bts_trx_ts *pdch;
+
+/* Normally provided by the PHY specific part of the scheduler */
+void _sched_act_rach_det(struct gsm_bts_trx *trx, uint8_t tn, uint8_t ss, int activate)
+{
+}
+
+/* Stand-in for the bts-trx counters of main.c, only the indices matter */
+static struct rate_ctr_desc btstrx_ctr_desc[BTSTRX_CTR_SCHED_FH_TABLE_REBUILD + 1];
+static char btstrx_ctr_names[ARRAY_SIZE(btstrx_ctr_desc)][16];
+static const struct rate_ctr_group_desc btstrx_ctrg_desc = {
+	"bts-trx",
+	"osmo-bts-trx specific counters",
+	OSMO_STATS_CLASS_GLOBAL,
+	ARRAY_SIZE(btstrx_ctr_desc),
+	btstrx_ctr_desc
+};
+
+/* Deterministic pseudo-random numbers, so that the results are reproducible */
+static uint32_t rand_state = 0x2342;
+
+static uint32_t test_rand(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return rand_state >> 8;
+}
+
+static void setup_bts(void)
+{
+	struct bts_trx_priv *priv;
+	struct gsm_lchan *lchan;
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(btstrx_ctr_desc); i++) {
+		snprintf(btstrx_ctr_names[i], sizeof(btstrx_ctr_names[i]), "ctr%u", i);
+		btstrx_ctr_desc[i].name = btstrx_ctr_names[i];
+		btstrx_ctr_desc[i].description = btstrx_ctr_names[i];
+	}
+
+	priv = talloc_zero(bts, struct bts_trx_priv);
+	ASSERT_TRUE(priv != NULL);
+	priv->ctrs = rate_ctr_group_alloc(priv, &btstrx_ctrg_desc, 0);
+	ASSERT_TRUE(priv->ctrs != NULL);
+	bts->model_priv = priv;
+
+	trx_sched_init(bts->c0);
+
+	pdch = &bts->c0->ts[PDCH_TN];
+	pdch->tsc_set = 0;
+	pdch->tsc = 0;
+	pdch->pchan = GSM_PCHAN_PDCH;
+	ASSERT_TRUE(trx_sched_set_pchan(pdch, pdch->pchan) == 0);
+
+	lchan = &pdch->lchan[0];
+	lchan->type = GSM_LCHAN_PDTCH;
+	ASSERT_TRUE(trx_sched_set_lchan(lchan, RSL_CHAN_OSMO_PDCH | PDCH_TN, LID_DEDIC, true) == 0);
+	/* The decoded blocks are queued on the lchan instead of going to the PCU */
+	lchan->loopback = 1;
+}
+
+static uint64_t btstrx_ctr(unsigned int idx)
+{
+	const struct bts_trx_priv *priv = bts->model_priv;
+
+	return rate_ctr_group_get_ctr(priv->ctrs, idx)->current;
+}
+
+static struct l1sched_chan_state *pdtch_state(void)
+{
+	struct l1sched_ts *l1ts = pdch->priv;
+
+	return &l1ts->chan_state[TRXC_PDTCH];
+}
+
+/* Feed the 4 bursts of a block to rx_pdtch_fn().  'bursts' holds the
+ * encoded GMSK bits (ubit), or NULL for noise of the given burst length. */
+static struct msgb *rx_block(const ubit_t *bursts, size_t burst_len)
+{
+	static uint32_t fn = 0;
+	struct gsm_lchan *lchan = &pdch->lchan[0];
+	struct trx_ul_burst_ind bi;
+	unsigned int bid, i;
+
+	for (bid = 0; bid < 4; bid++) {
+		memset(&bi, 0, sizeof(bi));
+		bi.fn = fn++;
+		bi.tn = PDCH_TN;
+		bi.chan = TRXC_PDTCH;
+		bi.bid = bid;
+		bi.burst_len = burst_len;
+
+		if (bursts != NULL) {
+			osmo_ubit2sbit(&bi.burst[3], &bursts[bid * 116], 58);
+			osmo_ubit2sbit(&bi.burst[87], &bursts[bid * 116 + 58], 58);
+		} else {
+			for (i = 0; i < burst_len; i++)
+				bi.burst[i] = (int) (test_rand() % 255) - 127;
+		}
+
+		ASSERT_TRUE(rx_pdtch_fn(pdch->priv, &bi) == 0);
+	}
+
+	ASSERT_TRUE(lchan->dl_tch_queue_len == 1);
+	return msgb_dequeue_count(&lchan->dl_tch_queue, &lchan->dl_tch_queue_len);
+}
+
+static void print_block(const char *what, const struct msgb *msg,
+			uint64_t dec, uint64_t wasted)
+{
+	printf("  %-5s: %" PRIu64 " attempt(s), %" PRIu64 " wasted, %2u bytes decoded, "
+	       "ul_egprs_gmsk=%d\n", what,
+	       btstrx_ctr(BTSTRX_CTR_SCHED_UL_PDTCH_DEC) - dec,
+	       btstrx_ctr(BTSTRX_CTR_SCHED_UL_PDTCH_DEC_WASTED) - wasted,
+	       msgb_l2len(msg), pdtch_state()->ul_egprs_gmsk);
+}
+
+/* CS-1..4 coded block with random content */
+static void rx_gprs(unsigned int cs)
+{
+	static const unsigned int cs_len[] = { 23, 34, 40, 54 };
+	/* Tail bits of the last octet which are not coded */
+	static const uint8_t cs_last_mask[] = { 0xff, 0x7f, 0x07, 0x7f };
+	const uint64_t dec = btstrx_ctr(BTSTRX_CTR_SCHED_UL_PDTCH_DEC);
+	const uint64_t wasted = btstrx_ctr(BTSTRX_CTR_SCHED_UL_PDTCH_DEC_WASTED);
+	const unsigned int len = cs_len[cs - 1];
+	ubit_t bursts[GSM0503_GPRS_BURSTS_NBITS];
+	uint8_t l2[54];
+	struct msgb *msg;
+	char name[8];
+	unsigned int i;
+
+	for (i = 0; i < len; i++)
+		l2[i] = test_rand();
+	l2[len - 1] &= cs_last_mask[cs - 1];
+	ASSERT_TRUE(gsm0503_pdtch_encode(bursts, l2, len) == GSM0503_GPRS_BURSTS_NBITS);
+
+	msg = rx_block(bursts, GSM_BURST_LEN);
+	ASSERT_TRUE(msgb_l2len(msg) == len);
+	msgb_l2(msg)[len - 1] &= cs_last_mask[cs - 1];
+	ASSERT_TRUE(memcmp(msgb_l2(msg), l2, len) == 0);
+
+	snprintf(name, sizeof(name), "CS-%u", cs);
+	print_block(name, msg, dec, wasted);
+	msgb_free(msg);
+}
+
+/* A block which neither decoder can make sense of */
+static void rx_noise(size_t burst_len)
+{
+	const uint64_t dec = btstrx_ctr(BTSTRX_CTR_SCHED_UL_PDTCH_DEC);
+	const uint64_t wasted = btstrx_ctr(BTSTRX_CTR_SCHED_UL_PDTCH_DEC_WASTED);
+	struct msgb *msg;
+
+	msg = rx_block(NULL, burst_len);
+	ASSERT_TRUE(msgb_l2len(msg) == 0);
+
+	print_block(burst_len == GSM_BURST_LEN ? "GMSK" : "8-PSK", msg, dec, wasted);
+	msgb_free(msg);
+}
+
+static void test_pdtch_dec(void)
+{
+	unsigned int cs;
+
+	printf("\n%s()\n", __func__);
+
+	printf("GPRS blocks, from the start:\n");
+	for (cs = 1; cs <= 4; cs++)
+		rx_gprs(cs);
+
+	printf("GPRS blocks, after an EGPRS (MCS-1..4) block:\n");
+	for (cs = 1; cs <= 4; cs++) {
+		pdtch_state()->ul_egprs_gmsk = true;
+		rx_gprs(cs);
+	}
+
+	printf("CS-4 blocks in a row, after an EGPRS (MCS-1..4) block:\n");
+	pdtch_state()->ul_egprs_gmsk = true;
+	rx_gprs(4);
+	rx_gprs(4);
+
+	printf("Noise, after an EGPRS (MCS-1..4) block:\n");
+	pdtch_state()->ul_egprs_gmsk = true;
+	rx_noise(GSM_BURST_LEN);
+	rx_noise(EGPRS_BURST_LEN);
+}
+
+int main(int argc, char **argv)
+{
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+
+	g_bts_sm = gsm_bts_sm_alloc(tall_bts_ctx);
+	bts = gsm_bts_alloc(g_bts_sm, 0);
+	if (bts_init(bts) < 0) {
+		fprintf(stderr, "unable to open bts\n");
+		exit(1);
+	}
+
+	setup_bts();
+	test_pdtch_dec();
+
+	printf("Success\n");
+
+	return 0;
+}
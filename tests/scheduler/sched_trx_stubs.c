@@ -0,0 +1,120 @@
+/* Stand-ins for the parts of osmo-bts-trx which scheduler_trx.c depends
+ * on, so that bts_sched_fn() can be run without a transceiver. */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+
+#include <osmocom/core/talloc.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/bts_trx.h>
+#include <osmo-bts/phy_link.h>
+#include <osmo-bts/fh_route.h>
+
+#include "l1_if.h"
+#include "trx_if.h"
+#include "sched_trx_stubs.h"
+
+void (*sched_trx_stub_time_ind_cb)(struct gsm_bts *bts, uint32_t fn);
+void (*sched_trx_stub_burst_cb)(const struct gsm_bts_trx *trx,
+				const struct trx_dl_burst_req *br);
+
+/* l1_if.c */
+int l1if_mph_time_ind(struct gsm_bts *bts, uint32_t fn)
+{
+	if (sched_trx_stub_time_ind_cb != NULL)
+		sched_trx_stub_time_ind_cb(bts, fn);
+	return 0;
+}
+
+/* trx_if.c */
+int trx_if_powered(struct trx_l1h *l1h)
+{
+	return 1;
+}
+
+int trx_if_cmd_handover(struct trx_l1h *l1h, uint8_t tn, uint8_t ss)
+{
+	return 0;
+}
+
+int trx_if_cmd_nohandover(struct trx_l1h *l1h, uint8_t tn, uint8_t ss)
+{
+	return 0;
+}
+
+void trx_if_tx_begin(struct trx_l1h *l1h)
+{
+}
+
+int trx_if_tx_append(struct trx_l1h *l1h, const struct trx_dl_burst_req *br)
+{
+	if (sched_trx_stub_burst_cb != NULL)
+		sched_trx_stub_burst_cb(l1h->phy_inst->trx, br);
+	return 0;
+}
+
+int trx_if_tx_finish(struct trx_l1h *l1h)
+{
+	return 0;
+}
+
+int trx_if_tx_send(struct trx_l1h *l1h)
+{
+	return -ENOMSG;
+}
+
+/*! Set up what bts_model_init() and the PHY configuration would for
+ *  osmo-bts-trx: one PHY link per BTS, one PHY instance per TRX. */
+void sched_trx_stub_setup_bts(struct gsm_bts *bts)
+{
+	struct bts_trx_priv *priv;
+	struct gsm_bts_trx *trx;
+	struct phy_link *plink;
+
+	priv = talloc_zero(bts, struct bts_trx_priv);
+	OSMO_ASSERT(priv != NULL);
+	priv->sched_workers_cpu = -1;
+	priv->fh_route = fh_route_alloc(priv);
+	OSMO_ASSERT(priv->fh_route != NULL);
+	bts->model_priv = priv;
+
+	plink = phy_link_create(bts, bts->nr);
+	OSMO_ASSERT(plink != NULL);
+	plink->type = PHY_LINK_T_OSMOTRX;
+	/* defaults of osmo-bts-trx, see main.c */
+	plink->u.osmotrx.clock_advance = 2;
+	plink->u.osmotrx.rts_advance = 3;
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		struct phy_instance *pinst;
+		struct trx_l1h *l1h;
+
+		pinst = phy_instance_create(plink, trx->nr);
+		OSMO_ASSERT(pinst != NULL);
+		phy_instance_link_to_trx(pinst, trx);
+
+		l1h = talloc_zero(pinst, struct trx_l1h);
+		OSMO_ASSERT(l1h != NULL);
+		l1h->phy_inst = pinst;
+		pinst->u.osmotrx.hdl = l1h;
+	}
+}
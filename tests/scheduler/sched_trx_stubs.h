@@ -0,0 +1,19 @@
+#pragma once
+
+/* Stand-ins for what scheduler_trx.c needs from trx_if.c and l1_if.c */
+
+#include <stdint.h>
+
+struct gsm_bts;
+struct gsm_bts_trx;
+struct trx_dl_burst_req;
+
+/* Called by bts_sched_fn() for each TDMA frame before the RTS, like L2 would
+ * be triggered by the time indication, if set */
+extern void (*sched_trx_stub_time_ind_cb)(struct gsm_bts *bts, uint32_t fn);
+
+/* Downlink bursts sent by bts_sched_fn() are passed here, if set */
+extern void (*sched_trx_stub_burst_cb)(const struct gsm_bts_trx *trx,
+				       const struct trx_dl_burst_req *br);
+
+void sched_trx_stub_setup_bts(struct gsm_bts *bts);
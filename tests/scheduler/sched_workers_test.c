@@ -0,0 +1,501 @@
+/* The Downlink scheduler workers must not change what is sent: two BTS
+ * with the same configuration and the same L2 input are run in lockstep
+ * through bts_sched_fn(), one single-threaded and one with a pool of
+ * workers, and their Downlink bursts, log messages and rate counters are
+ * compared frame by frame. */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/codec/codec.h>
+#include <osmocom/gsm/protocol/gsm_04_08.h>
+#include <osmocom/gsm/protocol/gsm_08_58.h>
+#include <osmocom/netif/amr.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/bts_sm.h>
+#include <osmo-bts/bts_trx.h>
+#include <osmo-bts/l1sap.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/phy_link.h>
+#include <osmo-bts/scheduler.h>
+#include <osmo-bts/scheduler_backend.h>
+
+#include "l1_if.h"
+#include "sched_trx_stubs.h"
+
+/* Two 51-multiframes of 26-multiframes, so that all the channels go
+ * through their whole multiframe a few times */
+#define TEST_FRAMES		(26 * 51 * 2)
+#define TEST_NUM_TRX		3
+#define TEST_NUM_WORKERS	3
+
+/* Primitives which are too late are queued during the first 51-multiframe
+ * of every that many frames */
+#define TEST_LATE_PERIOD	(51 * 4)
+
+enum test_ts_type {
+	TEST_TS_CCCH,
+	TEST_TS_TCHF_AMR,
+	TEST_TS_TCHF_SIGN,	/* no speech frames: dummy FACCH frames */
+	TEST_TS_SDCCH8,
+	TEST_TS_PDCH,
+	TEST_TS_IDLE,
+};
+
+/* TS0 of the other TRXs is TCH/F (AMR) instead of CCCH */
+static const struct {
+	enum test_ts_type type;
+	int cipher;		/* A5/x, 0 means no ciphering */
+} ts_layout[TRX_NR_TS] = {
+	{ TEST_TS_CCCH },
+	{ TEST_TS_TCHF_AMR },
+	{ TEST_TS_TCHF_SIGN },
+	{ TEST_TS_SDCCH8, 3 },
+	{ TEST_TS_PDCH },
+	{ TEST_TS_TCHF_AMR, 1 },
+	{ TEST_TS_SDCCH8 },
+	{ TEST_TS_IDLE },
+};
+
+/* The Downlink bursts of a BTS for one TDMA frame */
+struct test_frame {
+	struct trx_dl_burst_req br[TEST_NUM_TRX * TRX_NR_TS];
+	unsigned int num_br;
+};
+
+/* The log messages of a BTS for the whole test */
+struct test_log {
+	char *buf;
+	size_t len;
+};
+
+static struct gsm_bts *test_bts[2];
+static struct test_frame frames[2];
+static struct test_log logs[2];
+/* Which of the BTS is scheduled right now */
+static unsigned int cur_bts;
+
+static enum test_ts_type ts_type(const struct gsm_bts_trx_ts *ts)
+{
+	if (ts->nr == 0 && ts->trx != ts->trx->bts->c0)
+		return TEST_TS_TCHF_AMR;
+	return ts_layout[ts->nr].type;
+}
+
+/* Primitives of the common part (BCCH/CCCH) go to the scheduler queues,
+ * like in osmo-bts-trx/l1_if.c */
+int bts_model_l1sap_down(struct gsm_bts_trx *trx, struct osmo_phsap_prim *l1sap)
+{
+	struct msgb *msg = l1sap->oph.msg;
+
+	switch (OSMO_PRIM_HDR(&l1sap->oph)) {
+	case OSMO_PRIM(PRIM_PH_DATA, PRIM_OP_REQUEST):
+		if (!msg)
+			break;
+		return trx_sched_ph_data_req(trx, l1sap);
+	case OSMO_PRIM(PRIM_TCH, PRIM_OP_REQUEST):
+		if (!msg)
+			break;
+		return trx_sched_tch_req(trx, l1sap);
+	default:
+		break;
+	}
+
+	if (msg)
+		msgb_free(msg);
+	return 0;
+}
+
+static void burst_cb(const struct gsm_bts_trx *trx, const struct trx_dl_burst_req *br)
+{
+	struct test_frame *frame = &frames[trx->bts == test_bts[0] ? 0 : 1];
+
+	OSMO_ASSERT(frame->num_br < ARRAY_SIZE(frame->br));
+	frame->br[frame->num_br++] = *br;
+}
+
+/* Collect the log messages of each BTS, with the number of the second one
+ * replaced, so that they can be compared */
+static void log_output_cb(struct log_target *target, unsigned int level, const char *string)
+{
+	struct test_log *log = &logs[cur_bts];
+	size_t len = strlen(string);
+	char *bts_nr;
+
+	log->buf = talloc_realloc_size(tall_bts_ctx, log->buf, log->len + len + 1);
+	OSMO_ASSERT(log->buf != NULL);
+	memcpy(&log->buf[log->len], string, len + 1);
+
+	bts_nr = &log->buf[log->len];
+	while ((bts_nr = strstr(bts_nr, "bts=1,")) != NULL)
+		bts_nr[4] = '0';
+
+	log->len += len;
+}
+
+static void setup_log_target(void)
+{
+	struct log_target *tgt;
+	unsigned int i;
+
+	/* Idle channels log a lot, keep quiet */
+	log_set_log_level(osmo_stderr_target, LOGL_FATAL);
+
+	tgt = log_target_create();
+	OSMO_ASSERT(tgt != NULL);
+	tgt->output = &log_output_cb;
+	log_set_print_filename2(tgt, LOG_FILENAME_NONE);
+	log_set_print_category(tgt, 0);
+	log_set_print_category_hex(tgt, 0);
+	log_set_print_level(tgt, 0);
+	log_set_use_color(tgt, 0);
+	log_set_all_filter(tgt, 1);
+
+	/* Only the Downlink primitives, e.g. those which are too late */
+	for (i = 0; i < osmo_log_info->num_cat; i++)
+		log_set_category_filter(tgt, i, 0, LOGL_FATAL);
+	log_set_category_filter(tgt, DL1P, 1, LOGL_NOTICE);
+
+	log_add_target(tgt);
+}
+
+static void set_cipher(struct gsm_lchan *lchan, uint8_t chan_nr, int cipher)
+{
+	unsigned int i;
+
+	if (cipher == 0)
+		return;
+
+	lchan->encr.alg_id = RSL_ENC_ALG_A5(cipher);
+	lchan->encr.key_len = 8;
+	for (i = 0; i < lchan->encr.key_len; i++)
+		lchan->encr.key[i] = (lchan->ts->trx->nr << 4) + lchan->ts->nr + i;
+
+	OSMO_ASSERT(trx_sched_set_cipher(lchan, chan_nr, true) == 0);
+	OSMO_ASSERT(trx_sched_set_cipher(lchan, chan_nr, false) == 0);
+}
+
+static void setup_tchf(struct gsm_bts_trx_ts *ts, bool speech, int cipher)
+{
+	struct gsm_lchan *lchan = &ts->lchan[0];
+	const uint8_t chan_nr = RSL_CHAN_Bm_ACCHs | ts->nr;
+
+	lchan->type = GSM_LCHAN_TCH_F;
+	ts->pchan = GSM_PCHAN_TCH_F;
+	OSMO_ASSERT(trx_sched_set_pchan(ts, ts->pchan) == 0);
+	OSMO_ASSERT(trx_sched_set_lchan(lchan, chan_nr, LID_DEDIC, true) == 0);
+	OSMO_ASSERT(trx_sched_set_lchan(lchan, chan_nr, LID_SACCH, true) == 0);
+	if (speech) {
+		/* AMR with a single mode: 12.2 kbit/s */
+		OSMO_ASSERT(trx_sched_set_mode(ts, chan_nr, RSL_CMOD_SPD_SPEECH,
+					       GSM48_CMODE_SPEECH_AMR, 1, AMR_12_2,
+					       0, 0, 0, 0, 0) == 0);
+	}
+	set_cipher(lchan, chan_nr, cipher);
+}
+
+static void setup_sdcch8(struct gsm_bts_trx_ts *ts, int cipher)
+{
+	unsigned int ss;
+
+	ts->pchan = GSM_PCHAN_SDCCH8_SACCH8C;
+	OSMO_ASSERT(trx_sched_set_pchan(ts, ts->pchan) == 0);
+
+	for (ss = 0; ss < 8; ss++) {
+		struct gsm_lchan *lchan = &ts->lchan[ss];
+		const uint8_t chan_nr = RSL_CHAN_SDCCH8_ACCH + (ss << 3) + ts->nr;
+
+		lchan->type = GSM_LCHAN_SDCCH;
+		OSMO_ASSERT(trx_sched_set_lchan(lchan, chan_nr, LID_DEDIC, true) == 0);
+		OSMO_ASSERT(trx_sched_set_lchan(lchan, chan_nr, LID_SACCH, true) == 0);
+		set_cipher(lchan, chan_nr, cipher);
+	}
+}
+
+static void setup_pdch(struct gsm_bts_trx_ts *ts)
+{
+	struct gsm_lchan *lchan = &ts->lchan[0];
+	const uint8_t chan_nr = RSL_CHAN_OSMO_PDCH | ts->nr;
+
+	lchan->type = GSM_LCHAN_PDTCH;
+	ts->pchan = GSM_PCHAN_PDCH;
+	OSMO_ASSERT(trx_sched_set_pchan(ts, ts->pchan) == 0);
+	/* PDTCH and PTCCH */
+	OSMO_ASSERT(trx_sched_set_lchan(lchan, chan_nr, LID_DEDIC, true) == 0);
+	OSMO_ASSERT(trx_sched_set_lchan(lchan, chan_nr, LID_SACCH, true) == 0);
+}
+
+static struct gsm_bts *setup_bts(unsigned int nr, unsigned int num_workers)
+{
+	struct bts_trx_priv *priv;
+	struct gsm_bts_trx *trx;
+	struct gsm_bts *bts;
+	unsigned int tn;
+
+	bts = gsm_bts_alloc(g_bts_sm, nr);
+	OSMO_ASSERT(bts != NULL);
+	OSMO_ASSERT(bts_init(bts) == 0);
+
+	while (bts->num_trx < TEST_NUM_TRX)
+		gsm_bts_trx_alloc(bts);
+
+	sched_trx_stub_setup_bts(bts);
+	priv = bts->model_priv;
+	priv->sched_workers_num = num_workers;
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		trx_sched_init(trx);
+
+		for (tn = 0; tn < ARRAY_SIZE(trx->ts); tn++) {
+			struct gsm_bts_trx_ts *ts = &trx->ts[tn];
+
+			ts->tsc_set = 0;
+			ts->tsc = 0;
+
+			switch (ts_type(ts)) {
+			case TEST_TS_CCCH:
+				ts->pchan = GSM_PCHAN_CCCH;
+				OSMO_ASSERT(trx_sched_set_pchan(ts, ts->pchan) == 0);
+				break;
+			case TEST_TS_TCHF_AMR:
+				setup_tchf(ts, true, ts_layout[tn].cipher);
+				break;
+			case TEST_TS_TCHF_SIGN:
+				setup_tchf(ts, false, ts_layout[tn].cipher);
+				break;
+			case TEST_TS_SDCCH8:
+				setup_sdcch8(ts, ts_layout[tn].cipher);
+				break;
+			case TEST_TS_PDCH:
+				setup_pdch(ts);
+				break;
+			case TEST_TS_IDLE:
+				ts->lchan[0].type = GSM_LCHAN_TCH_F;
+				ts->pchan = GSM_PCHAN_TCH_F;
+				OSMO_ASSERT(trx_sched_set_pchan(ts, ts->pchan) == 0);
+				break;
+			}
+		}
+	}
+
+	OSMO_ASSERT(trx_sched_set_bcch_ccch(&bts->c0->ts[0].lchan[CCCH_LCHAN], true) == 0);
+
+	return bts;
+}
+
+/* Deterministic content, the same for both BTS */
+static uint8_t l2_byte(const struct gsm_bts_trx_ts *ts, uint32_t fn, unsigned int i)
+{
+	return (fn * 7) + (ts->trx->nr * 31) + (ts->nr * 13) + (i * 5);
+}
+
+static void l2_send(struct gsm_bts_trx_ts *ts, enum trx_chan_type chan, uint32_t fn)
+{
+	const struct trx_chan_desc *desc = &trx_chan_desc[chan];
+	struct osmo_phsap_prim *l1sap;
+	struct msgb *msg;
+	unsigned int i;
+
+	if (chan == TRXC_TCHF) {
+		uint8_t payload[sizeof(struct amr_hdr) + 31];
+		int len;
+
+		for (i = sizeof(struct amr_hdr); i < sizeof(payload); i++)
+			payload[i] = l2_byte(ts, fn, i);
+		len = osmo_amr_rtp_enc(payload, AMR_12_2, AMR_12_2, AMR_GOOD);
+		OSMO_ASSERT(len > 0);
+
+		msg = l1sap_msgb_alloc(len);
+		l1sap = msgb_l1sap_prim(msg);
+		osmo_prim_init(&l1sap->oph, SAP_GSM_PH, PRIM_TCH, PRIM_OP_REQUEST, msg);
+		l1sap->u.tch.chan_nr = desc->chan_nr | ts->nr;
+		l1sap->u.tch.fn = fn;
+		msg->l2h = msgb_put(msg, len);
+		memcpy(msg->l2h, payload, len);
+
+		trx_sched_tch_req(ts->trx, l1sap);
+		return;
+	}
+
+	/* L2 frames (SDCCH, SACCH) and CS-1 blocks (PDTCH) */
+	msg = l1sap_msgb_alloc(GSM_MACBLOCK_LEN);
+	l1sap = msgb_l1sap_prim(msg);
+	osmo_prim_init(&l1sap->oph, SAP_GSM_PH, PRIM_PH_DATA, PRIM_OP_REQUEST, msg);
+	l1sap->u.data.chan_nr = desc->chan_nr | ts->nr;
+	l1sap->u.data.link_id = desc->link_id;
+	l1sap->u.data.fn = fn;
+	msg->l2h = msgb_put(msg, GSM_MACBLOCK_LEN);
+	for (i = 0; i < GSM_MACBLOCK_LEN; i++)
+		msg->l2h[i] = l2_byte(ts, fn, i);
+
+	trx_sched_ph_data_req(ts->trx, l1sap);
+}
+
+/* Stand-in for the upper layers: a frame for each Downlink block of the
+ * active dedicated channels (except for the TCH/F in signalling mode),
+ * and now and then one which is too late to be sent */
+static void time_ind_cb(struct gsm_bts *bts, uint32_t fn)
+{
+	const struct phy_link *plink = bts->c0->pinst->phy_link;
+	struct gsm_bts_trx *trx;
+
+	/* the RTS is for a later frame, see bts_sched_rts_trx() */
+	fn = GSM_TDMA_FN_SUM(fn, plink->u.osmotrx.clock_advance + plink->u.osmotrx.rts_advance);
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		uint8_t active_ts = trx->l1sched.active_ts;
+
+		for (; active_ts != 0; active_ts &= active_ts - 1) {
+			struct gsm_bts_trx_ts *ts = &trx->ts[__builtin_ctz(active_ts)];
+			const struct l1sched_ts *l1ts = ts->priv;
+			const struct trx_sched_frame *frame;
+			enum trx_chan_type chan;
+
+			frame = &l1ts->mf_frames[fn % l1ts->mf_period];
+			chan = frame->dl_chan;
+			if (frame->dl_bid != 0 || !(l1ts->active_chans & (1ULL << chan)))
+				continue;
+			if (!TRX_CHAN_IS_DEDIC(chan) && chan != TRXC_PDTCH)
+				continue;
+			if (chan == TRXC_TCHF && ts_type(ts) == TEST_TS_TCHF_SIGN)
+				continue;
+
+			l2_send(ts, chan, fn);
+
+			/* goes to the same queue bucket, but is dropped */
+			if (ts_type(ts) == TEST_TS_SDCCH8 && fn % TEST_LATE_PERIOD < 51)
+				l2_send(ts, chan, GSM_TDMA_FN_SUB(fn, L1SCHED_DL_PRIM_SLOTS));
+		}
+	}
+}
+
+static bool frames_equal(void)
+{
+	unsigned int i;
+
+	if (frames[0].num_br != frames[1].num_br)
+		return false;
+
+	for (i = 0; i < frames[0].num_br; i++) {
+		const struct trx_dl_burst_req *a = &frames[0].br[i];
+		const struct trx_dl_burst_req *b = &frames[1].br[i];
+
+		if (a->fn != b->fn || a->tn != b->tn || a->trx_num != b->trx_num ||
+		    a->att != b->att || a->mod != b->mod ||
+		    a->tsc_set != b->tsc_set || a->tsc != b->tsc ||
+		    a->burst_len != b->burst_len ||
+		    memcmp(a->burst, b->burst, a->burst_len) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+static uint64_t sum_ts_ctr(const struct gsm_bts *bts, unsigned int idx)
+{
+	const struct gsm_bts_trx *trx;
+	uint64_t sum = 0;
+	unsigned int tn;
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		for (tn = 0; tn < ARRAY_SIZE(trx->ts); tn++) {
+			const struct l1sched_ts *l1ts = trx->ts[tn].priv;
+
+			sum += rate_ctr_group_get_ctr(l1ts->ctrs, idx)->current;
+		}
+	}
+
+	return sum;
+}
+
+static void test_sched_workers(void)
+{
+	unsigned int num_bursts = 0;
+	uint64_t late[2], not_found[2];
+	unsigned int i;
+	uint32_t fn;
+
+	printf("Downlink of %u TRX, scheduled by the main thread and by %u workers\n",
+	       TEST_NUM_TRX, TEST_NUM_WORKERS);
+
+	test_bts[0] = setup_bts(0, 0);
+	test_bts[1] = setup_bts(1, TEST_NUM_WORKERS);
+
+	sched_trx_stub_time_ind_cb = &time_ind_cb;
+	sched_trx_stub_burst_cb = &burst_cb;
+
+	for (fn = 0; fn < TEST_FRAMES; fn++) {
+		for (i = 0; i < ARRAY_SIZE(test_bts); i++) {
+			cur_bts = i;
+			frames[i].num_br = 0;
+			bts_sched_fn(test_bts[i], fn);
+		}
+
+		if (!frames_equal()) {
+			printf("Downlink bursts differ at fn=%u\n", fn);
+			exit(1);
+		}
+		num_bursts += frames[0].num_br;
+	}
+
+	OSMO_ASSERT(((struct bts_trx_priv *) test_bts[1]->model_priv)->sched_workers != NULL);
+	OSMO_ASSERT(num_bursts > TEST_FRAMES * TRX_NR_TS);
+	printf("%u frames: Downlink bursts identical\n", TEST_FRAMES);
+
+	OSMO_ASSERT(logs[0].len > 0);
+	printf("Log messages %s\n",
+	       logs[0].len == logs[1].len && !memcmp(logs[0].buf, logs[1].buf, logs[0].len) ?
+	       "identical" : "differ");
+
+	late[0] = sum_ts_ctr(test_bts[0], L1SCHED_TS_CTR_DL_LATE);
+	late[1] = sum_ts_ctr(test_bts[1], L1SCHED_TS_CTR_DL_LATE);
+	not_found[0] = sum_ts_ctr(test_bts[0], L1SCHED_TS_CTR_DL_NOT_FOUND);
+	not_found[1] = sum_ts_ctr(test_bts[1], L1SCHED_TS_CTR_DL_NOT_FOUND);
+	OSMO_ASSERT(late[0] > 0 && not_found[0] > 0);
+	printf("Rate counters %s\n",
+	       late[0] == late[1] && not_found[0] == not_found[1] ? "identical" : "differ");
+}
+
+int main(int argc, char **argv)
+{
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+	setup_log_target();
+
+	g_bts_sm = gsm_bts_sm_alloc(tall_bts_ctx);
+	OSMO_ASSERT(g_bts_sm != NULL);
+
+	test_sched_workers();
+
+	printf("Success\n");
+
+	return 0;
+}
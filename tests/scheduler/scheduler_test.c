@@ -0,0 +1,363 @@
+/* Test the active channel/timeslot bitmaps and the Downlink primitive
+ * queues of the L1 scheduler, and benchmark the Downlink burst generation
+ * at different cell loads. */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/gsm/protocol/gsm_08_58.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/bts_sm.h>
+#include <osmo-bts/bts_trx.h>
+#include <osmo-bts/l1sap.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/gsm_data.h>
+#include <osmo-bts/scheduler.h>
+#include <osmo-bts/scheduler_backend.h>
+
+#define ASSERT_TRUE(rc) \
+	if (!(rc)) { \
+		printf("Assert failed in %s:%d.\n",  \
+		       __FILE__, __LINE__);          \
+		abort();			     \
+	}
+
+#define NUM_TRX		4
+/* Number of TDMA frames per benchmark run (a multiple of 26 and 51) */
+#define BENCH_FRAMES	(26 * 51 * 4)
+
+static struct gsm_bts *bts;
+
+/* Normally provided by the PHY specific part of the scheduler */
+void _sched_act_rach_det(struct gsm_bts_trx *trx, uint8_t tn, uint8_t ss, int activate)
+{
+}
+
+static void print_bitmaps(const char *what)
+{
+	const struct gsm_bts_trx *trx;
+
+	printf("%s:\n", what);
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		printf("  TRX%u: mf_ts=0x%02x active_ts=0x%02x\n",
+		       trx->nr, trx->l1sched.mf_ts, trx->l1sched.active_ts);
+	}
+}
+
+/* TS0 on C0 is BCCH+CCCH, all other timeslots are TCH/F */
+static void setup_trx(void)
+{
+	struct gsm_bts_trx *trx;
+	unsigned int tn;
+
+	while (bts->num_trx < NUM_TRX)
+		gsm_bts_trx_alloc(bts);
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		trx_sched_init(trx);
+
+		for (tn = 0; tn < ARRAY_SIZE(trx->ts); tn++) {
+			struct gsm_bts_trx_ts *ts = &trx->ts[tn];
+
+			ts->tsc_set = 0;
+			ts->tsc = 0;
+
+			if (trx == bts->c0 && tn == 0) {
+				ts->pchan = GSM_PCHAN_CCCH;
+			} else {
+				ts->pchan = GSM_PCHAN_TCH_F;
+				ts->lchan[0].type = GSM_LCHAN_TCH_F;
+			}
+
+			ASSERT_TRUE(trx_sched_set_pchan(ts, ts->pchan) == 0);
+		}
+	}
+
+	ASSERT_TRUE(trx_sched_set_bcch_ccch(&bts->c0->ts[0].lchan[CCCH_LCHAN], true) == 0);
+}
+
+static int set_tchf(struct gsm_bts_trx_ts *ts, uint8_t link_id, bool active)
+{
+	return trx_sched_set_lchan(&ts->lchan[0], RSL_CHAN_Bm_ACCHs | ts->nr, link_id, active);
+}
+
+static void test_bitmaps(void)
+{
+	struct gsm_bts_trx *trx1 = gsm_bts_trx_num(bts, 1);
+	struct gsm_bts_trx *trx2 = gsm_bts_trx_num(bts, 2);
+	struct gsm_bts_trx *trx3 = gsm_bts_trx_num(bts, 3);
+	struct gsm_bts_trx_ts *shadow = trx2->ts[5].vamos.peer;
+
+	printf("\n%s()\n", __func__);
+
+	print_bitmaps("Initial state (BCCH+CCCH only)");
+
+	ASSERT_TRUE(set_tchf(&trx1->ts[3], LID_DEDIC, true) == 0);
+	ASSERT_TRUE(set_tchf(&trx1->ts[3], LID_SACCH, true) == 0);
+	print_bitmaps("TCH/F+SACCH active on TRX1/TS3");
+
+	ASSERT_TRUE(set_tchf(&trx1->ts[3], LID_DEDIC, false) == 0);
+	print_bitmaps("TCH/F released, SACCH still active on TRX1/TS3");
+
+	ASSERT_TRUE(set_tchf(&trx1->ts[3], LID_SACCH, false) == 0);
+	print_bitmaps("SACCH released on TRX1/TS3");
+
+	shadow->pchan = GSM_PCHAN_TCH_F;
+	shadow->lchan[0].type = GSM_LCHAN_TCH_F;
+	ASSERT_TRUE(set_tchf(shadow, LID_DEDIC, true) == 0);
+	print_bitmaps("TCH/F active on the shadow TRX2/TS5");
+
+	ASSERT_TRUE(set_tchf(shadow, LID_DEDIC, false) == 0);
+	print_bitmaps("TCH/F released on the shadow TRX2/TS5");
+
+	ASSERT_TRUE(trx_sched_set_pchan(&trx3->ts[7], GSM_PCHAN_NONE) == 0);
+	print_bitmaps("TRX3/TS7 has no multiframe layout");
+
+	ASSERT_TRUE(trx_sched_set_pchan(&trx3->ts[7], GSM_PCHAN_TCH_F) == 0);
+	print_bitmaps("TRX3/TS7 is TCH/F again");
+}
+
+static void queue_sacch(struct gsm_bts_trx_ts *ts, uint32_t fn)
+{
+	const struct trx_chan_desc *desc = &trx_chan_desc[TRXC_SACCHTF];
+	struct osmo_phsap_prim *l1sap;
+	struct msgb *msg;
+
+	msg = l1sap_msgb_alloc(GSM_MACBLOCK_LEN);
+	l1sap = msgb_l1sap_prim(msg);
+	osmo_prim_init(&l1sap->oph, SAP_GSM_PH, PRIM_PH_DATA, PRIM_OP_REQUEST, msg);
+	l1sap->u.data.chan_nr = desc->chan_nr | ts->nr;
+	l1sap->u.data.link_id = desc->link_id;
+	l1sap->u.data.fn = fn;
+	msg->l2h = msgb_put(msg, GSM_MACBLOCK_LEN);
+	memset(msg->l2h, 0x2b, GSM_MACBLOCK_LEN);
+
+	ASSERT_TRUE(trx_sched_ph_data_req(ts->trx, l1sap) == 0);
+}
+
+static struct msgb *dequeue_sacch(struct gsm_bts_trx_ts *ts, uint32_t fn)
+{
+	const struct trx_dl_burst_req br = {
+		.fn = fn,
+		.tn = ts->nr,
+		.chan = TRXC_SACCHTF,
+	};
+
+	return _sched_dequeue_prim(ts->priv, &br);
+}
+
+static void print_dl_prims(const struct gsm_bts_trx_ts *ts, const char *what)
+{
+	const struct l1sched_ts *l1ts = ts->priv;
+	unsigned int i, used = 0;
+
+	for (i = 0; i < ARRAY_SIZE(l1ts->dl_prims_used); i++)
+		used += __builtin_popcountll(l1ts->dl_prims_used[i]);
+
+	printf("%s:
+", what);
+	printf("  %u queued (%u buckets in use), dl_late=%" PRIu64 ", dl_not_found=%" PRIu64 "\n",
+	       trx_sched_dl_prims_count(l1ts), used,
+	       rate_ctr_group_get_ctr(l1ts->ctrs, L1SCHED_TS_CTR_DL_LATE)->current,
+	       rate_ctr_group_get_ctr(l1ts->ctrs, L1SCHED_TS_CTR_DL_NOT_FOUND)->current);
+}
+
+/* Primitives are sent at their FN, those for a past FN are dropped and
+ * counted, those of a released channel are removed */
+static void test_dl_prims(void)
+{
+	struct gsm_bts_trx_ts *ts = &gsm_bts_trx_num(bts, 1)->ts[3];
+	struct msgb *msg;
+
+	printf("\n%s()\n", __func__);
+
+	ASSERT_TRUE(set_tchf(ts, LID_DEDIC, true) == 0);
+	ASSERT_TRUE(set_tchf(ts, LID_SACCH, true) == 0);
+
+	queue_sacch(ts, 100);
+	queue_sacch(ts, 104);
+	queue_sacch(ts, 300);
+	print_dl_prims(ts, "SACCH queued for fn=100, fn=104 and fn=300");
+
+	ASSERT_TRUE(dequeue_sacch(ts, 99) == NULL);
+	print_dl_prims(ts, "Nothing to send for fn=99");
+
+	msg = dequeue_sacch(ts, 104);
+	ASSERT_TRUE(msg != NULL);
+	ASSERT_TRUE(msgb_l1sap_prim(msg)->u.data.fn == 104);
+	msgb_free(msg);
+	print_dl_prims(ts, "Sent for fn=104, the one for fn=100 is late");
+
+	/* more than L1SCHED_DL_PRIM_SLOTS frames later */
+	queue_sacch(ts, 400);
+	ASSERT_TRUE(dequeue_sacch(ts, 700) == NULL);
+	print_dl_prims(ts, "SACCH queued for fn=400, nothing to send for fn=700");
+
+	queue_sacch(ts, 800);
+	queue_sacch(ts, 900);
+	ASSERT_TRUE(set_tchf(ts, LID_SACCH, false) == 0);
+	print_dl_prims(ts, "SACCH queued for fn=800 and fn=900, then released");
+
+	ASSERT_TRUE(set_tchf(ts, LID_DEDIC, false) == 0);
+}
+
+/* (Re)activate TCH/F+SACCH on the first num_active TCH/F timeslots, so
+ * that each benchmark run starts from the same channel state */
+static void set_load(unsigned int num_active)
+{
+	struct gsm_bts_trx *trx;
+	unsigned int tn, n = 0;
+
+	llist_for_each_entry(trx, &bts->trx_list, list) {
+		for (tn = 0; tn < ARRAY_SIZE(trx->ts); tn++) {
+			struct gsm_bts_trx_ts *ts = &trx->ts[tn];
+
+			if (ts->pchan != GSM_PCHAN_TCH_F)
+				continue;
+
+			set_tchf(ts, LID_DEDIC, false);
+			set_tchf(ts, LID_SACCH, false);
+			if (n++ >= num_active)
+				continue;
+			set_tchf(ts, LID_DEDIC, true);
+			set_tchf(ts, LID_SACCH, true);
+		}
+	}
+}
+
+struct sched_run {
+	unsigned int bursts;
+	uint32_t hash;
+	double ns_per_fn;
+};
+
+static double elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+/* Generate the Downlink bursts of all TRX for BENCH_FRAMES frames, either
+ * visiting every timeslot (as before) or the active ones only */
+static void sched_run(struct sched_run *run, bool all_ts)
+{
+	struct timespec start, end;
+	struct gsm_bts_trx *trx;
+	unsigned int tn, i;
+	uint32_t fn;
+
+	*run = (struct sched_run) { .hash = 0 };
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (fn = 0; fn < BENCH_FRAMES; fn++) {
+		llist_for_each_entry(trx, &bts->trx_list, list) {
+			const uint8_t active_ts = trx->l1sched.active_ts;
+
+			for (tn = 0; tn < ARRAY_SIZE(trx->ts); tn++) {
+				struct trx_dl_burst_req br = {
+					.trx_num = trx->nr,
+					.fn = fn,
+					.tn = tn,
+				};
+
+				if (!all_ts && (~active_ts & (1 << tn)))
+					continue;
+
+				_sched_dl_burst(trx->ts[tn].priv, &br);
+				if (br.burst_len == 0)
+					continue;
+
+				/* Inactive timeslots must never have a burst */
+				ASSERT_TRUE(active_ts & (1 << tn));
+
+				run->bursts++;
+				for (i = 0; i < br.burst_len; i++)
+					run->hash = run->hash * 31 + br.burst[i];
+			}
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	run->ns_per_fn = elapsed_ns(&start, &end) / BENCH_FRAMES;
+}
+
+static void bench_load(unsigned int load)
+{
+	const unsigned int num_tchf = NUM_TRX * TRX_NR_TS - 1;
+	const unsigned int num_active = num_tchf * load / 100;
+	struct sched_run all, active;
+
+	set_load(num_active);
+	sched_run(&all, true);
+
+	set_load(num_active);
+	sched_run(&active, false);
+
+	/* Skipping the inactive timeslots must not change a single bit */
+	ASSERT_TRUE(all.bursts == active.bursts);
+	ASSERT_TRUE(all.hash == active.hash);
+
+	printf("load %3u%%: %2u of %u TCH/F active, same bursts for all/active TS\n",
+	       load, num_active, num_tchf);
+	fprintf(stderr, "load %3u%%: %u bursts, %7.1f ns/FN (all TS), "
+		"%7.1f ns/FN (active TS)\n", load, all.bursts,
+		all.ns_per_fn, active.ns_per_fn);
+}
+
+int main(int argc, char **argv)
+{
+	static const unsigned int loads[] = { 0, 10, 100 };
+	unsigned int i;
+
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+	/* Idle channels log on every block, keep the benchmark quiet */
+	log_set_log_level(osmo_stderr_target, LOGL_FATAL);
+
+	g_bts_sm = gsm_bts_sm_alloc(tall_bts_ctx);
+	bts = gsm_bts_alloc(g_bts_sm, 0);
+	if (bts_init(bts) < 0) {
+		fprintf(stderr, "unable to open bts\n");
+		exit(1);
+	}
+
+	setup_trx();
+	test_bitmaps();
+	test_dl_prims();
+
+	printf("\nbench_load()\n");
+	for (i = 0; i < ARRAY_SIZE(loads); i++)
+		bench_load(loads[i]);
+
+	printf("Success\n");
+
+	return 0;
+}
@@ -0,0 +1,340 @@
+/* Test the shared memory rings using a stand-in transceiver exchanging
+ * TRXDv0 PDUs with the BTS side. */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <fcntl.h>
+
+#include <sys/socket.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/bits.h>
+
+#include <osmo-bts/shm_ring.h>
+
+#define GSM_BURST_LEN		148
+#define TRXD_DL_V0HDR_LEN	(1 + 4 + 1)
+#define TRXD_UL_V0HDR_LEN	(1 + 4 + 1 + 2)
+
+static void *ctx;
+
+static bool efd_readable(int fd)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	return poll(&pfd, 1, 0) == 1;
+}
+
+/* Stand-in transceiver: consume DL bursts, answer each with an UL burst */
+static unsigned int fake_trx_handle(struct shm_link *trx)
+{
+	uint8_t dl[TRXD_DL_V0HDR_LEN + GSM_BURST_LEN];
+	uint8_t ul[TRXD_UL_V0HDR_LEN + GSM_BURST_LEN];
+	unsigned int num = 0;
+	int len, i;
+
+	shm_link_rx_ack(trx);
+
+	while ((len = shm_link_pop(trx, dl, sizeof(dl))) != -EAGAIN) {
+		OSMO_ASSERT(len == sizeof(dl));
+		OSMO_ASSERT((dl[0] >> 4) == 0); /* TRXDv0 */
+
+		ul[0] = dl[0] & 0x07; /* TN */
+		memcpy(&ul[1], &dl[1], 4); /* FN */
+		ul[5] = 60; /* RSSI: -60 dBm */
+		osmo_store16be(256, &ul[6]); /* ToA256 */
+
+		/* Convert hard-bits {0,1} into soft-bits [0..254] */
+		for (i = 0; i < GSM_BURST_LEN; i++)
+			ul[TRXD_UL_V0HDR_LEN + i] = dl[TRXD_DL_V0HDR_LEN + i] ? 254 : 0;
+
+		OSMO_ASSERT(shm_link_push(trx, ul, sizeof(ul)) == 0);
+		num++;
+	}
+
+	return num;
+}
+
+static void test_trxd_exchange(struct shm_link *bts, struct shm_link *trx)
+{
+	uint8_t dl[TRXD_DL_V0HDR_LEN + GSM_BURST_LEN];
+	uint8_t ul[TRXD_UL_V0HDR_LEN + GSM_BURST_LEN];
+	unsigned int fn, tn, num_dl = 0, num_ul = 0, num_trx = 0;
+	int len, i;
+
+	printf("%s(): exchanging TRXDv0 PDUs for 1000 TDMA frames\n", __func__);
+
+	for (fn = 0; fn < 1000; fn++) {
+		for (tn = 0; tn < 8; tn++) {
+			dl[0] = tn;
+			osmo_store32be(fn, &dl[1]);
+			dl[5] = 0; /* attenuation */
+			for (i = 0; i < GSM_BURST_LEN; i++)
+				dl[TRXD_DL_V0HDR_LEN + i] = (fn + tn + i) & 1;
+			OSMO_ASSERT(shm_link_push(bts, dl, sizeof(dl)) == 0);
+			num_dl++;
+		}
+
+		/* The transceiver is woken up once per batch at most */
+		if (efd_readable(trx->efd_rx))
+			num_trx += fake_trx_handle(trx);
+
+		if (!efd_readable(bts->efd_rx))
+			continue;
+		shm_link_rx_ack(bts);
+
+		while ((len = shm_link_pop(bts, ul, sizeof(ul))) != -EAGAIN) {
+			OSMO_ASSERT(len == sizeof(ul));
+			OSMO_ASSERT(osmo_load32be(&ul[1]) == fn);
+			OSMO_ASSERT(ul[0] == num_ul % 8);
+			for (i = 0; i < GSM_BURST_LEN; i++) {
+				uint8_t bit = (fn + ul[0] + i) & 1;
+				OSMO_ASSERT(ul[TRXD_UL_V0HDR_LEN + i] == (bit ? 254 : 0));
+			}
+			num_ul++;
+		}
+	}
+
+	printf("%s(): DL PDUs sent %u, handled by fake TRX %u, UL PDUs received %u\n",
+	       __func__, num_dl, num_trx, num_ul);
+	OSMO_ASSERT(shm_link_rx_empty(bts));
+	OSMO_ASSERT(shm_link_rx_empty(trx));
+}
+
+static void test_ring_limits(struct shm_link *bts, struct shm_link *trx)
+{
+	uint8_t buf[1024] = { 0 };
+	unsigned int num = 0;
+	int rc;
+
+	printf("%s(): filling the ring until it is full\n", __func__);
+
+	while ((rc = shm_link_push(bts, buf, sizeof(buf))) == 0)
+		num++;
+	printf("%s(): pushed %u records, then rc=%d (%s)\n",
+	       __func__, num, rc, rc == -ENOSPC ? "ENOSPC" : "unexpected");
+
+	/* A too small buffer drops the record */
+	rc = shm_link_pop(trx, buf, 16);
+	printf("%s(): pop into a short buffer: rc=%d (%s)\n",
+	       __func__, rc, rc == -EMSGSIZE ? "EMSGSIZE" : "unexpected");
+
+	num = 1;
+	while ((rc = shm_link_pop(trx, buf, sizeof(buf))) > 0)
+		num++;
+	printf("%s(): popped %u records, then rc=%d (%s)\n",
+	       __func__, num, rc, rc == -EAGAIN ? "EAGAIN" : "unexpected");
+
+	/* A record larger than half of the ring never fits */
+	rc = shm_link_push(bts, NULL, SHM_RING_DEF_SIZE);
+	printf("%s(): pushing an oversized record: rc=%d (%s)\n",
+	       __func__, rc, rc == -EMSGSIZE ? "EMSGSIZE" : "unexpected");
+}
+
+/* Hand over the rings like the BTS does on its unix socket */
+static struct shm_link *trx_attach(struct shm_link *bts)
+{
+	struct shm_link *trx;
+	int sk[2];
+
+	OSMO_ASSERT(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sk) == 0);
+	OSMO_ASSERT(shm_link_send_fds(bts, sk[0]) == 0);
+	trx = shm_link_recv_fds(ctx, sk[1]);
+	OSMO_ASSERT(trx != NULL);
+	close(sk[0]);
+	close(sk[1]);
+
+	return trx;
+}
+
+static struct shm_link *test_reattach(struct shm_link *bts, struct shm_link *trx)
+{
+	uint8_t buf[64] = { 0 };
+	int i;
+
+	printf("%s(): the transceiver goes away with records in both rings\n", __func__);
+
+	for (i = 0; i < 3; i++)
+		OSMO_ASSERT(shm_link_push(bts, buf, sizeof(buf)) == 0);
+	for (i = 0; i < 2; i++)
+		OSMO_ASSERT(shm_link_push(trx, buf, sizeof(buf)) == 0);
+	shm_link_free(trx);
+
+	shm_link_reset(bts);
+	trx = trx_attach(bts);
+
+	printf("%s(): after the reset, the new transceiver sees empty rings\n", __func__);
+	OSMO_ASSERT(shm_link_rx_empty(trx));
+	OSMO_ASSERT(shm_link_rx_empty(bts));
+	OSMO_ASSERT(!efd_readable(trx->efd_rx));
+	OSMO_ASSERT(!efd_readable(bts->efd_rx));
+
+	/* ... and is woken up for the first record */
+	buf[0] = 0x42;
+	OSMO_ASSERT(shm_link_push(bts, buf, sizeof(buf)) == 0);
+	OSMO_ASSERT(efd_readable(trx->efd_rx));
+	shm_link_rx_ack(trx);
+	OSMO_ASSERT(shm_link_pop(trx, buf, sizeof(buf)) == sizeof(buf));
+	OSMO_ASSERT(buf[0] == 0x42);
+	printf("%s(): the new transceiver got the next record\n", __func__);
+
+	return trx;
+}
+
+/* Find the length prefix of the record carrying the given payload */
+static uint8_t *find_record_len(struct shm_link *link, const uint8_t *buf, size_t len)
+{
+	uint8_t *map = link->map;
+	size_t i;
+
+	for (i = sizeof(uint32_t); i + len <= link->map_len; i++) {
+		if (memcmp(&map[i], buf, len) == 0)
+			return &map[i - sizeof(uint32_t)];
+	}
+
+	return NULL;
+}
+
+static void pop_corrupt(struct shm_link *bts, uint8_t *rec_len, uint32_t len)
+{
+	uint8_t buf[64];
+	int rc;
+
+	memcpy(rec_len, &len, sizeof(len));
+	rc = shm_link_pop(bts, buf, sizeof(buf));
+	printf("%s(): record length %u: rc=%d (%s)\n",
+	       __func__, len, rc, rc == -EIO ? "EIO" : "unexpected");
+}
+
+/* A broken transceiver can not make the BTS read past the ring */
+static void test_corrupt(struct shm_link *bts, struct shm_link *trx)
+{
+	uint8_t buf[64];
+	uint8_t *rec_len;
+	uint32_t len;
+	int rc;
+
+	printf("%s(): the transceiver corrupts the length of a record\n", __func__);
+
+	memset(buf, 0xa5, sizeof(buf));
+	OSMO_ASSERT(shm_link_push(trx, buf, sizeof(buf)) == 0);
+	rec_len = find_record_len(bts, buf, sizeof(buf));
+	OSMO_ASSERT(rec_len != NULL);
+
+	/* past the end of the data area */
+	pop_corrupt(bts, rec_len, SHM_RING_DEF_SIZE);
+	/* past the end of what was published */
+	pop_corrupt(bts, rec_len, 128);
+
+	/* nothing was consumed */
+	len = sizeof(buf);
+	memcpy(rec_len, &len, sizeof(len));
+	memset(buf, 0x00, sizeof(buf));
+	rc = shm_link_pop(bts, buf, sizeof(buf));
+	OSMO_ASSERT(rc == sizeof(buf) && buf[0] == 0xa5);
+	printf("%s(): the record is popped once its length is restored\n", __func__);
+}
+
+/* Descriptors coming along with an unexpected datagram are closed */
+static void test_recv_bad_fds(void)
+{
+	uint32_t magic = 0;
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} u;
+	struct iovec iov = { .iov_base = &magic, .iov_len = sizeof(magic) };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = u.buf,
+		.msg_controllen = sizeof(u.buf),
+	};
+	struct cmsghdr *cmsg;
+	struct shm_link *link;
+	int sk[2], pfd[2];
+	uint8_t byte;
+	int rc;
+
+	printf("%s(): receiving one descriptor instead of three\n", __func__);
+
+	OSMO_ASSERT(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sk) == 0);
+	OSMO_ASSERT(pipe(pfd) == 0);
+	OSMO_ASSERT(fcntl(pfd[0], F_SETFL, O_NONBLOCK) == 0);
+
+	memset(&u, 0x00, sizeof(u));
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &pfd[1], sizeof(int));
+	OSMO_ASSERT(sendmsg(sk[0], &msg, 0) == sizeof(magic));
+	close(pfd[1]);
+
+	rc = shm_link_recv_msg(ctx, sk[1], &magic, sizeof(magic), &link, 0);
+	printf("%s(): rc=%d (%s), link %s\n", __func__, rc,
+	       rc == -EPROTO ? "EPROTO" : "unexpected", link ? "attached" : "NULL");
+
+	/* the write end was closed by the receiver as well */
+	rc = read(pfd[0], &byte, sizeof(byte));
+	printf("%s(): the write end of the pipe is %s\n", __func__,
+	       rc == 0 ? "closed" : "still open");
+
+	close(pfd[0]);
+	close(sk[0]);
+	close(sk[1]);
+}
+
+int main(int argc, char **argv)
+{
+	struct shm_link *bts, *trx;
+	char name[64];
+
+	ctx = talloc_named_const(NULL, 0, "shm_ring_test");
+
+	snprintf(name, sizeof(name), "/osmo-bts-shm-ring-test.%d", (int) getpid());
+	bts = shm_link_create(ctx, name, SHM_RING_DEF_SIZE);
+	OSMO_ASSERT(bts != NULL);
+
+	trx = trx_attach(bts);
+
+	test_trxd_exchange(bts, trx);
+	test_ring_limits(bts, trx);
+	trx = test_reattach(bts, trx);
+	test_corrupt(bts, trx);
+	test_recv_bad_fds();
+
+	shm_link_free(trx);
+	shm_link_free(bts);
+
+	OSMO_ASSERT(talloc_total_blocks(ctx) == 1);
+	talloc_free(ctx);
+
+	printf("Success\n");
+
+	return 0;
+}
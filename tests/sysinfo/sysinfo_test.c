@@ -0,0 +1,196 @@
+/* Check the precomputed BCCH schedule (see bts_sysinfo_sched_build()) against
+ * the rules of 3GPP TS 05.02 6.3.1.3, as they were applied on each BCCH RTS. */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/gsm_utils.h>
+#include <osmocom/gsm/sysinfo.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/gsm_data.h>
+
+#define ASSERT_TRUE(rc) \
+	if (!(rc)) { \
+		printf("Assert failed in %s:%d.\n",  \
+		       __FILE__, __LINE__);          \
+		abort();			     \
+	}
+
+/* Number of 51-multiframes per configuration */
+#define NUM_MFRMS	(8 * 16)
+
+/* The SI which change the schedule, besides SI2, SI3 and SI4 */
+static const uint8_t opt_si[] = {
+	SYSINFO_TYPE_1,
+	SYSINFO_TYPE_2bis,
+	SYSINFO_TYPE_2ter,
+	SYSINFO_TYPE_2quater,
+	SYSINFO_TYPE_9,
+	SYSINFO_TYPE_13,
+};
+
+static struct gsm_bts bts, ref_bts;
+
+static uint8_t *ref_si2q_inc_index(struct gsm_bts *bts)
+{
+	uint8_t i = bts->si2q_index;
+	bts->si2q_index = (bts->si2q_index + 1) % (bts->si2q_count + 1);
+
+	return (uint8_t *)GSM_BTS_SI2Q(bts, i);
+}
+
+/* bts_sysinfo_get() as it was, evaluating the rules on each call */
+static uint8_t *ref_sysinfo_get(struct gsm_bts *bts, unsigned int tc, bool pcu_connected)
+{
+	unsigned int tc4_cnt = 0;
+	unsigned int tc4_sub[4];
+
+	switch (tc) {
+	case 0:
+		if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_1))
+			return GSM_BTS_SI(bts, SYSINFO_TYPE_1);
+		return GSM_BTS_SI(bts, SYSINFO_TYPE_2);
+	case 1:
+		return GSM_BTS_SI(bts, SYSINFO_TYPE_2);
+	case 2:
+		return GSM_BTS_SI(bts, SYSINFO_TYPE_3);
+	case 3:
+		return GSM_BTS_SI(bts, SYSINFO_TYPE_4);
+	case 4:
+		if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2ter) && GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2bis))
+			tc4_sub[tc4_cnt++] = SYSINFO_TYPE_2ter;
+		if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2quater) &&
+		    (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2bis) || GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2ter)))
+			tc4_sub[tc4_cnt++] = SYSINFO_TYPE_2quater;
+		if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_13) && pcu_connected)
+			tc4_sub[tc4_cnt++] = SYSINFO_TYPE_13;
+		if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_9))
+			tc4_sub[tc4_cnt++] = SYSINFO_TYPE_9;
+		if (tc4_cnt == 0)
+			return GSM_BTS_SI(bts, SYSINFO_TYPE_2);
+		bts->si.tc4_ctr = (bts->si.tc4_ctr + 1) % tc4_cnt;
+		if (tc4_sub[bts->si.tc4_ctr] == SYSINFO_TYPE_2quater)
+			return ref_si2q_inc_index(bts);
+		return GSM_BTS_SI(bts, tc4_sub[bts->si.tc4_ctr]);
+	case 5:
+		if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2bis) && !GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2ter))
+			return GSM_BTS_SI(bts, SYSINFO_TYPE_2bis);
+		else if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2ter) && !GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2bis))
+			return GSM_BTS_SI(bts, SYSINFO_TYPE_2ter);
+		else if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2bis) && GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2ter))
+			return GSM_BTS_SI(bts, SYSINFO_TYPE_2bis);
+		else if (GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2quater) &&
+			 !GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2bis) && !GSM_BTS_HAS_SI(bts, SYSINFO_TYPE_2ter))
+			return ref_si2q_inc_index(bts);
+		else
+			return GSM_BTS_SI(bts, SYSINFO_TYPE_2);
+	case 6:
+		return GSM_BTS_SI(bts, SYSINFO_TYPE_3);
+	case 7:
+		return GSM_BTS_SI(bts, SYSINFO_TYPE_4);
+	}
+
+	OSMO_ASSERT(0);
+	return NULL;
+}
+
+static void print_sched(const struct bts_bcch_sched *sched)
+{
+	unsigned int tc, i;
+
+	for (tc = 0; tc < ARRAY_SIZE(sched->num); tc++) {
+		printf(" TC%u:", tc);
+		for (i = 0; i < sched->num[tc]; i++)
+			printf("%s%s", i ? "," : "", get_value_string(osmo_sitype_strs, sched->si[tc][i]));
+	}
+	printf("\n");
+}
+
+static void test_config(uint32_t si_valid, bool pcu_connected, uint8_t si2q_count)
+{
+	struct gsm_time g_time = { 0 };
+	unsigned int mfrm;
+
+	memset(&bts, 0, sizeof(bts));
+	bts.si_valid = si_valid;
+	bts.si2q_count = si2q_count;
+	ref_bts = bts;
+
+	bts_sysinfo_sched_build(&bts.si.sched, bts.si_valid, pcu_connected);
+
+	/* The same SI buffers, and the same SI2quater instances, for each TC */
+	for (mfrm = 0; mfrm < NUM_MFRMS; mfrm++) {
+		const uint8_t *si, *ref_si;
+
+		g_time.tc = mfrm % 8;
+		si = bts_sysinfo_get(&bts, &g_time);
+		ref_si = ref_sysinfo_get(&ref_bts, g_time.tc, pcu_connected);
+		ASSERT_TRUE(si - (uint8_t *)&bts == ref_si - (uint8_t *)&ref_bts);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const uint32_t si_always = (1 << SYSINFO_TYPE_2) | (1 << SYSINFO_TYPE_3) | (1 << SYSINFO_TYPE_4);
+	struct bts_bcch_sched sched;
+	unsigned int mask, i, num = 0;
+	uint32_t si_valid;
+
+	printf("Testing the BCCH schedule against the rules of TS 05.02 6.3.1.3\n");
+
+	for (mask = 0; mask < (1 << ARRAY_SIZE(opt_si)); mask++) {
+		si_valid = si_always;
+		for (i = 0; i < ARRAY_SIZE(opt_si); i++) {
+			if (mask & (1 << i))
+				si_valid |= 1 << opt_si[i];
+		}
+
+		test_config(si_valid, false, 0);
+		test_config(si_valid, true, 0);
+		test_config(si_valid, true, 3);
+		num += 3;
+	}
+	printf("%u configurations checked\n", num);
+
+	printf("SI2, SI3, SI4:");
+	bts_sysinfo_sched_build(&sched, si_always, true);
+	print_sched(&sched);
+
+	printf("SI1, SI2quater, SI13 (PCU not connected):");
+	si_valid = si_always | (1 << SYSINFO_TYPE_1) | (1 << SYSINFO_TYPE_2quater) | (1 << SYSINFO_TYPE_13);
+	bts_sysinfo_sched_build(&sched, si_valid, false);
+	print_sched(&sched);
+
+	printf("All SI (PCU connected):");
+	si_valid = si_always;
+	for (i = 0; i < ARRAY_SIZE(opt_si); i++)
+		si_valid |= 1 << opt_si[i];
+	bts_sysinfo_sched_build(&sched, si_valid, true);
+	print_sched(&sched);
+
+	printf("Success\n");
+
+	return 0;
+}
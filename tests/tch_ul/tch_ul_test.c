@@ -0,0 +1,306 @@
+/* Check that the ring of Uplink TCH bursts (see tch_ul_ring_push()) hands
+ * exactly the same bits to the decoders as the shifted burst buffer did. */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/coding/gsm0503_coding.h>
+
+#include <osmo-bts/scheduler.h>
+
+#include "sched_utils.h"
+
+#define ASSERT_TRUE(rc) \
+	if (!(rc)) { \
+		printf("Assert failed in %s:%d.\n",  \
+		       __FILE__, __LINE__);          \
+		abort();			     \
+	}
+
+/* Number of TCH blocks per mode */
+#define NUM_BLOCKS	(26 * 8)
+
+enum tch_dec {
+	DEC_FR,
+	DEC_EFR,
+	DEC_AFS,
+	DEC_F96,
+	DEC_F144,
+	DEC_HR,
+	DEC_AHS,
+	DEC_H48,
+};
+
+struct tch_test_mode {
+	const char *name;
+	enum tch_dec dec;
+	unsigned int n;		/* bursts per block: 4 on TCH/F, 2 on TCH/H */
+	unsigned int len;	/* payload length (bytes, or bits for CSD) */
+};
+
+static const struct tch_test_mode modes[] = {
+	{ "TCH/FS",	DEC_FR,		4, GSM_FR_BYTES },
+	{ "TCH/EFS",	DEC_EFR,	4, GSM_EFR_BYTES },
+	{ "TCH/AFS",	DEC_AFS,	4, 31 },	/* AMR 12.2 */
+	{ "TCH/F9.6",	DEC_F96,	4, 4 * 60 },
+	{ "TCH/F14.4",	DEC_F144,	4, 290 },
+	{ "TCH/HS",	DEC_HR,		2, GSM_HR_BYTES },
+	{ "TCH/AHS",	DEC_AHS,	2, 20 },	/* AMR 7.4 */
+	{ "TCH/H4.8",	DEC_H48,	2, 2 * 60 },
+};
+
+/* Deterministic pseudo-random numbers, so that the results are reproducible */
+static uint32_t rand_state;
+
+static uint32_t test_rand(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return rand_state >> 8;
+}
+
+/* The Uplink burst buffer as it was before, see ref_push() */
+struct ref_buf {
+	sbit_t bursts[BUFMAX * BPLEN];
+	uint32_t mask;
+};
+
+/* Copied from rx_tch[fh]_fn() as they were before the ring */
+static void ref_push(struct ref_buf *ref, const struct trx_ul_burst_ind *bi, unsigned int n)
+{
+	sbit_t *burst, *bursts_p = ref->bursts;
+	uint32_t *mask = &ref->mask;
+
+	/* shift the buffer by 4 (TCH/F) or 2 (TCH/H) bursts leftwards */
+	if (n == 4 && bi->bid == 0) {
+		memmove(BUFPOS(bursts_p, 0), BUFPOS(bursts_p, 4), 20 * BPLEN);
+		memset(BUFPOS(bursts_p, 20), 0, 4 * BPLEN);
+		*mask = *mask << 4;
+	}
+	if (n == 2 && bi->bid == 0) {
+		memmove(BUFPOS(bursts_p, 0), BUFPOS(bursts_p, 2), 20 * BPLEN);
+		memset(BUFPOS(bursts_p, 20), 0, 2 * BPLEN);
+		*mask = *mask << 2;
+	}
+
+	/* update mask */
+	*mask |= (1 << bi->bid);
+
+	/* copy burst to end of buffer of 24 bursts */
+	burst = BUFPOS(bursts_p, 20 + bi->bid);
+	if (bi->burst_len > 0) {
+		memcpy(burst, bi->burst + 3, 58);
+		memcpy(burst + 58, bi->burst + 87, 58);
+	}
+}
+
+/* Encode a random frame into the shifted Downlink buffer, as tx_tch[fh]_fn() do */
+static void dl_encode(const struct tch_test_mode *m, ubit_t *dl, uint8_t *codec)
+{
+	uint8_t data[290];
+	unsigned int i;
+
+	/* shift the buffer by 4 (TCH/F) or 2 (TCH/H) bursts leftwards */
+	memmove(BUFPOS(dl, 0), BUFPOS(dl, m->n), 20 * BPLEN);
+	memset(BUFPOS(dl, 20), 0, m->n * BPLEN);
+
+	for (i = 0; i < m->len; i++)
+		data[i] = test_rand();
+
+	switch (m->dec) {
+	case DEC_FR:
+		data[0] = 0xd0 | (data[0] & 0x0f);
+		gsm0503_tch_fr_encode(BUFPOS(dl, 0), data, m->len, 1);
+		break;
+	case DEC_EFR:
+		data[0] = 0xc0 | (data[0] & 0x0f);
+		gsm0503_tch_fr_encode(BUFPOS(dl, 0), data, m->len, 1);
+		break;
+	case DEC_AFS:
+		gsm0503_tch_afs_encode(BUFPOS(dl, 0), data, m->len, 0, codec, 1, 0, 0);
+		break;
+	case DEC_F96:
+		for (i = 0; i < m->len; i++)
+			data[i] &= 1;
+		gsm0503_tch_fr96_encode(BUFPOS(dl, 0), data);
+		break;
+	case DEC_F144:
+		for (i = 0; i < m->len; i++)
+			data[i] &= 1;
+		gsm0503_tch_fr144_encode(BUFPOS(dl, 0), data);
+		break;
+	case DEC_HR:
+		data[0] &= 0x7f; /* no SID */
+		gsm0503_tch_hr_encode(BUFPOS(dl, 0), data, m->len);
+		break;
+	case DEC_AHS:
+		gsm0503_tch_ahs_encode(BUFPOS(dl, 0), data, m->len, 0, codec, 1, 0, 0);
+		break;
+	case DEC_H48:
+		for (i = 0; i < m->len; i++)
+			data[i] &= 1;
+		gsm0503_tch_hr48_encode(BUFPOS(dl, 0), data);
+		break;
+	}
+}
+
+struct dec_result {
+	int rc;
+	int n_errors;
+	int n_bits_total;
+	uint8_t data[290];
+};
+
+/* Run the decoder of the given mode on a window of BUFMAX bursts,
+ * with the same arguments as rx_tch[fh]_fn() */
+static void decode(const struct tch_test_mode *m, const sbit_t *bursts_p,
+		   uint8_t *codec, struct dec_result *res)
+{
+	uint8_t ft = 0, cmr = 0, dtx = 0;
+
+	memset(res, 0, sizeof(*res));
+
+	switch (m->dec) {
+	case DEC_FR:
+	case DEC_EFR:
+		res->rc = gsm0503_tch_fr_decode(res->data, BUFTAIL8(bursts_p), 1, m->dec == DEC_EFR,
+						&res->n_errors, &res->n_bits_total);
+		break;
+	case DEC_AFS:
+		res->rc = gsm0503_tch_afs_decode_dtx(res->data, BUFTAIL8(bursts_p), 0, codec, 1,
+						     &ft, &cmr, &res->n_errors, &res->n_bits_total,
+						     &dtx);
+		break;
+	case DEC_F96:
+		res->rc = gsm0503_tch_fr96_decode(res->data, BUFPOS(bursts_p, 0),
+						  &res->n_errors, &res->n_bits_total);
+		break;
+	case DEC_F144:
+		res->rc = gsm0503_tch_fr144_decode(res->data, BUFPOS(bursts_p, 0),
+						   &res->n_errors, &res->n_bits_total);
+		break;
+	case DEC_HR:
+		res->rc = gsm0503_tch_hr_decode2(res->data, BUFTAIL8(bursts_p), 1,
+						 &res->n_errors, &res->n_bits_total);
+		break;
+	case DEC_AHS:
+		res->rc = gsm0503_tch_ahs_decode_dtx(res->data, BUFTAIL8(bursts_p), 1, 0, codec, 1,
+						     &ft, &cmr, &res->n_errors, &res->n_bits_total,
+						     &dtx);
+		break;
+	case DEC_H48:
+		res->rc = gsm0503_tch_hr48_decode(res->data, BUFPOS(bursts_p, 0),
+						  &res->n_errors, &res->n_bits_total);
+		break;
+	}
+}
+
+static void test_mode(const struct tch_test_mode *m)
+{
+	const uint32_t full_mask = (m->n == 4) ? 0xff : 0x3f;
+	static sbit_t ring_bursts[UL_RING_BUFMAX * BPLEN];
+	static ubit_t dl[BUFMAX * BPLEN];
+	struct l1sched_chan_state chan_state;
+	struct trx_ul_burst_ind bi;
+	struct ref_buf ref;
+	uint8_t codec[1] = { m->dec == DEC_AFS ? 7 : 4 };
+	unsigned int blk, bid, i;
+	unsigned int lost = 0, nope = 0, decoded = 0, good = 0;
+
+	rand_state = 0x2342;
+	memset(&ref, 0, sizeof(ref));
+	memset(&chan_state, 0, sizeof(chan_state));
+	memset(ring_bursts, 0, sizeof(ring_bursts));
+	memset(dl, 0, sizeof(dl));
+	chan_state.ul_bursts = ring_bursts;
+
+	for (blk = 0; blk < NUM_BLOCKS; blk++) {
+		dl_encode(m, dl, codec);
+
+		for (bid = 0; bid < m->n; bid++) {
+			const ubit_t *burst = BUFPOS(dl, bid);
+			const uint32_t r = test_rand();
+
+			memset(&bi, 0, sizeof(bi));
+			bi.bid = bid;
+
+			/* Lose a burst now and then, or get a NOPE.ind instead */
+			if (r % 29 == 0) {
+				lost++;
+				continue;
+			} else if (r % 31 == 0) {
+				nope++;
+				bi.burst_len = 0;
+			} else {
+				osmo_ubit2sbit(&bi.burst[3], &burst[0], 58);
+				osmo_ubit2sbit(&bi.burst[87], &burst[58], 58);
+				/* ... and disturb some bits */
+				for (i = 0; i < 4; i++)
+					bi.burst[3 + (test_rand() % 58)] = 0;
+				bi.burst_len = GSM_BURST_LEN;
+			}
+
+			ref_push(&ref, &bi, m->n);
+			tch_ul_ring_push(&chan_state, &bi, m->n);
+			ASSERT_TRUE(ref.mask == chan_state.ul_mask);
+
+			/* Same conditions as in rx_tch[fh]_fn() */
+			if (bid == m->n - 1 && (ref.mask & full_mask) == full_mask) {
+				struct dec_result ref_res, ring_res;
+
+				ASSERT_TRUE(memcmp(ref.bursts, tch_ul_window(&chan_state),
+						   BUFMAX * BPLEN) == 0);
+
+				decode(m, ref.bursts, codec, &ref_res);
+				decode(m, tch_ul_window(&chan_state), codec, &ring_res);
+				ASSERT_TRUE(memcmp(&ref_res, &ring_res, sizeof(ref_res)) == 0);
+
+				decoded++;
+				if (ref_res.rc > 0)
+					good++;
+			}
+		}
+	}
+
+	printf("%-9s: %u blocks, %u bursts lost, %u NOPE, %u decoded, bit-exact\n",
+	       m->name, NUM_BLOCKS, lost, nope, decoded);
+	fprintf(stderr, "%-9s: %u of %u frames decoded successfully\n",
+		m->name, good, decoded);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int i;
+
+	printf("Testing the Uplink TCH burst ring against the shifted buffer\n");
+
+	for (i = 0; i < ARRAY_SIZE(modes); i++)
+		test_mode(&modes[i]);
+
+	printf("Success\n");
+
+	return 0;
+}
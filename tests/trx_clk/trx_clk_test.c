@@ -0,0 +1,195 @@
+/* Simulate the TRX frame clock handling with a drifting and jittery
+ * transceiver clock, with and without the drift tracking filter. */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "trx_clk_filter.h"
+
+#define ASSERT_TRUE(rc) \
+	if (!(rc)) { \
+		printf("Assert failed in %s:%d.\n",  \
+		       __FILE__, __LINE__);          \
+		abort();			     \
+	}
+
+/* The transceiver sends a clock indication every 216 frames (~1 s) */
+#define CLK_IND_PERIOD_FN	216
+/* Simulated duration: one hour */
+#define SIM_CLK_INDS		3600
+/* Settling time, not taken into account for the results */
+#define SIM_SETTLE_INDS		300
+
+struct sim_params {
+	double drift_ppm;	/* drift of the TRX clock against the local one */
+	double jitter_us;	/* jitter (standard deviation) of the clock indications */
+};
+
+struct sim_result {
+	unsigned int faster;	/* "We were N FN faster than TRX" events */
+	unsigned int slower;	/* "We were N FN slower than TRX" events */
+	double max_phase_err_us;
+	double drift_ppm;
+	double jitter_us;
+};
+
+/* Deterministic pseudo-random numbers, so that the results are reproducible */
+static uint32_t sim_rand_state;
+
+static double sim_rand_uniform(void)
+{
+	sim_rand_state = sim_rand_state * 1103515245 + 12345;
+	return (double)(sim_rand_state >> 8) / (1 << 24) - 0.5;
+}
+
+/* Approximately normally distributed (Irwin-Hall), unit variance */
+static double sim_rand_normal(void)
+{
+	double sum = 0.0;
+	unsigned int i;
+
+	for (i = 0; i < 12; i++)
+		sum += sim_rand_uniform() + 0.5;
+	return sum - 6.0;
+}
+
+/* Mirrors trx_sched_clock() and the timerfd: the local timer fires every
+ * 'period' us, each expiry processes one frame; clock indications carry
+ * the frame number of the TRX and arrive with some jitter. */
+static void sim_run(const struct sim_params *p, bool use_filter, struct sim_result *res)
+{
+	struct trx_clk_filter f;
+	double tick_us = 0.0, period_us;
+	double clk_prev_us = 0.0;
+	int64_t tick_fn = 0, clk_prev_fn = 0;
+	bool clk_prev_valid = false;
+	unsigned int i;
+
+	trx_clk_filter_init(&f);
+	period_us = f.nominal_us;
+	sim_rand_state = 0x2342;
+	*res = (struct sim_result) { 0 };
+
+	for (i = 1; i <= SIM_CLK_INDS; i++) {
+		const int64_t fn = (int64_t) i * CLK_IND_PERIOD_FN;
+		const double t_us = fn * f.nominal_us * (1.0 + p->drift_ppm / 1000000.0)
+				  + p->jitter_us * sim_rand_normal();
+		int64_t elapsed_fn;
+		double elapsed_us, phase_err_us;
+
+		/* Let the local timer process all frames due until now */
+		while (tick_us + period_us <= t_us) {
+			tick_us += period_us;
+			tick_fn++;
+		}
+
+		elapsed_fn = fn - tick_fn;
+		elapsed_us = t_us - tick_us;
+		/* against the middle of the frame, see trx_clk_filter.c */
+		phase_err_us = elapsed_fn * f.nominal_us - elapsed_us + f.nominal_us / 2;
+
+		/* the first clock indication only serves as the reference of the next one */
+		if (use_filter && clk_prev_valid) {
+			/* the local time is measured in (rounded) us */
+			period_us = trx_clk_filter_update(&f, (int64_t)(t_us - clk_prev_us + 0.5),
+							  fn - clk_prev_fn, (int64_t)(elapsed_us + 0.5),
+							  elapsed_fn);
+		}
+		clk_prev_valid = true;
+		clk_prev_us = t_us;
+		clk_prev_fn = fn;
+
+		if (i > SIM_SETTLE_INDS) {
+			double abs_err = phase_err_us < 0 ? -phase_err_us : phase_err_us;
+			if (abs_err > res->max_phase_err_us)
+				res->max_phase_err_us = abs_err;
+			if (elapsed_fn < 0)
+				res->faster++;
+			else if (elapsed_fn > 0)
+				res->slower++;
+		}
+
+		if (elapsed_fn < 0) {
+			/* Delay the timer by the frames processed too early */
+			tick_us = t_us - elapsed_fn * f.nominal_us;
+			tick_fn = fn;
+		} else if (elapsed_fn > 0) {
+			/* Catch up immediately */
+			tick_us = t_us;
+			tick_fn = fn;
+		} else {
+			/* The timer is re-armed with the new period */
+		}
+	}
+
+	res->drift_ppm = f.drift_ppm;
+	res->jitter_us = f.jitter_us;
+}
+
+static void test_sim(const struct sim_params *p)
+{
+	struct sim_result fixed, filtered;
+
+	sim_run(p, false, &fixed);
+	sim_run(p, true, &filtered);
+
+	printf("drift %+6.1f ppm, jitter %4.0f us: fixed period: %4u faster, %4u slower; "
+	       "filter: %u faster, %u slower, drift estimate %s\n",
+	       p->drift_ppm, p->jitter_us, fixed.faster, fixed.slower,
+	       filtered.faster, filtered.slower,
+	       fabs(filtered.drift_ppm - p->drift_ppm) < 0.2 ? "within 0.2 ppm" : "off");
+
+	/* The filter shall keep the timer in lock: no frame skipped or caught up */
+	ASSERT_TRUE(filtered.faster == 0 && filtered.slower == 0);
+	/* ... and converge to the simulated drift */
+	ASSERT_TRUE(fabs(filtered.drift_ppm - p->drift_ppm) < 0.2);
+
+	fprintf(stderr, "  max phase error %7.1f us (fixed), %7.1f us (filter), "
+		"residual jitter %5.1f us, estimated drift %+8.3f ppm\n",
+		fixed.max_phase_err_us, filtered.max_phase_err_us,
+		filtered.jitter_us, filtered.drift_ppm);
+}
+
+int main(int argc, char **argv)
+{
+	static const struct sim_params params[] = {
+		{ .drift_ppm =   0.0, .jitter_us =  50.0 },
+		{ .drift_ppm =  +2.0, .jitter_us =  50.0 },
+		{ .drift_ppm =  -2.0, .jitter_us =  50.0 },
+		{ .drift_ppm = +20.0, .jitter_us = 100.0 },
+		{ .drift_ppm = -20.0, .jitter_us = 100.0 },
+		{ .drift_ppm = +50.0, .jitter_us = 300.0 },
+	};
+	unsigned int i;
+
+	printf("Testing TRX clock drift tracking (%u clock indications)\n", SIM_CLK_INDS);
+
+	for (i = 0; i < sizeof(params) / sizeof(params[0]); i++)
+		test_sim(&params[i]);
+
+	printf("Success\n");
+
+	return 0;
+}
@@ -0,0 +1,486 @@
+/* Benchmark of the TRXC provisioning sequence against a fake transceiver.
+ *
+ * When the PHY link is opened, osmo-bts-trx provisions each transceiver
+ * with a series of TRXC commands (see trx_provision_fsm.c): tuning, TSC,
+ * BSIC and TRXD PDU version, then POWERON, then gain, delay limits and
+ * the configuration of each timeslot.  Every stage waits for all of its
+ * responses before the next one starts, so the time this takes is
+ * dominated by the round trips to the transceiver.
+ *
+ * This program replays that sequence through the real TRXC code of
+ * trx_if.c against a fake transceiver running in a separate thread.  The
+ * fake transceiver handles one command at a time, and answers each of
+ * them after a processing time plus a simulated round trip time; it can
+ * also drop commands to exercise the retransmissions.  The provisioning
+ * time is reported for different 'osmotrx trxc-window' sizes.  This is
+ * not part of the testsuite, run it manually:
+ *
+ *   ./trxc_bench --num-trx 4 --rtt-us 1000 --proc-us 50 --loss 2
+ */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/fsm.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/phy_link.h>
+
+#include "l1_if.h"
+#include "trx_if.h"
+#include "trxc_stubs.h"
+
+#define BENCH_MAX_TRX		8
+#define BENCH_PORT_LOCAL	25800
+#define BENCH_PORT_REMOTE	25700
+/* Maximum number of responses waiting for the simulated round trip */
+#define FAKE_RSP_QUEUE		256
+
+static struct {
+	unsigned int num_trx;
+	unsigned int rtt_us;
+	unsigned int proc_us;
+	unsigned int loss;
+	unsigned int runs;
+	unsigned int window;	/* 0: try all of 1, 2, 4, 8, 16 */
+} cfg = {
+	.num_trx = 1,
+	.rtt_us = 1000,
+	.proc_us = 50,
+	.loss = 0,
+	.runs = 10,
+	.window = 0,
+};
+
+static struct phy_link *plink;
+static struct trx_l1h *l1h[BENCH_MAX_TRX];
+
+/* The same command sequence as trx_provision_fsm.c: one TRXC command and
+ * whether it's critical, stages are separated by { NULL } entries. */
+static const struct bench_cmd {
+	const char *cmd;
+	const char *params;
+	int critical;
+} prov_seq[] = {
+	{ "RFMUTE",	 "1",		0 },
+	{ "RXTUNE",	 "1710200",	1 },
+	{ "TXTUNE",	 "1805200",	1 },
+	{ "NOMTXPOWER",	 "",		1 },
+	{ "SETTSC",	 "7",		1 },
+	{ "SETBSIC",	 "63",		1 },
+	{ "SETFORMAT",	 "2",		0 },
+	{ NULL },
+	{ "POWERON",	 "",		1 },
+	{ NULL },
+	{ "SETRXGAIN",	 "40",		0 },
+	{ "SETMAXDLY",	 "63",		0 },
+	{ "SETMAXDLYNB", "63",		0 },
+	{ "SETSLOT",	 "0 5",		1 },
+	{ "SETSLOT",	 "1 7",		1 },
+	{ "SETSLOT",	 "2 1",		1 },
+	{ "SETSLOT",	 "3 1",		1 },
+	{ "SETSLOT",	 "4 1",		1 },
+	{ "SETSLOT",	 "5 1",		1 },
+	{ "SETSLOT",	 "6 13",	1 },
+	{ "SETSLOT",	 "7 13",	1 },
+	{ NULL },
+};
+
+static uint64_t now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ * Fake transceiver
+ */
+
+struct fake_rsp {
+	uint64_t due_us;
+	int fd;
+	struct sockaddr_in to;
+	char buf[128];
+};
+
+static struct {
+	pthread_t thread;
+	int fd[BENCH_MAX_TRX];
+	volatile bool stop;
+	/* the control loop is busy with previous commands until then */
+	uint64_t busy_us;
+	struct fake_rsp q[FAKE_RSP_QUEUE];
+	unsigned int q_head, q_len;
+	uint32_t rand_state;
+	/* statistics */
+	unsigned int rx_cmds;
+	unsigned int dropped;
+} fake;
+
+static uint32_t fake_rand(void)
+{
+	fake.rand_state = fake.rand_state * 1103515245 + 12345;
+	return fake.rand_state >> 8;
+}
+
+static void fake_trx_handle_cmd(int fd)
+{
+	struct sockaddr_in from;
+	socklen_t from_len = sizeof(from);
+	char buf[TRXC_MSG_BUF_SIZE];
+	char verb[32], *params;
+	struct fake_rsp *rsp;
+	uint64_t now;
+	ssize_t len;
+
+	len = recvfrom(fd, buf, sizeof(buf) - 1, 0, (struct sockaddr *) &from, &from_len);
+	if (len <= 0)
+		return;
+	buf[len] = '\0';
+	fake.rx_cmds++;
+
+	if (cfg.loss && fake_rand() % 100 < cfg.loss) {
+		fake.dropped++;
+		return;
+	}
+
+	if (sscanf(buf, "CMD %31s", verb) != 1)
+		return;
+	params = buf + 4 + strlen(verb);
+	if (*params == ' ')
+		params++;
+
+	OSMO_ASSERT(fake.q_len < FAKE_RSP_QUEUE);
+	rsp = &fake.q[(fake.q_head + fake.q_len++) % FAKE_RSP_QUEUE];
+	rsp->fd = fd;
+	rsp->to = from;
+
+	if (!strcmp(verb, "NOMTXPOWER"))
+		snprintf(rsp->buf, sizeof(rsp->buf), "RSP %s 0 23", verb);
+	else if (!strcmp(verb, "SETFORMAT")) /* accept the requested version */
+		snprintf(rsp->buf, sizeof(rsp->buf), "RSP %s %s %s", verb, params, params);
+	else
+		snprintf(rsp->buf, sizeof(rsp->buf), "RSP %s 0%s%s", verb, *params ? " " : "", params);
+
+	/* Commands are handled one after the other */
+	now = now_us();
+	if (fake.busy_us < now)
+		fake.busy_us = now;
+	fake.busy_us += cfg.proc_us;
+	rsp->due_us = fake.busy_us + cfg.rtt_us;
+}
+
+static void *fake_trx_main(void *arg)
+{
+	struct pollfd pfd[BENCH_MAX_TRX];
+	unsigned int i;
+
+	for (i = 0; i < cfg.num_trx; i++) {
+		pfd[i].fd = fake.fd[i];
+		pfd[i].events = POLLIN;
+	}
+
+	while (!fake.stop) {
+		int timeout_ms = 10;
+		uint64_t now = now_us();
+
+		/* send the responses which are due */
+		while (fake.q_len > 0 && fake.q[fake.q_head].due_us <= now) {
+			struct fake_rsp *rsp = &fake.q[fake.q_head];
+			sendto(rsp->fd, rsp->buf, strlen(rsp->buf) + 1, 0,
+			       (struct sockaddr *) &rsp->to, sizeof(rsp->to));
+			fake.q_head = (fake.q_head + 1) % FAKE_RSP_QUEUE;
+			fake.q_len--;
+		}
+		if (fake.q_len > 0) {
+			/* round up, a response shall never be sent early */
+			timeout_ms = (fake.q[fake.q_head].due_us - now + 999) / 1000;
+		}
+
+		if (poll(pfd, cfg.num_trx, timeout_ms) <= 0)
+			continue;
+		for (i = 0; i < cfg.num_trx; i++) {
+			if (pfd[i].revents & POLLIN)
+				fake_trx_handle_cmd(pfd[i].fd);
+		}
+	}
+
+	return NULL;
+}
+
+static void fake_trx_start(void)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	unsigned int i;
+
+	for (i = 0; i < cfg.num_trx; i++) {
+		fake.fd[i] = socket(AF_INET, SOCK_DGRAM, 0);
+		OSMO_ASSERT(fake.fd[i] >= 0);
+		/* TRXC port of the transceiver, see compute_port() */
+		addr.sin_port = htons(BENCH_PORT_REMOTE + (i << 1) + 1);
+		if (bind(fake.fd[i], (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+			perror("bind()");
+			exit(1);
+		}
+	}
+
+	fake.rand_state = 0x2342;
+	OSMO_ASSERT(pthread_create(&fake.thread, NULL, fake_trx_main, NULL) == 0);
+}
+
+static void fake_trx_stop(void)
+{
+	fake.stop = true;
+	pthread_join(fake.thread, NULL);
+}
+
+/*
+ * BTS side
+ */
+
+static void setup_phy(void)
+{
+	struct phy_instance *pinst;
+	unsigned int i;
+
+	OSMO_ASSERT(osmo_fsm_register(&trxc_stub_prov_fsm) == 0);
+
+	plink = phy_link_create(tall_bts_ctx, 0);
+	OSMO_ASSERT(plink != NULL);
+	plink->type = PHY_LINK_T_OSMOTRX;
+	plink->u.osmotrx.local_ip = talloc_strdup(plink, "127.0.0.1");
+	plink->u.osmotrx.remote_ip = talloc_strdup(plink, "127.0.0.1");
+	plink->u.osmotrx.base_port_local = BENCH_PORT_LOCAL;
+	plink->u.osmotrx.base_port_remote = BENCH_PORT_REMOTE;
+	plink->u.osmotrx.trxc_window = 1;
+
+	for (i = 0; i < cfg.num_trx; i++) {
+		pinst = phy_instance_create(plink, i);
+		OSMO_ASSERT(pinst != NULL);
+
+		l1h[i] = talloc_zero(tall_bts_ctx, struct trx_l1h);
+		l1h[i]->phy_inst = pinst;
+		l1h[i]->provision_fi = osmo_fsm_inst_alloc(&trxc_stub_prov_fsm, l1h[i], l1h[i],
+							   LOGL_INFO, NULL);
+		l1h[i]->config.trxd_pdu_ver_req = TRX_DATA_PDU_VER;
+		trx_if_init(l1h[i]);
+		pinst->u.osmotrx.hdl = l1h[i];
+	}
+
+	if (bts_model_phy_link_open(plink) < 0) {
+		fprintf(stderr, "unable to open the PHY link\n");
+		exit(1);
+	}
+}
+
+static bool bench_idle(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < cfg.num_trx; i++) {
+		/* never more commands in flight than the window allows */
+		OSMO_ASSERT(l1h[i]->trx_ctrl_in_flight <= plink->u.osmotrx.trxc_window);
+		if (!llist_empty(&l1h[i]->trx_ctrl_list))
+			return false;
+	}
+
+	return true;
+}
+
+/* Provision all transceivers, as on startup; returns the time it took */
+static uint64_t bench_provision(void)
+{
+	const struct bench_cmd *c;
+	uint64_t start = now_us();
+	unsigned int i;
+
+	for (c = &prov_seq[0]; c < &prov_seq[ARRAY_SIZE(prov_seq)]; c++) {
+		if (c->cmd != NULL) {
+			for (i = 0; i < cfg.num_trx; i++)
+				trx_ctrl_cmd_cb(l1h[i], c->critical, NULL, c->cmd, "%s", c->params);
+			continue;
+		}
+
+		/* end of a stage: wait for all responses */
+		while (!bench_idle())
+			osmo_select_main(0);
+	}
+
+	return now_us() - start;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	const uint64_t *x = a, *y = b;
+
+	return (*x > *y) - (*x < *y);
+}
+
+static void bench_window(unsigned int window)
+{
+	unsigned int num_cmds = 0, rx_cmds, dropped, i;
+	uint64_t *t;
+
+	t = talloc_zero_array(tall_bts_ctx, uint64_t, cfg.runs);
+	OSMO_ASSERT(t != NULL);
+
+	for (i = 0; i < ARRAY_SIZE(prov_seq); i++) {
+		if (prov_seq[i].cmd != NULL)
+			num_cmds += cfg.num_trx;
+	}
+
+	plink->u.osmotrx.trxc_window = window;
+	rx_cmds = fake.rx_cmds;
+	dropped = fake.dropped;
+
+	for (i = 0; i < cfg.runs; i++)
+		t[i] = bench_provision();
+	qsort(t, cfg.runs, sizeof(t[0]), cmp_u64);
+
+	/* The fake transceiver is idle by now, its statistics are stable */
+	rx_cmds = fake.rx_cmds - rx_cmds;
+	dropped = fake.dropped - dropped;
+
+	printf("window %2u: provisioning p50 %8.2f ms, min %8.2f ms, max %8.2f ms; "
+	       "%u commands, %u retransmitted, %u dropped\n",
+	       window, t[cfg.runs / 2] / 1000.0, t[0] / 1000.0, t[cfg.runs - 1] / 1000.0,
+	       num_cmds * cfg.runs, rx_cmds - num_cmds * cfg.runs, dropped);
+
+	talloc_free(t);
+}
+
+static void print_help(void)
+{
+	printf("Usage: trxc_bench [options]\n"
+	       "  -t --num-trx N     Number of transceivers (default %u, max %u)\n"
+	       "  -r --rtt-us N      Round trip time to the transceiver (default %u us)\n"
+	       "  -p --proc-us N     Processing time per command (default %u us)\n"
+	       "  -l --loss N        Drop N %% of the commands (default %u)\n"
+	       "  -n --runs N        Provisioning runs per window size (default %u)\n"
+	       "  -w --window N      Only use the given window size (default: 1 to %u)\n",
+	       cfg.num_trx, BENCH_MAX_TRX, cfg.rtt_us, cfg.proc_us, cfg.loss,
+	       cfg.runs, TRXC_WINDOW_MAX);
+}
+
+static void handle_options(int argc, char **argv)
+{
+	while (1) {
+		int option_index = 0, c;
+		static const struct option long_options[] = {
+			{ "help", 0, 0, 'h' },
+			{ "num-trx", 1, 0, 't' },
+			{ "rtt-us", 1, 0, 'r' },
+			{ "proc-us", 1, 0, 'p' },
+			{ "loss", 1, 0, 'l' },
+			{ "runs", 1, 0, 'n' },
+			{ "window", 1, 0, 'w' },
+			{ 0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "ht:r:p:l:n:w:", long_options, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			print_help();
+			exit(0);
+		case 't':
+			cfg.num_trx = atoi(optarg);
+			break;
+		case 'r':
+			cfg.rtt_us = atoi(optarg);
+			break;
+		case 'p':
+			cfg.proc_us = atoi(optarg);
+			break;
+		case 'l':
+			cfg.loss = atoi(optarg);
+			break;
+		case 'n':
+			cfg.runs = atoi(optarg);
+			break;
+		case 'w':
+			cfg.window = atoi(optarg);
+			break;
+		default:
+			print_help();
+			exit(1);
+		}
+	}
+
+	if (cfg.num_trx < 1 || cfg.num_trx > BENCH_MAX_TRX || cfg.runs < 1 ||
+	    cfg.loss >= 100 || cfg.window > TRXC_WINDOW_MAX) {
+		print_help();
+		exit(1);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int window;
+
+	handle_options(argc, argv);
+
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+	/* Retransmissions are logged, keep quiet */
+	log_set_log_level(osmo_stderr_target, LOGL_FATAL);
+
+	fake_trx_start();
+	setup_phy();
+
+	printf("Provisioning %u TRX (%u runs), RTT %u us, %u us per command, %u%% loss\n",
+	       cfg.num_trx, cfg.runs, cfg.rtt_us, cfg.proc_us, cfg.loss);
+
+	if (cfg.window) {
+		bench_window(cfg.window);
+	} else {
+		for (window = 1; window <= TRXC_WINDOW_MAX; window <<= 1)
+			bench_window(window);
+	}
+
+	fake_trx_stop();
+
+	return 0;
+}
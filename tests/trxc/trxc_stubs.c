@@ -0,0 +1,196 @@
+/* Stand-ins for the parts of the BTS model and of osmo-bts-trx which
+ * trx_if.c depends on, so that the TRXC code can be run on its own.
+ *
+ * tests/stubs.c can not be used here: trx_if.c brings the real
+ * bts_model_phy_link_open().
+ */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <osmocom/core/fsm.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/bts_model.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/phy_link.h>
+
+#include "l1_if.h"
+#include "trx_provision_fsm.h"
+#include "trxc_stubs.h"
+
+struct femtol1_hdl;
+
+/* BTS model, see tests/stubs.c */
+int bts_model_chg_adm_state(struct gsm_bts *bts, struct gsm_abis_mo *mo,
+			    void *obj, uint8_t adm_state)
+{ return 0; }
+int bts_model_init(struct gsm_bts *bts)
+{ return 0; }
+int bts_model_trx_init(struct gsm_bts_trx *trx)
+{ return 0; }
+int bts_model_apply_oml(struct gsm_bts *bts, const struct msgb *msg,
+			 struct gsm_abis_mo *mo, void *obj)
+{ return 0; }
+
+int bts_model_trx_deact_rf(struct gsm_bts_trx *trx)
+{ return 0; }
+void bts_model_trx_close(struct gsm_bts_trx *trx)
+{ bts_model_trx_close_cb(trx, 0); }
+int bts_model_check_oml(struct gsm_bts *bts, uint8_t msg_type,
+			struct tlv_parsed *old_attr, struct tlv_parsed *new_attr,
+			void *obj)
+{ return 0; }
+int bts_model_opstart(struct gsm_bts *bts, struct gsm_abis_mo *mo,
+		      void *obj)
+{ return 0; }
+int bts_model_l1sap_down(struct gsm_bts_trx *trx, struct osmo_phsap_prim *l1sap)
+{ return 0; }
+
+uint32_t trx_get_hlayer1(const struct gsm_bts_trx *trx)
+{ return 0; }
+
+int bts_model_oml_estab(struct gsm_bts *bts)
+{ return 0; }
+
+int bts_model_change_power(struct gsm_bts_trx *trx, int p_trxout_mdBm)
+{ return 0; }
+
+int l1if_set_txpower(struct femtol1_hdl *fl1h, float tx_power)
+{ return 0; }
+
+int bts_model_lchan_deactivate(struct gsm_lchan *lchan) { return 0; }
+int bts_model_lchan_deactivate_sacch(struct gsm_lchan *lchan) { return 0; }
+
+int bts_model_adjst_ms_pwr(struct gsm_lchan *lchan)
+{ return 0; }
+
+void bts_model_abis_close(struct gsm_bts *bts)
+{ }
+
+int bts_model_ts_disconnect(struct gsm_bts_trx_ts *ts)
+{ return 0; }
+
+void bts_model_ts_connect(struct gsm_bts_trx_ts *ts,
+			 enum gsm_phys_chan_config as_pchan)
+{ return; }
+
+void bts_model_phy_link_set_defaults(struct phy_link *plink)
+{ return; }
+
+void bts_model_phy_instance_set_defaults(struct phy_instance *pinst)
+{ return; }
+
+/* trx_if.c talks to the scheduler, which is not needed here */
+int trx_sched_clock(struct gsm_bts *bts, uint32_t fn)
+{ return 0; }
+int trx_sched_clock_stopped(struct gsm_bts *bts)
+{ return 0; }
+void (*trxc_stub_burst_ind_cb)(const struct trx_ul_burst_ind *bi);
+int trx_sched_route_burst_ind(const struct gsm_bts_trx *trx, struct trx_ul_burst_ind *bi)
+{
+	if (trxc_stub_burst_ind_cb != NULL)
+		trxc_stub_burst_ind_cb(bi);
+	return 0;
+}
+void trx_sched_init(struct gsm_bts_trx *trx)
+{ }
+void trx_sched_clean(struct gsm_bts_trx *trx)
+{ }
+
+static void stub_prov_action(struct osmo_fsm_inst *fi, uint32_t event, void *data)
+{
+}
+
+static const struct osmo_fsm_state stub_prov_fsm_states[] = {
+	[0] = {
+		.name = "STUB",
+		.in_event_mask = (1 << TRX_PROV_EV_OPEN),
+		.action = stub_prov_action,
+	},
+};
+
+struct osmo_fsm trxc_stub_prov_fsm = {
+	.name = "STUB_PROV",
+	.states = stub_prov_fsm_states,
+	.num_states = ARRAY_SIZE(stub_prov_fsm_states),
+	.log_subsys = DTRX,
+};
+
+/*! Bind a UDP socket to an ephemeral port on the loopback, so that tests
+ *  running in parallel do not collide.
+ *  \param[out] port the port the socket is bound to.
+ *  \returns the socket; negative on error. */
+int trxc_stub_udp_bind(uint16_t *port)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+		.sin_port = 0,
+	};
+	socklen_t addr_len = sizeof(addr);
+	int fd;
+
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0)
+		return -1;
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+	    getsockname(fd, (struct sockaddr *) &addr, &addr_len) != 0) {
+		close(fd);
+		return -1;
+	}
+
+	*port = ntohs(addr.sin_port);
+	return fd;
+}
+
+/*! Open the PHY link of a single phy_instance on local ports picked by
+ *  the kernel.  The clock, TRXC and TRXD sockets need three consecutive
+ *  ports: start from a free ephemeral one, and retry if one of the next
+ *  two is taken. */
+int trxc_stub_phy_link_open(struct phy_link *plink)
+{
+	struct phy_instance *pinst = phy_instance_by_num(plink, 0);
+	struct trx_l1h *l1h = pinst->u.osmotrx.hdl;
+	unsigned int i;
+	uint16_t port;
+	int fd;
+
+	for (i = 0; i < 16; i++) {
+		fd = trxc_stub_udp_bind(&port);
+		if (fd < 0)
+			return -1;
+		close(fd);
+		if (port > UINT16_MAX - 2)
+			continue;
+
+		plink->u.osmotrx.base_port_local = port;
+		if (bts_model_phy_link_open(plink) == 0)
+			return 0;
+		/* dropped by the cleanup of bts_model_phy_link_open() */
+		pinst->u.osmotrx.hdl = l1h;
+	}
+
+	return -1;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+/* Stand-ins for what trx_if.c needs from the rest of osmo-bts-trx */
+
+#include <stdint.h>
+
+#include <osmocom/core/fsm.h>
+
+struct phy_link;
+struct trx_ul_burst_ind;
+
+/* Provisioning FSM doing nothing: the commands are sent by the caller */
+extern struct osmo_fsm trxc_stub_prov_fsm;
+
+/* Uplink bursts parsed by trx_if.c are passed here, if set */
+extern void (*trxc_stub_burst_ind_cb)(const struct trx_ul_burst_ind *bi);
+
+int trxc_stub_udp_bind(uint16_t *port);
+int trxc_stub_phy_link_open(struct phy_link *plink);
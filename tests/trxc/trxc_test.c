@@ -0,0 +1,215 @@
+/* Matching of TRXC responses to the commands in flight, against a fake
+ * transceiver driven step by step. */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/fsm.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/phy_link.h>
+
+#include "l1_if.h"
+#include "trx_if.h"
+#include "trxc_stubs.h"
+
+static struct phy_link *plink;
+static struct trx_l1h *l1h;
+
+/* The fake transceiver: its TRXC socket, and where the commands come from */
+static int fake_fd;
+static struct sockaddr_in bts_addr;
+
+static uint16_t fake_trx_open(void)
+{
+	uint16_t port;
+
+	fake_fd = trxc_stub_udp_bind(&port);
+	OSMO_ASSERT(fake_fd >= 0);
+
+	return port;
+}
+
+/* Print the commands the BTS sent since the last call */
+static void fake_trx_recv(void)
+{
+	socklen_t addr_len = sizeof(bts_addr);
+	char buf[TRXC_MSG_BUF_SIZE];
+	ssize_t len;
+
+	while ((len = recvfrom(fake_fd, buf, sizeof(buf) - 1, MSG_DONTWAIT,
+			       (struct sockaddr *) &bts_addr, &addr_len)) > 0) {
+		buf[len] = '\0';
+		printf("  TRX <- '%s'\n", buf);
+	}
+}
+
+static void print_queue(void)
+{
+	const struct trx_ctrl_msg *tcm;
+
+	printf("  %u in flight\n", l1h->trx_ctrl_in_flight);
+	llist_for_each_entry(tcm, &l1h->trx_ctrl_list, list) {
+		printf("    CMD %s%s%s (%s)\n", tcm->cmd, tcm->params_len ? " " : "",
+		       tcm->params, tcm->in_flight ? "in flight" : "queued");
+	}
+}
+
+/* Send a response to the BTS, and let it process it */
+static void fake_trx_send(const char *rsp)
+{
+	printf("  TRX -> '%s'\n", rsp);
+	OSMO_ASSERT(sendto(fake_fd, rsp, strlen(rsp) + 1, 0,
+			   (struct sockaddr *) &bts_addr, sizeof(bts_addr)) > 0);
+	osmo_select_main(0);
+
+	fake_trx_recv();
+	print_queue();
+}
+
+static void generic_cb(struct trx_l1h *l1h, int rc)
+{
+	printf("  callback: rc=%d\n", rc);
+}
+
+static void queue_cmd(int critical, const char *cmd, const char *params)
+{
+	OSMO_ASSERT(trx_ctrl_cmd_cb(l1h, critical, generic_cb, cmd, "%s", params) == 0);
+}
+
+static void setup_phy(uint16_t trxc_port)
+{
+	struct phy_instance *pinst;
+
+	OSMO_ASSERT(osmo_fsm_register(&trxc_stub_prov_fsm) == 0);
+
+	plink = phy_link_create(tall_bts_ctx, 0);
+	OSMO_ASSERT(plink != NULL);
+	plink->type = PHY_LINK_T_OSMOTRX;
+	plink->u.osmotrx.local_ip = talloc_strdup(plink, "127.0.0.1");
+	plink->u.osmotrx.remote_ip = talloc_strdup(plink, "127.0.0.1");
+	/* TRXC port of the transceiver, see compute_port() */
+	plink->u.osmotrx.base_port_remote = trxc_port - 1;
+	plink->u.osmotrx.trxc_window = 4;
+
+	pinst = phy_instance_create(plink, 0);
+	OSMO_ASSERT(pinst != NULL);
+
+	l1h = talloc_zero(tall_bts_ctx, struct trx_l1h);
+	l1h->phy_inst = pinst;
+	l1h->provision_fi = osmo_fsm_inst_alloc(&trxc_stub_prov_fsm, l1h, l1h, LOGL_INFO, NULL);
+	l1h->config.trxd_pdu_ver_req = TRX_DATA_PDU_VER;
+	trx_if_init(l1h);
+	pinst->u.osmotrx.hdl = l1h;
+
+	OSMO_ASSERT(trxc_stub_phy_link_open(plink) == 0);
+}
+
+/* Responses in any order are matched to their commands by verb */
+static void test_window(void)
+{
+	printf("%s(): window %u\n", __func__, plink->u.osmotrx.trxc_window);
+
+	queue_cmd(1, "RXTUNE", "1710200");
+	queue_cmd(1, "SETTSC", "7");
+	queue_cmd(1, "SETBSIC", "63");
+	queue_cmd(0, "SETRXGAIN", "40");
+	queue_cmd(0, "SETMAXDLY", "63");
+	fake_trx_recv();
+	print_queue();
+
+	fake_trx_send("RSP SETBSIC 0 63");
+	fake_trx_send("RSP RXTUNE 0 1710200");
+	fake_trx_send("RSP SETMAXDLY 0 63");
+	fake_trx_send("RSP SETTSC 0 7");
+	fake_trx_send("RSP SETRXGAIN 0 40");
+}
+
+/* Responses to retransmissions of acknowledged commands are discarded */
+static void test_dup(void)
+{
+	printf("%s()\n", __func__);
+
+	fake_trx_send("RSP SETTSC 0 7");
+	/* not kept anymore: only as many as the window allows */
+	fake_trx_send("RSP SETBSIC 0 63");
+}
+
+/* A response matching none of several commands in flight is dropped,
+ * rather than blamed on the oldest of them */
+static void test_unmatched(void)
+{
+	printf("%s()\n", __func__);
+
+	queue_cmd(1, "SETTSC", "5");
+	queue_cmd(0, "SETRXGAIN", "30");
+	fake_trx_recv();
+	print_queue();
+
+	fake_trx_send("RSP ERR 1");
+	fake_trx_send("RSP SETRXGAIN 0 30");
+	fake_trx_send("RSP SETTSC 0 5");
+}
+
+/* SETFORMAT is sent alone, so that 'RSP ERR 1' can be matched to it */
+static void test_setformat(void)
+{
+	printf("%s()\n", __func__);
+
+	queue_cmd(0, "SETRXGAIN", "20");
+	OSMO_ASSERT(trx_if_cmd_setformat(l1h, 1, generic_cb) == 0);
+	queue_cmd(0, "SETMAXDLY", "32");
+	fake_trx_recv();
+	print_queue();
+
+	fake_trx_send("RSP SETRXGAIN 0 20");
+	fake_trx_send("RSP ERR 1");
+	fake_trx_send("RSP SETMAXDLY 0 32");
+}
+
+int main(int argc, char **argv)
+{
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+
+	setup_phy(fake_trx_open());
+
+	test_window();
+	test_dup();
+	test_unmatched();
+	test_setformat();
+
+	printf("Success\n");
+
+	return 0;
+}
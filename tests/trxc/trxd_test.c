@@ -0,0 +1,319 @@
+/* TRXD over UDP and over the shared memory rings, between trx_if.c and
+ * a fake transceiver. */
+
+/* (C) 2026 by sysmocom - s.f.m.c. GmbH <info@sysmocom.de>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/fsm.h>
+#include <osmocom/core/bits.h>
+#include <osmocom/core/utils.h>
+
+#include <osmo-bts/bts.h>
+#include <osmo-bts/logging.h>
+#include <osmo-bts/phy_link.h>
+#include <osmo-bts/scheduler.h>
+#include <osmo-bts/shm_ring.h>
+
+#include "l1_if.h"
+#include "trx_if.h"
+#include "trxc_stubs.h"
+
+#define TRXD_UL_V0HDR_LEN	(1 + 4 + 1 + 2)
+#define TRXD_UL_PDU_LEN		(TRXD_UL_V0HDR_LEN + GSM_BURST_LEN)
+#define TRXD_DL_V0HDR_LEN	(1 + 4 + 1)
+
+#define TEST_SHM_PATH		"trxd_test.sock"
+
+static struct phy_link *plink;
+static struct trx_l1h *l1h;
+
+/* The PHY link using the shared memory rings, and its unix socket */
+static struct phy_link *shm_plink;
+static struct trx_l1h *shm_l1h;
+static char shm_path[108];
+
+/* The TRXD socket of the fake transceiver, and where the BTS listens */
+static int fake_fd;
+static struct sockaddr_in bts_addr;
+
+/* Uplink bursts received by the scheduler */
+static unsigned int num_bursts;
+
+static void burst_ind_cb(const struct trx_ul_burst_ind *bi)
+{
+	/* the fake transceiver sends one burst per timeslot, in order */
+	OSMO_ASSERT(bi->tn == num_bursts % 8);
+	OSMO_ASSERT(bi->fn == num_bursts / 8);
+	num_bursts++;
+}
+
+static uint16_t fake_trx_open(void)
+{
+	uint16_t port;
+
+	fake_fd = trxc_stub_udp_bind(&port);
+	OSMO_ASSERT(fake_fd >= 0);
+
+	return port;
+}
+
+/* Encode the TRXDv0 Uplink PDU number seq of a sequence */
+static void fake_trx_ul_pdu(uint8_t *buf, unsigned int seq)
+{
+	memset(buf, 0x00, TRXD_UL_PDU_LEN);
+	buf[0] = seq % 8; /* TN */
+	osmo_store32be(seq / 8, &buf[1]); /* FN */
+	buf[5] = 60; /* RSSI */
+	osmo_store16be(0, &buf[6]); /* ToA256 */
+}
+
+/* Send TRXDv0 Uplink PDUs, one per datagram, continuing the sequence */
+static void fake_trx_send_ul(unsigned int num)
+{
+	static unsigned int seq;
+	uint8_t buf[TRXD_UL_PDU_LEN];
+	unsigned int i;
+
+	for (i = 0; i < num; i++, seq++) {
+		fake_trx_ul_pdu(buf, seq);
+		OSMO_ASSERT(sendto(fake_fd, buf, sizeof(buf), 0, (struct sockaddr *) &bts_addr,
+				   sizeof(bts_addr)) == sizeof(buf));
+	}
+}
+
+static struct trx_l1h *setup_phy(struct phy_link **plink_out, int num, uint16_t trxd_port)
+{
+	struct phy_instance *pinst;
+	struct phy_link *plink;
+	struct trx_l1h *l1h;
+
+	plink = phy_link_create(tall_bts_ctx, num);
+	OSMO_ASSERT(plink != NULL);
+	plink->type = PHY_LINK_T_OSMOTRX;
+	plink->u.osmotrx.local_ip = talloc_strdup(plink, "127.0.0.1");
+	plink->u.osmotrx.remote_ip = talloc_strdup(plink, "127.0.0.1");
+	/* TRXD port of the transceiver, see compute_port() */
+	plink->u.osmotrx.base_port_remote = trxd_port - 2;
+
+	pinst = phy_instance_create(plink, 0);
+	OSMO_ASSERT(pinst != NULL);
+
+	l1h = talloc_zero(tall_bts_ctx, struct trx_l1h);
+	l1h->phy_inst = pinst;
+	l1h->provision_fi = osmo_fsm_inst_alloc(&trxc_stub_prov_fsm, l1h, l1h, LOGL_INFO, NULL);
+	trx_if_init(l1h);
+	pinst->u.osmotrx.hdl = l1h;
+
+	*plink_out = plink;
+	return l1h;
+}
+
+static void setup_udp_phy(void)
+{
+	l1h = setup_phy(&plink, 0, fake_trx_open());
+	plink->u.osmotrx.trxd_batch_io = true;
+	OSMO_ASSERT(trxc_stub_phy_link_open(plink) == 0);
+
+	bts_addr = (struct sockaddr_in) {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+		.sin_port = htons(plink->u.osmotrx.base_port_local + 2),
+	};
+}
+
+static void setup_shm_phy(void)
+{
+	/* the number of the PHY link names the rings and the unix socket:
+	 * keep it unique, for tests running in parallel */
+	shm_l1h = setup_phy(&shm_plink, getpid(), fake_trx_open());
+	shm_plink->u.osmotrx.trxd_use_shm = true;
+	shm_plink->u.osmotrx.trxd_shm_path = talloc_strdup(shm_plink, TEST_SHM_PATH);
+	shm_plink->u.osmotrx.powered = true;
+	OSMO_ASSERT(trxc_stub_phy_link_open(shm_plink) == 0);
+
+	snprintf(shm_path, sizeof(shm_path), "%s.%d.%d", TEST_SHM_PATH, shm_plink->num, 0);
+}
+
+/* More datagrams than fit into one recvmmsg() call are read on a single
+ * wakeup, and a drained socket is not an error */
+static void test_batch_read(void)
+{
+	struct osmo_fd *ofd = &l1h->trx_ofd_data;
+	int rc;
+
+	printf("%s()\n", __func__);
+
+	fake_trx_send_ul(TRXD_MMSG_MAX + 4);
+	osmo_select_main(0);
+	printf("  %u bursts received on one wakeup\n", num_bursts);
+
+	/* e.g. woken up for a datagram that was read by the loop already */
+	rc = ofd->cb(ofd, OSMO_FD_READ);
+	printf("  nothing pending: rc=%d, %u bursts received\n", rc, num_bursts);
+}
+
+/* A datagram exceeding the Rx buffer is dropped, without affecting the others */
+static void test_oversize(void)
+{
+	uint8_t buf[TRXD_MMSG_BUF_SIZE + 1] = { 0 };
+
+	printf("%s()\n", __func__);
+
+	OSMO_ASSERT(sendto(fake_fd, buf, sizeof(buf), 0, (struct sockaddr *) &bts_addr,
+			   sizeof(bts_addr)) == sizeof(buf));
+	fake_trx_send_ul(1);
+	osmo_select_main(0);
+	printf("  %u bursts received\n", num_bursts);
+}
+
+/* A fake transceiver attaching to the TRXD rings of the BTS */
+struct fake_shm_trx {
+	int fd;
+	struct shm_link *link;
+};
+
+static void fake_shm_attach(struct fake_shm_trx *trx)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+	osmo_strlcpy(addr.sun_path, shm_path, sizeof(addr.sun_path));
+	trx->fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	OSMO_ASSERT(trx->fd >= 0);
+	OSMO_ASSERT(connect(trx->fd, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+
+	/* let the BTS accept the connection, and hand over the rings */
+	osmo_select_main(1);
+
+	/* NULL if the BTS closed the connection instead */
+	trx->link = shm_link_recv_fds(tall_bts_ctx, trx->fd);
+}
+
+static void fake_shm_detach(struct fake_shm_trx *trx)
+{
+	shm_link_free(trx->link);
+	trx->link = NULL;
+	close(trx->fd);
+	trx->fd = -1;
+
+	/* let the BTS notice */
+	osmo_select_main(1);
+}
+
+static int send_dl_burst(uint32_t fn, uint8_t tn)
+{
+	struct trx_dl_burst_req br = {
+		.fn = fn,
+		.tn = tn,
+		.mod = TRX_MOD_T_GMSK,
+		.burst_len = GSM_BURST_LEN,
+	};
+
+	trx_if_tx_begin(shm_l1h);
+	OSMO_ASSERT(trx_if_tx_append(shm_l1h, &br) == 0);
+	OSMO_ASSERT(trx_if_tx_finish(shm_l1h) == 1);
+	return trx_if_tx_send(shm_l1h);
+}
+
+/* TRXD over the rings, with one transceiver attached at a time */
+static void test_shm(void)
+{
+	struct fake_shm_trx trx, other;
+	uint8_t buf[TRXD_MMSG_BUF_SIZE];
+	unsigned int i;
+	int rc;
+
+	printf("%s()\n", __func__);
+
+	fake_shm_attach(&trx);
+	printf("  transceiver attached: %s\n", trx.link ? "yes" : "no");
+	OSMO_ASSERT(trx.link != NULL);
+
+	/* the rings have a single producer and a single consumer */
+	fake_shm_attach(&other);
+	printf("  second transceiver attached: %s\n", other.link ? "yes" : "no");
+	fake_shm_detach(&other);
+
+	num_bursts = 0;
+	for (i = 0; i < 20; i++) {
+		fake_trx_ul_pdu(buf, i);
+		OSMO_ASSERT(shm_link_push(trx.link, buf, TRXD_UL_PDU_LEN) == 0);
+	}
+	osmo_select_main(1);
+	printf("  %u Uplink bursts received\n", num_bursts);
+
+	rc = send_dl_burst(42, 3);
+	printf("  Downlink burst sent: rc=%d\n", rc);
+	rc = shm_link_pop(trx.link, buf, sizeof(buf));
+	OSMO_ASSERT(rc == TRXD_DL_V0HDR_LEN + GSM_BURST_LEN);
+	printf("  transceiver got %d bytes: tn=%u fn=%u\n", rc, buf[0] & 0x07, osmo_load32be(&buf[1]));
+
+	/* go away, leaving a record behind */
+	OSMO_ASSERT(send_dl_burst(43, 3) == 0);
+	fake_shm_detach(&trx);
+	rc = send_dl_burst(44, 3);
+	printf("  Downlink burst sent without transceiver: rc=%d (%s)\n",
+	       rc, rc == -ENOTCONN ? "ENOTCONN" : "unexpected");
+
+	/* the next one starts with empty rings */
+	fake_shm_attach(&trx);
+	printf("  transceiver attached again: %s, rings %s\n", trx.link ? "yes" : "no",
+	       trx.link && shm_link_rx_empty(trx.link) && shm_link_rx_empty(shm_l1h->trxd_shm) ?
+	       "empty" : "not empty");
+	fake_shm_detach(&trx);
+}
+
+int main(int argc, char **argv)
+{
+	tall_bts_ctx = talloc_named_const(NULL, 1, "OsmoBTS context");
+	msgb_talloc_ctx_init(tall_bts_ctx, 0);
+
+	osmo_init_logging2(tall_bts_ctx, &bts_log_info);
+
+	OSMO_ASSERT(osmo_fsm_register(&trxc_stub_prov_fsm) == 0);
+	trxc_stub_burst_ind_cb = burst_ind_cb;
+
+	setup_udp_phy();
+	test_batch_read();
+	test_oversize();
+
+	setup_shm_phy();
+	test_shm();
+
+	/* unlinks the rings, the unix socket is left behind */
+	trx_if_close(shm_l1h);
+	unlink(shm_path);
+
+	printf("Success\n");
+
+	return 0;
+}